@@ -149,6 +149,9 @@ void ComposerCommandEngine::dispatchDisplayCommand(const DisplayCommand& command
 }
 
 void ComposerCommandEngine::dispatchLayerCommand(int64_t display, const LayerCommand& command) {
+    // Resolve the layer once for all fields. If it fails, every setter reports the error.
+    bool batched = (mHal->beginLayerStates(display, command.layer) == HWC2_ERROR_NONE);
+
     DISPATCH_LAYER_COMMAND(display, command, cursorPosition, CursorPosition);
     DISPATCH_LAYER_COMMAND(display, command, buffer, Buffer);
     DISPATCH_LAYER_COMMAND(display, command, damage, SurfaceDamage);
@@ -169,6 +172,10 @@ void ComposerCommandEngine::dispatchLayerCommand(int64_t display, const LayerCom
     DISPATCH_LAYER_COMMAND(display, command, perFrameMetadataBlob, PerFrameMetadataBlobs);
     DISPATCH_LAYER_COMMAND_SIMPLE(display, command, blockingRegion, BlockingRegion);
     DISPATCH_LAYER_COMMAND(display, command, bufferSlotsToClear, BufferSlotsToClear);
+
+    if (batched) {
+        mHal->endLayerStates();
+    }
 }
 
 int32_t ComposerCommandEngine::executeValidateDisplayInternal(int64_t display) {
@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Drives ComposerCommandEngine::execute with frames of batched SET_LAYER_* commands against a
+// fake HAL. The fake resolves layers like HalImpl does, through LayerIdMap and
+// ExynosLayerSlotMap, and stores the state instead of forwarding it to ExynosLayer, so the
+// benchmark measures the command dispatch and the per-command layer lookup.
+// BM_MapAndScan replays the lookup HalImpl used before ExynosLayerSlotMap: a std::map from the
+// client id to the layer, then a scan of the layers of the display (ExynosDisplay::checkLayer).
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ComposerCommandEngine.h"
+#include "ExynosLayerSlotMap.h"
+#include "Util.h"
+#include "impl/LayerIdMap.h"
+#include "impl/ResourceManager.h"
+
+// The state a frame of commands updates
+class ExynosLayer {
+  public:
+    void beginStateUpdate() { ++mStateUpdates; }
+    void endStateUpdate() {}
+
+    uint64_t mSlotHandle = ExynosLayerSlotMap::kInvalidHandle;
+    int64_t mStateUpdates = 0;
+    aidl::android::hardware::graphics::common::Rect mDisplayFrame;
+    aidl::android::hardware::graphics::common::FRect mSourceCrop;
+    std::vector<std::optional<aidl::android::hardware::graphics::common::Rect>> mDamage;
+    float mPlaneAlpha = 1.f;
+    uint32_t mZ = 0;
+};
+
+namespace aidl::android::hardware::graphics::composer3::impl {
+namespace {
+
+constexpr int64_t kDisplay = 0;
+
+enum class Lookup {
+    kSlotHandle, // ids returned by createLayer()
+    kBatchedId,  // ids chosen by the client through LayerLifecycleBatchCommand
+    kMapAndScan, // the lookup before ExynosLayerSlotMap
+};
+
+class FakeHal : public IComposerHal {
+  public:
+    explicit FakeHal(Lookup lookup) : mLookup(lookup) {}
+
+    int32_t createLayer(int64_t display, int64_t* outLayer) override {
+        if (display != kDisplay) return HWC2_ERROR_BAD_DISPLAY;
+        ExynosLayer* layer = addLayer();
+        *outLayer = (mLookup == Lookup::kMapAndScan) ? mNextMappedId++
+                                                     : static_cast<int64_t>(layer->mSlotHandle);
+        mSfLayerToHalLayerMap[*outLayer] = reinterpret_cast<uint64_t>(layer);
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t batchedCreateDestroyLayer(int64_t display, int64_t layer,
+                                      LayerLifecycleBatchCommandType cmd) override {
+        if (display != kDisplay) return HWC2_ERROR_BAD_DISPLAY;
+        if (cmd != LayerLifecycleBatchCommandType::CREATE) return HWC2_ERROR_UNSUPPORTED;
+        if (mSlots.find(static_cast<uint64_t>(layer)) || mLayerIds.hasBatchedId(layer)) {
+            return HWC2_ERROR_BAD_LAYER;
+        }
+        mLayerIds.addBatchedId(layer, addLayer()->mSlotHandle);
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t layerSf2Hwc(int64_t display, int64_t layer, hwc2_layer_t& outMappedLayer) override {
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+        outMappedLayer = reinterpret_cast<hwc2_layer_t>(halLayer);
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t beginLayerStates(int64_t display, int64_t layer) override {
+        endLayerStates();
+
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+
+        halLayer->beginStateUpdate();
+        mLayerStates = {display, layer, halLayer};
+        return HWC2_ERROR_NONE;
+    }
+
+    void endLayerStates() override {
+        if (!mLayerStates.halLayer) return;
+
+        mLayerStates.halLayer->endStateUpdate();
+        mLayerStates.halLayer = nullptr;
+    }
+
+    int32_t setLayerDisplayFrame(int64_t display, int64_t layer,
+                                 const common::Rect& frame) override {
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+        halLayer->mDisplayFrame = frame;
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t setLayerPlaneAlpha(int64_t display, int64_t layer, float alpha) override {
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+        halLayer->mPlaneAlpha = alpha;
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t setLayerSourceCrop(int64_t display, int64_t layer,
+                               const common::FRect& crop) override {
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+        halLayer->mSourceCrop = crop;
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t setLayerSurfaceDamage(int64_t display, int64_t layer,
+                                  const std::vector<std::optional<common::Rect>>& damage) override {
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+        halLayer->mDamage = damage;
+        return HWC2_ERROR_NONE;
+    }
+
+    int32_t setLayerZOrder(int64_t display, int64_t layer, uint32_t z) override {
+        ExynosLayer* halLayer;
+        RET_IF_ERR(getHalLayer(display, layer, halLayer));
+        halLayer->mZ = z;
+        return HWC2_ERROR_NONE;
+    }
+
+    const std::vector<std::unique_ptr<ExynosLayer>>& getLayers() const { return mLayers; }
+
+    // Not reached by the benchmarked commands
+    void getCapabilities(std::vector<Capability>*) override {}
+    void dumpDebugInfo(std::string*, const std::vector<std::string>&) override {}
+    bool hasCapability(Capability) override { return false; }
+    void registerEventCallback(EventCallback*) override {}
+    void unregisterEventCallback() override {}
+    int32_t acceptDisplayChanges(int64_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t createVirtualDisplay(uint32_t, uint32_t, AidlPixelFormat, VirtualDisplay*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t destroyLayer(int64_t, int64_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t destroyVirtualDisplay(int64_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t flushDisplayBrightnessChange(int64_t) override { return HWC2_ERROR_NONE; }
+    int32_t getActiveConfig(int64_t, int32_t*) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getColorModes(int64_t, std::vector<ColorMode>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDataspaceSaturationMatrix(common::Dataspace, std::vector<float>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayAttribute(int64_t, int32_t, DisplayAttribute, int32_t*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayBrightnessSupport(int64_t, bool&) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getDisplayIdleTimerSupport(int64_t, bool&) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getDisplayMultiThreadedPresentSupport(const int64_t&, bool&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayCapabilities(int64_t, std::vector<DisplayCapability>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayConfigs(int64_t, std::vector<int32_t>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayConfigurations(int64_t, int32_t,
+                                     std::vector<DisplayConfiguration>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t notifyExpectedPresent(int64_t, const ClockMonotonicTimestamp&, int32_t) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayConnectionType(int64_t, DisplayConnectionType*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayIdentificationData(int64_t, DisplayIdentification*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayName(int64_t, std::string*) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getDisplayVsyncPeriod(int64_t, int32_t*) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getDisplayedContentSample(int64_t, int64_t, int64_t,
+                                      DisplayContentSample*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayedContentSamplingAttributes(int64_t,
+                                                  DisplayContentSamplingAttributes*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDisplayPhysicalOrientation(int64_t, common::Transform*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getDozeSupport(int64_t, bool&) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getHdrCapabilities(int64_t, HdrCapabilities*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getOverlaySupport(OverlayProperties*) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getMaxVirtualDisplayCount(int32_t*) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getPerFrameMetadataKeys(int64_t, std::vector<PerFrameMetadataKey>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getReadbackBufferAttributes(int64_t, ReadbackBufferAttributes*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getReadbackBufferFence(int64_t, ndk::ScopedFileDescriptor*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getRenderIntents(int64_t, ColorMode, std::vector<RenderIntent>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getSupportedContentTypes(int64_t, std::vector<ContentType>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t presentDisplay(int64_t, ndk::ScopedFileDescriptor&, std::vector<int64_t>*,
+                           std::vector<ndk::ScopedFileDescriptor>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setActiveConfig(int64_t, int32_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setActiveConfigWithConstraints(int64_t, int32_t, const VsyncPeriodChangeConstraints&,
+                                           VsyncPeriodChangeTimeline*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setBootDisplayConfig(int64_t, int32_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t clearBootDisplayConfig(int64_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getPreferredBootDisplayConfig(int64_t, int32_t*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getHdrConversionCapabilities(std::vector<common::HdrConversionCapability>*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setHdrConversionStrategy(const common::HdrConversionStrategy&,
+                                     common::Hdr*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setAutoLowLatencyMode(int64_t, bool) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setClientTarget(int64_t, buffer_handle_t, const ndk::ScopedFileDescriptor&,
+                            common::Dataspace, const std::vector<common::Rect>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t getHasClientComposition(int64_t, bool&) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setColorMode(int64_t, ColorMode, RenderIntent) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setColorTransform(int64_t, const std::vector<float>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setContentType(int64_t, ContentType) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setDisplayBrightness(int64_t, float) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setDisplayedContentSamplingEnabled(int64_t, bool, FormatColorComponent,
+                                               int64_t) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerBlendMode(int64_t, int64_t, common::BlendMode) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerBuffer(int64_t, int64_t, buffer_handle_t,
+                           const ndk::ScopedFileDescriptor&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t uncacheLayerBuffers(int64_t, int64_t, const std::vector<buffer_handle_t>&,
+                                std::vector<buffer_handle_t>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerColor(int64_t, int64_t, Color) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setLayerColorTransform(int64_t, int64_t, const std::vector<float>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerCompositionType(int64_t, int64_t, Composition) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerCursorPosition(int64_t, int64_t, int32_t, int32_t) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerDataspace(int64_t, int64_t, common::Dataspace) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerPerFrameMetadata(int64_t, int64_t,
+                                     const std::vector<std::optional<PerFrameMetadata>>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerPerFrameMetadataBlobs(
+            int64_t, int64_t, const std::vector<std::optional<PerFrameMetadataBlob>>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerSidebandStream(int64_t, int64_t, buffer_handle_t) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerTransform(int64_t, int64_t, common::Transform) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerVisibleRegion(int64_t, int64_t,
+                                  const std::vector<std::optional<common::Rect>>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setLayerBrightness(int64_t, int64_t, float) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setOutputBuffer(int64_t, buffer_handle_t, const ndk::ScopedFileDescriptor&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setPowerMode(int64_t, PowerMode) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getPowerMode(int64_t, std::optional<PowerMode>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setReadbackBuffer(int64_t, buffer_handle_t, const ndk::ScopedFileDescriptor&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setVsyncEnabled(int64_t, bool) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t validateDisplay(int64_t, std::vector<int64_t>*, std::vector<Composition>*, uint32_t*,
+                            std::vector<int64_t>*, std::vector<int32_t>*, ClientTargetProperty*,
+                            DimmingStage*) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setExpectedPresentTime(int64_t, const std::optional<ClockMonotonicTimestamp>,
+                                   int) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setIdleTimerEnabled(int64_t, int32_t) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t getRCDLayerSupport(int64_t, bool&) override { return HWC2_ERROR_UNSUPPORTED; }
+    int32_t setLayerBlockingRegion(int64_t, int64_t,
+                                   const std::vector<std::optional<common::Rect>>&) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    int32_t setRefreshRateChangedCallbackDebugEnabled(int64_t, bool) override {
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+
+  private:
+    ExynosLayer* addLayer() {
+        auto layer = std::make_unique<ExynosLayer>();
+        layer->mSlotHandle = mSlots.insert(layer.get());
+        mLayers.push_back(std::move(layer));
+        return mLayers.back().get();
+    }
+
+    // HalImpl::getHalLayer, or its lookup before ExynosLayerSlotMap for Lookup::kMapAndScan
+    int32_t getHalLayer(int64_t display, int64_t layer, ExynosLayer*& halLayer) {
+        if (mLayerStates.halLayer && mLayerStates.layer == layer &&
+            mLayerStates.display == display) {
+            halLayer = mLayerStates.halLayer;
+            return HWC2_ERROR_NONE;
+        }
+        if (display != kDisplay) return HWC2_ERROR_BAD_DISPLAY;
+
+        if (mLookup == Lookup::kMapAndScan) {
+            auto iter = mSfLayerToHalLayerMap.find(layer);
+            halLayer = (iter != mSfLayerToHalLayerMap.end()) ? checkLayer(iter->second) : nullptr;
+        } else {
+            halLayer = mSlots.find(mLayerIds.getSlotHandle(layer));
+        }
+        if (!halLayer) { [[unlikely]]
+            return HWC2_ERROR_BAD_LAYER;
+        }
+        return HWC2_ERROR_NONE;
+    }
+
+    // ExynosDisplay::checkLayer
+    ExynosLayer* checkLayer(uint64_t addr) const {
+        for (auto& layer : mLayers) {
+            if (reinterpret_cast<uint64_t>(layer.get()) == addr) return layer.get();
+        }
+        return nullptr;
+    }
+
+    const Lookup mLookup;
+    std::vector<std::unique_ptr<ExynosLayer>> mLayers;
+    ExynosLayerSlotMap mSlots;
+    LayerIdMap mLayerIds;
+    std::map<int64_t, uint64_t> mSfLayerToHalLayerMap;
+    int64_t mNextMappedId = 1;
+
+    struct {
+        int64_t display;
+        int64_t layer;
+        ExynosLayer* halLayer = nullptr;
+    } mLayerStates;
+};
+
+// A client frame: every layer gets its geometry and damage, in a shuffled order
+DisplayCommand buildFrame(std::vector<int64_t> layers) {
+    std::shuffle(layers.begin(), layers.end(), std::mt19937(0));
+    DisplayCommand command;
+    command.display = kDisplay;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        LayerCommand layerCommand;
+        layerCommand.layer = layers[i];
+        int32_t offset = static_cast<int32_t>(i);
+        layerCommand.displayFrame = common::Rect{offset, offset, offset + 100, offset + 100};
+        layerCommand.sourceCrop = common::FRect{0.f, 0.f, 100.f, 100.f};
+        layerCommand.damage = std::vector<std::optional<common::Rect>>{
+                common::Rect{offset, offset, offset + 10, offset + 10}};
+        layerCommand.planeAlpha = PlaneAlpha{0.5f};
+        layerCommand.z = ZOrder{offset};
+        command.layers.push_back(std::move(layerCommand));
+    }
+    return command;
+}
+
+void runFrames(benchmark::State& state, Lookup lookup) {
+    const int numLayers = state.range(0);
+    FakeHal hal(lookup);
+    ResourceManager resources;
+    resources.addPhysicalDisplay(kDisplay);
+    ComposerCommandEngine engine(&hal, &resources);
+    engine.init();
+
+    std::vector<CommandResultPayload> results;
+    std::vector<int64_t> layers;
+    if (lookup == Lookup::kBatchedId) {
+        DisplayCommand create;
+        create.display = kDisplay;
+        for (int i = 0; i < numLayers; ++i) {
+            LayerCommand layerCommand;
+            layerCommand.layer = 1000 + i;
+            layerCommand.layerLifecycleBatchCommandType = LayerLifecycleBatchCommandType::CREATE;
+            layerCommand.newBufferSlotCount = 1;
+            layers.push_back(layerCommand.layer);
+            create.layers.push_back(std::move(layerCommand));
+        }
+        engine.execute({create}, &results);
+    } else {
+        for (int i = 0; i < numLayers; ++i) {
+            int64_t layer;
+            hal.createLayer(kDisplay, &layer);
+            resources.addLayer(kDisplay, layer, 1);
+            layers.push_back(layer);
+        }
+    }
+    const std::vector<DisplayCommand> frame = {buildFrame(layers)};
+
+    for (auto _ : state) {
+        engine.execute(frame, &results);
+        benchmark::DoNotOptimize(results);
+    }
+
+    for (const auto& layer : hal.getLayers()) {
+        if (layer->mStateUpdates != state.iterations()) {
+            state.SkipWithError("a layer command was not applied");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numLayers);
+}
+
+void BM_SlotHandle(benchmark::State& state) {
+    runFrames(state, Lookup::kSlotHandle);
+}
+
+void BM_BatchedId(benchmark::State& state) {
+    runFrames(state, Lookup::kBatchedId);
+}
+
+void BM_MapAndScan(benchmark::State& state) {
+    runFrames(state, Lookup::kMapAndScan);
+}
+
+BENCHMARK(BM_SlotHandle)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_BatchedId)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_MapAndScan)->Arg(4)->Arg(16)->Arg(64);
+
+} // namespace
+} // namespace aidl::android::hardware::graphics::composer3::impl
+
+BENCHMARK_MAIN();
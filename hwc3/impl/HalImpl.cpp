@@ -192,12 +192,16 @@ int32_t HalImpl::getHalDisplay(int64_t display, ExynosDisplay*& halDisplay) {
 }
 
 int32_t HalImpl::getHalLayer(int64_t display, int64_t layer, ExynosLayer*& halLayer) {
+    if (mLayerStates.halLayer && mLayerStates.layer == layer &&
+        mLayerStates.display == display) {
+        halLayer = mLayerStates.halLayer;
+        return HWC2_ERROR_NONE;
+    }
+
     ExynosDisplay* halDisplay;
     RET_IF_ERR(getHalDisplay(display, halDisplay));
 
-    hwc2_layer_t mapped_layer;
-    RET_IF_ERR(layerSf2Hwc(display, layer, mapped_layer));
-    halLayer = halDisplay->checkLayer(mapped_layer);
+    halLayer = halDisplay->getLayerBySlot(mLayerIds.getSlotHandle(layer));
     if (!halLayer) { [[unlikely]]
         return HWC2_ERROR_BAD_LAYER;
     }
@@ -206,16 +210,30 @@ int32_t HalImpl::getHalLayer(int64_t display, int64_t layer, ExynosLayer*& halLa
 }
 
 int32_t HalImpl::layerSf2Hwc(int64_t display, int64_t layer, hwc2_layer_t& outMappedLayer) {
-    ExynosDisplay* halDisplay;
-    RET_IF_ERR(getHalDisplay(display, halDisplay));
-    auto iter = mSfLayerToHalLayerMap.find(layer);
-    if (iter == mSfLayerToHalLayerMap.end()) {
-        return HWC2_ERROR_BAD_LAYER;
-    }
-    outMappedLayer = iter->second;
+    ExynosLayer* halLayer;
+    RET_IF_ERR(getHalLayer(display, layer, halLayer));
+    outMappedLayer = reinterpret_cast<hwc2_layer_t>(halLayer);
     return HWC2_ERROR_NONE;
 }
 
+int32_t HalImpl::beginLayerStates(int64_t display, int64_t layer) {
+    endLayerStates();
+
+    ExynosLayer* halLayer;
+    RET_IF_ERR(getHalLayer(display, layer, halLayer));
+
+    halLayer->beginStateUpdate();
+    mLayerStates = {display, layer, halLayer};
+    return HWC2_ERROR_NONE;
+}
+
+void HalImpl::endLayerStates() {
+    if (!mLayerStates.halLayer) return;
+
+    mLayerStates.halLayer->endStateUpdate();
+    mLayerStates.halLayer = nullptr;
+}
+
 bool HalImpl::hasCapability(Capability cap) {
     return mCaps.find(cap) != mCaps.end();
 }
@@ -297,10 +315,8 @@ int32_t HalImpl::createLayer(int64_t display, int64_t* outLayer) {
     hwc2_layer_t hwcLayer = 0;
     RET_IF_ERR(halDisplay->createLayer(&hwcLayer));
 
-    h2a::translate(hwcLayer, *outLayer);
-    // Adding this to stay backward compatible with new batching command,
-    // if HWC supports batching, and create does not.
-    mSfLayerToHalLayerMap[*outLayer] = hwcLayer;
+    // The slot handle is handed out as the layer id, so it resolves without any map
+    *outLayer = static_cast<int64_t>(reinterpret_cast<ExynosLayer*>(hwcLayer)->mSlotHandle);
     mHalLayerToSfLayerMap[hwcLayer] = *outLayer;
     return HWC2_ERROR_NONE;
 }
@@ -311,31 +327,28 @@ int32_t HalImpl::batchedCreateDestroyLayer(int64_t display, int64_t layer,
     ExynosDisplay* halDisplay;
     RET_IF_ERR(getHalDisplay(display, halDisplay));
     if (cmd == LayerLifecycleBatchCommandType::CREATE) {
-        if (mSfLayerToHalLayerMap.find(layer) != mSfLayerToHalLayerMap.end()) {
+        // The id must not shadow a layer addressed by its slot handle
+        if (halDisplay->getLayerBySlot(static_cast<uint64_t>(layer)) ||
+            mLayerIds.hasBatchedId(layer)) {
             return HWC2_ERROR_BAD_LAYER;
         }
         hwc2_layer_t hwcLayer = 0;
         RET_IF_ERR(halDisplay->createLayer(&hwcLayer));
-        int64_t hwclayerAidl;
-        h2a::translate(hwcLayer, hwclayerAidl);
-        mSfLayerToHalLayerMap[layer] = hwclayerAidl;
+        mLayerIds.addBatchedId(layer, reinterpret_cast<ExynosLayer*>(hwcLayer)->mSlotHandle);
 
         mHalLayerToSfLayerMap[hwcLayer] = layer;
     } else if (cmd == LayerLifecycleBatchCommandType::DESTROY) {
-        int64_t HalLayerAidl;
         ExynosLayer* halLayer;
-        auto iter = mSfLayerToHalLayerMap.find(layer);
-        if (iter == mSfLayerToHalLayerMap.end()) {
+        if (!mLayerIds.hasBatchedId(layer)) {
             return HWC2_ERROR_BAD_LAYER;
         }
-        HalLayerAidl = iter->second;
 
         RET_IF_ERR(getHalLayer(display, layer, halLayer));
         err = halDisplay->destroyLayer(reinterpret_cast<hwc2_layer_t>(halLayer));
         if (err != HWC2_ERROR_NONE) {
             ALOGW("HalImpl: destroyLayer failed with error: %u", err);
         }
-        mSfLayerToHalLayerMap.erase(iter);
+        mLayerIds.removeBatchedId(layer);
         auto iterator = mHalLayerToSfLayerMap.find(reinterpret_cast<hwc2_layer_t>(halLayer));
         if (iterator == mHalLayerToSfLayerMap.end()) {
             return HWC2_ERROR_BAD_LAYER;
@@ -354,10 +367,7 @@ int32_t HalImpl::destroyLayer(int64_t display, int64_t layer) {
     ExynosLayer *halLayer;
     RET_IF_ERR(getHalLayer(display, layer, halLayer));
     err = halDisplay->destroyLayer(reinterpret_cast<hwc2_layer_t>(halLayer));
-    auto iter = mSfLayerToHalLayerMap.find(layer);
-    if (iter != mSfLayerToHalLayerMap.end()) {
-        mSfLayerToHalLayerMap.erase(iter);
-    }
+    mLayerIds.removeBatchedId(layer);
     auto iterator = mHalLayerToSfLayerMap.find(reinterpret_cast<hwc2_layer_t>(halLayer));
     if (iterator != mHalLayerToSfLayerMap.end()) {
         mHalLayerToSfLayerMap.erase(iterator);
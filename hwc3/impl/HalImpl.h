@@ -18,11 +18,13 @@
 
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <hardware/hwcomposer2.h>
 
 #include "include/IComposerHal.h"
+#include "LayerIdMap.h"
 
 class ExynosDevice;
 class ExynosDisplay;
@@ -185,6 +187,8 @@ class HalImpl : public IComposerHal {
       EventCallback* getEventCallback() { return mEventCallback; }
       int32_t setRefreshRateChangedCallbackDebugEnabled(int64_t display, bool enabled) override;
       int32_t layerSf2Hwc(int64_t display, int64_t layer, hwc2_layer_t& outMappedLayer) override;
+      int32_t beginLayerStates(int64_t display, int64_t layer) override;
+      void endLayerStates() override;
       void setHwcBatchingSupport(bool supported);
 
   private:
@@ -198,8 +202,15 @@ class HalImpl : public IComposerHal {
     std::unique_ptr<ExynosHWCCtx> mHwcCtx;
 #endif
     std::unordered_set<Capability> mCaps;
-    std::map<int64_t, hwc2_layer_t> mSfLayerToHalLayerMap;
+    LayerIdMap mLayerIds;
     std::map<hwc2_layer_t, int64_t> mHalLayerToSfLayerMap;
+
+    // Layer resolved by beginLayerStates
+    struct {
+        int64_t display;
+        int64_t layer;
+        ExynosLayer* halLayer = nullptr;
+    } mLayerStates;
 };
 
 } // namespace aidl::android::hardware::graphics::composer3::impl
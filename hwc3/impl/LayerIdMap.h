@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace aidl::android::hardware::graphics::composer3::impl {
+
+// Translates the layer ids of the client to ExynosLayerSlotMap handles.
+// Layers from createLayer() are addressed by their slot handle directly. Layers created by
+// LayerLifecycleBatchCommand carry an id chosen by the client, which can take any value, so the
+// map of those ids is checked first whenever it is in use.
+class LayerIdMap {
+  public:
+    uint64_t getSlotHandle(int64_t layer) const {
+        if (!mBatchedIds.empty()) {
+            auto iter = mBatchedIds.find(layer);
+            if (iter != mBatchedIds.end()) {
+                return iter->second;
+            }
+        }
+        return static_cast<uint64_t>(layer);
+    }
+
+    bool hasBatchedId(int64_t layer) const { return mBatchedIds.find(layer) != mBatchedIds.end(); }
+
+    void addBatchedId(int64_t layer, uint64_t handle) { mBatchedIds[layer] = handle; }
+
+    void removeBatchedId(int64_t layer) { mBatchedIds.erase(layer); }
+
+  private:
+    std::unordered_map<int64_t, uint64_t> mBatchedIds;
+};
+
+} // namespace aidl::android::hardware::graphics::composer3::impl
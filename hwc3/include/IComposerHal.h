@@ -253,6 +253,10 @@ class IComposerHal {
             const std::vector<std::optional<common::Rect>>& blockingRegion) = 0;
     virtual int32_t setRefreshRateChangedCallbackDebugEnabled(int64_t display, bool enabled) = 0;
     virtual int32_t layerSf2Hwc(int64_t display, int64_t layer, hwc2_layer_t& outMappedLayer) = 0;
+    // setLayer* calls for this layer between begin and end reuse the resolved layer and
+    // report their geometry changes to the display at once in endLayerStates.
+    virtual int32_t beginLayerStates(int64_t display, int64_t layer) = 0;
+    virtual void endLayerStates() = 0;
 };
 
 } // namespace aidl::android::hardware::graphics::composer3::detail
@@ -40,6 +40,11 @@ Acrylic::~Acrylic()
         removeTransitData(layer);
     }
 
+    for (auto layer: mDetachedLayers) {
+        layer->disconnectLayer();
+        removeTransitData(layer);
+    }
+
     ALOGD_TEST("Destroyed Acrylic on %p", this);
 }
 
@@ -68,14 +73,83 @@ void Acrylic::removeLayer(AcrylicLayer *layer)
 {
     auto it = find(std::begin(mLayers), std::end(mLayers), layer);
 
-    if (it == std::end(mLayers)) {
+    if (it != std::end(mLayers)) {
+        removeTransitData(*it);
+        mLayers.erase(it);
+        return;
+    }
+
+    it = find(std::begin(mDetachedLayers), std::end(mDetachedLayers), layer);
+    if (it == std::end(mDetachedLayers)) {
         ALOGE("Deleting an unregistered layer");
     } else {
         removeTransitData(*it);
-        mLayers.erase(it);
+        mDetachedLayers.erase(it);
     }
 }
 
+bool Acrylic::detachLayer(AcrylicLayer *layer)
+{
+    auto it = find(std::begin(mLayers), std::end(mLayers), layer);
+
+    if (it == std::end(mLayers)) {
+        if (find(std::begin(mDetachedLayers), std::end(mDetachedLayers), layer) ==
+                std::end(mDetachedLayers)) {
+            ALOGE("Detaching an unregistered layer");
+            return false;
+        }
+        return true;
+    }
+
+    mLayers.erase(it);
+    mDetachedLayers.push_back(layer);
+
+    return true;
+}
+
+bool Acrylic::attachLayer(AcrylicLayer *layer)
+{
+    auto it = find(std::begin(mDetachedLayers), std::end(mDetachedLayers), layer);
+
+    if (it == std::end(mDetachedLayers)) {
+        if (find(std::begin(mLayers), std::end(mLayers), layer) == std::end(mLayers)) {
+            ALOGE("Attaching an unregistered layer");
+            return false;
+        }
+        return true;
+    }
+
+    if (mLayers.size() >= getCapabilities().maxLayerCount()) {
+        ALOGE("Full of composit layer: current %zu, max %u",
+                mLayers.size() , getCapabilities().maxLayerCount());
+        return false;
+    }
+
+    mDetachedLayers.erase(it);
+    mLayers.push_back(layer);
+
+    return true;
+}
+
+bool Acrylic::adoptLayer(AcrylicLayer *layer)
+{
+    Acrylic *owner = layer->getCompositor();
+
+    if (owner == this)
+        return true;
+
+    if (!owner) {
+        ALOGE("Adopting a layer of a destroyed compositor");
+        return false;
+    }
+
+    owner->removeLayer(layer);
+    layer->mCompositor = this;
+    mDetachedLayers.push_back(layer);
+
+    return true;
+}
+
 int Acrylic::prioritize(int priority)
 {
     if ((priority < -1) || (priority > 15)) {
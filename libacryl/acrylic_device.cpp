@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 
 #include <log/log.h>
@@ -26,6 +27,39 @@
 #include "acrylic_internal.h"
 #include "acrylic_device.h"
 
+bool wait_fence(int fence, int timeout_msec)
+{
+    if (fence < 0)
+        return true;
+
+    struct pollfd fds;
+    fds.fd = fence;
+    fds.events = POLLIN;
+
+    int ret;
+    do {
+        ret = ::poll(&fds, 1, timeout_msec);
+    } while ((ret < 0) && ((errno == EINTR) || (errno == EAGAIN)));
+
+    if (ret < 0) {
+        ALOGERR("Failed to wait for fence %d", fence);
+        return false;
+    }
+
+    if (ret == 0) {
+        // Zero timeout just probes the fence
+        ALOGE_IF(timeout_msec != 0, "Timed out waiting for fence %d for %d msec", fence, timeout_msec);
+        return false;
+    }
+
+    if (fds.revents & (POLLERR | POLLNVAL)) {
+        ALOGE("Error on fence %d while waiting: revents %#x", fence, fds.revents);
+        return false;
+    }
+
+    return true;
+}
+
 AcrylicDevice::AcrylicDevice(const char *devpath)
     : mDevPath(devpath), mDevFD(-1)
 {
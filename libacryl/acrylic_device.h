@@ -24,7 +24,7 @@ class AcrylicDevice {
 public:
     AcrylicDevice(const char *path);
     virtual ~AcrylicDevice();
-    int ioctl(int cmd, void *arg);
+    virtual int ioctl(int cmd, void *arg);
 private:
     bool open();
 
@@ -212,6 +212,8 @@ private:
 
 #define NUM_VERT_COEF_REGS (NUM_FILTER_PHASE * NUM_VERT_COEFFICIENTS)
 #define NUM_HORI_COEF_REGS (NUM_FILTER_PHASE * NUM_HORI_COEFFICIENTS)
+// Y and C coefficients of both directions
+#define NUM_MAX_FILTER_COEF_REGS (2 * (NUM_VERT_COEF_REGS + NUM_HORI_COEF_REGS))
 
 static uint32_t g2dHoriFilterCoef[NUM_FILTER_COEF_SETS][NUM_FILTER_PHASE][NUM_HORI_COEFFICIENTS] = {
     { // Upsampling
@@ -291,14 +293,17 @@ static unsigned int findFilterCoefficientsIndex(uint32_t factor)
     return NUM_FILTER_COEF_SETS - 1;
 }
 
+// Register values of all coefficient sets in the register order, offsets are relative to the
+// coefficients of the plane. They are built once and then copied with the base of the layer.
+struct FilterCoefficientRegisters {
+    g2d_reg vert[NUM_FILTER_COEF_SETS][NUM_VERT_COEF_REGS];
+    g2d_reg hori[NUM_FILTER_COEF_SETS][NUM_HORI_COEF_REGS];
+};
+
 template<typename CoefT>
-static unsigned int __writeFilterCoefficients(CoefT &coef_set, unsigned int index, uint32_t base, g2d_reg regs[])
+static void __buildFilterCoefficients(CoefT &coef_set, unsigned int index, g2d_reg regs[])
 {
-    // The default value of filter coefficients are values of 8:8/zoom-in
-    // So, do not update redundantly.
-    if (index == 0)
-        return 0;
-
+    uint32_t base = 0;
     unsigned int cnt = 0;
 
     for (auto &coef_table: coef_set[index]) {
@@ -316,8 +321,36 @@ static unsigned int __writeFilterCoefficients(CoefT &coef_set, unsigned int inde
         }
         base += sizeof(uint32_t);
     }
+}
 
-    return cnt;
+static const FilterCoefficientRegisters &getFilterCoefficientRegisters()
+{
+    static const FilterCoefficientRegisters *coef_regs = [] {
+        auto *regs = new FilterCoefficientRegisters;
+        for (unsigned int i = 0; i < NUM_FILTER_COEF_SETS; i++) {
+            __buildFilterCoefficients(g2dVertFilterCoef, i, regs->vert[i]);
+            __buildFilterCoefficients(g2dHoriFilterCoef, i, regs->hori[i]);
+        }
+        return regs;
+    }();
+
+    return *coef_regs;
+}
+
+template<size_t N>
+static unsigned int __writeFilterCoefficients(const g2d_reg (&coef_regs)[N], unsigned int index, uint32_t base, g2d_reg regs[])
+{
+    // The default value of filter coefficients are values of 8:8/zoom-in
+    // So, do not update redundantly.
+    if (index == 0)
+        return 0;
+
+    for (unsigned int i = 0; i < N; i++) {
+        regs[i].offset = base + coef_regs[i].offset;
+        regs[i].value = coef_regs[i].value;
+    }
+
+    return N;
 }
 
 void getChromaScaleFactor(uint32_t colormode, unsigned int *hfactor, unsigned int *vfactor)
@@ -336,62 +369,59 @@ void getChromaScaleFactor(uint32_t colormode, unsigned int *hfactor, unsigned in
     }
 }
 
-static unsigned int writeFilterCoefficients(uint32_t hfactor, uint32_t vfactor, uint32_t colormode,
+#define FILTER_SET_SHIFT_Y_VERT 0
+#define FILTER_SET_SHIFT_Y_HORI 8
+#define FILTER_SET_SHIFT_C_VERT 16
+#define FILTER_SET_SHIFT_C_HORI 24
+#define FILTER_SET_INDEX(sets, shift) (((sets) >> (shift)) & 0xFF)
+
+// The coefficient sets of the vertical and horizontal filters of luma and chroma in a word.
+// Scaling factors in the same buckets of the coefficient sets give the same registers.
+static uint32_t getFilterCoefficientSets(uint32_t hfactor, uint32_t vfactor, uint32_t colormode)
+{
+    uint32_t sets = (findFilterCoefficientsIndex(vfactor) << FILTER_SET_SHIFT_Y_VERT) |
+                    (findFilterCoefficientsIndex(hfactor) << FILTER_SET_SHIFT_Y_HORI);
+
+    if (IS_YUV(colormode)) {
+        getChromaScaleFactor(colormode, &hfactor, &vfactor);
+
+        sets |= (findFilterCoefficientsIndex(vfactor) << FILTER_SET_SHIFT_C_VERT) |
+                (findFilterCoefficientsIndex(hfactor) << FILTER_SET_SHIFT_C_HORI);
+    }
+
+    return sets;
+}
+
+static unsigned int writeFilterCoefficients(uint32_t sets, uint32_t colormode,
                                             unsigned layer_index, g2d_reg regs[])
 {
-    unsigned int hindex = findFilterCoefficientsIndex(hfactor);
-    unsigned int vindex = findFilterCoefficientsIndex(vfactor);
     // Filter coefficients of 1:1 and upsampling are configured to the filter by default (reset value)
-    if ((hindex == 0) && (vindex == 0))
+    if ((FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_Y_VERT) == 0) &&
+            (FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_Y_HORI) == 0))
         return 0;
 
+    const FilterCoefficientRegisters &coef_regs = getFilterCoefficientRegisters();
     unsigned int base = G2D_FILTER_COEF_REG(layer_index);
     unsigned int cnt = 0;
     // Y Coefficients
-    cnt += __writeFilterCoefficients(g2dVertFilterCoef, vindex, base, regs);
-    cnt += __writeFilterCoefficients(g2dHoriFilterCoef, hindex, base + sizeof(g2dVertFilterCoef[0]), regs + cnt);
+    cnt += __writeFilterCoefficients(coef_regs.vert[FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_Y_VERT)],
+                                     FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_Y_VERT), base, regs);
+    cnt += __writeFilterCoefficients(coef_regs.hori[FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_Y_HORI)],
+                                     FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_Y_HORI),
+                                     base + sizeof(g2dVertFilterCoef[0]), regs + cnt);
     if (IS_YUV(colormode)) {
         // C Coefficients
-        getChromaScaleFactor(colormode, &hfactor, &vfactor);
-
-        hindex = findFilterCoefficientsIndex(hfactor);
-        vindex = findFilterCoefficientsIndex(vfactor);
         base += G2D_FILTER_C_OFFSET;
-        cnt += __writeFilterCoefficients(g2dVertFilterCoef, vindex, base, regs + cnt);
-        cnt += __writeFilterCoefficients(g2dHoriFilterCoef, hindex, base + sizeof(g2dVertFilterCoef[0]), regs + cnt);
+        cnt += __writeFilterCoefficients(coef_regs.vert[FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_C_VERT)],
+                                         FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_C_VERT), base, regs + cnt);
+        cnt += __writeFilterCoefficients(coef_regs.hori[FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_C_HORI)],
+                                         FILTER_SET_INDEX(sets, FILTER_SET_SHIFT_C_HORI),
+                                         base + sizeof(g2dVertFilterCoef[0]), regs + cnt);
     }
 
     return cnt;
 }
 
-static unsigned int getFilterCoefficientCount(uint32_t *src_cmds[], unsigned int layer_count)
-{
-    unsigned int count = 0;
-
-
-    for (unsigned int i = 0; i < layer_count; i++) {
-        unsigned int layer_coef_cnt = 0;
-        unsigned int hfactor = src_cmds[i][G2DSFR_SRC_XSCALE];
-        unsigned int vfactor = src_cmds[i][G2DSFR_SRC_YSCALE];
-
-        if (hfactor > G2D_SCALE_FACTOR(8, 8))
-            layer_coef_cnt += NUM_HORI_COEF_REGS;
-        if (vfactor > G2D_SCALE_FACTOR(8, 8))
-            layer_coef_cnt += NUM_VERT_COEF_REGS;
-        if (IS_YUV(src_cmds[i][G2DSFR_IMG_COLORMODE])) {
-            getChromaScaleFactor(src_cmds[i][G2DSFR_IMG_COLORMODE], &hfactor, &vfactor);
-            if (hfactor > G2D_SCALE_FACTOR(8, 8))
-                layer_coef_cnt += NUM_HORI_COEF_REGS;
-            if (vfactor > G2D_SCALE_FACTOR(8, 8))
-                layer_coef_cnt += NUM_VERT_COEF_REGS;
-        }
-
-        count += layer_coef_cnt;
-    }
-
-    return count;
-}
-
 static void show_g2d_layer(const char *title, int idx, const g2d_layer &layer)
 {
     ALOGD("%s%d: flags %#x, fence %d, buffer_type %d, num_buffers %d", title, idx,
@@ -547,13 +577,21 @@ static g2d_fmt *halfmt_to_g2dfmt(struct g2d_fmt *tbl, size_t tbl_len, uint32_t h
 }
 
 AcrylicCompositorG2D::AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode)
-    : Acrylic(capability), mDev((capability.maxLayerCount() > 2) ? "/dev/g2d" : "/dev/fimg2d"),
-      mMaxSourceCount(0), mPriority(-1)
+    : AcrylicCompositorG2D(capability, newcolormode,
+                           std::make_unique<AcrylicDevice>((capability.maxLayerCount() > 2) ?
+                                                           "/dev/g2d" : "/dev/fimg2d"))
+{
+}
+
+AcrylicCompositorG2D::AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode,
+                                           std::unique_ptr<AcrylicDevice> device)
+    : Acrylic(capability), mDev(std::move(device)), mMaxSourceCount(0), mSourceCacheHitCount(0),
+      mPriority(-1), mLastHandle(0)
 {
     memset(&mTask, 0, sizeof(mTask));
 
     mVersion = 0;
-    if (mDev.ioctl(G2D_IOC_VERSION, &mVersion) < 0)
+    if (mDev->ioctl(G2D_IOC_VERSION, &mVersion) < 0)
         ALOGERR("Failed to get G2D command version");
     ALOGI("G2D API Version %d", mVersion);
 
@@ -567,6 +605,9 @@ AcrylicCompositorG2D::AcrylicCompositorG2D(const HW2DCapability &capability, boo
 
 AcrylicCompositorG2D::~AcrylicCompositorG2D()
 {
+    while (!mJobs.empty())
+        retireJob(mJobs.begin());
+
     delete [] mTask.source;
     delete [] mTask.commands.target;
     for (unsigned int i = 0; i < mMaxSourceCount; i++)
@@ -575,18 +616,75 @@ AcrylicCompositorG2D::~AcrylicCompositorG2D()
     ALOGD_TEST("Deleting Acrylic for G2D on %p", this);
 }
 
-unsigned int AcrylicCompositorG2D::updateFilterCoefficients(unsigned int layercount, g2d_reg regs[])
+void AcrylicCompositorG2D::removeTransitData(AcrylicLayer *layer)
 {
-    if (!mUsePolyPhaseFilter)
-        return 0;
+    for (auto &cache : mSourceCache) {
+        if (cache.layer == layer)
+            cache.layer = nullptr;
+    }
+}
 
-    unsigned int cnt = 0;
+bool AcrylicCompositorG2D::isSourceCacheValid(AcrylicLayer &layer, unsigned int index, unsigned int image_index)
+{
+    // Solid color layers have no buffer to update and their commands are trivial to build
+    if (layer.isSolidColor())
+        return false;
+
+    if ((mSourceCache[index].layer != &layer) || (mSourceCache[index].image_index != image_index))
+        return false;
+
+    return !(layer.getSettingFlags() & (AcrylicCanvas::SETTING_TYPE_MODIFIED |
+                                        AcrylicCanvas::SETTING_DIMENSION_MODIFIED |
+                                        AcrylicCanvas::SETTING_COMPOSIT_MODIFIED));
+}
+
+void AcrylicCompositorG2D::updateSourceCache(AcrylicLayer *layer, unsigned int index, unsigned int image_index)
+{
+    SourceCache &cache = mSourceCache[index];
+
+    cache.layer = layer;
+    cache.image_index = image_index;
+
+    if (!mUsePolyPhaseFilter || !layer ||
+            ((mTask.commands.source[index][G2DSFR_SRC_SCALECONTROL] & 0xF) != G2D_SCALECONTROL_POLYPHASE)) {
+        cache.filter_sets = 0;
+        cache.filter_coef.clear();
+        return;
+    }
+
+    uint32_t colormode = mTask.commands.source[index][G2DSFR_IMG_COLORMODE];
+    uint32_t sets = getFilterCoefficientSets(mTask.commands.source[index][G2DSFR_SRC_XSCALE],
+                                             mTask.commands.source[index][G2DSFR_SRC_YSCALE],
+                                             colormode);
+    // The registers depend only on the slot and the buckets of the scaling factors
+    if (sets == cache.filter_sets)
+        return;
+
+    cache.filter_sets = sets;
+    cache.filter_coef.resize(NUM_MAX_FILTER_COEF_REGS);
+    cache.filter_coef.resize(writeFilterCoefficients(sets, colormode, index, cache.filter_coef.data()));
+}
+
+unsigned int AcrylicCompositorG2D::getFilterCoefficientCount(unsigned int layercount)
+{
+    unsigned int count = 0;
 
     for (unsigned int i = 0; i < layercount; i++)
-        cnt += writeFilterCoefficients(mTask.commands.source[i][G2DSFR_SRC_XSCALE],
-                                       mTask.commands.source[i][G2DSFR_SRC_YSCALE],
-                                       mTask.commands.source[i][G2DSFR_IMG_COLORMODE],
-                                       i, regs + cnt);
+        count += mSourceCache[i].filter_coef.size();
+
+    return count;
+}
+
+unsigned int AcrylicCompositorG2D::updateFilterCoefficients(unsigned int layercount, g2d_reg regs[])
+{
+    unsigned int cnt = 0;
+
+    for (unsigned int i = 0; i < layercount; i++) {
+        const std::vector<g2d_reg> &coef = mSourceCache[i].filter_coef;
+
+        std::copy(coef.begin(), coef.end(), regs + cnt);
+        cnt += coef.size();
+    }
 
     return cnt;
 }
@@ -637,15 +735,50 @@ static lossy_formats sbwc_lossy_formats[] {
 };
 
 
-bool AcrylicCompositorG2D::prepareImage(AcrylicCanvas &layer, struct g2d_layer &image, uint32_t cmd[], int index)
+bool AcrylicCompositorG2D::prepareImageBuffer(AcrylicCanvas &layer, struct g2d_layer &image)
 {
-    image.flags = 0;
+    image.flags &= ~G2D_LAYERFLAG_ACQUIRE_FENCE;
 
     if (layer.getFence() >= 0) {
         image.flags |= G2D_LAYERFLAG_ACQUIRE_FENCE;
         image.fence = layer.getFence();
     }
 
+    if (layer.getBufferType() == AcrylicCanvas::MT_EMPTY) {
+        image.buffer_type = G2D_BUFTYPE_EMPTY;
+        return true;
+    }
+
+    if (layer.getBufferCount() < image.num_buffers) {
+        ALOGE("HAL Format %#x requires %d buffers but %d buffers are given",
+                layer.getFormat(), image.num_buffers, layer.getBufferCount());
+        return false;
+    }
+
+    if (layer.getBufferType() == AcrylicCanvas::MT_DMABUF) {
+        image.buffer_type = G2D_BUFTYPE_DMABUF;
+        for (unsigned int i = 0; i < image.num_buffers; i++) {
+            image.buffer[i].dmabuf.fd = layer.getDmabuf(i);
+            image.buffer[i].dmabuf.offset = layer.getOffset(i);
+            image.buffer[i].length = layer.getBufferLength(i);
+        }
+    } else {
+        LOGASSERT(layer.getBufferType() == AcrylicCanvas::MT_USERPTR,
+                  "Unknown buffer type %d", layer.getBufferType());
+        image.buffer_type = G2D_BUFTYPE_USERPTR;
+        for (unsigned int i = 0; i < image.num_buffers; i++) {
+            image.buffer[i].userptr = layer.getUserptr(i);
+            image.buffer[i].length = layer.getBufferLength(i);
+        }
+    }
+
+    return true;
+}
+
+bool AcrylicCompositorG2D::prepareImage(AcrylicCanvas &layer, struct g2d_layer &image, uint32_t cmd[], int index)
+{
+    image.flags = 0;
+
     if (layer.isProtected())
         image.flags |= G2D_LAYERFLAG_SECURE;
 
@@ -661,35 +794,11 @@ bool AcrylicCompositorG2D::prepareImage(AcrylicCanvas &layer, struct g2d_layer &
         }
     }
 
-    if (layer.getBufferType() == AcrylicCanvas::MT_EMPTY) {
-        image.buffer_type = G2D_BUFTYPE_EMPTY;
-    } else {
-        if (layer.getBufferCount() < g2dfmt->num_bufs) {
-            ALOGE("HAL Format %#x requires %d buffers but %d buffers are given",
-                    layer.getFormat(), g2dfmt->num_bufs, layer.getBufferCount());
-            return false;
-        }
-
-        if (layer.getBufferType() == AcrylicCanvas::MT_DMABUF) {
-            image.buffer_type = G2D_BUFTYPE_DMABUF;
-            for (unsigned int i = 0; i < g2dfmt->num_bufs; i++) {
-                image.buffer[i].dmabuf.fd = layer.getDmabuf(i);
-                image.buffer[i].dmabuf.offset = layer.getOffset(i);
-                image.buffer[i].length = layer.getBufferLength(i);
-            }
-        } else {
-            LOGASSERT(layer.getBufferType() == AcrylicCanvas::MT_USERPTR,
-                      "Unknown buffer type %d", layer.getBufferType());
-            image.buffer_type = G2D_BUFTYPE_USERPTR;
-            for (unsigned int i = 0; i < g2dfmt->num_bufs; i++) {
-                image.buffer[i].userptr = layer.getUserptr(i);
-                image.buffer[i].length = layer.getBufferLength(i);
-            }
-        }
-    }
-
     image.num_buffers = g2dfmt->num_bufs;
 
+    if (!prepareImageBuffer(layer, image))
+        return false;
+
     hw2d_coord_t xy = layer.getImageDimension();
 
     cmd[G2DSFR_IMG_COLORMODE] = g2dfmt->g2dfmt;
@@ -1021,13 +1130,17 @@ bool AcrylicCompositorG2D::reallocLayer(unsigned int layercount)
 
     mMaxSourceCount = layercount;
 
+    // All compiled commands are gone with the command buffers
+    mSourceCache.clear();
+    mSourceCache.resize(layercount);
+
     return true;
 }
 
 int AcrylicCompositorG2D::ioctlG2D(void)
 {
     if (mVersion == 1) {
-        if (mDev.ioctl(G2D_IOC_PROCESS, &mTask) < 0)
+        if (mDev->ioctl(G2D_IOC_PROCESS, &mTask) < 0)
             return -errno;
     } else {
         struct g2d_compat_task task;
@@ -1041,7 +1154,7 @@ int AcrylicCompositorG2D::ioctlG2D(void)
         task.commands.extra = mTask.commands.extra;
         task.commands.num_extra_regs = mTask.commands.num_extra_regs;
 
-        if (mDev.ioctl(G2D_IOC_COMPAT_PROCESS, &task) < 0)
+        if (mDev->ioctl(G2D_IOC_COMPAT_PROCESS, &task) < 0)
             return -errno;
 
         mTask.flags = task.flags;
@@ -1104,8 +1217,16 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
     if (hasBackground) {
         baseidx++;
         prepareSolidLayer(getCanvas(), mTask.source[0], mTask.commands.source[0]);
+        updateSourceCache(nullptr, 0, 0);
     }
 
+    for (unsigned int i = layercount; i < mMaxSourceCount; i++)
+        updateSourceCache(nullptr, i, 0);
+
+    // The target dimension is the default window of the source images
+    bool rebuild = !!(getCanvas().getSettingFlags() & (AcrylicCanvas::SETTING_TYPE_MODIFIED |
+                                                       AcrylicCanvas::SETTING_DIMENSION_MODIFIED));
+
     mTask.commands.target[G2DSFR_DST_YCBCRMODE] = 0;
 
     CSCMatrixWriter cscMatrixWriter(mTask.commands.target[G2DSFR_IMG_COLORMODE],
@@ -1117,11 +1238,27 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
     for (unsigned int i = baseidx; i < layercount; i++) {
         AcrylicLayer &layer = *getLayer(i - baseidx);
 
-        if (!prepareSource(layer, mTask.source[i],
-                           mTask.commands.source[i], getCanvas().getImageDimension(),
-                           i, i - baseidx)) {
-            ALOGE("Failed to configure source layer %u", i - baseidx);
-            return false;
+        if (!rebuild && isSourceCacheValid(layer, i, i - baseidx)) {
+            if (!prepareImageBuffer(layer, mTask.source[i])) {
+                ALOGE("Failed to configure the buffer of source layer %u", i - baseidx);
+                return false;
+            }
+
+            // Clear the fields written after prepareSource() on the previous execution
+            mTask.commands.source[i][G2DSFR_SRC_COMMAND] &= ~G2D_LAYERCMD_PREMULT_ALPHA;
+            mTask.commands.source[i][G2DSFR_SRC_YCBCRMODE] = 0;
+            mTask.commands.source[i][G2DSFR_SRC_HDRMODE] = 0;
+            mSourceCacheHitCount++;
+        } else {
+            if (!prepareSource(layer, mTask.source[i],
+                               mTask.commands.source[i], getCanvas().getImageDimension(),
+                               i, i - baseidx)) {
+                ALOGE("Failed to configure source layer %u", i - baseidx);
+                updateSourceCache(nullptr, i, 0);
+                return false;
+            }
+
+            updateSourceCache(&layer, i, i - baseidx);
         }
 
         if (!cscMatrixWriter.configure(mTask.commands.source[i][G2DSFR_IMG_COLORMODE],
@@ -1159,11 +1296,12 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
     mTask.release_fence = reinterpret_cast<int *>(alloca(sizeof(int) * num_fences));
 
     mTask.commands.num_extra_regs = cscMatrixWriter.getRegisterCount() +
-                                    mHdrWriter.getCommandCount();
-    if (mUsePolyPhaseFilter)
-        mTask.commands.num_extra_regs += getFilterCoefficientCount(mTask.commands.source, layercount);
+                                    mHdrWriter.getCommandCount() +
+                                    getFilterCoefficientCount(layercount);
 
-    mTask.commands.extra = reinterpret_cast<g2d_reg *>(alloca(sizeof(g2d_reg) * mTask.commands.num_extra_regs));
+    if (mExtraRegs.size() < mTask.commands.num_extra_regs)
+        mExtraRegs.resize(mTask.commands.num_extra_regs);
+    mTask.commands.extra = mExtraRegs.data();
 
     g2d_reg *regs = mTask.commands.extra;
 
@@ -1218,9 +1356,51 @@ bool AcrylicCompositorG2D::execute(int fence[], unsigned int num_fences)
     return true;
 }
 
+void AcrylicCompositorG2D::retireJob(std::deque<G2DJob>::iterator job)
+{
+    if (job->fence >= 0)
+        close(job->fence);
+
+    mJobs.erase(job);
+}
+
+void AcrylicCompositorG2D::retireCompletedJobs()
+{
+    auto job = mJobs.begin();
+
+    while (job != mJobs.end()) {
+        if (wait_fence(job->fence, 0)) {
+            if (job->fence >= 0)
+                close(job->fence);
+            job = mJobs.erase(job);
+        } else {
+            ++job;
+        }
+    }
+}
+
 bool AcrylicCompositorG2D::execute(int *handle)
 {
-    if (!executeG2D(NULL, 0, handle ? true : false)) {
+    int fence = -1;
+
+    if (handle != NULL) {
+        // Completed tasks do not count against the depth
+        // even though their handles are not released by the users.
+        retireCompletedJobs();
+
+        while (mJobs.size() >= MAX_INFLIGHT_JOBS) {
+            ALOGD_TEST("Waiting for the oldest task of handle %d to submit a new task", mJobs.front().handle);
+            if (!wait_fence(mJobs.front().fence, JOB_TIMEOUT_MSEC)) {
+                if (mTimedOutHandles.size() >= MAX_INFLIGHT_JOBS)
+                    mTimedOutHandles.pop_front();
+                mTimedOutHandles.push_back(mJobs.front().handle);
+            }
+            retireJob(mJobs.begin());
+        }
+    }
+
+    // The first release fence is signaled when the task is completed
+    if (!executeG2D(&fence, handle ? 1 : 0, handle ? true : false)) {
         // Clearing all acquire fences because their buffers are expired.
         // The clients should configure everything again to start new execution
         for (unsigned int i = 0; i < layerCount(); i++)
@@ -1230,16 +1410,55 @@ bool AcrylicCompositorG2D::execute(int *handle)
         return false;
     }
 
-    if (handle != NULL)
-        *handle = 1; /* dummy handle */
+    if (handle != NULL) {
+        if (++mLastHandle <= 0)
+            mLastHandle = 1;
+
+        mJobs.push_back({mLastHandle, fence});
+        *handle = mLastHandle;
+    }
 
     return true;
 }
 
-bool AcrylicCompositorG2D::waitExecution(int __unused handle)
+void AcrylicCompositorG2D::releaseHandle(int handle)
 {
-    ALOGD_TEST("Waiting for execution of m2m1shot2 G2D completed by handle %d", handle);
+    auto timedout = std::find(mTimedOutHandles.begin(), mTimedOutHandles.end(), handle);
+    if (timedout != mTimedOutHandles.end()) {
+        mTimedOutHandles.erase(timedout);
+        return;
+    }
+
+    for (auto job = mJobs.begin(); job != mJobs.end(); ++job) {
+        if (job->handle == handle) {
+            retireJob(job);
+            return;
+        }
+    }
+}
+
+bool AcrylicCompositorG2D::waitExecution(int handle)
+{
+    ALOGD_TEST("Waiting for execution of G2D completed by handle %d", handle);
+
+    for (auto job = mJobs.begin(); job != mJobs.end(); ++job) {
+        if (job->handle == handle) {
+            bool completed = wait_fence(job->fence, JOB_TIMEOUT_MSEC);
+
+            retireJob(job);
+
+            return completed;
+        }
+    }
+
+    auto timedout = std::find(mTimedOutHandles.begin(), mTimedOutHandles.end(), handle);
+    if (timedout != mTimedOutHandles.end()) {
+        ALOGE("The task of handle %d was released after timeout", handle);
+        mTimedOutHandles.erase(timedout);
+        return false;
+    }
 
+    // Other unknown handles are of the tasks that are already retired after completion
     return true;
 }
 
@@ -1250,7 +1469,7 @@ bool AcrylicCompositorG2D::requestPerformanceQoS(AcrylicPerformanceRequest *requ
     memset(&data, 0, sizeof(data));
 
     if (!request || (request->getFrameCount() == 0)) {
-        if (mDev.ioctl(G2D_IOC_PERFORMANCE, &data) < 0) {
+        if (mDev->ioctl(G2D_IOC_PERFORMANCE, &data) < 0) {
             ALOGERR("Failed to cancel performance request");
             return false;
         }
@@ -1373,7 +1592,7 @@ bool AcrylicCompositorG2D::requestPerformanceQoS(AcrylicPerformanceRequest *requ
 
     data.num_frame = request->getFrameCount();
 
-    if (mDev.ioctl(G2D_IOC_PERFORMANCE, &data) < 0) {
+    if (mDev->ioctl(G2D_IOC_PERFORMANCE, &data) < 0) {
         ALOGERR("Failed to request performance");
         return false;
     }
@@ -1404,7 +1623,7 @@ int AcrylicCompositorG2D::prioritize(int priority)
     else
         arg = g2d_priorities[priority];
 
-    if (mDev.ioctl(G2D_IOC_PRIORITY, &arg) < 0) {
+    if (mDev->ioctl(G2D_IOC_PRIORITY, &arg) < 0) {
         if (errno != EBUSY) {
             ALOGERR("Failed to set priority on a context of G2D");
             return -1;
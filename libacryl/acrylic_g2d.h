@@ -18,7 +18,9 @@
 #ifndef __HARDWARE_EXYNOS_HW2DCOMPOSITOR_G2D_H__
 #define __HARDWARE_EXYNOS_HW2DCOMPOSITOR_G2D_H__
 
+#include <deque>
 #include <memory>
+#include <vector>
 
 #include <hardware/exynos/acryl.h>
 
@@ -120,9 +122,24 @@ struct g2d_fmt;
 class AcrylicCompositorG2D: public Acrylic {
 public:
     AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode);
+    /*
+     * Create a compositor that talks to @device instead of the G2D driver.
+     * e.g. AcrylicFakeG2DDevice to run the compositor without the hardware.
+     */
+    AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode,
+                         std::unique_ptr<AcrylicDevice> device);
     virtual ~AcrylicCompositorG2D();
     virtual bool execute(int fence[], unsigned int num_fences);
+    /*
+     * If @handle is not NULL, the task is queued to the driver and a handle of
+     * the task is stored to @handle. Up to MAX_INFLIGHT_JOBS tasks are kept in
+     * flight. Submitting more tasks waits for the oldest task to complete, and
+     * the handle of that task is released implicitly. If the oldest task does
+     * not complete in JOB_TIMEOUT_MSEC, it is released anyway and the later
+     * waitExecution() on its handle fails.
+     */
     virtual bool execute(int *handle = NULL);
+    virtual void releaseHandle(int handle);
     virtual bool waitExecution(int handle);
     virtual unsigned int getLaptimeUSec() { return mTask.laptime_in_usec; }
     /*
@@ -133,24 +150,73 @@ public:
      */
     virtual int prioritize(int priority = -1);
     virtual bool requestPerformanceQoS(AcrylicPerformanceRequest *request);
+    /*
+     * Obtain the number of source images whose commands are reused from the
+     * previous execution so far
+     */
+    unsigned int getSourceCacheHitCount() { return mSourceCacheHitCount; }
+protected:
+    /*
+     * Forget the commands compiled for @layer so that they are not reused if
+     * the layer comes back to this compositor after it is configured elsewhere.
+     */
+    virtual void removeTransitData(AcrylicLayer *layer);
 private:
+    enum { MAX_INFLIGHT_JOBS = 4, JOB_TIMEOUT_MSEC = 1000 };
+
+    /*
+     * A task submitted with a handle. @fence is signaled when G2D completes the task.
+     */
+    struct G2DJob {
+        int handle;
+        int fence;
+    };
+
+    /*
+     * Commands of a source image compiled by the previous execution.
+     * The commands in mTask.commands.source[] are reused as long as the same
+     * layer stays in the same slot without changes in its type, dimension and
+     * compositing settings. Only the buffer and the fence are updated then.
+     * The filter coefficient registers of the slot are kept until the
+     * coefficient sets selected by the scaling factors change.
+     */
+    struct SourceCache {
+        AcrylicLayer *layer = nullptr;
+        unsigned int image_index = 0;
+        uint32_t filter_sets = 0;
+        std::vector<g2d_reg> filter_coef;
+    };
+
     int ioctlG2D(void);
     bool executeG2D(int fence[], unsigned int num_fences, bool nonblocking);
     bool prepareImage(AcrylicCanvas &layer, struct g2d_layer &image, uint32_t cmd[], int index);
+    bool prepareImageBuffer(AcrylicCanvas &layer, struct g2d_layer &image);
     bool prepareSource(AcrylicLayer &layer, struct g2d_layer &image, uint32_t cmd[], hw2d_coord_t target_size,
                        unsigned int index, unsigned int image_index);
     bool prepareSolidLayer(AcrylicCanvas &canvas, struct g2d_layer &image, uint32_t cmd[]);
     bool prepareSolidLayer(AcrylicLayer &layer, struct g2d_layer &image, uint32_t cmd[], hw2d_coord_t target_size, unsigned int index);
     bool reallocLayer(unsigned int layercount);
+    bool isSourceCacheValid(AcrylicLayer &layer, unsigned int index, unsigned int image_index);
+    void updateSourceCache(AcrylicLayer *layer, unsigned int index, unsigned int image_index);
+    unsigned int getFilterCoefficientCount(unsigned int layercount);
     unsigned int updateFilterCoefficients(unsigned int layercount, g2d_reg regs[]);
+    void retireJob(std::deque<G2DJob>::iterator job);
+    void retireCompletedJobs();
 
-    AcrylicDevice mDev;
+    std::unique_ptr<AcrylicDevice> mDev;
     g2d_task	  mTask;
     G2DHdrWriter  mHdrWriter;
     unsigned int  mMaxSourceCount;
+    std::vector<SourceCache> mSourceCache;
+    unsigned int mSourceCacheHitCount;
+    std::vector<g2d_reg> mExtraRegs;
     int mPriority;
     unsigned int mVersion;
     bool mUsePolyPhaseFilter;
+    std::deque<G2DJob> mJobs;
+    // Handles of the tasks released without completion, the oldest is forgotten first
+    std::deque<int> mTimedOutHandles;
+    int mLastHandle;
 
     g2d_fmt *halfmt_to_g2dfmt_tbl;
     size_t len_halfmt_to_g2dfmt_tbl;
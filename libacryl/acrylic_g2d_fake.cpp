@@ -0,0 +1,592 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <log/log.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "acrylic_g2d_fake.h"
+#include "acrylic_internal.h"
+
+// The version of struct g2d_task, G2D_IOC_PROCESS is the only processing command supported
+#define FAKE_G2D_VERSION 1
+
+#define CSC_MATRIX_SRC_BASE 0x2000
+// The strides of the luminance plane of MFC buffers
+#define MFC_ALIGN(v) (((v) + 15) & ~15)
+// CSC coefficients are signed fixed point numbers with 9 fractional bits
+#define CSC_COEF_ONE 512.0f
+
+// BT.601 limited range, used for the matrices that a task does not configure
+static const int16_t defaultYCbCr2sRGBCoefficients[9] = {
+    0x0254, 0x0000, 0x0331, 0x0254, -201, -416, 0x0254, 0x0409, 0x0000,
+};
+
+static bool is_supported_format(uint32_t colormode, bool target)
+{
+    if (colormode & (G2D_DATAFORMAT_AFBC | G2D_DATAFORMAT_UORDER |
+                     G2D_DATAFORMAT_SBWC | G2D_FMT_YCBCR_BITDEPTH_MASK))
+        return false;
+
+    switch (colormode & G2D_DATAFMT_MASK) {
+        case G2D_DATAFMT_8888:
+        case G2D_DATAFMT_565:
+            return true;
+        case G2D_DATAFMT_YUV420SP:
+            return !target;
+        default:
+            return false;
+    }
+}
+
+static unsigned int get_luma_stride(const uint32_t cmd[], uint32_t flags)
+{
+    if (!IS_YUV(cmd[G2DSFR_IMG_COLORMODE]))
+        return cmd[G2DSFR_IMG_STRIDE];
+    return (flags & G2D_LAYERFLAG_MFC_STRIDE) ? MFC_ALIGN(cmd[G2DSFR_IMG_WIDTH])
+                                              : cmd[G2DSFR_IMG_WIDTH];
+}
+
+static unsigned int get_luma_vstride(const uint32_t cmd[], uint32_t flags)
+{
+    return (flags & G2D_LAYERFLAG_MFC_STRIDE) ? MFC_ALIGN(cmd[G2DSFR_IMG_HEIGHT])
+                                              : cmd[G2DSFR_IMG_HEIGHT];
+}
+
+// Byte size of each buffer in @cmd that has @num_buffers buffers
+static void get_buffer_sizes(const uint32_t cmd[], uint32_t flags,
+                             unsigned int num_buffers, size_t sizes[])
+{
+    size_t luma = static_cast<size_t>(get_luma_stride(cmd, flags)) * get_luma_vstride(cmd, flags);
+
+    if (!IS_YUV(cmd[G2DSFR_IMG_COLORMODE])) {
+        sizes[0] = luma;
+    } else if (num_buffers == 1) {
+        sizes[0] = luma + luma / 2;
+    } else {
+        sizes[0] = luma;
+        sizes[1] = luma / 2;
+    }
+}
+
+// The source of the component in the swizzle of @colormode: 0 ~ 3 for bytes, otherwise one
+static unsigned int get_swizzle(uint32_t colormode, unsigned int shift)
+{
+    return (colormode >> shift) & 0xF;
+}
+
+enum { SWZ_SHIFT_A = 12, SWZ_SHIFT_R = 8, SWZ_SHIFT_G = 4, SWZ_SHIFT_B = 0 };
+
+static inline float unorm(unsigned int value, unsigned int max)
+{
+    return static_cast<float>(value) / max;
+}
+
+static inline unsigned int to_unorm(float value, unsigned int max)
+{
+    return static_cast<unsigned int>(std::clamp(value, 0.0f, 1.0f) * max + 0.5f);
+}
+
+AcrylicFakeG2DDevice::AcrylicFakeG2DDevice(unsigned int laptime_usec)
+    : AcrylicDevice("fake-g2d"), mExit(false), mLaptimeUSec(laptime_usec),
+      mCompletedCount(0), mMaxQueueDepth(0)
+{
+    mThread = std::thread(&AcrylicFakeG2DDevice::worker, this);
+}
+
+AcrylicFakeG2DDevice::~AcrylicFakeG2DDevice()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+    mThread.join();
+}
+
+int AcrylicFakeG2DDevice::ioctl(int cmd, void *arg)
+{
+    // ioctl request numbers do not fit in int
+    switch (static_cast<unsigned int>(cmd)) {
+        case G2D_IOC_VERSION:
+            *static_cast<uint32_t *>(arg) = FAKE_G2D_VERSION;
+            return 0;
+        case G2D_IOC_PROCESS:
+            return process(*static_cast<g2d_task *>(arg));
+        case G2D_IOC_PRIORITY:
+        case G2D_IOC_PERFORMANCE:
+            return 0;
+        default:
+            errno = ENOTTY;
+            return -1;
+    }
+}
+
+unsigned int AcrylicFakeG2DDevice::getCompletedCount()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mCompletedCount;
+}
+
+unsigned int AcrylicFakeG2DDevice::getMaxQueueDepth()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mMaxQueueDepth;
+}
+
+bool AcrylicFakeG2DDevice::mapImage(const g2d_layer &layer, const uint32_t cmd[],
+                                    unsigned int count, Image &image)
+{
+    std::fill_n(image.cmd, G2DSFR_SRC_FIELD_COUNT, 0);
+    std::copy_n(cmd, count, image.cmd);
+    image.flags = layer.flags;
+    std::fill_n(image.plane, G2D_MAX_BUFFERS, nullptr);
+
+    if (layer.flags & G2D_LAYERFLAG_COLORFILL)
+        return true;
+
+    if (!is_supported_format(cmd[G2DSFR_IMG_COLORMODE], count != G2DSFR_SRC_FIELD_COUNT)) {
+        ALOGE("Unsupported color mode %#x", cmd[G2DSFR_IMG_COLORMODE]);
+        errno = EINVAL;
+        return false;
+    }
+
+    if ((layer.num_buffers == 0) || (layer.num_buffers > 2) ||
+            (!IS_YUV(cmd[G2DSFR_IMG_COLORMODE]) && (layer.num_buffers > 1))) {
+        ALOGE("Invalid number of buffers %u for color mode %#x",
+              layer.num_buffers, cmd[G2DSFR_IMG_COLORMODE]);
+        errno = EINVAL;
+        return false;
+    }
+
+    size_t sizes[G2D_MAX_BUFFERS];
+    get_buffer_sizes(cmd, layer.flags, layer.num_buffers, sizes);
+
+    for (unsigned int i = 0; i < layer.num_buffers; i++) {
+        if (layer.buffer[i].length < sizes[i]) {
+            ALOGE("Too small buffer[%u] %u for %zu bytes", i, layer.buffer[i].length, sizes[i]);
+            errno = EINVAL;
+            return false;
+        }
+
+        if (layer.buffer_type == G2D_BUFTYPE_USERPTR) {
+            image.plane[i] = static_cast<uint8_t *>(layer.buffer[i].userptr);
+        } else if (layer.buffer_type == G2D_BUFTYPE_DMABUF) {
+            size_t len = layer.buffer[i].dmabuf.offset + layer.buffer[i].length;
+            void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                              layer.buffer[i].dmabuf.fd, 0);
+            if (addr == MAP_FAILED) {
+                ALOGERR("Failed to map dmabuf %d", layer.buffer[i].dmabuf.fd);
+                return false;
+            }
+            image.mappings.emplace_back(addr, len);
+            image.plane[i] = static_cast<uint8_t *>(addr) + layer.buffer[i].dmabuf.offset;
+        } else {
+            ALOGE("Invalid buffer type %u", layer.buffer_type);
+            errno = EINVAL;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AcrylicFakeG2DDevice::unmapImage(Image &image)
+{
+    for (auto &mapping : image.mappings)
+        munmap(mapping.first, mapping.second);
+    image.mappings.clear();
+}
+
+bool AcrylicFakeG2DDevice::prepareJob(g2d_task &task, Job &job)
+{
+    job.compose = G2D_BUFTYPE_VALID(task.target.buffer_type) && !(task.flags & G2D_FLAG_HWFC);
+    if (!job.compose)
+        return true;
+
+    for (unsigned int m = 0; m < CSC_MATRIX_COUNT; m++)
+        for (unsigned int i = 0; i < CSC_MATRIX_REGISTER_COUNT; i++)
+            job.csc[m][i] = defaultYCbCr2sRGBCoefficients[i] / CSC_COEF_ONE;
+
+    for (unsigned int i = 0; i < task.commands.num_extra_regs; i++) {
+        uint32_t offset = task.commands.extra[i].offset;
+        if ((offset < CSC_MATRIX_SRC_BASE) ||
+                (offset >= CSC_MATRIX_SRC_BASE +
+                           CSC_MATRIX_COUNT * CSC_MATRIX_REGISTER_COUNT * sizeof(uint32_t)))
+            continue;
+        unsigned int idx = (offset - CSC_MATRIX_SRC_BASE) / sizeof(uint32_t);
+        job.csc[idx / CSC_MATRIX_REGISTER_COUNT][idx % CSC_MATRIX_REGISTER_COUNT] =
+                static_cast<int16_t>(task.commands.extra[i].value) / CSC_COEF_ONE;
+    }
+
+    if (!mapImage(task.target, task.commands.target, G2DSFR_DST_FIELD_COUNT, job.target))
+        return false;
+
+    job.sources.resize(task.num_source);
+    for (unsigned int i = 0; i < task.num_source; i++)
+        if (!mapImage(task.source[i], task.commands.source[i], G2DSFR_SRC_FIELD_COUNT, job.sources[i]))
+            return false;
+
+    return true;
+}
+
+int AcrylicFakeG2DDevice::process(g2d_task &task)
+{
+    if ((task.num_source > G2D_MAX_IMAGES) || (task.num_release_fences > G2D_MAX_RELEASE_FENCES)) {
+        ALOGE("Invalid task: %u sources, %u release fences", task.num_source, task.num_release_fences);
+        errno = EINVAL;
+        return -1;
+    }
+
+    Job job;
+
+    if (!prepareJob(task, job)) {
+        unmapImage(job.target);
+        for (auto &image : job.sources)
+            unmapImage(image);
+        return -1;
+    }
+
+    // The caller closes its acquire fences right after the ioctl returns
+    for (unsigned int i = 0; i < task.num_source; i++)
+        if (task.source[i].flags & G2D_LAYERFLAG_ACQUIRE_FENCE)
+            job.acquire_fences.push_back(::dup(task.source[i].fence));
+    if (task.target.flags & G2D_LAYERFLAG_ACQUIRE_FENCE)
+        job.acquire_fences.push_back(::dup(task.target.fence));
+
+    // All release fences of a task are signaled at once, so they share an eventfd
+    job.release_fence = -1;
+    if (task.num_release_fences > 0) {
+        job.release_fence = eventfd(0, EFD_CLOEXEC);
+        if (job.release_fence < 0) {
+            ALOGERR("Failed to create release fence");
+            for (int fence : job.acquire_fences)
+                ::close(fence);
+            unmapImage(job.target);
+            for (auto &image : job.sources)
+                unmapImage(image);
+            return -1;
+        }
+
+        for (unsigned int i = 0; i < task.num_release_fences; i++)
+            task.release_fence[i] = ::dup(job.release_fence);
+    }
+
+    if (!(task.flags & G2D_FLAG_NONBLOCK)) {
+        auto begin = std::chrono::steady_clock::now();
+
+        run(job);
+
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        task.laptime_in_usec = static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mQueue.push_back(std::move(job));
+        if (mQueue.size() > mMaxQueueDepth)
+            mMaxQueueDepth = static_cast<unsigned int>(mQueue.size());
+    }
+    mCond.notify_one();
+
+    return 0;
+}
+
+AcrylicFakeG2DDevice::Pixel AcrylicFakeG2DDevice::readPixel(const Job &job, const Image &image, int x, int y)
+{
+    const uint32_t *cmd = image.cmd;
+    uint32_t colormode = cmd[G2DSFR_IMG_COLORMODE];
+    unsigned int stride = get_luma_stride(cmd, image.flags);
+    Pixel pixel;
+
+    if ((colormode & G2D_DATAFMT_MASK) == G2D_DATAFMT_YUV420SP) {
+        const uint8_t *chroma = image.plane[1] ? image.plane[1]
+                : image.plane[0] + stride * get_luma_vstride(cmd, image.flags);
+        const uint8_t *uv = chroma + (y / 2) * stride + (x / 2) * 2;
+        bool uvorder = (colormode & G2D_YUVORDER_MASK) == (G2D_YUV_UV & G2D_YUVORDER_MASK);
+        float luma = image.plane[0][y * stride + x];
+        float cb = uv[uvorder ? 0 : 1] - 128.0f;
+        float cr = uv[uvorder ? 1 : 0] - 128.0f;
+        uint32_t ycbcrmode = cmd[G2DSFR_SRC_YCBCRMODE];
+        const float *m = job.csc[ycbcrmode & (CSC_MATRIX_COUNT - 1)];
+
+        if (!(ycbcrmode & G2D_LAYER_YCBCRMODE_WIDE))
+            luma -= 16.0f;
+
+        pixel.r = (m[0] * luma + m[1] * cb + m[2] * cr) / 255.0f;
+        pixel.g = (m[3] * luma + m[4] * cb + m[5] * cr) / 255.0f;
+        pixel.b = (m[6] * luma + m[7] * cb + m[8] * cr) / 255.0f;
+        pixel.a = 1.0f;
+    } else if ((colormode & G2D_DATAFMT_MASK) == G2D_DATAFMT_565) {
+        uint16_t value = *reinterpret_cast<const uint16_t *>(image.plane[0] + y * stride + x * 2);
+        // swizzle 2, 1 and 0 select bits [15:11], [10:5] and [4:0]
+        const unsigned int shift[3] = {0, 5, 11}, max[3] = {31, 63, 31};
+        unsigned int swz;
+
+        swz = get_swizzle(colormode, SWZ_SHIFT_R);
+        pixel.r = unorm((value >> shift[swz]) & max[swz], max[swz]);
+        swz = get_swizzle(colormode, SWZ_SHIFT_G);
+        pixel.g = unorm((value >> shift[swz]) & max[swz], max[swz]);
+        swz = get_swizzle(colormode, SWZ_SHIFT_B);
+        pixel.b = unorm((value >> shift[swz]) & max[swz], max[swz]);
+        pixel.a = 1.0f;
+    } else {
+        const uint8_t *bytes = image.plane[0] + y * stride + x * 4;
+        auto component = [&](unsigned int shift) {
+            unsigned int swz = get_swizzle(colormode, shift);
+            return (swz < 4) ? unorm(bytes[swz], 255) : 1.0f;
+        };
+
+        pixel.r = component(SWZ_SHIFT_R);
+        pixel.g = component(SWZ_SHIFT_G);
+        pixel.b = component(SWZ_SHIFT_B);
+        pixel.a = component(SWZ_SHIFT_A);
+    }
+
+    return pixel;
+}
+
+void AcrylicFakeG2DDevice::writePixel(Image &image, int x, int y, const Pixel &pixel)
+{
+    const uint32_t *cmd = image.cmd;
+    uint32_t colormode = cmd[G2DSFR_IMG_COLORMODE];
+    unsigned int stride = cmd[G2DSFR_IMG_STRIDE];
+
+    if ((colormode & G2D_DATAFMT_MASK) == G2D_DATAFMT_565) {
+        const unsigned int shift[3] = {0, 5, 11}, max[3] = {31, 63, 31};
+        uint16_t value = 0;
+        unsigned int swz;
+
+        swz = get_swizzle(colormode, SWZ_SHIFT_R);
+        value |= to_unorm(pixel.r, max[swz]) << shift[swz];
+        swz = get_swizzle(colormode, SWZ_SHIFT_G);
+        value |= to_unorm(pixel.g, max[swz]) << shift[swz];
+        swz = get_swizzle(colormode, SWZ_SHIFT_B);
+        value |= to_unorm(pixel.b, max[swz]) << shift[swz];
+
+        *reinterpret_cast<uint16_t *>(image.plane[0] + y * stride + x * 2) = value;
+    } else {
+        uint8_t *bytes = image.plane[0] + y * stride + x * 4;
+        // The byte without a component (X of XBGR) is filled with the maximum
+        uint8_t value[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+        auto component = [&](unsigned int shift, float v) {
+            unsigned int swz = get_swizzle(colormode, shift);
+            if (swz < 4)
+                value[swz] = static_cast<uint8_t>(to_unorm(v, 255));
+        };
+
+        component(SWZ_SHIFT_R, pixel.r);
+        component(SWZ_SHIFT_G, pixel.g);
+        component(SWZ_SHIFT_B, pixel.b);
+        component(SWZ_SHIFT_A, pixel.a);
+        std::copy_n(value, 4, bytes);
+    }
+}
+
+AcrylicFakeG2DDevice::Pixel AcrylicFakeG2DDevice::sample(const Job &job, const Image &image, float x, float y)
+{
+    const uint32_t *cmd = image.cmd;
+    int left = static_cast<int>(cmd[G2DSFR_IMG_LEFT]);
+    int top = static_cast<int>(cmd[G2DSFR_IMG_TOP]);
+    int right = static_cast<int>(cmd[G2DSFR_IMG_RIGHT]) - 1;
+    int bottom = static_cast<int>(cmd[G2DSFR_IMG_BOTTOM]) - 1;
+
+    if ((cmd[G2DSFR_SRC_SCALECONTROL] & 0xF) == 0)
+        return readPixel(job, image, std::clamp(static_cast<int>(x), left, right),
+                                     std::clamp(static_cast<int>(y), top, bottom));
+
+    // The polyphase filters are approximated by bilinear interpolation
+    x -= 0.5f;
+    y -= 0.5f;
+    float fx = x - std::floor(x), fy = y - std::floor(y);
+    int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y));
+    int x1 = std::clamp(x0 + 1, left, right), y1 = std::clamp(y0 + 1, top, bottom);
+    x0 = std::clamp(x0, left, right);
+    y0 = std::clamp(y0, top, bottom);
+
+    Pixel p00 = readPixel(job, image, x0, y0), p01 = readPixel(job, image, x1, y0);
+    Pixel p10 = readPixel(job, image, x0, y1), p11 = readPixel(job, image, x1, y1);
+    auto lerp = [&](float v00, float v01, float v10, float v11) {
+        return (v00 * (1 - fx) + v01 * fx) * (1 - fy) + (v10 * (1 - fx) + v11 * fx) * fy;
+    };
+
+    return {lerp(p00.r, p01.r, p10.r, p11.r), lerp(p00.g, p01.g, p10.g, p11.g),
+            lerp(p00.b, p01.b, p10.b, p11.b), lerp(p00.a, p01.a, p10.a, p11.a)};
+}
+
+void AcrylicFakeG2DDevice::compose(Job &job)
+{
+    Image &target = job.target;
+    int target_left = static_cast<int>(target.cmd[G2DSFR_IMG_LEFT]);
+    int target_top = static_cast<int>(target.cmd[G2DSFR_IMG_TOP]);
+    int target_right = static_cast<int>(std::min(target.cmd[G2DSFR_IMG_RIGHT],
+                                                 target.cmd[G2DSFR_IMG_WIDTH]));
+    int target_bottom = static_cast<int>(std::min(target.cmd[G2DSFR_IMG_BOTTOM],
+                                                  target.cmd[G2DSFR_IMG_HEIGHT]));
+
+    for (auto &source : job.sources) {
+        const uint32_t *cmd = source.cmd;
+        if (!(cmd[G2DSFR_SRC_COMMAND] & G2D_LAYERCMD_VALID))
+            continue;
+
+        int dst_left = static_cast<int>(cmd[G2DSFR_SRC_DSTLEFT]);
+        int dst_top = static_cast<int>(cmd[G2DSFR_SRC_DSTTOP]);
+        int win_width = static_cast<int>(cmd[G2DSFR_SRC_DSTRIGHT]) - dst_left;
+        int win_height = static_cast<int>(cmd[G2DSFR_SRC_DSTBOTTOM]) - dst_top;
+        if ((win_width <= 0) || (win_height <= 0))
+            continue;
+
+        float crop_left = cmd[G2DSFR_IMG_LEFT];
+        float crop_top = cmd[G2DSFR_IMG_TOP];
+        float crop_width = static_cast<float>(cmd[G2DSFR_IMG_RIGHT]) - crop_left;
+        float crop_height = static_cast<float>(cmd[G2DSFR_IMG_BOTTOM]) - crop_top;
+        bool rot90 = !!(cmd[G2DSFR_SRC_ROTATE] & G2D_ROTATEDIR_ROT90CCW);
+        unsigned int flip = cmd[G2DSFR_SRC_ROTATE] >> G2D_ROTATEDIR_FLIP_SHIFT;
+        bool colorfill = cmd[G2DSFR_SRC_SELECT] == G2D_LAYERSEL_COLORFILL;
+        bool opaque = !!(cmd[G2DSFR_SRC_COMMAND] & G2D_LAYERCMD_OPAQUE);
+        bool alpha_one = (cmd[G2DSFR_IMG_COLORMODE] & G2D_SWZ_ALPHA_MASK) == G2D_SWZ_ALPHA_ONE;
+        uint32_t blend = cmd[G2DSFR_SRC_BLEND];
+        float global_alpha = unorm(cmd[G2DSFR_SRC_ALPHA] & 0xFF, 255);
+
+        // The opaque layer only takes its global alpha if it is premultiplied explicitly
+        if (opaque && !(cmd[G2DSFR_SRC_COMMAND] & G2D_LAYERCMD_PREMULT_GLOBALALPHA))
+            global_alpha = 1.0f;
+
+        Pixel color = {unorm((cmd[G2DSFR_SRC_COLOR] >> 16) & 0xFF, 255),
+                       unorm((cmd[G2DSFR_SRC_COLOR] >> 8) & 0xFF, 255),
+                       unorm(cmd[G2DSFR_SRC_COLOR] & 0xFF, 255),
+                       unorm(cmd[G2DSFR_SRC_COLOR] >> 24, 255)};
+
+        for (int y = std::max(dst_top, target_top);
+                y < std::min(dst_top + win_height, target_bottom); y++) {
+            for (int x = std::max(dst_left, target_left);
+                    x < std::min(dst_left + win_width, target_right); x++) {
+                Pixel src = color;
+
+                if (!colorfill) {
+                    // normalized position in the crop in the source orientation
+                    float u = (x - dst_left + 0.5f) / win_width;
+                    float v = (y - dst_top + 0.5f) / win_height;
+                    float su = rot90 ? 1.0f - v : u;
+                    float sv = rot90 ? u : v;
+
+                    if (flip & 1)
+                        su = 1.0f - su;
+                    if (flip & 2)
+                        sv = 1.0f - sv;
+
+                    src = sample(job, source, crop_left + su * crop_width,
+                                 crop_top + sv * crop_height);
+                }
+
+                if (alpha_one)
+                    src.a = 1.0f;
+
+                Pixel dst = {0.0f, 0.0f, 0.0f, 0.0f};
+                if (!opaque)
+                    dst = readPixel(job, target, x, y);
+
+                Pixel out;
+                float src_factor, dst_factor;
+                switch (blend) {
+                    case G2D_BLEND_SRCCOPY:    // Ga*Sc
+                        src_factor = global_alpha;
+                        dst_factor = 0.0f;
+                        break;
+                    case G2D_BLEND_SRCOVER:    // Ga*Sc + (1-Sa*Ga)*Dc
+                        src_factor = global_alpha;
+                        dst_factor = 1.0f - src.a * global_alpha;
+                        break;
+                    case G2D_BLEND_NONE:       // Ga*Sa*Sc + (1-Sa*Ga)*Dc
+                        src_factor = global_alpha * src.a;
+                        dst_factor = 1.0f - src.a * global_alpha;
+                        break;
+                    default:                   // plain copy like the background color
+                        src_factor = 1.0f;
+                        dst_factor = 0.0f;
+                        global_alpha = 1.0f;
+                        break;
+                }
+
+                out.r = src.r * src_factor + dst.r * dst_factor;
+                out.g = src.g * src_factor + dst.g * dst_factor;
+                out.b = src.b * src_factor + dst.b * dst_factor;
+                out.a = opaque ? 1.0f : (src.a * global_alpha + dst.a * dst_factor);
+
+                writePixel(target, x, y, out);
+            }
+        }
+    }
+}
+
+void AcrylicFakeG2DDevice::run(Job &job)
+{
+    for (int fence : job.acquire_fences) {
+        wait_fence(fence, -1);
+        ::close(fence);
+    }
+
+    if (job.compose)
+        compose(job);
+
+    unmapImage(job.target);
+    for (auto &image : job.sources)
+        unmapImage(image);
+
+    if (mLaptimeUSec > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(mLaptimeUSec));
+
+    // Counted before signaling so that the waiters of the fence see the count
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mCompletedCount++;
+    }
+
+    if (job.release_fence >= 0) {
+        uint64_t signal = 1;
+        if (::write(job.release_fence, &signal, sizeof(signal)) != sizeof(signal))
+            ALOGERR("Failed to signal release fence %d", job.release_fence);
+        ::close(job.release_fence);
+    }
+}
+
+void AcrylicFakeG2DDevice::worker()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    for (;;) {
+        mCond.wait(lock, [this] { return mExit || !mQueue.empty(); });
+        // Drain the queue before exiting so that no release fence is left unsignaled
+        if (mQueue.empty())
+            return;
+
+        Job job = std::move(mQueue.front());
+        mQueue.pop_front();
+
+        lock.unlock();
+        run(job);
+        lock.lock();
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HARDWARE_EXYNOS_ACRYLIC_G2D_FAKE_H__
+#define __HARDWARE_EXYNOS_ACRYLIC_G2D_FAKE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <uapi/g2d.h>
+
+#include "acrylic_device.h"
+
+/*
+ * AcrylicDevice that emulates the G2D driver without the hardware so that
+ * AcrylicCompositorG2D can run on a host. It accepts the same ioctl commands
+ * as /dev/g2d. A task waits for its acquire fences, composes its sources on
+ * the CPU, takes the configured extra processing time and then signals its
+ * release fences. Nonblocking tasks are processed in order by a worker thread
+ * like the job queue of the driver. Release fences are eventfd descriptors
+ * that become readable when they are signaled, so users can poll them like
+ * sync_file fences.
+ *
+ * The composition follows the layer commands: color fill, crop, scaling with
+ * nearest or bilinear sampling (polyphase filters are approximated by
+ * bilinear), rotation and flip, YCbCr to RGB conversion with the CSC matrices
+ * in the extra registers and the blending equations of G2D_BLEND_*.
+ * Sources are RGB 8888/565 or NV12/NV21 and the target is RGB 8888/565.
+ * Compressed, 10-bit and other formats are rejected with EINVAL. Buffers are
+ * either user pointers or dmabufs that can be mmap()ed like memfd.
+ */
+class AcrylicFakeG2DDevice: public AcrylicDevice {
+public:
+    AcrylicFakeG2DDevice(unsigned int laptime_usec = 0);
+    virtual ~AcrylicFakeG2DDevice();
+    virtual int ioctl(int cmd, void *arg);
+    /*
+     * Obtain the number of tasks completed so far
+     */
+    unsigned int getCompletedCount();
+    /*
+     * Obtain the largest number of tasks queued at the same time
+     */
+    unsigned int getMaxQueueDepth();
+private:
+    enum { CSC_MATRIX_COUNT = 4, CSC_MATRIX_REGISTER_COUNT = 9 };
+
+    struct Pixel {
+        float r, g, b, a;
+    };
+
+    struct Image {
+        uint32_t cmd[G2DSFR_SRC_FIELD_COUNT];
+        uint32_t flags;
+        uint8_t *plane[G2D_MAX_BUFFERS];
+        std::vector<std::pair<void *, size_t>> mappings;
+    };
+
+    struct Job {
+        std::vector<int> acquire_fences;
+        int release_fence;
+        bool compose;
+        Image target;
+        std::vector<Image> sources;
+        float csc[CSC_MATRIX_COUNT][CSC_MATRIX_REGISTER_COUNT];
+    };
+
+    int process(g2d_task &task);
+    bool prepareJob(g2d_task &task, Job &job);
+    bool mapImage(const g2d_layer &layer, const uint32_t cmd[], unsigned int count, Image &image);
+    void unmapImage(Image &image);
+    void compose(Job &job);
+    Pixel readPixel(const Job &job, const Image &image, int x, int y);
+    Pixel sample(const Job &job, const Image &image, float x, float y);
+    void writePixel(Image &image, int x, int y, const Pixel &pixel);
+    void run(Job &job);
+    void worker();
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::deque<Job> mQueue;
+    std::thread mThread;
+    bool mExit;
+
+    unsigned int mLaptimeUSec;
+    unsigned int mCompletedCount;
+    unsigned int mMaxQueueDepth;
+};
+
+#endif //__HARDWARE_EXYNOS_ACRYLIC_G2D_FAKE_H__
@@ -122,4 +122,11 @@ uint8_t halfmt_chroma_subsampling(uint32_t fmt);
 unsigned int halfmt_bpp(uint32_t fmt);
 uint8_t halfmt_plane_count(uint32_t fmt);
 
+/*
+ * Wait for @fence to be signaled for @timeout_msec milliseconds at most.
+ * A negative @timeout_msec waits forever. Returns true if @fence is signaled
+ * or invalid (negative).
+ */
+bool wait_fence(int fence, int timeout_msec);
+
 #endif /* __HARDWARE_EXYNOS_ACRYLIC_INTERNAL_H__ */
@@ -110,7 +110,7 @@ bool AcrylicCanvas::setImageBuffer(int a, int r, int g, int b, uint32_t attr)
     mMemoryType = MT_EMPTY;
     mNumBuffers = 0;
 
-    mAttributes = (attr & ATTR_ALL_MASK) | ATTR_SOLIDCOLOR;
+    setAttributes((attr & ATTR_ALL_MASK) | ATTR_SOLIDCOLOR);
 
     set(SETTING_BUFFER | SETTING_BUFFER_MODIFIED);
 
@@ -168,7 +168,7 @@ bool AcrylicCanvas::setImageBuffer(int fd[MAX_HW2D_PLANES], size_t len[MAX_HW2D_
     mMemoryType = MT_DMABUF;
     mNumBuffers = num_buffers;
 
-    mAttributes = attr & ATTR_ALL_MASK;
+    setAttributes(attr & ATTR_ALL_MASK);
     ALOGD_TEST("Configured buffer: fence %d, type %d, count %d, attr %#x (type: %s)",
                mFence, mMemoryType, mNumBuffers, mAttributes, canvasTypeName(mCanvasType));
 
@@ -220,7 +220,7 @@ bool AcrylicCanvas::setImageBuffer(void *addr[MAX_HW2D_PLANES], size_t len[MAX_H
     mMemoryType = MT_USERPTR;
     mNumBuffers = num_buffers;
 
-    mAttributes = attr & ATTR_ALL_MASK;
+    setAttributes(attr & ATTR_ALL_MASK);
 
     ALOGD_TEST("Configured buffer: fence %d, type %d, count %d, attr %#x (type: %s)",
                mFence, mMemoryType, mNumBuffers, mAttributes, canvasTypeName(mCanvasType));
@@ -249,7 +249,7 @@ bool AcrylicCanvas::setImageOTFBuffer(uint32_t attr)
     mMemoryType = MT_EMPTY;
     mNumBuffers = 0;
 
-    mAttributes = (attr & ATTR_ALL_MASK) | ATTR_OTF;
+    setAttributes((attr & ATTR_ALL_MASK) | ATTR_OTF);
 
     set(SETTING_BUFFER | SETTING_BUFFER_MODIFIED);
 
@@ -292,6 +292,16 @@ bool AcrylicCanvas::setImageType(uint32_t fmt, int dataspace)
     return true;
 }
 
+void AcrylicCanvas::setAttributes(uint32_t attr)
+{
+    // Attributes such as compression and U-order change how the image is encoded
+    // in the commands to HW while the buffer itself is replaced on every frame.
+    if (mAttributes != attr)
+        set(SETTING_TYPE_MODIFIED);
+
+    mAttributes = attr;
+}
+
 void AcrylicCanvas::setFence(int fence)
 {
     if (mFence >= 0)
@@ -314,6 +324,8 @@ AcrylicLayer::AcrylicLayer(Acrylic *compositor)
     // - target area: full area of the target image
     mTargetRect.pos = {0, 0};
     mTargetRect.size = {0, 0};
+
+    set(SETTING_COMPOSIT_MODIFIED);
 }
 
 AcrylicLayer::~AcrylicLayer()
@@ -324,6 +336,10 @@ AcrylicLayer::~AcrylicLayer()
 
 bool AcrylicLayer::setCompositMode(uint32_t mode, uint8_t alpha, int z_order)
 {
+    if (((getSettingFlags() & SETTING_COMPOSIT_MODIFIED) == 0) &&
+            (mode == mBlendingMode) && (alpha == mPlaneAlpha) && (z_order == mZOrder))
+        return true;
+
     if (!getCompositor()) {
         ALOGE("Trying to set compositing mode to an orphaned layer");
         return false;
@@ -363,6 +379,8 @@ bool AcrylicLayer::setCompositMode(uint32_t mode, uint8_t alpha, int z_order)
     mZOrder = z_order;
     mPlaneAlpha = alpha;
 
+    set(SETTING_COMPOSIT_MODIFIED);
+
     ALOGD_TEST("Configured compositing mode: mode %d, z-order %d, alpha %d",
                mBlendingMode, mZOrder, mPlaneAlpha);
 
@@ -455,19 +473,29 @@ bool AcrylicLayer::setCompositArea(hwc_rect_t &src_area, hwc_rect_t &out_area, u
         }
     }
 
-    mTargetRect.pos.hori = static_cast<int16_t>(out_area.left);
-    mTargetRect.pos.vert = static_cast<int16_t>(out_area.top);
-    mTargetRect.size.hori = static_cast<int16_t>(get_width(out_area));
-    mTargetRect.size.vert = static_cast<int16_t>(get_height(out_area));
+    hw2d_rect_t target_rect, image_rect;
 
-    mImageRect.pos.hori = static_cast<int16_t>(src_area.left);
-    mImageRect.pos.vert = static_cast<int16_t>(src_area.top);
-    mImageRect.size.hori = static_cast<int16_t>(get_width(src_area));
-    mImageRect.size.vert = static_cast<int16_t>(get_height(src_area));
+    target_rect.pos.hori = static_cast<int16_t>(out_area.left);
+    target_rect.pos.vert = static_cast<int16_t>(out_area.top);
+    target_rect.size.hori = static_cast<int16_t>(get_width(out_area));
+    target_rect.size.vert = static_cast<int16_t>(get_height(out_area));
 
+    image_rect.pos.hori = static_cast<int16_t>(src_area.left);
+    image_rect.pos.vert = static_cast<int16_t>(src_area.top);
+    image_rect.size.hori = static_cast<int16_t>(get_width(src_area));
+    image_rect.size.vert = static_cast<int16_t>(get_height(src_area));
+
+    if ((target_rect == mTargetRect) && (image_rect == mImageRect) &&
+            (transform == mTransform) && ((attr & ATTR_ALL_MASK) == mCompositAttr))
+        return true;
+
+    mTargetRect = target_rect;
+    mImageRect = image_rect;
     mTransform = transform;
     mCompositAttr = attr & ATTR_ALL_MASK;
 
+    set(SETTING_COMPOSIT_MODIFIED);
+
     ALOGD_TEST("Configured area: %dx%d@%dx%d -> %dx%d@%dx%d, transform: %d, attr: %#x",
                 mImageRect.size.hori, mImageRect.size.vert, mImageRect.pos.hori, mImageRect.pos.vert,
                 mTargetRect.size.hori, mTargetRect.size.vert, mTargetRect.pos.hori, mTargetRect.pos.vert,
@@ -548,7 +576,14 @@ void AcrylicLayer::importLayer(AcrylicLayer &other, bool inherit_transform)
     }
 
     other.clearFence();
+
+    if ((mImageRect == other.mImageRect) &&
+            (!inherit_transform || (mTransform == other.mTransform)))
+        return;
+
     mImageRect = other.mImageRect;
     if (inherit_transform)
         mTransform = other.mTransform;
+
+    set(SETTING_COMPOSIT_MODIFIED);
 }
@@ -480,6 +480,10 @@ public:
      *                            it is not applied to HW yet.
      * - SETTING_DIMENSION_MODIFIED: Image dimension information is configured by users
      *                               and it is not applied to HW yet.
+     * - SETTING_COMPOSIT_MODIFIED: Compositing mode, area or transform of a layer is
+     *                              configured by users and it is not applied to HW yet.
+     *                              Changes of the buffer attributes are reported as
+     *                              SETTING_TYPE_MODIFIED because they change the image encoding.
      */
     enum setting_check_t {
         SETTING_TYPE = 1,
@@ -489,7 +493,9 @@ public:
         SETTING_TYPE_MODIFIED = 16,
         SETTING_BUFFER_MODIFIED = 32,
         SETTING_DIMENSION_MODIFIED = 64,
-        SETTIMG_MODIFIED_MASK = SETTING_TYPE_MODIFIED | SETTING_BUFFER_MODIFIED | SETTING_DIMENSION_MODIFIED,
+        SETTING_COMPOSIT_MODIFIED = 128,
+        SETTIMG_MODIFIED_MASK = SETTING_TYPE_MODIFIED | SETTING_BUFFER_MODIFIED | SETTING_DIMENSION_MODIFIED |
+                                SETTING_COMPOSIT_MODIFIED,
     };
 
     /*
@@ -661,7 +667,8 @@ public:
     {
         unset(SETTING_TYPE_MODIFIED |
               SETTING_BUFFER_MODIFIED |
-              SETTING_DIMENSION_MODIFIED);
+              SETTING_DIMENSION_MODIFIED |
+              SETTING_COMPOSIT_MODIFIED);
     }
     /*
      * Obtain the flags that indicates the configuration status
@@ -692,6 +699,11 @@ private:
      * that no Acrylic has a reference to it.
      */
     void disconnectLayer() { mCompositor = NULL; }
+    /*
+     * Replace the buffer attributes. SETTING_TYPE_MODIFIED is set if they differ
+     * from the current attributes.
+     */
+    void setAttributes(uint32_t attr);
 
     hw2d_coord_t mImageDimension;
     uint32_t mPixFormat;
@@ -997,6 +1009,21 @@ public:
      * has been destroyed, all configuration to AcrylicLayer have no effect.
      */
     AcrylicLayer *createLayer();
+    /*
+     * Exclude an AcrylicLayer from the following executions without destroying
+     * it. The layer keeps all its configuration and is composited again after
+     * attachLayer(). Both are no-ops if the layer is already in the requested
+     * state. attachLayer() fails if the number of attached layers is already
+     * mCapability.maxLayerCount().
+     */
+    bool detachLayer(AcrylicLayer *layer);
+    bool attachLayer(AcrylicLayer *layer);
+    /*
+     * Move an AcrylicLayer created by another Acrylic of the same capability to
+     * this Acrylic. The layer keeps all its configuration and is detached until
+     * attachLayer(). It is a no-op if the layer already belongs to this Acrylic.
+     */
+    bool adoptLayer(AcrylicLayer *layer);
     /*
      * Obtain HW2DCapability object to study the capability fo HW 2D that the
      * Acrylic handles.
@@ -1141,12 +1168,15 @@ public:
      */
     virtual bool execute(int *handle = NULL) = 0;
     /*
-     * Release @handle informed by execute()
+     * Release @handle informed by execute() without waiting for HW 2D. The
+     * implementations that keep track of the handles should override it.
      */
     virtual void releaseHandle(int __attribute__((__unused__)) handle) { }
     /*
      * Wait HW 2D to finish the processing associated with @handle. The handle
-     * is released after the wait completes.
+     * is released after the wait completes. It returns false if the processing
+     * does not complete in time, including the case that the implementation
+     * has already given up waiting for it and released the handle by itself.
      */
     virtual bool waitExecution(int handle) = 0;
     /*
@@ -1220,6 +1250,7 @@ protected:
     void *getTargetDisplayInfo() { return mTargetDisplayInfo; }
 private:
     std::vector<AcrylicLayer *> mLayers;
+    std::vector<AcrylicLayer *> mDetachedLayers;
     const HW2DCapability &mCapability;
     struct {
         uint16_t R;
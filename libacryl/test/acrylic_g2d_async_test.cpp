@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "acrylic_test_fixture.h"
+
+class AcrylicG2DAsyncTest : public AcrylicG2DTest {
+public:
+    AcrylicG2DAsyncTest() { mLaptimeUSec = 10000; }
+};
+
+TEST_F(AcrylicG2DAsyncTest, WaitExecutionCompletesTask)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    ASSERT_NE(createLayer(32, 32, 0xFF0000FF, window, 0), nullptr);
+
+    int handle = -1;
+    ASSERT_TRUE(mCompositor->execute(&handle));
+    EXPECT_GT(handle, 0);
+    EXPECT_TRUE(mCompositor->waitExecution(handle));
+    EXPECT_EQ(mDevice->getCompletedCount(), 1U);
+    EXPECT_EQ(getTargetPixel(0, 0), 0xFF0000FFU);
+
+    // The handle is released by the wait
+    EXPECT_TRUE(mCompositor->waitExecution(handle));
+}
+
+TEST_F(AcrylicG2DAsyncTest, InflightTasksAreBounded)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    AcrylicLayer *layer = createLayer(32, 32, 0xFF0000FF, window, 0);
+    ASSERT_NE(layer, nullptr);
+
+    const int count = 10;
+    int handles[count];
+    for (int i = 0; i < count; i++) {
+        configureLayer(layer, window, 0);
+        ASSERT_TRUE(mCompositor->execute(&handles[i]));
+        if (i > 0) {
+            EXPECT_NE(handles[i], handles[i - 1]);
+        }
+    }
+    EXPECT_LE(mDevice->getMaxQueueDepth(), 4U);
+
+    for (int i = 0; i < count; i++)
+        EXPECT_TRUE(mCompositor->waitExecution(handles[i]));
+    EXPECT_EQ(mDevice->getCompletedCount(), static_cast<unsigned int>(count));
+}
+
+TEST_F(AcrylicG2DAsyncTest, ReleasedHandleDoesNotBlock)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    ASSERT_NE(createLayer(32, 32, 0xFF0000FF, window, 0), nullptr);
+
+    int handle = -1;
+    ASSERT_TRUE(mCompositor->execute(&handle));
+    mCompositor->releaseHandle(handle);
+    EXPECT_TRUE(mCompositor->waitExecution(handle));
+}
+
+TEST_F(AcrylicG2DAsyncTest, TimedOutTaskReportsFailure)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    AcrylicLayer *layer = createLayer(32, 32, 0xFF0000FF, window, 0);
+    ASSERT_NE(layer, nullptr);
+
+    // The first task waits for an acquire fence that is not signaled in time
+    int acquire = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(acquire, 0);
+    layer->setFence(dup(acquire));
+
+    int handles[5];
+    for (int i = 0; i < 5; i++) {
+        configureLayer(layer, window, 0);
+        ASSERT_TRUE(mCompositor->execute(&handles[i]));
+    }
+
+    uint64_t signal = 1;
+    ASSERT_EQ(write(acquire, &signal, sizeof(signal)), static_cast<ssize_t>(sizeof(signal)));
+    close(acquire);
+
+    EXPECT_FALSE(mCompositor->waitExecution(handles[0]));
+    for (int i = 1; i < 5; i++)
+        EXPECT_TRUE(mCompositor->waitExecution(handles[i]));
+}
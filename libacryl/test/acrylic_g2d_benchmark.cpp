@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures AcrylicCompositorG2D::execute() on AcrylicFakeG2DDevice for a layer stack that is
+// unchanged between frames and for one that changes a layer on every frame.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include <hardware/exynos/acryl.h>
+#include <hardware/hwcomposer2.h>
+#include <system/graphics.h>
+
+#include "acrylic_g2d.h"
+#include "acrylic_g2d_fake.h"
+
+namespace {
+
+uint32_t bench_formats[] = {HAL_PIXEL_FORMAT_RGBA_8888};
+int bench_dataspaces[] = {HAL_DATASPACE_SRGB & ~HAL_DATASPACE_TRANSFER_MASK};
+
+const stHW2DCapability bench_capability = {
+    .max_upsampling_num = {8, 8},
+    .max_downsampling_factor = {4, 4},
+    .max_upsizing_num = {8, 8},
+    .max_downsizing_factor = {4, 4},
+    .min_src_dimension = {1, 1},
+    .max_src_dimension = {8192, 8192},
+    .min_dst_dimension = {1, 1},
+    .max_dst_dimension = {8192, 8192},
+    .min_pix_align = {1, 1},
+    .rescaling_count = 0,
+    .compositing_mode = HW2DCapability::BLEND_NONE | HW2DCapability::BLEND_SRC_COPY |
+                        HW2DCapability::BLEND_SRC_OVER,
+    .transform_type = HW2DCapability::TRANSFORM_ALL,
+    .auxiliary_feature = HW2DCapability::FEATURE_PLANE_ALPHA,
+    .num_formats = 1,
+    .num_dataspaces = 1,
+    .max_layers = 16,
+    .pixformats = bench_formats,
+    .dataspaces = bench_dataspaces,
+    .base_align = 1,
+};
+
+constexpr int kTargetSize = 256;
+constexpr int kLayerSize = 64;
+
+struct Composition {
+    explicit Composition(int numLayers)
+          : capability(bench_capability),
+            compositor(capability, false, std::make_unique<AcrylicFakeG2DDevice>(0)),
+            target(kTargetSize * kTargetSize) {
+        void *addr[1] = {target.data()};
+        size_t len[1] = {target.size() * sizeof(target[0])};
+        compositor.setCanvasDimension(kTargetSize, kTargetSize);
+        compositor.setCanvasImageType(HAL_PIXEL_FORMAT_RGBA_8888, HAL_DATASPACE_SRGB);
+        compositor.setCanvasBuffer(addr, len, 1);
+
+        for (int i = 0; i < numLayers; i++) {
+            images.emplace_back(kLayerSize * kLayerSize, 0x80000000U | (i * 0x102030));
+            layers.emplace_back(compositor.createLayer());
+
+            void *laddr[1] = {images.back().data()};
+            size_t llen[1] = {images.back().size() * sizeof(uint32_t)};
+            layers.back()->setImageDimension(kLayerSize, kLayerSize);
+            layers.back()->setImageType(HAL_PIXEL_FORMAT_RGBA_8888, HAL_DATASPACE_SRGB);
+            layers.back()->setImageBuffer(laddr, llen, 1);
+            configure(i, 0xFF);
+        }
+    }
+
+    // Configures a layer as HWC does on every frame
+    void configure(int index, unsigned int alpha) {
+        hwc_rect_t crop = {0, 0, kLayerSize, kLayerSize};
+        int offset = index * (kTargetSize - kLayerSize * 2) / static_cast<int>(layers.size());
+        hwc_rect_t window = {offset, offset, offset + kLayerSize * 2, offset + kLayerSize * 2};
+
+        layers[index]->setCompositArea(crop, window);
+        layers[index]->setCompositMode(HWC2_BLEND_MODE_PREMULTIPLIED, alpha, index);
+    }
+
+    HW2DCapability capability;
+    AcrylicCompositorG2D compositor;
+    std::vector<uint32_t> target;
+    std::vector<std::vector<uint32_t>> images;
+    std::vector<std::unique_ptr<AcrylicLayer>> layers;
+};
+
+void BM_ExecuteUnchanged(benchmark::State &state) {
+    Composition comp(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < comp.layers.size(); i++)
+            comp.configure(static_cast<int>(i), 0xFF);
+        benchmark::DoNotOptimize(comp.compositor.execute(static_cast<int *>(nullptr)));
+    }
+    state.counters["cache_hits"] = comp.compositor.getSourceCacheHitCount();
+}
+BENCHMARK(BM_ExecuteUnchanged)->Arg(1)->Arg(4)->Arg(8);
+
+void BM_ExecuteChanged(benchmark::State &state) {
+    Composition comp(static_cast<int>(state.range(0)));
+    unsigned int alpha = 0xFF;
+
+    for (auto _ : state) {
+        alpha = (alpha == 0xFF) ? 0xFE : 0xFF;
+        for (size_t i = 0; i < comp.layers.size(); i++)
+            comp.configure(static_cast<int>(i), alpha);
+        benchmark::DoNotOptimize(comp.compositor.execute(static_cast<int *>(nullptr)));
+    }
+    state.counters["cache_hits"] = comp.compositor.getSourceCacheHitCount();
+}
+BENCHMARK(BM_ExecuteChanged)->Arg(1)->Arg(4)->Arg(8);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <sys/ioctl.h>
+
+#include <cstring>
+
+#include <hardware/hwcomposer2.h>
+#include <system/graphics.h>
+
+#include "acrylic_test_fixture.h"
+
+static bool isNear(uint32_t pixel, uint32_t expected, unsigned int tolerance)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        int diff = static_cast<int>((pixel >> shift) & 0xFF) -
+                   static_cast<int>((expected >> shift) & 0xFF);
+        if (static_cast<unsigned int>(std::abs(diff)) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+TEST_F(AcrylicG2DTest, FakeScalesSource)
+{
+    hwc_rect_t window = {0, 0, TARGET_WIDTH, TARGET_HEIGHT};
+    ASSERT_NE(createLayer(32, 32, 0xFF0000FF, window, 0), nullptr);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    EXPECT_EQ(getTargetPixel(0, 0), 0xFF0000FFU);
+    EXPECT_EQ(getTargetPixel(TARGET_WIDTH - 1, TARGET_HEIGHT - 1), 0xFF0000FFU);
+    EXPECT_EQ(mDevice->getCompletedCount(), 1U);
+}
+
+TEST_F(AcrylicG2DTest, FakeRotatesSource)
+{
+    // Column 0 is blue and the others are green, rotation by 90 puts column 0 on the top
+    hwc_rect_t window = {40, 0, 42, 4};
+    AcrylicLayer *layer = createLayer(4, 2, 0xFF00FF00, window, 0);
+    ASSERT_NE(layer, nullptr);
+    mImages.back()[0] = 0xFFFF0000;
+    mImages.back()[4] = 0xFFFF0000;
+
+    hwc_rect_t crop = {0, 0, 4, 2};
+    ASSERT_TRUE(layer->setCompositArea(crop, window, HAL_TRANSFORM_ROT_90));
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    EXPECT_EQ(getTargetPixel(40, 0), 0xFFFF0000U);
+    EXPECT_EQ(getTargetPixel(41, 0), 0xFFFF0000U);
+    EXPECT_EQ(getTargetPixel(40, 3), 0xFF00FF00U);
+    EXPECT_EQ(getTargetPixel(39, 0), 0U);
+}
+
+TEST_F(AcrylicG2DTest, FakeConvertsYCbCr)
+{
+    // Limited range mid grey
+    static uint8_t nv21[16 * 16 * 3 / 2];
+    memset(nv21, 126, 16 * 16);
+    memset(nv21 + 16 * 16, 128, 16 * 8);
+
+    mLayers.emplace_back(mCompositor->createLayer());
+    AcrylicLayer *layer = mLayers.back().get();
+    ASSERT_NE(layer, nullptr);
+    void *addr[1] = {nv21};
+    size_t len[1] = {sizeof(nv21)};
+    ASSERT_TRUE(layer->setImageDimension(16, 16));
+    ASSERT_TRUE(layer->setImageType(HAL_PIXEL_FORMAT_YCrCb_420_SP, HAL_DATASPACE_BT601_625));
+    ASSERT_TRUE(layer->setImageBuffer(addr, len, 1));
+    configureLayer(layer, hwc_rect_t{0, 48, 16, 64}, 0);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    EXPECT_TRUE(isNear(getTargetPixel(5, 50), 0xFF7F7F7F, 2)) << std::hex << getTargetPixel(5, 50);
+}
+
+TEST_F(AcrylicG2DTest, FakeBlendsSolidColorWithPlaneAlpha)
+{
+    hwc_rect_t window = {0, 0, TARGET_WIDTH, TARGET_HEIGHT};
+    ASSERT_NE(createLayer(32, 32, 0xFF0000FF, window, 0), nullptr);
+
+    mLayers.emplace_back(mCompositor->createLayer());
+    AcrylicLayer *layer = mLayers.back().get();
+    ASSERT_NE(layer, nullptr);
+    ASSERT_TRUE(layer->setImageDimension(TARGET_WIDTH, TARGET_HEIGHT));
+    ASSERT_TRUE(layer->setImageType(HAL_PIXEL_FORMAT_RGBA_8888, HAL_DATASPACE_SRGB));
+    ASSERT_TRUE(layer->setImageBuffer(0xFF, 0, 0, 0xFF));
+    hwc_rect_t crop = {0, 0, 32, 32};
+    hwc_rect_t area = {32, 32, 64, 64};
+    ASSERT_TRUE(layer->setCompositArea(crop, area));
+    ASSERT_TRUE(layer->setCompositMode(HWC2_BLEND_MODE_PREMULTIPLIED, 0x80, 1));
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    // Half blue over red
+    EXPECT_TRUE(isNear(getTargetPixel(40, 40), 0xFF7F007F, 1)) << std::hex << getTargetPixel(40, 40);
+    EXPECT_EQ(getTargetPixel(8, 8), 0xFF0000FFU);
+}
+
+TEST_F(AcrylicG2DTest, FakeRejectsUnsupportedTarget)
+{
+    g2d_task task{};
+    g2d_layer target{};
+    uint32_t commands[G2DSFR_DST_FIELD_COUNT] = {};
+
+    target.buffer_type = G2D_BUFTYPE_USERPTR;
+    target.num_buffers = 1;
+    target.buffer[0].userptr = mTarget.data();
+    target.buffer[0].length = mTarget.size() * sizeof(mTarget[0]);
+    commands[G2DSFR_IMG_COLORMODE] = G2D_FMT_NV12;
+    commands[G2DSFR_IMG_WIDTH] = TARGET_WIDTH;
+    commands[G2DSFR_IMG_HEIGHT] = TARGET_HEIGHT;
+    task.target = target;
+    task.commands.target = commands;
+
+    errno = 0;
+    EXPECT_EQ(mDevice->ioctl(G2D_IOC_PROCESS, &task), -1);
+    EXPECT_EQ(errno, EINVAL);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <hardware/hwcomposer2.h>
+
+#include "acrylic_test_fixture.h"
+
+TEST_F(AcrylicG2DTest, UnchangedSettingsAreNotModified)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    AcrylicLayer *layer = createLayer(32, 32, 0xFF0000FF, window, 0);
+    ASSERT_NE(layer, nullptr);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+    EXPECT_EQ(layer->getSettingFlags() & AcrylicCanvas::SETTING_COMPOSIT_MODIFIED, 0U);
+
+    configureLayer(layer, window, 0);
+    EXPECT_EQ(layer->getSettingFlags() & AcrylicCanvas::SETTING_COMPOSIT_MODIFIED, 0U);
+
+    hwc_rect_t moved = {8, 8, 40, 40};
+    configureLayer(layer, moved, 0);
+    EXPECT_NE(layer->getSettingFlags() & AcrylicCanvas::SETTING_COMPOSIT_MODIFIED, 0U);
+}
+
+TEST_F(AcrylicG2DTest, ChangedCompositModeIsModified)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    AcrylicLayer *layer = createLayer(32, 32, 0xFF0000FF, window, 0);
+    ASSERT_NE(layer, nullptr);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    EXPECT_TRUE(layer->setCompositMode(HWC2_BLEND_MODE_PREMULTIPLIED, 0x80, 0));
+    EXPECT_NE(layer->getSettingFlags() & AcrylicCanvas::SETTING_COMPOSIT_MODIFIED, 0U);
+}
+
+TEST_F(AcrylicG2DTest, ImportingSameLayerIsNotModified)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    AcrylicLayer *layer = createLayer(32, 32, 0xFF0000FF, window, 0);
+    AcrylicLayer *copy = createLayer(32, 32, 0xFF00FF00, window, 1);
+    ASSERT_NE(layer, nullptr);
+    ASSERT_NE(copy, nullptr);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    copy->importLayer(*layer, false);
+    EXPECT_EQ(copy->getSettingFlags() & AcrylicCanvas::SETTING_COMPOSIT_MODIFIED, 0U);
+}
+
+TEST_F(AcrylicG2DTest, IdenticalFrameHitsSourceCache)
+{
+    hwc_rect_t window0 = {0, 0, 32, 32};
+    hwc_rect_t window1 = {16, 16, 64, 64};
+    AcrylicLayer *layer0 = createLayer(32, 32, 0xFF0000FF, window0, 0);
+    AcrylicLayer *layer1 = createLayer(16, 16, 0xFF00FF00, window1, 1);
+    ASSERT_NE(layer0, nullptr);
+    ASSERT_NE(layer1, nullptr);
+
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+    EXPECT_EQ(mCompositor->getSourceCacheHitCount(), 0U);
+
+    configureLayer(layer0, window0, 0);
+    configureLayer(layer1, window1, 1);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+    EXPECT_EQ(mCompositor->getSourceCacheHitCount(), 2U);
+    EXPECT_EQ(getTargetPixel(0, 0), 0xFF0000FFU);
+    EXPECT_EQ(getTargetPixel(40, 40), 0xFF00FF00U);
+
+    // Only the moved layer is compiled again
+    hwc_rect_t moved = {0, 32, 32, 64};
+    configureLayer(layer0, window0, 0);
+    configureLayer(layer1, moved, 1);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+    EXPECT_EQ(mCompositor->getSourceCacheHitCount(), 3U);
+}
+
+TEST_F(AcrylicG2DTest, AdoptedLayerKeepsSettingsAndDropsStaleCommands)
+{
+    hwc_rect_t window = {0, 0, 32, 32};
+    AcrylicLayer *layer = createLayer(32, 32, 0xFF0000FF, window, 0);
+    ASSERT_NE(layer, nullptr);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+
+    AcrylicCompositorG2D other(*mCapability, false, std::make_unique<AcrylicFakeG2DDevice>(0));
+    std::vector<uint32_t> otherTarget(TARGET_WIDTH * TARGET_HEIGHT, 0);
+    void *addr[1] = {otherTarget.data()};
+    size_t len[1] = {otherTarget.size() * sizeof(otherTarget[0])};
+    ASSERT_TRUE(other.setCanvasDimension(TARGET_WIDTH, TARGET_HEIGHT));
+    ASSERT_TRUE(other.setCanvasImageType(HAL_PIXEL_FORMAT_RGBA_8888, HAL_DATASPACE_SRGB));
+    ASSERT_TRUE(other.setCanvasBuffer(addr, len, 1));
+
+    ASSERT_TRUE(other.adoptLayer(layer));
+    EXPECT_EQ(mCompositor->layerCount(), 0U);
+    EXPECT_EQ(other.layerCount(), 0U);
+    ASSERT_TRUE(other.attachLayer(layer));
+    ASSERT_TRUE(other.execute(static_cast<int *>(nullptr)));
+    EXPECT_EQ(otherTarget[0], 0xFF0000FFU);
+
+    // Move the layer while it is away, the first compositor must not reuse its commands
+    hwc_rect_t moved = {32, 32, 64, 64};
+    configureLayer(layer, moved, 0);
+    ASSERT_TRUE(other.execute(static_cast<int *>(nullptr)));
+
+    ASSERT_TRUE(mCompositor->adoptLayer(layer));
+    ASSERT_TRUE(mCompositor->attachLayer(layer));
+    mTarget.assign(mTarget.size(), 0);
+    configureLayer(layer, moved, 0);
+    ASSERT_TRUE(mCompositor->execute(static_cast<int *>(nullptr)));
+    EXPECT_EQ(getTargetPixel(0, 0), 0U);
+    EXPECT_EQ(getTargetPixel(40, 40), 0xFF0000FFU);
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <hardware/hwcomposer2.h>
+#include <system/graphics.h>
+
+#include "acrylic_test_fixture.h"
+
+static uint32_t test_formats[] = {
+    HAL_PIXEL_FORMAT_RGBA_8888,
+    HAL_PIXEL_FORMAT_RGB_565,
+    HAL_PIXEL_FORMAT_YCrCb_420_SP,
+};
+
+static int test_dataspaces[] = {
+    HAL_DATASPACE_SRGB & ~HAL_DATASPACE_TRANSFER_MASK,
+    HAL_DATASPACE_BT601_625 & ~HAL_DATASPACE_TRANSFER_MASK,
+    HAL_DATASPACE_JFIF & ~HAL_DATASPACE_TRANSFER_MASK,
+};
+
+static const stHW2DCapability test_capability = {
+    .max_upsampling_num = {8, 8},
+    .max_downsampling_factor = {4, 4},
+    .max_upsizing_num = {8, 8},
+    .max_downsizing_factor = {4, 4},
+    .min_src_dimension = {1, 1},
+    .max_src_dimension = {8192, 8192},
+    .min_dst_dimension = {1, 1},
+    .max_dst_dimension = {8192, 8192},
+    .min_pix_align = {1, 1},
+    .rescaling_count = 0,
+    .compositing_mode = HW2DCapability::BLEND_NONE | HW2DCapability::BLEND_SRC_COPY |
+                        HW2DCapability::BLEND_SRC_OVER,
+    .transform_type = HW2DCapability::TRANSFORM_ALL,
+    .auxiliary_feature = HW2DCapability::FEATURE_PLANE_ALPHA |
+                         HW2DCapability::FEATURE_SOLIDCOLOR,
+    .num_formats = sizeof(test_formats) / sizeof(test_formats[0]),
+    .num_dataspaces = sizeof(test_dataspaces) / sizeof(test_dataspaces[0]),
+    .max_layers = 16,
+    .pixformats = test_formats,
+    .dataspaces = test_dataspaces,
+    .base_align = 1,
+};
+
+AcrylicG2DTest::AcrylicG2DTest() : mLaptimeUSec(0), mDevice(nullptr)
+{
+}
+
+void AcrylicG2DTest::SetUp()
+{
+    mCapability = std::make_unique<HW2DCapability>(test_capability);
+    mDevice = new AcrylicFakeG2DDevice(mLaptimeUSec);
+    mCompositor = std::make_unique<AcrylicCompositorG2D>(*mCapability, false,
+                                                         std::unique_ptr<AcrylicDevice>(mDevice));
+    mTarget.assign(TARGET_WIDTH * TARGET_HEIGHT, 0);
+
+    void *addr[1] = {mTarget.data()};
+    size_t len[1] = {mTarget.size() * sizeof(mTarget[0])};
+    ASSERT_TRUE(mCompositor->setCanvasDimension(TARGET_WIDTH, TARGET_HEIGHT));
+    ASSERT_TRUE(mCompositor->setCanvasImageType(HAL_PIXEL_FORMAT_RGBA_8888, HAL_DATASPACE_SRGB));
+    ASSERT_TRUE(mCompositor->setCanvasBuffer(addr, len, 1));
+}
+
+void AcrylicG2DTest::TearDown()
+{
+    mLayers.clear();
+    mCompositor.reset();
+    mCapability.reset();
+}
+
+AcrylicLayer *AcrylicG2DTest::createLayer(int width, int height, uint32_t color,
+                                          hwc_rect_t window, int z_order)
+{
+    mImages.emplace_back(width * height, color);
+    mLayers.emplace_back(mCompositor->createLayer());
+
+    AcrylicLayer *layer = mLayers.back().get();
+    if (!layer)
+        return nullptr;
+
+    void *addr[1] = {mImages.back().data()};
+    size_t len[1] = {mImages.back().size() * sizeof(uint32_t)};
+    if (!layer->setImageDimension(width, height) ||
+        !layer->setImageType(HAL_PIXEL_FORMAT_RGBA_8888, HAL_DATASPACE_SRGB) ||
+        !layer->setImageBuffer(addr, len, 1))
+        return nullptr;
+
+    configureLayer(layer, window, z_order);
+
+    return layer;
+}
+
+void AcrylicG2DTest::configureLayer(AcrylicLayer *layer, hwc_rect_t window, int z_order)
+{
+    hw2d_coord_t xy = layer->getImageDimension();
+    hwc_rect_t crop = {0, 0, xy.hori, xy.vert};
+
+    EXPECT_TRUE(layer->setCompositArea(crop, window));
+    EXPECT_TRUE(layer->setCompositMode(HWC2_BLEND_MODE_PREMULTIPLIED, 0xFF, z_order));
+}
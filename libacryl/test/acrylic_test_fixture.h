@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ACRYLIC_TEST_FIXTURE_H_
+#define ACRYLIC_TEST_FIXTURE_H_
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <hardware/exynos/acryl.h>
+
+#include "acrylic_g2d.h"
+#include "acrylic_g2d_fake.h"
+
+/*
+ * Runs AcrylicCompositorG2D on AcrylicFakeG2DDevice with a RGBA8888 target
+ * of TARGET_WIDTH x TARGET_HEIGHT in user memory.
+ */
+class AcrylicG2DTest : public ::testing::Test {
+public:
+    enum { TARGET_WIDTH = 64, TARGET_HEIGHT = 64 };
+
+    AcrylicG2DTest();
+    virtual void SetUp();
+    virtual void TearDown();
+
+    /*
+     * Create a layer of a RGBA8888 image of @width x @height filled with
+     * @color (R in the lowest byte) shown at @window with SRC_OVER.
+     */
+    AcrylicLayer *createLayer(int width, int height, uint32_t color, hwc_rect_t window,
+                              int z_order);
+    /*
+     * Configure the layer created by createLayer() again with the same values
+     * as HWC does for an unchanged layer in the next frame.
+     */
+    void configureLayer(AcrylicLayer *layer, hwc_rect_t window, int z_order);
+    uint32_t getTargetPixel(int x, int y) { return mTarget[y * TARGET_WIDTH + x]; }
+
+protected:
+    unsigned int mLaptimeUSec;
+    std::unique_ptr<HW2DCapability> mCapability;
+    AcrylicFakeG2DDevice *mDevice;
+    std::unique_ptr<AcrylicCompositorG2D> mCompositor;
+    std::vector<uint32_t> mTarget;
+    std::vector<std::unique_ptr<AcrylicLayer>> mLayers;
+    std::vector<std::vector<uint32_t>> mImages;
+};
+
+#endif // ACRYLIC_TEST_FIXTURE_H_
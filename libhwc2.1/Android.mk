@@ -135,10 +135,14 @@ LOCAL_SRC_FILES := \
 	libdevice/ExynosDisplay.cpp \
 	libdevice/ExynosDevice.cpp \
 	libdevice/ExynosLayer.cpp \
+	libdevice/DynamicRecompositionPolicy.cpp \
 	libdevice/HistogramDevice.cpp \
 	libdevice/DisplayTe2Manager.cpp \
+	libdevice/PresentLatencyHistogram.cpp \
 	libmaindisplay/ExynosPrimaryDisplay.cpp \
+	libresource/CompositionPassPolicy.cpp \
 	libresource/ExynosMPP.cpp \
+	libresource/ExynosMPPDstBufPool.cpp \
 	libresource/ExynosResourceManager.cpp \
 	libexternaldisplay/ExynosExternalDisplay.cpp \
 	libvirtualdisplay/ExynosVirtualDisplay.cpp \
@@ -151,7 +155,11 @@ LOCAL_SRC_FILES := \
 	libvrr/Power/PowerStatsProfileTokenGenerator.cpp \
 	libvrr/Power/DisplayStateResidencyProvider.cpp \
 	libvrr/Power/DisplayStateResidencyWatcher.cpp \
+	libvrr/AdaptivePresentTimeoutPolicy.cpp \
 	libvrr/FileNode.cpp \
+	libvrr/PresentFenceQueue.cpp \
+	libvrr/RefreshControlCommandQueue.cpp \
+	libvrr/RefreshRateCalculator/CadenceFrameRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/InstantRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/ExitIdleRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/PeriodRefreshRateCalculator.cpp \
@@ -161,6 +169,7 @@ LOCAL_SRC_FILES := \
 	libvrr/Statistics/VariableRefreshRateStatistic.cpp \
 	libvrr/Utils.cpp \
 	libvrr/VariableRefreshRateController.cpp \
+	libvrr/VariableRefreshRateDispatcher.cpp \
 	libvrr/VariableRefreshRateVersion.cpp \
 	pixel-display.cpp \
 	pixelstats-display.cpp \
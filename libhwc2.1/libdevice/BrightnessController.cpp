@@ -214,6 +214,7 @@ int BrightnessController::initDrm(const DrmDevice& drmDevice, const DrmConnector
     initBrightnessTable(drmDevice, connector);
 
     initDimmingUsage();
+    initBrightnessRamp();
 
     mLhbmSupported = connector.lhbm_on().id() != 0;
     mGhbmSupported = connector.hbm_mode().id() != 0;
@@ -244,6 +245,72 @@ void BrightnessController::initDimmingUsage() {
     }
 }
 
+void BrightnessController::initBrightnessRamp() {
+    String8 propName;
+    propName.appendFormat(kBrightnessRampPropName, mPanelIndex);
+
+    mBrightnessRampEnabled = property_get_bool(propName.c_str(), false);
+    ALOGI("%s brightness ramp scheduler %s", __func__,
+          mBrightnessRampEnabled ? "enabled" : "disabled");
+
+    // the ramp commit timeout is handled on the dimming thread
+    if (mBrightnessRampEnabled && !mDimmingHandler) {
+        mDimmingHandler = new DimmingMsgHandler(this);
+        mDimmingThread = std::thread(&BrightnessController::dimmingThread, this);
+    }
+}
+
+void BrightnessController::processBrightnessRampTimeout() {
+    nsecs_t vsyncNs;
+    {
+        std::lock_guard<std::recursive_mutex> lock(mBrightnessMutex);
+        // a frame commit has applied the target in time
+        if (!mRampCommitPending) {
+            return;
+        }
+        // the refresh did not produce a commit in time, e.g. the display is idle or off
+        ALOGW("%s ramp commit timeout, fall back to sysfs path", __func__);
+        mRampCommitPending = false;
+        vsyncNs = mRampCommitVsyncNs;
+    }
+    applyPendingChangeViaSysfs(vsyncNs);
+}
+
+bool BrightnessController::isBrightnessRampActive(const nsecs_t vsyncNs) {
+    if (!mBrightnessRampEnabled || vsyncNs <= 0) {
+        return false;
+    }
+
+    // a commit is already scheduled, the latest target will ride on it
+    if (mRampCommitPending) {
+        return true;
+    }
+
+    if (mLastBrightnessApplyNs == 0) {
+        return false;
+    }
+
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    return (now - mLastBrightnessApplyNs) < vsyncNs * kBrightnessRampWindowVsyncs;
+}
+
+void BrightnessController::requestRampCommit(const nsecs_t vsyncNs) {
+    // only one forced refresh per frame, later requests are coalesced into it
+    if (mRampCommitPending) {
+        return;
+    }
+    mRampCommitPending = true;
+    mRampCommitVsyncNs = vsyncNs;
+    if (mDimmingLooper) {
+        mDimmingLooper->removeMessages(mDimmingHandler,
+                                       DimmingMsgHandler::MSG_BRIGHTNESS_RAMP_TIMEOUT);
+        mDimmingLooper->sendMessageDelayed(vsyncNs * kBrightnessRampTimeoutVsyncs,
+                                           mDimmingHandler,
+                                           DimmingMsgHandler::MSG_BRIGHTNESS_RAMP_TIMEOUT);
+    }
+    mFrameRefresh();
+}
+
 void BrightnessController::initBrightnessSysfs() {
     String8 nodeName;
     nodeName.appendFormat(BRIGHTNESS_SYSFS_NODE, mPanelIndex);
@@ -413,6 +480,8 @@ int BrightnessController::processDisplayBrightness(float brightness, const nsecs
 
     {
         std::lock_guard<std::recursive_mutex> lock(mBrightnessMutex);
+        // the previous target has not reached the panel yet if it is still dirty
+        const bool supersede = mBrightnessLevel.is_dirty();
         /* apply the first brightness */
         if (mBrightnessFloatReq.is_dirty()) mBrightnessLevel.set_dirty();
 
@@ -421,16 +490,26 @@ int BrightnessController::processDisplayBrightness(float brightness, const nsecs
             return NO_ERROR;
         }
 
+        mRampRequestCount++;
+        if (supersede) {
+            mRampCoalescedCount++;
+        }
+
         // check if it will go drm path for below cases.
         // case 1: hbm state will change
         // case 2: for hwc3, brightness command could apply at next present if possible
+        // case 3: a brightness ramp is in progress, apply the latest target at next commit
         if (queryBrightness(brightness, &ghbm, &level) == NO_ERROR) {
             // ghbm on/off always go drm path
             // check if this will cause a hbm transition
             if (mGhbmSupported && (mGhbm.get() != HbmMode::OFF) != ghbm) {
                 // this brightness change will go drm path
                 updateStates();
-                mFrameRefresh(); // force next frame to update brightness
+                if (mBrightnessRampEnabled) {
+                    requestRampCommit(vsyncNs);
+                } else {
+                    mFrameRefresh(); // force next frame to update brightness
+                }
                 return NO_ERROR;
             }
             // there will be a Present to apply this brightness change
@@ -439,6 +518,12 @@ int BrightnessController::processDisplayBrightness(float brightness, const nsecs
                 updateStates();
                 return NO_ERROR;
             }
+            if (isBrightnessRampActive(vsyncNs)) {
+                ATRACE_NAME("brightness_ramp_defer");
+                updateStates();
+                requestRampCommit(vsyncNs);
+                return NO_ERROR;
+            }
         } else {
             level = brightness < 0 ? 0 : static_cast<uint32_t>(brightness * mMaxBrightness + 0.5f);
         }
@@ -512,6 +597,11 @@ int BrightnessController::applyPendingChangeViaSysfs(const nsecs_t vsyncNs) {
             return NO_ERROR;
         }
 
+        // the ramp scheduler has already requested a frame to apply the latest target
+        if (mRampCommitPending) {
+            return NO_ERROR;
+        }
+
         // there will be a drm commit to apply this brightness change if a GHBM change is pending.
         if (mGhbm.is_dirty()) {
             ALOGI("%s standalone brightness change will be handled by next frame update for GHBM",
@@ -668,6 +758,11 @@ void BrightnessController::onClearDisplay(bool needModeClear) {
     resetLhbmState();
     mInstantHbmReq.reset(false);
 
+    {
+        std::lock_guard<std::recursive_mutex> lock(mBrightnessMutex);
+        // no frame will come to carry a deferred ramp target
+        mRampCommitPending = false;
+    }
     if (mBrightnessLevel.is_dirty()) applyBrightnessViaSysfs(mBrightnessLevel.get());
 
     if (!needModeClear) return;
@@ -790,7 +885,12 @@ int BrightnessController::prepareFrameCommit(ExynosDisplay& display, const DrmCo
         }
         mBrightnessLevel.clear_dirty();
         mPrevDisplayWhitePointNits = mDisplayWhitePointNits;
+        mLastBrightnessApplyNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (mRampCommitPending) {
+            mRampCommitCount++;
+        }
     }
+    mRampCommitPending = false;
 
     if (mGhbm.is_dirty() && mGhbmSupported) {
         HbmMode hbmMode = mGhbm.get();
@@ -833,6 +933,10 @@ void BrightnessController::DimmingMsgHandler::handleMessage(const ::android::Mes
             mBrightnessController->processDimmingOff();
             break;
 
+        case MSG_BRIGHTNESS_RAMP_TIMEOUT:
+            mBrightnessController->processBrightnessRampTimeout();
+            break;
+
         case MSG_QUIT:
             mBrightnessController->mDimmingThreadRunning = false;
             break;
@@ -1131,6 +1235,8 @@ int BrightnessController::applyBrightnessViaSysfs(uint32_t level) {
             std::lock_guard<std::recursive_mutex> lock(mBrightnessMutex);
             mBrightnessLevel.reset(level);
             mPrevDisplayWhitePointNits = mDisplayWhitePointNits;
+            mLastBrightnessApplyNs = systemTime(SYSTEM_TIME_MONOTONIC);
+            mRampSysfsWriteCount++;
             printBrightnessStates("sysfs");
         }
 
@@ -1226,6 +1332,11 @@ void BrightnessController::dump(String8& result) {
     result.appendFormat("\tacl mode supported %d, acl mode %d\n", mAclModeOfs.is_open(),
                         mAclMode.get());
     result.appendFormat("\toperation rate %d\n", mOperationRate.get());
+    result.appendFormat("\tbrightness ramp enabled %d, pending commit %d, requests %" PRIu64
+                        ", coalesced %" PRIu64 ", sysfs writes %" PRIu64 ", ramp commits %" PRIu64
+                        "\n",
+                        mBrightnessRampEnabled, mRampCommitPending, mRampRequestCount,
+                        mRampCoalescedCount, mRampSysfsWriteCount, mRampCommitCount);
 
     result.appendFormat("\n");
 }
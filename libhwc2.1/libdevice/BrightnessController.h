@@ -51,6 +51,7 @@ public:
         enum {
             MSG_QUIT,
             MSG_DIMMING_OFF,
+            MSG_BRIGHTNESS_RAMP_TIMEOUT,
         };
         DimmingMsgHandler(BrightnessController* bc) : mBrightnessController(bc) {}
         void handleMessage(const Message& message) override;
@@ -184,6 +185,15 @@ public:
         return mMaxBrightness > 0;
     }
 
+    /**
+     * Number of brightness requests superseded by a later request before they
+     * reached the panel, i.e. collapsed by the ramp scheduler.
+     */
+    uint64_t getCoalescedBrightnessRequests() {
+        std::lock_guard<std::recursive_mutex> lock(mBrightnessMutex);
+        return mRampCoalescedCount;
+    }
+
     void dump(String8 &result);
 
     void setOutdoorVisibility(LbeState state);
@@ -387,6 +397,13 @@ private:
             "/sys/class/backlight/panel%d-backlight/acl_mode";
     static constexpr const char* kAclModeDefaultPropName =
             "vendor.display.%d.brightness.acl.default";
+    static constexpr const char* kBrightnessRampPropName =
+            "vendor.display.%d.brightness.ramp.enabled";
+    // A brightness request arriving within this many vsync periods of the last applied
+    // change is considered part of an animation and is deferred to the next frame commit.
+    static constexpr int32_t kBrightnessRampWindowVsyncs = 2;
+    // A deferred target falls back to the sysfs path if no commit picks it up in time.
+    static constexpr int32_t kBrightnessRampTimeoutVsyncs = 5;
 
     int queryBrightness(float brightness, bool* ghbm = nullptr, uint32_t* level = nullptr,
                         float *nits = nullptr);
@@ -394,6 +411,10 @@ private:
     void initBrightnessSysfs();
     void initCabcSysfs();
     void initDimmingUsage();
+    void initBrightnessRamp();
+    void processBrightnessRampTimeout();
+    bool isBrightnessRampActive(const nsecs_t vsyncNs); // REQUIRES(mBrightnessMutex)
+    void requestRampCommit(const nsecs_t vsyncNs);      // REQUIRES(mBrightnessMutex)
     int applyBrightnessViaSysfs(uint32_t level);
     int applyCabcModeViaSysfs(uint8_t mode);
     int updateStates(); // REQUIRES(mBrightnessMutex)
@@ -439,6 +460,21 @@ private:
     // Indicating if brightness updates are ignored
     bool mIgnoreBrightnessUpdateRequests = false;
 
+    /*
+     * Brightness ramp scheduler. Brightness animations send a request per frame or faster.
+     * Once a change has been applied, following requests in the ramp window only update the
+     * target and are applied atomically by the next prepareFrameCommit. At most one refresh
+     * is requested per frame and no sysfs write happens while the ramp is active.
+     */
+    bool mBrightnessRampEnabled = false;
+    nsecs_t mLastBrightnessApplyNs = 0; // GUARDED_BY(mBrightnessMutex)
+    bool mRampCommitPending = false;    // GUARDED_BY(mBrightnessMutex)
+    nsecs_t mRampCommitVsyncNs = 0;     // GUARDED_BY(mBrightnessMutex)
+    uint64_t mRampRequestCount = 0;     // GUARDED_BY(mBrightnessMutex)
+    uint64_t mRampCoalescedCount = 0;   // GUARDED_BY(mBrightnessMutex)
+    uint64_t mRampSysfsWriteCount = 0;  // GUARDED_BY(mBrightnessMutex)
+    uint64_t mRampCommitCount = 0;      // GUARDED_BY(mBrightnessMutex)
+
     std::function<void(void)> mFrameRefresh;
     CtrlValue<HdrLayerState> mHdrLayerState;
     CtrlValue<ColorRenderIntent> mColorRenderIntent;
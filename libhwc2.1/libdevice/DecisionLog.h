@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DECISION_LOG_H_
+#define _DECISION_LOG_H_
+
+#include <algorithm>
+#include <array>
+
+/*
+ * The latest decisions of a composition policy, with the inputs they were made from,
+ * so that a dump can be replayed offline to tune the policy.
+ * Not thread safe, the owner of the policy serializes the accesses.
+ */
+template <typename Decision, size_t kSize>
+class DecisionLog {
+public:
+    void record(const Decision& decision) {
+        mDecisions[mCount % kSize] = decision;
+        mCount++;
+    }
+
+    /* Number of decisions recorded since the last clear() */
+    size_t getCount() const { return mCount; }
+
+    /* Calls @func with the kept decisions from the oldest one */
+    template <typename Func>
+    void forEach(Func func) const {
+        for (size_t i = mCount - std::min(mCount, kSize); i < mCount; i++)
+            func(mDecisions[i % kSize]);
+    }
+
+    void clear() { mCount = 0; }
+
+private:
+    std::array<Decision, kSize> mDecisions{};
+    size_t mCount = 0;
+};
+
+#endif // _DECISION_LOG_H_
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DynamicRecompositionPolicy.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <limits>
+
+size_t UpdateIntervalHistogram::getBucketIndex(nsecs_t intervalNs) {
+    const uint64_t quotient = static_cast<uint64_t>(std::max<nsecs_t>(intervalNs, 0)) /
+            kFirstBucketLimitNs;
+    if (quotient == 0) return 0;
+    size_t index = 64 - __builtin_clzll(quotient);
+    return index < kNumBuckets ? index : kNumBuckets - 1;
+}
+
+void UpdateIntervalHistogram::record(nsecs_t timestamp) {
+    if (mLastUpdateNs != 0) {
+        for (auto& weight : mWeights) weight *= kDecay;
+        mWeights[getBucketIndex(timestamp - mLastUpdateNs)] += 1.0f;
+    }
+    mLastUpdateNs = timestamp;
+}
+
+float UpdateIntervalHistogram::getPredictedRate(nsecs_t now) const {
+    if (mLastUpdateNs == 0) return 0;
+
+    // Only intervals longer than the current idle time are still possible
+    const nsecs_t elapsedNs = std::max(now - mLastUpdateNs, kFirstBucketLimitNs);
+    float totalWeight = 0;
+    float weightedRate = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        const bool isLast = (i == kNumBuckets - 1);
+        const nsecs_t lower = (i == 0) ? 0 : (kFirstBucketLimitNs << (i - 1));
+        const nsecs_t upper =
+                isLast ? std::numeric_limits<nsecs_t>::max() : (kFirstBucketLimitNs << i);
+        if ((mWeights[i] == 0) || (upper <= elapsedNs)) continue;
+
+        const nsecs_t mid = isLast ? (lower * 2) : ((lower + upper) / 2);
+        totalWeight += mWeights[i];
+        weightedRate += mWeights[i] * static_cast<float>(s2ns(1)) /
+                static_cast<float>(std::max(mid, elapsedNs));
+    }
+
+    return (totalWeight > 0) ? (weightedRate / totalWeight)
+                             : static_cast<float>(s2ns(1)) / static_cast<float>(elapsedNs);
+}
+
+void UpdateIntervalHistogram::reset() {
+    mWeights.fill(0);
+    mLastUpdateNs = 0;
+}
+
+float DynamicRecompositionPolicy::getSavingRatio(const Input& input) {
+    if ((input.incomingPixels == 0) || (input.refreshRate <= 0)) return 0;
+
+    const float deviceCost = input.refreshRate * input.incomingPixels;
+    const float clientCost = input.refreshRate * input.mergedPixels +
+            input.updateRate * (input.incomingPixels + input.mergedPixels) * kGpuCostWeight;
+    return (deviceCost - clientCost) / deviceCost;
+}
+
+bool DynamicRecompositionPolicy::evaluate(const Input& input, bool useClient) {
+    const float savingRatio = getSavingRatio(input);
+    bool newUseClient;
+    if (useClient) {
+        newUseClient = (savingRatio >= kExitSavingRatio) && (input.lastUpdateNs <= mLastSwitchNs);
+    } else {
+        newUseClient = (savingRatio >= kEnterSavingRatio) &&
+                (input.timestamp - mLastSwitchNs >= kMinDeviceDwellNs);
+    }
+
+    mDecisionLog.record({input, useClient, mLastSwitchNs, savingRatio, newUseClient});
+    if (newUseClient != useClient) {
+        mLastSwitchNs = input.timestamp;
+        mSwitchCount++;
+    }
+    return newUseClient;
+}
+
+nsecs_t DynamicRecompositionPolicy::getIdleThresholdNs(const Input& input) const {
+    // Update rate at which the saving ratio reaches kEnterSavingRatio
+    const float numerator = input.refreshRate *
+            (input.incomingPixels * (1.0f - kEnterSavingRatio) - input.mergedPixels);
+    const float denominator = (input.incomingPixels + input.mergedPixels) * kGpuCostWeight;
+    if ((numerator <= 0) || (denominator <= 0)) return -1;
+
+    const nsecs_t thresholdNs = static_cast<nsecs_t>(s2ns(1) * denominator / numerator);
+    return std::max(thresholdNs, mLastSwitchNs + kMinDeviceDwellNs - input.timestamp);
+}
+
+void DynamicRecompositionPolicy::reset() {
+    mLastSwitchNs = 0;
+    mSwitchCount = 0;
+    mDecisionLog.clear();
+}
+
+void DynamicRecompositionPolicy::dump(android::String8& result) const {
+    result.appendFormat("Dynamic recomposition decisions (%zu evaluations, %zu switches, "
+                        "last switch %" PRId64 ")\n",
+                        mDecisionLog.getCount(), mSwitchCount, mLastSwitchNs);
+    result.appendFormat("\ttimestamp refreshRate incomingPixels mergedPixels updateRate "
+                        "lastUpdateNs mode lastSwitchNs savingRatio newMode\n");
+    mDecisionLog.forEach([&result](const Decision& decision) {
+        const Input& input = decision.input;
+        result.appendFormat("\t%" PRId64 " %.2f %" PRIu64 " %" PRIu64 " %.3f %" PRId64
+                            " %s %" PRId64 " %.3f %s\n",
+                            input.timestamp, input.refreshRate, input.incomingPixels,
+                            input.mergedPixels, input.updateRate, input.lastUpdateNs,
+                            decision.useClient ? "CLIENT" : "DEVICE", decision.lastSwitchNs,
+                            decision.savingRatio, decision.newUseClient ? "CLIENT" : "DEVICE");
+    });
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DYNAMIC_RECOMPOSITION_POLICY_H_
+#define _DYNAMIC_RECOMPOSITION_POLICY_H_
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <array>
+
+#include "DecisionLog.h"
+
+/*
+ * Histogram of the intervals between buffer updates of a layer.
+ * Counts decay on every update so that the recent update pattern dominates.
+ */
+class UpdateIntervalHistogram {
+public:
+    // bucket 0 holds [0, 8ms), bucket i holds [8ms << (i-1), 8ms << i), the last one is open
+    static constexpr size_t kNumBuckets = 12;
+    static constexpr nsecs_t kFirstBucketLimitNs = ms2ns(8);
+
+    void record(nsecs_t timestamp);
+    /*
+     * Expected updates per second, given the time elapsed since the last update.
+     * Rates rather than intervals are averaged, so that a single long idle interval
+     * does not hide a burst of updates.
+     */
+    float getPredictedRate(nsecs_t now) const;
+    nsecs_t getLastUpdateTime() const { return mLastUpdateNs; }
+    void reset();
+
+private:
+    static constexpr float kDecay = 0.75f;
+
+    static size_t getBucketIndex(nsecs_t intervalNs);
+
+    std::array<float, kNumBuckets> mWeights{};
+    nsecs_t mLastUpdateNs = 0;
+};
+
+/*
+ * Decides whether collapsing the layer stack of a display into the client target saves
+ * memory bandwidth. With device composition the DPU fetches every layer on each refresh,
+ * with client composition it fetches the client target only, but the GPU has to read the
+ * layers and write the target on each update.
+ * The policy is a pure function of its input, the current mode and the time of the last
+ * switch. Every evaluation is logged with all three, so a dump can be replayed offline to
+ * tune the constants.
+ */
+class DynamicRecompositionPolicy {
+public:
+    struct Input {
+        nsecs_t timestamp = 0;
+        float refreshRate = 0;
+        /* Pixels fetched by the DPU per refresh with device composition */
+        uint64_t incomingPixels = 0;
+        /* Pixels of the client target */
+        uint64_t mergedPixels = 0;
+        /* Predicted composition updates per second */
+        float updateRate = 0;
+        /* Time of the latest buffer update of any layer */
+        nsecs_t lastUpdateNs = 0;
+    };
+
+    /*
+     * Returns true if the display should use client composition.
+     * Client composition is left on the first update after switching to it.
+     */
+    bool evaluate(const Input& input, bool useClient);
+    /*
+     * Time without updates after which client composition would pay off,
+     * -1 if it never does for this layer stack
+     */
+    nsecs_t getIdleThresholdNs(const Input& input) const;
+    void reset();
+    void dump(android::String8& result) const;
+
+private:
+    /*
+     * A GPU pixel costs more than a DPU fetch as the GPU has to be woken up and render,
+     * this puts the break-even around one update per second for a few full screen layers
+     */
+    static constexpr float kGpuCostWeight = 16.0f;
+    /* Hysteresis on the ratio of the saved bandwidth */
+    static constexpr float kEnterSavingRatio = 0.3f;
+    static constexpr float kExitSavingRatio = 0.1f;
+    /* Minimum time in device composition before switching to client composition again */
+    static constexpr nsecs_t kMinDeviceDwellNs = ms2ns(500);
+    /* Evaluations run on every validation, keep about two seconds at 60Hz */
+    static constexpr size_t kDecisionLogSize = 128;
+
+    struct Decision {
+        Input input;
+        bool useClient;
+        nsecs_t lastSwitchNs;
+        float savingRatio;
+        bool newUseClient;
+    };
+
+    static float getSavingRatio(const Input& input);
+
+    nsecs_t mLastSwitchNs = 0;
+    size_t mSwitchCount = 0;
+    DecisionLog<Decision, kDecisionLogSize> mDecisionLog;
+};
+
+#endif // _DYNAMIC_RECOMPOSITION_POLICY_H_
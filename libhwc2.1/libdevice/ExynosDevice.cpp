@@ -239,7 +239,11 @@ void ExynosDevice::initDeviceInterface(uint32_t interfaceType)
 }
 
 ExynosDevice::~ExynosDevice() {
-    mDRLoopStatus = false;
+    {
+        std::lock_guard<std::mutex> lock(mDRWakeUpMutex);
+        mDRLoopStatus = false;
+        mDRWakeUpCondition.notify_one();
+    }
     mDRThread.join();
     for(auto& display : mDisplays) {
         delete display;
@@ -250,6 +254,9 @@ ExynosDevice::~ExynosDevice() {
 bool ExynosDevice::isFirstValidate()
 {
     for (uint32_t i = 0; i < mDisplays.size(); i++) {
+        /* Partitioned displays are validated independently */
+        if (mDisplays[i]->isResourcePartitioned())
+            continue;
         if ((mDisplays[i]->mType != HWC_DISPLAY_VIRTUAL) &&
             (!mDisplays[i]->mPowerModeState.has_value() ||
              (mDisplays[i]->mPowerModeState.value() == (hwc2_power_mode_t)HWC_POWER_MODE_OFF)))
@@ -266,7 +273,7 @@ bool ExynosDevice::isFirstValidate()
 bool ExynosDevice::isLastValidate(ExynosDisplay *display)
 {
     for (uint32_t i = 0; i < mDisplays.size(); i++) {
-        if (mDisplays[i] == display)
+        if ((mDisplays[i] == display) || mDisplays[i]->isResourcePartitioned())
             continue;
         if ((mDisplays[i]->mType != HWC_DISPLAY_VIRTUAL) &&
             (!mDisplays[i]->mPowerModeState.has_value() ||
@@ -315,8 +322,11 @@ void ExynosDevice::checkDynamicRecompositionThread()
                 return;
         }
         ALOGI("Destroying dynamic recomposition thread");
-        mDRLoopStatus = false;
-        mDRWakeUpCondition.notify_one();
+        {
+            std::lock_guard<std::mutex> lock(mDRWakeUpMutex);
+            mDRLoopStatus = false;
+            mDRWakeUpCondition.notify_one();
+        }
         mDRThread.join();
     }
 }
@@ -330,43 +340,56 @@ void ExynosDevice::dynamicRecompositionThreadCreate()
     }
 }
 
+void ExynosDevice::scheduleDynamicRecompositionCheck(nsecs_t timestamp)
+{
+    std::lock_guard<std::mutex> lock(mDRWakeUpMutex);
+    if ((mDRWakeUpTime != 0) && (mDRWakeUpTime <= timestamp))
+        return;
+    mDRWakeUpTime = timestamp;
+    mDRWakeUpCondition.notify_one();
+}
+
 void *ExynosDevice::dynamicRecompositionThreadLoop(void *data)
 {
     ExynosDevice *dev = (ExynosDevice *)data;
-    ExynosDisplay *display[dev->mDisplays.size()];
-    uint64_t event_cnt[dev->mDisplays.size()];
 
-    for (uint32_t i = 0; i < dev->mDisplays.size(); i++) {
-        display[i] = dev->mDisplays[i];
-        event_cnt[i] = 0;
-    }
     android_atomic_inc(&(dev->mDRThreadStatus));
 
     while (dev->mDRLoopStatus) {
-        for (uint32_t i = 0; i < dev->mDisplays.size(); i++)
-            event_cnt[i] = display[i]->mUpdateEventCnt;
-
         /*
-         * If there is no update for more than 5s, favor the client composition mode.
-         * If all other conditions are met, mode will be switched to client composition.
+         * Displays request a check when their layers would have been idle long enough for
+         * client composition to pay off, so the thread sleeps until the earliest request.
          */
         {
             std::unique_lock<std::mutex> lock(dev->mDRWakeUpMutex);
-            dev->mDRWakeUpCondition.wait_for(lock, std::chrono::seconds(5));
+            while (dev->mDRLoopStatus) {
+                nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+                if (dev->mDRWakeUpTime == 0)
+                    dev->mDRWakeUpCondition.wait(lock);
+                else if (dev->mDRWakeUpTime > now)
+                    dev->mDRWakeUpCondition.wait_for(lock,
+                            std::chrono::nanoseconds(dev->mDRWakeUpTime - now));
+                else
+                    break;
+            }
             if (!dev->mDRLoopStatus) {
                 break;
             }
+            dev->mDRWakeUpTime = 0;
         }
-        for (uint32_t i = 0; i < dev->mDisplays.size(); i++) {
-            if (display[i]->mDREnable &&
-                display[i]->mPlugState == true &&
-                event_cnt[i] == display[i]->mUpdateEventCnt) {
-                if (display[i]->checkDynamicReCompMode() == DEVICE_2_CLIENT) {
-                    display[i]->mUpdateEventCnt = 0;
-                    display[i]->setGeometryChanged(GEOMETRY_DISPLAY_DYNAMIC_RECOMPOSITION);
-                    dev->onRefresh(display[i]->mDisplayId);
-                }
+
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (auto display : dev->mDisplays) {
+            nsecs_t checkTime = display->mDRNextCheckTime;
+            if (!display->mDREnable || (display->mPlugState == false) || (checkTime == 0))
+                continue;
+            /* The display was updated after it requested this check */
+            if (checkTime > now) {
+                dev->scheduleDynamicRecompositionCheck(checkTime);
+                continue;
             }
+            if (display->checkDynamicReCompMode() == DEVICE_2_CLIENT)
+                dev->onRefresh(display->mDisplayId);
         }
     }
 
@@ -1008,7 +1031,7 @@ void ExynosDevice::clearGeometryChanged()
     mGeometryChanged = 0;
 }
 
-bool ExynosDevice::canSkipValidate()
+bool ExynosDevice::canSkipValidate(ExynosDisplay *display)
 {
     /*
      * This should be called by presentDisplay()
@@ -1019,7 +1042,15 @@ bool ExynosDevice::canSkipValidate()
     if (exynosHWCControl.skipValidate == false)
         return false;
 
+    /*
+     * A partitioned display owns all of its resources,
+     * so its validate can be skipped independently of other displays.
+     */
+    bool partitioned = (display != nullptr) && display->isResourcePartitioned();
+
     for (uint32_t i = 0; i < mDisplays.size(); i++) {
+        if (partitioned ? (mDisplays[i] != display) : mDisplays[i]->isResourcePartitioned())
+            continue;
         /*
          * Check all displays.
          * Resource assignment can have problem if validateDisplay is skipped
@@ -1041,12 +1072,12 @@ bool ExynosDevice::canSkipValidate()
                                       "Display[%d] can't skip validate (%d), renderingState(%d), "
                                       "geometryChanged(0x%" PRIx64 ")",
                                       mDisplays[i]->mDisplayId, ret, mDisplays[i]->mRenderingState,
-                                      mGeometryChanged);
+                                      mGeometryChanged.load());
                 return false;
             } else {
                 HDEBUGLOGD(eDebugSkipValidate, "Display[%d] can skip validate (%d), renderingState(%d), geometryChanged(0x%" PRIx64 ")",
                         mDisplays[i]->mDisplayId, ret,
-                        mDisplays[i]->mRenderingState, mGeometryChanged);
+                        mDisplays[i]->mRenderingState, mGeometryChanged.load());
             }
         }
     }
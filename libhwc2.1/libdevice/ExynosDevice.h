@@ -142,6 +142,7 @@ enum {
     GEOMETRY_DEVICE_CONFIG_CHANGED            = 1ULL << 38,
     GEOMETRY_DEVICE_DISP_MODE_CHAGED          = 1ULL << 39,
     GEOMETRY_DEVICE_SCENARIO_CHANGED          = 1ULL << 40,
+    GEOMETRY_DEVICE_RESOURCE_RESERVED_CHANGED = 1ULL << 41,
 
     GEOMETRY_ERROR_CASE                       = 1ULL << 63,
 };
@@ -170,8 +171,9 @@ class ExynosDevice {
         /**
          * Geometry change will be saved by bit map.
          * ex) Display create/destory.
+         * Atomic since displays with partitioned resources validate concurrently.
          */
-        uint64_t mGeometryChanged;
+        std::atomic<uint64_t> mGeometryChanged;
 
         /**
          * If Panel has not self-refresh feature, dynamic recomposition will be enabled.
@@ -182,6 +184,8 @@ class ExynosDevice {
         bool mPrimaryBlank;
         std::mutex mDRWakeUpMutex;
         std::condition_variable mDRWakeUpCondition;
+        /* Earliest check requested by a display, 0 if none. Guarded by mDRWakeUpMutex */
+        nsecs_t mDRWakeUpTime = 0;
 
         /**
          * Callback informations those are used by SurfaceFlinger.
@@ -308,11 +312,13 @@ class ExynosDevice {
         void setGeometryChanged(uint64_t changedBit) { mGeometryChanged|= changedBit;};
         void clearGeometryChanged();
         void setDynamicRecomposition(uint32_t displayId, unsigned int on);
-        bool canSkipValidate();
+        bool canSkipValidate(ExynosDisplay *display = nullptr);
         bool validateFences(ExynosDisplay *display);
         void compareVsyncPeriod();
         bool isDynamicRecompositionThreadAlive();
         void checkDynamicRecompositionThread();
+        /* Wakes up the dynamic recomposition thread at the given monotonic time */
+        void scheduleDynamicRecompositionCheck(nsecs_t timestamp);
         int32_t setDisplayDeviceMode(int32_t display_id, int32_t mode);
         int32_t setPanelGammaTableSource(int32_t display_id, int32_t type, int32_t source);
         void dump(String8& result, const std::vector<std::string>& args = {});
@@ -34,8 +34,10 @@
 #include <utils/CallStack.h>
 
 #include <charconv>
+#include <cmath>
 #include <future>
 #include <map>
+#include <numeric>
 
 #include "BrightnessController.h"
 #include "DisplayTe2Manager.h"
@@ -64,7 +66,11 @@ extern struct update_time_info updateTimeInfo;
 
 constexpr const char* kBufferDumpPath = "/data/vendor/log/hwc";
 
-constexpr float kDynamicRecompFpsThreshold = 1.0 / 5.0; // 1 frame update per 5 second
+// Lower bound of the idle time before the dynamic recomposition mode is re-evaluated
+constexpr nsecs_t kMinDynamicRecompCheckNs = ms2ns(100);
+
+// Pixels added around the damage of scaled layers for the scaler filter taps
+constexpr int kScaledDamageMargin = 2;
 
 constexpr float nsecsPerSec = std::chrono::nanoseconds(1s).count();
 constexpr int64_t nsecsIdleHintTimeout = std::chrono::nanoseconds(100ms).count();
@@ -842,12 +848,6 @@ ExynosCompositionInfo::ExynosCompositionInfo(uint32_t type)
         mCompressionInfo.type = COMP_TYPE_AFBC;
 
     memset(&mSkipSrcInfo, 0, sizeof(mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
 
     if(type == COMPOSITION_CLIENT)
         mEnableSkipStatic = true;
@@ -1023,7 +1023,6 @@ ExynosDisplay::ExynosDisplay(uint32_t type, uint32_t index, ExynosDevice* device
         mLastFrameCount(0),
         mErrorFrameCount(0),
         mUpdateEventCnt(0),
-        mUpdateCallCnt(0),
         mDefaultDMA(MAX_DECON_DMA_TYPE),
         mLastRetireFence(-1),
         mWindowNumUsed(0),
@@ -1090,6 +1089,9 @@ ExynosDisplay::ExynosDisplay(uint32_t type, uint32_t index, ExynosDevice* device
     mUseDpu = true;
     mHpdStatus = false;
 
+    mWinUpdateXAlign = std::max(property_get_int32("vendor.display.win_update.x_align", 1), 1);
+    mWinUpdateYAlign = std::max(property_get_int32("vendor.display.win_update.y_align", 1), 1);
+
     return;
 }
 
@@ -1114,12 +1116,6 @@ void ExynosDisplay::initDisplay() {
     mClientCompositionInfo.mSkipStaticInitFlag = false;
     mClientCompositionInfo.mSkipFlag = false;
     memset(&mClientCompositionInfo.mSkipSrcInfo, 0x0, sizeof(mClientCompositionInfo.mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        mClientCompositionInfo.mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        mClientCompositionInfo.mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        mClientCompositionInfo.mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        mClientCompositionInfo.mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
     memset(&mClientCompositionInfo.mLastWinConfigData, 0x0, sizeof(mClientCompositionInfo.mLastWinConfigData));
     mClientCompositionInfo.mLastWinConfigData.acq_fence = -1;
     mClientCompositionInfo.mLastWinConfigData.rel_fence = -1;
@@ -1129,12 +1125,6 @@ void ExynosDisplay::initDisplay() {
     mExynosCompositionInfo.mSkipStaticInitFlag = false;
     mExynosCompositionInfo.mSkipFlag = false;
     memset(&mExynosCompositionInfo.mSkipSrcInfo, 0x0, sizeof(mExynosCompositionInfo.mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        mExynosCompositionInfo.mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        mExynosCompositionInfo.mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        mExynosCompositionInfo.mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        mExynosCompositionInfo.mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
 
     memset(&mExynosCompositionInfo.mLastWinConfigData, 0x0, sizeof(mExynosCompositionInfo.mLastWinConfigData));
     mExynosCompositionInfo.mLastWinConfigData.acq_fence = -1;
@@ -1144,6 +1134,8 @@ void ExynosDisplay::initDisplay() {
     mRenderingState = RENDERING_STATE_NONE;
     mDisplayBW = 0;
     mDynamicReCompMode = CLIENT_2_DEVICE;
+    mDRPolicy.reset();
+    mDRNextCheckTime = 0;
     mCursorIndex = -1;
 
     mDpuData.reset();
@@ -1198,6 +1190,7 @@ int32_t ExynosDisplay::destroyLayer(hwc2_layer_t outLayer) {
 
     mDisplayInterface->destroyLayer(layer);
     layer->resetAssignedResource();
+    mLayerSlots.erase(layer->mSlotHandle);
 
     delete layer;
 
@@ -1226,6 +1219,7 @@ void ExynosDisplay::destroyLayers() {
         it = mIgnoreLayers.erase(it);
         delete layer;
     }
+    mLayerSlots.clear();
 }
 
 ExynosLayer *ExynosDisplay::checkLayer(hwc2_layer_t addr) {
@@ -1385,15 +1379,9 @@ int ExynosDisplay::switchDynamicReCompMode(dynamic_recomp_mode mode) {
 int ExynosDisplay::checkDynamicReCompMode() {
     ATRACE_CALL();
     Mutex::Autolock lock(mDRMutex);
+    mDRNextCheckTime = 0;
 
     if (!exynosHWCControl.useDynamicRecomp) {
-        mLastModeSwitchTimeStamp = 0;
-        return switchDynamicReCompMode(CLIENT_2_DEVICE);
-    }
-
-    /* initialize the Timestamps */
-    if (!mLastModeSwitchTimeStamp) {
-        mLastModeSwitchTimeStamp = mLastUpdateTimeStamp;
         return switchDynamicReCompMode(CLIENT_2_DEVICE);
     }
 
@@ -1405,15 +1393,16 @@ int ExynosDisplay::checkDynamicReCompMode() {
             mLayers[i]->mPreprocessedInfo.preProcessed) {
             auto ret = switchDynamicReCompMode(CLIENT_2_DEVICE);
             if (ret) {
-                mUpdateCallCnt = 0;
-                mLastModeSwitchTimeStamp = mLastUpdateTimeStamp;
                 DISPLAY_LOGD(eDebugDynamicRecomp, "[DYNAMIC_RECOMP] GLES_2_HWC by video layer");
             }
             return ret;
         }
     }
 
-    unsigned int incomingPixels = 0;
+    DynamicRecompositionPolicy::Input input;
+    input.timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+    input.refreshRate = (mVsyncPeriod > 0) ? (nsecsPerSec / mVsyncPeriod) : 0;
+
     hwc_rect_t dispRect = {INT_MAX, INT_MAX, 0, 0};
     for (size_t i = 0; i < mLayers.size(); i++) {
         auto& r = mLayers[i]->mPreprocessedInfo.displayFrame;
@@ -1421,73 +1410,35 @@ int ExynosDisplay::checkDynamicReCompMode() {
         if (r.left < dispRect.left) dispRect.left = r.left;
         if (r.bottom > dispRect.bottom) dispRect.bottom = r.bottom;
         if (r.right > dispRect.right) dispRect.right = r.right;
-        auto w = WIDTH(r);
-        auto h = HEIGHT(r);
-        incomingPixels += w * h;
-    }
-
-    /* Mode Switch is not required if total pixels are not more than the threshold */
-    unsigned int mergedDisplayFrameSize = WIDTH(dispRect) * HEIGHT(dispRect);
-    if (incomingPixels <= mergedDisplayFrameSize) {
-        auto ret = switchDynamicReCompMode(CLIENT_2_DEVICE);
-        if (ret) {
-            mUpdateCallCnt = 0;
-            mLastModeSwitchTimeStamp = mLastUpdateTimeStamp;
-            DISPLAY_LOGD(eDebugDynamicRecomp, "[DYNAMIC_RECOMP] GLES_2_HWC by BW check");
-        }
-        return ret;
-    }
-
-    /*
-     * There will be at least one composition call per one minute (because of time update)
-     * To minimize the analysis overhead, just analyze it once in 5 second
-     */
-    auto timeStampDiff = systemTime(SYSTEM_TIME_MONOTONIC) - mLastModeSwitchTimeStamp;
-
-    /*
-     * previous CompModeSwitch was CLIENT_2_DEVICE: check fps after 5s from mLastModeSwitchTimeStamp
-     * previous CompModeSwitch was DEVICE_2_CLIENT: check immediately
-     */
-    if ((mDynamicReCompMode != DEVICE_2_CLIENT) && (timeStampDiff < kLayerFpsStableTimeNs))
-        return 0;
-
-    mLastModeSwitchTimeStamp = mLastUpdateTimeStamp;
-    float updateFps = 0;
-    if ((mUpdateEventCnt != 1) &&
-        (mDynamicReCompMode == DEVICE_2_CLIENT) && (mUpdateCallCnt == 1)) {
-        DISPLAY_LOGD(eDebugDynamicRecomp, "[DYNAMIC_RECOMP] first frame after DEVICE_2_CLIENT");
-        updateFps = kDynamicRecompFpsThreshold + 1;
-    } else {
-        float maxFps = 0;
-        for (uint32_t i = 0; i < mLayers.size(); i++) {
-            float layerFps = mLayers[i]->checkFps(/* increaseCount */ false);
-            if (maxFps < layerFps) maxFps = layerFps;
-        }
-        updateFps = maxFps;
+        input.incomingPixels += static_cast<uint64_t>(WIDTH(r)) * HEIGHT(r);
+        input.updateRate += mLayers[i]->mUpdateIntervals.getPredictedRate(input.timestamp);
+        input.lastUpdateNs =
+                std::max(input.lastUpdateNs, mLayers[i]->mUpdateIntervals.getLastUpdateTime());
+    }
+    if (mLayers.size() > 0)
+        input.mergedPixels = static_cast<uint64_t>(WIDTH(dispRect)) * HEIGHT(dispRect);
+    /* Updates of several layers in one refresh are composited together */
+    input.updateRate = std::min(input.updateRate, input.refreshRate);
+
+    bool useClient = mDRPolicy.evaluate(input, mDynamicReCompMode == DEVICE_2_CLIENT);
+    if (!useClient) {
+        /* Check again once the layers would have been idle long enough to switch */
+        nsecs_t idleThresholdNs = mDRPolicy.getIdleThresholdNs(input);
+        if (idleThresholdNs >= 0) {
+            mDRNextCheckTime =
+                    input.timestamp + std::max(idleThresholdNs, kMinDynamicRecompCheckNs);
+            mDevice->scheduleDynamicRecompositionCheck(mDRNextCheckTime);
+        }
+    }
+
+    auto ret = switchDynamicReCompMode(useClient ? DEVICE_2_CLIENT : CLIENT_2_DEVICE);
+    if (ret) {
+        DISPLAY_LOGD(eDebugDynamicRecomp,
+                     "[DYNAMIC_RECOMP] %s, update rate(%.2f), pixels(%" PRIu64 " -> %" PRIu64 ")",
+                     useClient ? "DEVICE_2_CLIENT" : "CLIENT_2_DEVICE", input.updateRate,
+                     input.incomingPixels, input.mergedPixels);
     }
-    mUpdateCallCnt = 0;
-
-    /*
-     * FPS estimation.
-     * If FPS is lower than kDynamicRecompFpsThreshold, try to switch the mode to GLES
-     */
-    if (updateFps < kDynamicRecompFpsThreshold) {
-        auto ret = switchDynamicReCompMode(DEVICE_2_CLIENT);
-        if (ret) {
-            DISPLAY_LOGD(eDebugDynamicRecomp, "[DYNAMIC_RECOMP] DEVICE_2_CLIENT by low FPS(%.2f)",
-                         updateFps);
-        }
-        return ret;
-    } else {
-        auto ret = switchDynamicReCompMode(CLIENT_2_DEVICE);
-        if (ret) {
-            DISPLAY_LOGD(eDebugDynamicRecomp, "[DYNAMIC_RECOMP] CLIENT_2_HWC by high FPS((%.2f)",
-                         updateFps);
-        }
-        return ret;
-    }
-
-    return 0;
+    return ret;
 }
 
 /**
@@ -1597,57 +1548,24 @@ bool ExynosDisplay::skipStaticLayerChanged(ExynosCompositionInfo& compositionInf
         return true;
     }
 
-    bool isChanged = false;
     for (size_t i = (size_t)compositionInfo.mFirstIndex; i <= (size_t)compositionInfo.mLastIndex; i++) {
         ExynosLayer *layer = mLayers[i];
         size_t index = i - compositionInfo.mFirstIndex;
-        if ((layer->mLayerBuffer == NULL) ||
-            (compositionInfo.mSkipSrcInfo.srcInfo[index].bufferHandle != layer->mLayerBuffer))
-        {
-            isChanged = true;
-            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] handle is changed"\
-                    " handle(%p -> %p), layerFlag(0x%8x)",
-                    i, compositionInfo.mSkipSrcInfo.srcInfo[index].bufferHandle,
-                    layer->mLayerBuffer, layer->mLayerFlag);
-            break;
-        } else if ((compositionInfo.mSkipSrcInfo.srcInfo[index].x != layer->mSrcImg.x) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].y != layer->mSrcImg.y) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].w != layer->mSrcImg.w) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].h != layer->mSrcImg.h) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].dataSpace != layer->mSrcImg.dataSpace) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].blending != layer->mSrcImg.blending) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].transform != layer->mSrcImg.transform) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].planeAlpha != layer->mSrcImg.planeAlpha))
-        {
-            isChanged = true;
-            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] source info is changed, "\
-                    "x(%d->%d), y(%d->%d), w(%d->%d), h(%d->%d), dataSpace(%d->%d), "\
-                    "blending(%d->%d), transform(%d->%d), planeAlpha(%3.1f->%3.1f)", i,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].x, layer->mSrcImg.x,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].y, layer->mSrcImg.y,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].w,  layer->mSrcImg.w,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].h,  layer->mSrcImg.h,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].dataSpace, layer->mSrcImg.dataSpace,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].blending, layer->mSrcImg.blending,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].transform, layer->mSrcImg.transform,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].planeAlpha, layer->mSrcImg.planeAlpha);
-            break;
-        } else if ((compositionInfo.mSkipSrcInfo.dstInfo[index].x != layer->mDstImg.x) ||
-                (compositionInfo.mSkipSrcInfo.dstInfo[index].y != layer->mDstImg.y) ||
-                (compositionInfo.mSkipSrcInfo.dstInfo[index].w != layer->mDstImg.w) ||
-                (compositionInfo.mSkipSrcInfo.dstInfo[index].h != layer->mDstImg.h))
-        {
-            isChanged = true;
-            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] dst info is changed, "\
-                    "x(%d->%d), y(%d->%d), w(%d->%d), h(%d->%d)", i,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].x, layer->mDstImg.x,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].y, layer->mDstImg.y,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].w, layer->mDstImg.w,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].h, layer->mDstImg.h);
-            break;
+        if (layer->mLayerBuffer == NULL) {
+            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] has no buffer, layerFlag(0x%8x)",
+                    i, layer->mLayerFlag);
+            return true;
+        }
+        uint64_t contentHash = layer->getContentHash();
+        if (compositionInfo.mSkipSrcInfo.contentHash[index] != contentHash) {
+            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] content is changed"\
+                    " hash(0x%" PRIx64 " -> 0x%" PRIx64 "), handle(%p)",
+                    i, compositionInfo.mSkipSrcInfo.contentHash[index], contentHash,
+                    layer->mLayerBuffer);
+            return true;
         }
     }
-    return isChanged;
+    return false;
 }
 
 void ExynosDisplay::requestLhbm(bool on) {
@@ -1717,20 +1635,13 @@ int ExynosDisplay::skipStaticLayers(ExynosCompositionInfo& compositionInfo)
 
     compositionInfo.mSkipStaticInitFlag = true;
     memset(&compositionInfo.mSkipSrcInfo, 0, sizeof(compositionInfo.mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        compositionInfo.mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        compositionInfo.mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        compositionInfo.mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        compositionInfo.mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
 
     for (size_t i = (size_t)compositionInfo.mFirstIndex; i <= (size_t)compositionInfo.mLastIndex; i++) {
         ExynosLayer *layer = mLayers[i];
         size_t index = i - compositionInfo.mFirstIndex;
-        compositionInfo.mSkipSrcInfo.srcInfo[index] = layer->mSrcImg;
-        compositionInfo.mSkipSrcInfo.dstInfo[index] = layer->mDstImg;
-        DISPLAY_LOGD(eDebugSkipStaicLayer, "mSkipSrcInfo.srcInfo[%zu] is initialized, %p",
-                index, layer->mSrcImg.bufferHandle);
+        compositionInfo.mSkipSrcInfo.contentHash[index] = layer->getContentHash();
+        DISPLAY_LOGD(eDebugSkipStaicLayer, "mSkipSrcInfo.contentHash[%zu] is initialized, %p",
+                index, layer->mLayerBuffer);
     }
     compositionInfo.mSkipSrcInfo.srcNum = (compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1);
     return NO_ERROR;
@@ -1819,6 +1730,8 @@ bool ExynosDisplay::validateExynosCompositionLayer()
  * @return int
  */
 int ExynosDisplay::doExynosComposition() {
+    PresentLatencyHistogram::ScopedStageTimer
+            stageTimer(mPresentLatencyHistogram, PresentLatencyHistogram::Stage::EXYNOS_COMPOSITION);
     int ret = NO_ERROR;
     exynos_image src_img;
     exynos_image dst_img;
@@ -1848,6 +1761,10 @@ int ExynosDisplay::doExynosComposition() {
             return -EINVAL;
         }
 
+        hwc_rect srcDamage;
+        if (getExynosCompositionSrcDamage(srcDamage))
+            mExynosCompositionInfo.mM2mMPP->setSrcDamage(srcDamage);
+
         if ((ret = mExynosCompositionInfo.mM2mMPP->doPostProcessing(
                      mExynosCompositionInfo.mDstImg)) != NO_ERROR) {
             DISPLAY_LOGE("exynosComposition doPostProcessing fail ret(%d)", ret);
@@ -2206,12 +2123,48 @@ int32_t ExynosDisplay::configureOverlay(ExynosLayer *layer, exynos_win_config_da
     if(layer != NULL) {
         if ((ret = configureHandle(*layer, layer->mAcquireFence, cfg)) != NO_ERROR)
             return ret;
+        if (layer->mM2mMPP == NULL)
+            cfg.content_hash = layer->getContentHash();
 
         /* This will be closed by setReleaseFences() using config.acq_fence */
         layer->mAcquireFence = -1;
     }
     return ret;
 }
+
+bool ExynosDisplay::reuseLastWinConfig(ExynosLayer &layer, int32_t windowIndex,
+                                       exynos_win_config_data &cfg)
+{
+    /* Layer changes are covered by the content hash, display changes are not */
+    constexpr uint64_t kLayerGeometryChangedMask = (GEOMETRY_LAYER_UNKNOWN_CHANGED << 1) - 1;
+
+    if ((exynosHWCControl.skipStaticLayers == 0) ||
+        (mGeometryChanged & ~kLayerGeometryChangedMask) ||
+        (windowIndex >= (int32_t)mLastDpuData.configs.size()))
+        return false;
+
+    const exynos_win_config_data &lastCfg = mLastDpuData.configs[windowIndex];
+    if (((lastCfg.state != lastCfg.WIN_STATE_BUFFER) &&
+         (lastCfg.state != lastCfg.WIN_STATE_CURSOR)) ||
+        (lastCfg.layer != &layer) || (lastCfg.content_hash == 0) ||
+        (layer.mM2mMPP != NULL) || layer.isDimLayer() ||
+        (lastCfg.assignedMPP != layer.mOtfMPP) ||
+        (lastCfg.content_hash != layer.getContentHash()))
+        return false;
+
+    cfg = lastCfg;
+    cfg.rel_fence = -1;
+    cfg.acq_fence =
+        hwcCheckFenceDebug(this, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_DPP, layer.mAcquireFence);
+    setFenceName(cfg.acq_fence, FENCE_DPP_SRC_LAYER);
+
+    /* This will be closed by setReleaseFences() using config.acq_fence */
+    layer.mAcquireFence = -1;
+
+    DISPLAY_LOGD(eDebugWinConfig, "config[%d] is reused, hash(0x%" PRIx64 ")", windowIndex,
+                 cfg.content_hash);
+    return true;
+}
 int32_t ExynosDisplay::configureOverlay(ExynosCompositionInfo &compositionInfo)
 {
     int32_t windowIndex = compositionInfo.mWindowIndex;
@@ -2452,6 +2405,9 @@ int ExynosDisplay::setWinConfigData() {
             return -EINVAL;
         }
         DISPLAY_LOGD(eDebugWinConfig, "%zu layer, config[%d]", i, windowIndex);
+        /* Static window: the config of the previous frame is still valid */
+        if (reuseLastWinConfig(*mLayers[i], windowIndex, mDpuData.configs[windowIndex]))
+            continue;
         if ((ret = configureOverlay(mLayers[i], mDpuData.configs[windowIndex])) != NO_ERROR)
             return ret;
     }
@@ -2472,7 +2428,7 @@ void ExynosDisplay::printDebugInfos(String8 &reason) {
 
     android::String8 result;
     result.appendFormat("Device mGeometryChanged(%" PRIx64 "), mGeometryChanged(%" PRIx64 "), mRenderingState(%d)\n",
-            mDevice->mGeometryChanged, mGeometryChanged, mRenderingState);
+            mDevice->mGeometryChanged.load(), mGeometryChanged, mRenderingState);
     result.appendFormat("=======================  dump composition infos  ================================\n");
     const ExynosCompositionInfo& clientCompInfo = mClientCompositionInfo;
     const ExynosCompositionInfo& exynosCompInfo = mExynosCompositionInfo;
@@ -2702,6 +2658,8 @@ int ExynosDisplay::checkConfigDstChanged(const exynos_dpu_data &lastConfigsData,
 int ExynosDisplay::deliverWinConfigData() {
 
     ATRACE_CALL();
+    PresentLatencyHistogram::ScopedStageTimer
+            stageTimer(mPresentLatencyHistogram, PresentLatencyHistogram::Stage::DELIVER_WIN_CONFIG);
     String8 errString;
     int ret = NO_ERROR;
     struct timeval tv_s, tv_e;
@@ -3026,6 +2984,7 @@ int32_t ExynosDisplay::createLayer(hwc2_layer_t* outLayer) {
 
     /* TODO : Sort sequence should be added to somewhere */
     mLayers.add((ExynosLayer*)layer);
+    layer->mSlotHandle = mLayerSlots.insert(layer);
 
     /* TODO : Set z-order to max, check outLayer address? */
     layer->setLayerZOrder(1000);
@@ -3383,7 +3342,15 @@ int32_t ExynosDisplay::canSkipValidate() {
     if (mRenderingState == RENDERING_STATE_NONE)
         return SKIP_ERR_FIRST_FRAME;
 
-    if (mDevice->mGeometryChanged != 0) {
+    /*
+     * A partitioned display only depends on its own geometry and on device changes that
+     * invalidate partitions
+     */
+    uint64_t geometryChanged = isResourcePartitioned()
+            ? (mGeometryChanged |
+               (mDevice->mGeometryChanged & ExynosResourceManager::kPartitionInvalidatingGeometry))
+            : mDevice->mGeometryChanged.load();
+    if (geometryChanged != 0) {
         /* validateDisplay() should be called */
         return SKIP_ERR_GEOMETRY_CHAGNED;
     } else {
@@ -3680,6 +3647,9 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
     }
 
     Mutex::Autolock lock(mDisplayMutex);
+    ExynosResourceManager::PartitionLock partitionLock(*mDevice->mResourceManager, this);
+    PresentLatencyHistogram::ScopedStageTimer
+            stageTimer(mPresentLatencyHistogram, PresentLatencyHistogram::Stage::PRESENT);
 
     if (!mHpdStatus) {
         ALOGD("presentDisplay: drop frame: mHpdStatus == false");
@@ -3751,7 +3721,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
             goto err;
         }
 
-        if (mDevice->canSkipValidate() == false)
+        if (mDevice->canSkipValidate(this) == false)
             goto not_validated;
         else {
             for (size_t i=0; i < mLayers.size(); i++) {
@@ -3772,7 +3742,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
              * if there is no buffer update. (using ExynosMPP::canSkipProcessing())
              * Therefore performanceInfo should be calculated again if the buffer is updated.
              */
-            if ((ret = mDevice->mResourceManager->deliverPerformanceInfo()) != NO_ERROR) {
+            if ((ret = mDevice->mResourceManager->deliverPerformanceInfo(this)) != NO_ERROR) {
                 DISPLAY_LOGE("deliverPerformanceInfo() error (%d) in validateSkip case", ret);
             }
             startPostProcessing();
@@ -4887,6 +4857,9 @@ int32_t ExynosDisplay::validateDisplay(
     DISPLAY_ATRACE_CALL();
     gettimeofday(&updateTimeInfo.lastValidateTime, NULL);
     Mutex::Autolock lock(mDisplayMutex);
+    ExynosResourceManager::PartitionLock partitionLock(*mDevice->mResourceManager, this);
+    PresentLatencyHistogram::ScopedStageTimer
+            stageTimer(mPresentLatencyHistogram, PresentLatencyHistogram::Stage::VALIDATE);
 
     if (!mHpdStatus) {
         ALOGD("validateDisplay: drop frame: mHpdStatus == false");
@@ -4907,7 +4880,6 @@ int32_t ExynosDisplay::validateDisplay(
     int ret = NO_ERROR;
     bool validateError = false;
     mUpdateEventCnt++;
-    mUpdateCallCnt++;
     mLastUpdateTimeStamp = systemTime(SYSTEM_TIME_MONOTONIC);
 
     if (usePowerHintSession()) {
@@ -4940,7 +4912,11 @@ int32_t ExynosDisplay::validateDisplay(
             mDevice->dynamicRecompositionThreadCreate();
     }
 
-    if ((ret = mResourceManager->assignResource(this)) != NO_ERROR) {
+    nsecs_t assignStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    ret = mResourceManager->assignResource(this);
+    mPresentLatencyHistogram.record(PresentLatencyHistogram::Stage::ASSIGN_RESOURCE,
+                                    systemTime(SYSTEM_TIME_MONOTONIC) - assignStartTime);
+    if (ret != NO_ERROR) {
         validateError = true;
         HWC_LOGE(this, "%s:: assignResource() fail, display(%d), ret(%d)", __func__, mDisplayId, ret);
         String8 errString;
@@ -4973,7 +4949,7 @@ int32_t ExynosDisplay::validateDisplay(
      * if there is no buffer update. (using ExynosMPP::canSkipProcessing())
      * Therefore performanceInfo should be calculated again if only the buffer is updated.
      */
-    if ((ret = mDevice->mResourceManager->deliverPerformanceInfo()) != NO_ERROR) {
+    if ((ret = mDevice->mResourceManager->deliverPerformanceInfo(this)) != NO_ERROR) {
         HWC_LOGE(NULL,"%s:: deliverPerformanceInfo() error (%d)",
                 __func__, ret);
     }
@@ -5165,6 +5141,12 @@ void ExynosDisplay::dumpLocked(String8& result) {
     if (mDisplayTe2Manager) {
         mDisplayTe2Manager->dump(result);
     }
+    mPresentLatencyHistogram.dump(result);
+    mCompositionPassPolicy.dump(result);
+    {
+        Mutex::Autolock lock(mDRMutex);
+        mDRPolicy.dump(result);
+    }
 }
 
 void ExynosDisplay::dumpConfig(String8 &result, const exynos_win_config_data &c)
@@ -5726,8 +5708,12 @@ bool ExynosDisplay::isSecureContentPresenting() const {
 
 bool ExynosDisplay::windowUpdateExceptions()
 {
+    hwc_rect exynosCompositionDamage;
 
-    if (mExynosCompositionInfo.mHasCompositionLayer) {
+    /* Exynos composition is allowed if the damage of its destination is known */
+    if (mExynosCompositionInfo.mHasCompositionLayer &&
+        ((mExynosCompositionInfo.mM2mMPP == NULL) ||
+         !mExynosCompositionInfo.mM2mMPP->getDstDamage(exynosCompositionDamage))) {
         DISPLAY_LOGD(eDebugWindowUpdate, "has exynos composition");
         return true;
     }
@@ -5736,20 +5722,81 @@ bool ExynosDisplay::windowUpdateExceptions()
         return true;
     }
 
+    /*
+     * Damage of scaled, rotated and M2M processed layers is mapped to the display
+     * by getLayerRegion(). Their windows are kept whole by alignWindowUpdateRegion().
+     */
     for (size_t i = 0; i < mLayers.size(); i++) {
-        if (mLayers[i]->mM2mMPP != NULL) return true;
+        if (isExynosCompositionLayer(i)) continue;
         if (mLayers[i]->mLayerBuffer == NULL) return true;
-        if (mLayers[i]->mTransform != 0) return true;
     }
 
+    return false;
+}
+
+/*
+ * Aligns the partial update region to the DPU constraints.
+ * DPU only crops unscaled windows without transform on partial update, so the
+ * region is expanded to cover every scaled, transformed or M2M processed window
+ * it overlaps, and it is aligned to the panel requirement and to the chroma
+ * subsampling of YUV windows.
+ * Returns false if the region can't be reduced.
+ */
+bool ExynosDisplay::alignWindowUpdateRegion(hwc_rect &region)
+{
+    std::vector<bool> wholeWindows(mDpuData.configs.size(), false);
     for (size_t i = 0; i < mDpuData.configs.size(); i++) {
-        exynos_win_config_data &config = mDpuData.configs[i];
-        if (config.state == config.WIN_STATE_BUFFER) {
-            if (config.src.w/config.dst.w != 1 || config.src.h/config.dst.h != 1) {
-                DISPLAY_LOGD(eDebugWindowUpdate, "Skip reason : scaled");
-                return true;
-            }
+        const auto &config = mDpuData.configs[i];
+        if (config.state != config.WIN_STATE_BUFFER)
+            continue;
+        uint32_t srcW = (config.transform & HAL_TRANSFORM_ROT_90) ? config.src.h : config.src.w;
+        uint32_t srcH = (config.transform & HAL_TRANSFORM_ROT_90) ? config.src.w : config.src.h;
+        wholeWindows[i] = (config.transform != 0) || (srcW != config.dst.w) ||
+                (srcH != config.dst.h);
+    }
+    /* M2M destination is written entirely, its window is not cropped either */
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        if (isExynosCompositionLayer(i) || (mLayers[i]->mM2mMPP == NULL))
+            continue;
+        if (mLayers[i]->mWindowIndex < wholeWindows.size())
+            wholeWindows[mLayers[i]->mWindowIndex] = true;
+    }
+
+    uint32_t xAlign = mWinUpdateXAlign;
+    uint32_t yAlign = mWinUpdateYAlign;
+    for (const auto &config : mDpuData.configs) {
+        if ((config.state == config.WIN_STATE_BUFFER) && isFormatYUV(config.format)) {
+            xAlign = std::lcm(xAlign, 2u);
+            yAlign = std::lcm(yAlign, 2u);
+        }
+    }
+
+    /* Each round can only grow the region, it ends once every window is settled */
+    for (size_t round = 0; round <= mDpuData.configs.size(); round++) {
+        hwc_rect aligned = region;
+        aligned.left = pixel_align_down(aligned.left, xAlign);
+        aligned.top = pixel_align_down(aligned.top, yAlign);
+        aligned.right = std::min(pixel_align(aligned.right, xAlign), (int)mXres);
+        aligned.bottom = std::min(pixel_align(aligned.bottom, yAlign), (int)mYres);
+
+        for (size_t i = 0; i < mDpuData.configs.size(); i++) {
+            if (!wholeWindows[i])
+                continue;
+
+            const auto &config = mDpuData.configs[i];
+            hwc_rect window = {(int)config.dst.x, (int)config.dst.y,
+                               (int)(config.dst.x + config.dst.w),
+                               (int)(config.dst.y + config.dst.h)};
+            hwc_rect overlap = intersect(aligned, window);
+            if ((WIDTH(overlap) > 0) && (HEIGHT(overlap) > 0))
+                aligned = expand(aligned, window);
         }
+
+        if ((aligned.left == region.left) && (aligned.top == region.top) &&
+            (aligned.right == region.right) && (aligned.bottom == region.bottom))
+            return (WIDTH(region) < (int)mXres) || (HEIGHT(region) < (int)mYres);
+        region = aligned;
+        adjustRect(region, mXres, mYres);
     }
 
     return false;
@@ -5791,10 +5838,22 @@ int ExynosDisplay::handleWindowUpdate()
     hwc_rect mergedRect = {(int)mXres, (int)mYres, 0, 0};
     hwc_rect damageRect = {(int)mXres, (int)mYres, 0, 0};
 
+    if (mExynosCompositionInfo.mHasCompositionLayer &&
+        mExynosCompositionInfo.mM2mMPP->getDstDamage(damageRect) &&
+        (WIDTH(damageRect) > 0) && (HEIGHT(damageRect) > 0)) {
+        DISPLAY_LOGD(eDebugWindowUpdate, "exynos composition partial : %d, %d, %d, %d",
+                damageRect.left, damageRect.top, damageRect.right, damageRect.bottom);
+        mergedRect = expand(mergedRect, damageRect);
+    }
+
     for (size_t i = 0; i < mLayers.size(); i++) {
         if (mLayers[i]->mExynosCompositionType == HWC2_COMPOSITION_DISPLAY_DECORATION) {
             continue;
         }
+        /* Damage of exynos composition layers is merged by its destination */
+        if (isExynosCompositionLayer(i)) {
+            continue;
+        }
         excp = getLayerRegion(mLayers[i], &damageRect, eDamageRegionByDamage);
         if (excp == eDamageRegionPartial) {
             DISPLAY_LOGD(eDebugWindowUpdate, "layer(%zu) partial : %d, %d, %d, %d", i,
@@ -5851,6 +5910,15 @@ int ExynosDisplay::handleWindowUpdate()
     if (mergedRect.top < 0) mergedRect.top = 0;
     if (mergedRect.bottom > (int32_t)mYres) mergedRect.bottom = mYres;
 
+    if (!alignWindowUpdateRegion(mergedRect)) {
+        mergedRect.left = 0;
+        mergedRect.top = 0;
+        mergedRect.right = mXres;
+        mergedRect.bottom = mYres;
+    }
+    DISPLAY_LOGD(eDebugWindowUpdate, "Partial(aligned) : %d, %d, %d, %d",
+            mergedRect.left, mergedRect.top, mergedRect.right, mergedRect.bottom);
+
     if (mergedRect.left == 0 && mergedRect.right == (int32_t)mXres &&
         mergedRect.top == 0 && mergedRect.bottom == (int32_t)mYres) {
         DISPLAY_LOGD(eDebugWindowUpdate, "Partial : Full size");
@@ -5893,25 +5961,40 @@ unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_ar
         return eDamageRegionSkip;
 
     switch (regionType) {
-    case eDamageRegionByDamage:
+    case eDamageRegionByDamage: {
+        const hwc_rect_t &frame = layer->mDisplayFrame;
+        const hwc_frect_t &crop = layer->mSourceCrop;
+        const bool rotated = !!(layer->mTransform & HAL_TRANSFORM_ROT_90);
+        const bool scaled = (WIDTH(frame) != (rotated ? HEIGHT(crop) : WIDTH(crop))) ||
+                (HEIGHT(frame) != (rotated ? WIDTH(crop) : HEIGHT(crop)));
+        const hwc_rect_t cropRect = {(int)floorf(crop.left), (int)floorf(crop.top),
+                                     (int)ceilf(crop.right), (int)ceilf(crop.bottom)};
+
         for (size_t j = 0; j < hwcRects.size(); j++) {
             hwc_rect_t rect;
 
             if ((hwcRects[j].left < 0) || (hwcRects[j].top < 0) ||
                     (hwcRects[j].right < 0) || (hwcRects[j].bottom < 0) ||
-                    (hwcRects[j].left >= hwcRects[j].right) || (hwcRects[j].top >= hwcRects[j].bottom) ||
-                    (hwcRects[j].right - hwcRects[j].left > WIDTH(layer->mSourceCrop)) ||
-                    (hwcRects[j].bottom - hwcRects[j].top > HEIGHT(layer->mSourceCrop))) {
+                    (hwcRects[j].left >= hwcRects[j].right) || (hwcRects[j].top >= hwcRects[j].bottom)) {
                 rect_area->left = INT_MAX;
                 rect_area->top = INT_MAX;
                 rect_area->right = rect_area->bottom = 0;
                 return eDamageRegionFull;
             }
 
-            rect.left = layer->mDisplayFrame.left + hwcRects[j].left - layer->mSourceCrop.left;
-            rect.top = layer->mDisplayFrame.top + hwcRects[j].top - layer->mSourceCrop.top;
-            rect.right = layer->mDisplayFrame.left + hwcRects[j].right - layer->mSourceCrop.left;
-            rect.bottom = layer->mDisplayFrame.top + hwcRects[j].bottom - layer->mSourceCrop.top;
+            /* Damage is in buffer coordinates, only the part in the crop is shown */
+            rect = intersect(hwcRects[j], cropRect);
+            if ((WIDTH(rect) <= 0) || (HEIGHT(rect) <= 0))
+                continue;
+            rect = mapSourceRectToDisplay(rect, crop, frame, layer->mTransform);
+            /* Scaler filter taps spread the damage to neighbor pixels */
+            if (scaled) {
+                rect.left -= kScaledDamageMargin;
+                rect.top -= kScaledDamageMargin;
+                rect.right += kScaledDamageMargin;
+                rect.bottom += kScaledDamageMargin;
+                rect = intersect(rect, frame);
+            }
             DISPLAY_LOGD(eDebugWindowUpdate, "Display frame : %d, %d, %d, %d", layer->mDisplayFrame.left,
                     layer->mDisplayFrame.top, layer->mDisplayFrame.right, layer->mDisplayFrame.bottom);
             DISPLAY_LOGD(eDebugWindowUpdate, "hwcRects : %d, %d, %d, %d", hwcRects[j].left,
@@ -5920,8 +6003,11 @@ unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_ar
             /* Get sums of rects */
             *rect_area = expand(*rect_area, rect);
         }
+        if ((rect_area->left >= rect_area->right) || (rect_area->top >= rect_area->bottom))
+            return eDamageRegionSkip;
         return eDamageRegionPartial;
         break;
+    }
     case eDamageRegionByLayer:
         if (layer->mLastLayerBuffer != layer->mLayerBuffer)
             return eDamageRegionFull;
@@ -5937,6 +6023,44 @@ unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_ar
     return eDamageRegionFull;
 }
 
+/*
+ * Gets the union of the damage of the layers in exynos composition in display
+ * coordinates. Returns false if the damage can't be known.
+ */
+bool ExynosDisplay::getExynosCompositionSrcDamage(hwc_rect &damage)
+{
+    ExynosMPP *m2mMpp = mExynosCompositionInfo.mM2mMPP;
+    if ((m2mMpp == NULL) || (mExynosCompositionInfo.mFirstIndex < 0) ||
+        (mExynosCompositionInfo.mLastIndex < 0) ||
+        (m2mMpp->mAssignedSources.size() !=
+         (size_t)(mExynosCompositionInfo.mLastIndex - mExynosCompositionInfo.mFirstIndex + 1)))
+        return false;
+
+    damage = {(int)mXres, (int)mYres, 0, 0};
+    for (int32_t i = mExynosCompositionInfo.mFirstIndex;
+         i <= mExynosCompositionInfo.mLastIndex; i++) {
+        ExynosLayer *layer = mLayers[i];
+        hwc_rect layerDamage;
+        unsigned int region = getLayerRegion(layer, &layerDamage, eDamageRegionByDamage);
+
+        if (region == eDamageRegionSkip)
+            continue;
+        if (region == eDamageRegionPartial)
+            damage = expand(damage, layerDamage);
+        else if (region == eDamageRegionFull)
+            damage = expand(damage, layer->mDisplayFrame);
+        else
+            return false;
+    }
+
+    if ((WIDTH(damage) <= 0) || (HEIGHT(damage) <= 0))
+        damage = {0, 0, 0, 0};
+
+    DISPLAY_LOGD(eDebugWindowUpdate, "exynos composition source damage : %d, %d, %d, %d",
+            damage.left, damage.top, damage.right, damage.bottom);
+    return true;
+}
+
 uint32_t ExynosDisplay::getRestrictionIndex(int halFormat)
 {
     if (isFormatRgb(halFormat))
@@ -6302,6 +6426,7 @@ int32_t ExynosDisplay::uncacheLayerBuffers(ExynosLayer* layer,
         for (auto buffer : buffers) {
             if (layer->mLayerBuffer == buffer) {
                 layer->mLayerBuffer = nullptr;
+                layer->invalidateContentHash();
             }
             if (layer->mLastLayerBuffer == buffer) {
                 layer->mLastLayerBuffer = nullptr;
@@ -6505,7 +6630,8 @@ int32_t ExynosDisplay::getDisplayIdleTimerSupport(bool &outSupport) {
 }
 
 int32_t ExynosDisplay::getDisplayMultiThreadedPresentSupport(bool &outSupport) {
-    outSupport = mDisplayControl.multiThreadedPresent;
+    outSupport = mDisplayControl.multiThreadedPresent ||
+            mDevice->mResourceManager->isParallelPresentEnabled();
     return NO_ERROR;
 }
 
@@ -34,8 +34,12 @@
 #include "ExynosHWCDebug.h"
 #include "ExynosHWCHelper.h"
 #include "ExynosHwc3Types.h"
+#include "ExynosLayerSlotMap.h"
 #include "ExynosMPP.h"
 #include "ExynosResourceManager.h"
+#include "CompositionPassPolicy.h"
+#include "DynamicRecompositionPolicy.h"
+#include "PresentLatencyHistogram.h"
 #include "drmeventlistener.h"
 #include "worker.h"
 
@@ -189,8 +193,8 @@ enum class DispIdleTimerRequester : uint32_t {
 struct ExynosFrameInfo
 {
     uint32_t srcNum;
-    exynos_image srcInfo[NUM_SKIP_STATIC_LAYER];
-    exynos_image dstInfo[NUM_SKIP_STATIC_LAYER];
+    /* ExynosLayer::getContentHash() of the source layers */
+    uint64_t contentHash[NUM_SKIP_STATIC_LAYER];
 };
 
 struct exynos_readback_info
@@ -244,6 +248,8 @@ struct exynos_win_config_data
     bool protection = false;
     CompressionInfo compressionInfo;
     bool needColorTransform = false;
+    /* Content hash of the layer the window was configured from, 0 if none */
+    uint64_t content_hash = 0;
 
     void reset(){
         *this = {};
@@ -502,6 +508,8 @@ class ExynosDisplay {
          */
         ExynosSortedLayer mLayers;
         std::vector<ExynosLayer*> mIgnoreLayers;
+        /* O(1) lookup of mLayers and mIgnoreLayers by slot handle */
+        ExynosLayerSlotMap mLayerSlots;
 
         ExynosResourceManager *mResourceManager;
 
@@ -554,15 +562,19 @@ class ExynosDisplay {
         bool mDREnable;
         bool mDRDefault;
         mutable Mutex mDRMutex;
+        DynamicRecompositionPolicy mDRPolicy;
+        /* When the dynamic recomposition thread should re-evaluate the mode, 0 if never */
+        std::atomic<nsecs_t> mDRNextCheckTime{0};
+
+        /* Chooses between extra G2D passes and client composition, under mDisplayMutex */
+        CompositionPassPolicy mCompositionPassPolicy;
 
         nsecs_t  mLastFpsTime;
         uint64_t mFrameCount;
         uint64_t mLastFrameCount;
         uint64_t mErrorFrameCount;
-        uint64_t mLastModeSwitchTimeStamp;
         uint64_t mLastUpdateTimeStamp;
         uint64_t mUpdateEventCnt;
-        uint64_t mUpdateCallCnt;
 
         /* default DMA for the display */
         decon_idma_type mDefaultDMA;
@@ -584,6 +596,12 @@ class ExynosDisplay {
 
         bool mUseDpu;
 
+        /**
+         * Alignment of the partial update region required by DPU and panel
+         */
+        uint32_t mWinUpdateXAlign;
+        uint32_t mWinUpdateYAlign;
+
         /**
          * Max Window number, It should be set by display module(chip)
          */
@@ -612,6 +630,13 @@ class ExynosDisplay {
 
         std::unique_ptr<DisplayTe2Manager> mDisplayTe2Manager;
 
+        /* Per-stage validate/present timings, reset via hwcService */
+        PresentLatencyHistogram mPresentLatencyHistogram;
+
+        /* Set by the resource manager when all MPPs of this display are reserved to it */
+        std::atomic<bool> mResourcePartitioned{false};
+        bool isResourcePartitioned() const { return mResourcePartitioned.load(); }
+
         std::shared_ptr<
                 aidl::com::google::hardware::pixel::display::IDisplayProximitySensorCallback>
                 mProximitySensorStateChangeCallback;
@@ -677,6 +702,7 @@ class ExynosDisplay {
         void destroyLayers();
 
         ExynosLayer *checkLayer(hwc2_layer_t addr);
+        ExynosLayer *getLayerBySlot(uint64_t handle) const { return mLayerSlots.find(handle); }
 
         void checkIgnoreLayers();
         virtual void doPreProcessing();
@@ -705,6 +731,8 @@ class ExynosDisplay {
         int32_t configureOverlay(ExynosCompositionInfo &compositionInfo);
 
         int32_t configureHandle(ExynosLayer &layer,  int fence_fd, exynos_win_config_data &cfg);
+        bool reuseLastWinConfig(ExynosLayer &layer, int32_t windowIndex,
+                                exynos_win_config_data &cfg);
 
         virtual int setWinConfigData();
 
@@ -1283,9 +1311,16 @@ class ExynosDisplay {
 
         unsigned int getLayerRegion(ExynosLayer *layer,
                 hwc_rect *rect_area, uint32_t regionType);
+        bool getExynosCompositionSrcDamage(hwc_rect &damage);
+        bool isExynosCompositionLayer(size_t index) const {
+            return mExynosCompositionInfo.mHasCompositionLayer &&
+                    ((int32_t)index >= mExynosCompositionInfo.mFirstIndex) &&
+                    ((int32_t)index <= mExynosCompositionInfo.mLastIndex);
+        }
 
         int handleWindowUpdate();
         bool windowUpdateExceptions();
+        bool alignWindowUpdateRegion(hwc_rect &region);
 
         /* For debugging */
         void setHWC1LayerList(hwc_display_contents_1_t *contents) {mHWC1LayerList = contents;};
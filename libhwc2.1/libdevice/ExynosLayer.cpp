@@ -22,6 +22,8 @@
 #include <sys/mman.h>
 #include <utils/Errors.h>
 
+#include <functional>
+
 #include "BrightnessController.h"
 #include "ExynosLayer.h"
 #include "ExynosResourceManager.h"
@@ -36,6 +38,24 @@
 
 using AidlBufferUsage = ::aidl::android::hardware::graphics::common::BufferUsage;
 
+namespace {
+
+template <typename T>
+uint64_t hashCombine(uint64_t seed, const T& value) {
+    return seed ^ (std::hash<T>{}(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+uint64_t hashBytes(uint64_t seed, const void* data, size_t size) {
+    /* FNV-1a */
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        seed = (seed ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return seed;
+}
+
+} // namespace
+
 ExynosLayer::ExynosLayer(ExynosDisplay* display)
       : ExynosMPPSource(MPP_SOURCE_LAYER, this),
         mDisplay(display),
@@ -419,12 +439,14 @@ int32_t ExynosLayer::setLayerBuffer(buffer_handle_t buffer, int32_t acquireFence
             setGeometryChanged(GEOMETRY_LAYER_FRONT_BUFFER_USAGE_CHANGED);
     }
 
+    invalidateContentHash();
     {
         Mutex::Autolock lock(mDisplay->mDRMutex);
         mLayerBuffer = buffer;
         checkFps(mLastLayerBuffer != mLayerBuffer);
         if (mLayerBuffer != mLastLayerBuffer) {
             mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
+            mUpdateIntervals.record(mLastUpdateTime);
             if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
                 mDisplay->mBufferUpdates++;
         }
@@ -491,8 +513,10 @@ int32_t ExynosLayer::setLayerBlendMode(int32_t /*hwc2_blend_mode_t*/ mode) {
     //TODO mGeometryChanged  here
     if (mode < 0)
         return HWC2_ERROR_BAD_PARAMETER;
-    if (mBlending != mode)
+    if (mBlending != mode) {
         setGeometryChanged(GEOMETRY_LAYER_BLEND_CHANGED);
+        invalidateContentHash();
+    }
     mBlending = mode;
     return HWC2_ERROR_NONE;
 }
@@ -501,6 +525,7 @@ int32_t ExynosLayer::setLayerBlendMode(int32_t /*hwc2_blend_mode_t*/ mode) {
 int32_t ExynosLayer::setLayerColor(hwc_color_t color) {
     /* TODO : Implementation here */
     mColor = color;
+    invalidateContentHash();
     return 0;
 }
 
@@ -519,6 +544,7 @@ int32_t ExynosLayer::setLayerCompositionType(int32_t /*hwc2_composition_t*/ type
 
     if (type != mCompositionType) {
         setGeometryChanged(GEOMETRY_LAYER_TYPE_CHANGED);
+        invalidateContentHash();
     }
 
     mCompositionType = type;
@@ -565,6 +591,7 @@ int32_t ExynosLayer::setLayerDataspace(int32_t /*android_dataspace_t*/ dataspace
         if (mMetaParcel != nullptr) {
             mMetaParcel->eType = VIDEO_INFO_TYPE_INVALID;
         }
+        invalidateContentHash();
     }
     mDataSpace = currentDataSpace;
 
@@ -576,8 +603,10 @@ int32_t ExynosLayer::setLayerDisplayFrame(hwc_rect_t frame) {
     if ((frame.left != mDisplayFrame.left) ||
         (frame.top != mDisplayFrame.top) ||
         (frame.right != mDisplayFrame.right) ||
-        (frame.bottom != mDisplayFrame.bottom))
+        (frame.bottom != mDisplayFrame.bottom)) {
         setGeometryChanged(GEOMETRY_LAYER_DISPLAYFRAME_CHANGED);
+        invalidateContentHash();
+    }
     mDisplayFrame = frame;
 
     return HWC2_ERROR_NONE;
@@ -591,6 +620,8 @@ int32_t ExynosLayer::setLayerPlaneAlpha(float alpha) {
 
     if ((mPlaneAlpha != alpha) && ((mPlaneAlpha == 0.0) || (alpha == 0.0)))
         setGeometryChanged(GEOMETRY_LAYER_IGNORE_CHANGED);
+    if (mPlaneAlpha != alpha)
+        invalidateContentHash();
 
     mPlaneAlpha = alpha;
 
@@ -612,6 +643,7 @@ int32_t ExynosLayer::setLayerSourceCrop(hwc_frect_t crop) {
         (crop.right != mSourceCrop.right) ||
         (crop.bottom != mSourceCrop.bottom)) {
         setGeometryChanged(GEOMETRY_LAYER_SOURCECROP_CHANGED);
+        invalidateContentHash();
         mSourceCrop = crop;
     }
 
@@ -622,6 +654,7 @@ int32_t ExynosLayer::setLayerTransform(int32_t /*hwc_transform_t*/ transform) {
 
     if (mTransform != transform) {
         setGeometryChanged(GEOMETRY_LAYER_TRANSFORM_CHANGED);
+        invalidateContentHash();
         mTransform = transform;
     }
 
@@ -649,6 +682,7 @@ int32_t ExynosLayer::setLayerPerFrameMetadata(uint32_t numElements,
     if (allocMetaParcel() != NO_ERROR)
         return -1;
     unsigned int multipliedVal = 50000;
+    invalidateContentHash();
     mMetaParcel->eType =
         static_cast<ExynosVideoInfoType>(mMetaParcel->eType | VIDEO_INFO_TYPE_HDR_STATIC);
     for (uint32_t i = 0; i < numElements; i++) {
@@ -716,6 +750,7 @@ int32_t ExynosLayer::setLayerPerFrameMetadataBlobs(uint32_t numElements, const i
         const uint8_t* metadata)
 {
     const uint8_t *metadata_start = metadata;
+    invalidateContentHash();
     for (uint32_t i = 0; i < numElements; i++) {
         HDEBUGLOGD(eDebugLayer, "HWC2: setLayerPerFrameMetadataBlobs key(%d)", keys[i]);
         switch (keys[i]) {
@@ -746,6 +781,7 @@ int32_t ExynosLayer::setLayerColorTransform(const float* matrix)
     {
         mLayerColorTransform.mat[i] = matrix[i];
     }
+    invalidateContentHash();
 
     return 0;
 }
@@ -776,6 +812,7 @@ int32_t ExynosLayer::setLayerBrightness(float brightness) {
         // Trigger display validation in case client composition is needed.
         setGeometryChanged(GEOMETRY_LAYER_WHITEPOINT_CHANGED);
         mBrightness = brightness;
+        invalidateContentHash();
     }
     return HWC2_ERROR_NONE;
 }
@@ -790,6 +827,7 @@ int32_t ExynosLayer::setLayerBlockingRegion(const std::vector<hwc_rect_t>& block
     }
 
     mBlockingRect = maxRect;
+    invalidateContentHash();
 
     return HWC2_ERROR_NONE;
 }
@@ -1247,12 +1285,28 @@ void ExynosLayer::printLayer()
 
 void ExynosLayer::setGeometryChanged(uint64_t changedBit)
 {
-    mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
     mGeometryChanged |= changedBit;
+    if (mInStateUpdate) {
+        mPendingGeometryChanged |= changedBit;
+        return;
+    }
+    mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
     if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
         mDisplay->setGeometryChanged(changedBit);
 }
 
+void ExynosLayer::endStateUpdate()
+{
+    mInStateUpdate = false;
+    if (mPendingGeometryChanged == 0)
+        return;
+
+    mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
+    if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
+        mDisplay->setGeometryChanged(mPendingGeometryChanged);
+    mPendingGeometryChanged = 0;
+}
+
 int ExynosLayer::allocMetaParcel()
 {
     /* Already allocated */
@@ -1291,3 +1345,41 @@ bool ExynosLayer::isDimLayer()
         return true;
     return false;
 }
+
+uint64_t ExynosLayer::getContentHash()
+{
+    if (!mContentHashDirty)
+        return mContentHash;
+
+    uint64_t hash = 0;
+    if (mLayerBuffer != NULL) {
+        VendorGraphicBufferMeta gmeta(mLayerBuffer);
+        hash = hashCombine(hash, gmeta.unique_id);
+        hash = hashCombine(hash, gmeta.format);
+    }
+    hash = hashCombine(hash, reinterpret_cast<uintptr_t>(mLayerBuffer));
+    hash = hashCombine(hash, mCompressionInfo.type);
+    hash = hashCombine(hash, mCompositionType);
+    hash = hashBytes(hash, &mSourceCrop, sizeof(mSourceCrop));
+    hash = hashBytes(hash, &mDisplayFrame, sizeof(mDisplayFrame));
+    hash = hashBytes(hash, &mBlockingRect, sizeof(mBlockingRect));
+    hash = hashCombine(hash, static_cast<int32_t>(mDataSpace));
+    hash = hashCombine(hash, mPlaneAlpha);
+    hash = hashCombine(hash, mTransform);
+    hash = hashCombine(hash, mBlending);
+    hash = hashBytes(hash, &mColor, sizeof(mColor));
+    hash = hashBytes(hash, &mBrightness, sizeof(mBrightness));
+    if (mLayerColorTransform.enable)
+        hash = hashBytes(hash, mLayerColorTransform.mat.data(),
+                         sizeof(float) * mLayerColorTransform.mat.size());
+    if (mMetaParcel != nullptr) {
+        hash = hashCombine(hash, static_cast<int32_t>(mMetaParcel->eType));
+        hash = hashBytes(hash, &mMetaParcel->sHdrStaticInfo, sizeof(mMetaParcel->sHdrStaticInfo));
+        hash = hashBytes(hash, &mMetaParcel->sHdrDynamicInfo,
+                         sizeof(mMetaParcel->sHdrDynamicInfo));
+    }
+
+    mContentHash = hash;
+    mContentHashDirty = false;
+    return mContentHash;
+}
@@ -83,6 +83,11 @@ class ExynosLayer : public ExynosMPPSource {
 
         ExynosDisplay* mDisplay;
 
+        /**
+         * Handle of this layer in the display's ExynosLayerSlotMap
+         */
+        uint64_t mSlotHandle = ExynosLayerSlotMap::kInvalidHandle;
+
         /**
          * Layer's compositionType
          *
@@ -196,6 +201,8 @@ class ExynosLayer : public ExynosMPPSource {
         buffer_handle_t mLayerBuffer;
 
         nsecs_t mLastUpdateTime;
+        /* Buffer update intervals, used by the dynamic recomposition policy */
+        UpdateIntervalHistogram mUpdateIntervals;
 
         /**
          * Surface Damage
@@ -510,12 +517,28 @@ class ExynosLayer : public ExynosMPPSource {
         size_t getDisplayFrameArea() { return HEIGHT(mDisplayFrame) * WIDTH(mDisplayFrame); }
         void setGeometryChanged(uint64_t changedBit);
         void clearGeometryChanged() {mGeometryChanged = 0;};
+        /* Geometry changes between begin and end are reported to the display once */
+        void beginStateUpdate() { mInStateUpdate = true; };
+        void endStateUpdate();
         bool isDimLayer();
         const ExynosVideoMeta* getMetaParcel() { return mMetaParcel; };
+        /*
+         * Fingerprint of the state that defines the content of the layer's window:
+         * buffer, crop, frame, dataspace, alpha, transform, blending, color and metadata.
+         * It is recomputed on the first query after the layer is updated.
+         */
+        uint64_t getContentHash();
+        void invalidateContentHash() { mContentHashDirty = true; };
 
     private:
         ExynosVideoMeta *mMetaParcel;
         int allocMetaParcel();
+
+        bool mInStateUpdate = false;
+        uint64_t mPendingGeometryChanged = 0;
+
+        bool mContentHashDirty = true;
+        uint64_t mContentHash = 0;
 };
 
 #endif //_EXYNOSLAYER_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EXYNOS_LAYER_SLOT_MAP_H_
+#define _EXYNOS_LAYER_SLOT_MAP_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class ExynosLayer;
+
+/*
+ * Generational slot map for the layers of a display.
+ * A handle packs a slot index and the generation of the layer that owns the slot, so
+ * looking up and validating a layer is a single indexed load. Generations come from a
+ * process-wide counter, therefore a handle of one display never resolves on another.
+ */
+class ExynosLayerSlotMap {
+public:
+    /*
+     * Set in every handle so that a handle is never 0 or a small index. It does not tell
+     * handles apart from ids chosen by the client, which can have any bit set.
+     */
+    static constexpr uint64_t kHandleTag = 1ULL << 62;
+    static constexpr uint64_t kGenerationMask = (1ULL << 30) - 1;
+    static constexpr uint64_t kInvalidHandle = 0;
+
+    static bool isHandle(uint64_t id) {
+        return (id & ~(kHandleTag | (kGenerationMask << 32) | UINT32_MAX)) == 0 &&
+                (id & kHandleTag) != 0;
+    }
+
+    uint64_t insert(ExynosLayer* layer) {
+        uint32_t index;
+        if (!mFreeSlots.empty()) {
+            index = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(mSlots.size());
+            mSlots.emplace_back();
+        }
+
+        uint32_t generation;
+        do {
+            generation = sNextGeneration.fetch_add(1, std::memory_order_relaxed) & kGenerationMask;
+        } while (generation == 0);
+
+        mSlots[index] = {layer, generation};
+        return kHandleTag | (static_cast<uint64_t>(generation) << 32) | index;
+    }
+
+    ExynosLayer* find(uint64_t handle) const {
+        if (!isHandle(handle)) return nullptr;
+        const uint32_t index = static_cast<uint32_t>(handle);
+        if (index >= mSlots.size()) return nullptr;
+        const Slot& slot = mSlots[index];
+        return slot.generation == ((handle >> 32) & kGenerationMask) ? slot.layer : nullptr;
+    }
+
+    void erase(uint64_t handle) {
+        if (find(handle) == nullptr) return;
+        const uint32_t index = static_cast<uint32_t>(handle);
+        mSlots[index] = {};
+        mFreeSlots.push_back(index);
+    }
+
+    void clear() {
+        mSlots.clear();
+        mFreeSlots.clear();
+    }
+
+private:
+    struct Slot {
+        ExynosLayer* layer = nullptr;
+        /* 0 marks a free slot */
+        uint32_t generation = 0;
+    };
+
+    std::vector<Slot> mSlots;
+    std::vector<uint32_t> mFreeSlots;
+    static inline std::atomic<uint32_t> sNextGeneration{1};
+};
+
+#endif // _EXYNOS_LAYER_SLOT_MAP_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentLatencyHistogram.h"
+
+#include <inttypes.h>
+
+size_t PresentLatencyHistogram::getBucketIndex(uint64_t durationUs) {
+    if (durationUs == 0) return 0;
+    // bucket i holds [2^(i-1), 2^i) us
+    size_t index = 64 - __builtin_clzll(durationUs);
+    return index < kNumBuckets ? index : kNumBuckets - 1;
+}
+
+void PresentLatencyHistogram::record(Stage stage, nsecs_t durationNs) {
+    if (stage >= Stage::MAX || durationNs < 0) return;
+
+    const uint64_t durationUs = static_cast<uint64_t>(ns2us(durationNs));
+    StageHistogram& histogram = mStages[static_cast<size_t>(stage)];
+
+    histogram.buckets[getBucketIndex(durationUs)].fetch_add(1, std::memory_order_relaxed);
+    histogram.totalUs.fetch_add(durationUs, std::memory_order_relaxed);
+
+    uint64_t prevMax = histogram.maxUs.load(std::memory_order_relaxed);
+    while (durationUs > prevMax &&
+           !histogram.maxUs.compare_exchange_weak(prevMax, durationUs,
+                                                  std::memory_order_relaxed)) {
+    }
+}
+
+void PresentLatencyHistogram::reset() {
+    for (auto& histogram : mStages) {
+        for (auto& bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histogram.totalUs.store(0, std::memory_order_relaxed);
+        histogram.maxUs.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t PresentLatencyHistogram::getPercentileUs(const std::array<uint64_t, kNumBuckets>& buckets,
+                                                  uint64_t count, uint32_t percentile) {
+    if (count == 0) return 0;
+
+    // rank of the sample at the given percentile, rounded up
+    const uint64_t rank = (count * percentile + 99) / 100;
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        accumulated += buckets[i];
+        if (accumulated >= rank) {
+            return getBucketLimitUs(i);
+        }
+    }
+    return getBucketLimitUs(kNumBuckets - 1);
+}
+
+const char* PresentLatencyHistogram::getStageName(Stage stage) {
+    switch (stage) {
+        case Stage::VALIDATE:
+            return "validate";
+        case Stage::ASSIGN_RESOURCE:
+            return "assignResource";
+        case Stage::EXYNOS_COMPOSITION:
+            return "exynosComposition";
+        case Stage::DELIVER_WIN_CONFIG:
+            return "deliverWinConfig";
+        case Stage::ATOMIC_COMMIT:
+            return "atomicCommit";
+        case Stage::PRESENT:
+            return "present";
+        default:
+            return "unknown";
+    }
+}
+
+void PresentLatencyHistogram::dump(android::String8& result) const {
+    result.appendFormat("Present pipeline latency (us, percentiles are bucket upper bounds):\n");
+    for (size_t stage = 0; stage < mStages.size(); stage++) {
+        const StageHistogram& histogram = mStages[stage];
+
+        // take a snapshot so the percentiles are consistent with the count
+        std::array<uint64_t, kNumBuckets> buckets;
+        uint64_t count = 0;
+        for (size_t i = 0; i < kNumBuckets; i++) {
+            buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            count += buckets[i];
+        }
+        if (count == 0) continue;
+
+        const uint64_t totalUs = histogram.totalUs.load(std::memory_order_relaxed);
+        result.appendFormat("\t%-18s count %" PRIu64 ", avg %" PRIu64 ", p50 <%" PRIu64
+                            ", p90 <%" PRIu64 ", p99 <%" PRIu64 ", max %" PRIu64 "\n",
+                            getStageName(static_cast<Stage>(stage)), count, totalUs / count,
+                            getPercentileUs(buckets, count, 50), getPercentileUs(buckets, count, 90),
+                            getPercentileUs(buckets, count, 99),
+                            histogram.maxUs.load(std::memory_order_relaxed));
+        result.appendFormat("\t\t");
+        for (size_t i = 0; i < kNumBuckets; i++) {
+            if (buckets[i] == 0) continue;
+            result.appendFormat("[<%" PRIu64 "]=%" PRIu64 " ", getBucketLimitUs(i), buckets[i]);
+        }
+        result.appendFormat("\n");
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PRESENT_LATENCY_HISTOGRAM_H_
+#define _PRESENT_LATENCY_HISTOGRAM_H_
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <atomic>
+
+/**
+ * Always-on per-stage timing of the validate/present pipeline.
+ *
+ * Each stage owns a log2 histogram of its duration in microseconds. Bucket 0 holds durations
+ * below 1us and bucket i (i > 0) holds durations in [2^(i-1), 2^i) us. Recording is a couple of
+ * relaxed atomic increments, so it is safe to call from the present path while dumpsys reads
+ * or the hwcService resets the histograms from another thread.
+ */
+class PresentLatencyHistogram {
+public:
+    enum class Stage : uint32_t {
+        VALIDATE = 0,
+        ASSIGN_RESOURCE,
+        EXYNOS_COMPOSITION,
+        DELIVER_WIN_CONFIG,
+        ATOMIC_COMMIT,
+        PRESENT,
+        MAX,
+    };
+
+    static constexpr size_t kNumBuckets = 24; // the last bucket covers >= 4.2s
+
+    class ScopedStageTimer {
+    public:
+        ScopedStageTimer(PresentLatencyHistogram& histogram, Stage stage)
+              : mHistogram(histogram), mStage(stage), mStartNs(systemTime(SYSTEM_TIME_MONOTONIC)) {}
+        ~ScopedStageTimer() {
+            mHistogram.record(mStage, systemTime(SYSTEM_TIME_MONOTONIC) - mStartNs);
+        }
+
+    private:
+        PresentLatencyHistogram& mHistogram;
+        const Stage mStage;
+        const nsecs_t mStartNs;
+    };
+
+    void record(Stage stage, nsecs_t durationNs);
+    void reset();
+    void dump(android::String8& result) const;
+
+private:
+    struct StageHistogram {
+        std::array<std::atomic<uint64_t>, kNumBuckets> buckets{};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint64_t> maxUs{0};
+    };
+
+    static size_t getBucketIndex(uint64_t durationUs);
+    // upper bound of the bucket in microseconds
+    static uint64_t getBucketLimitUs(size_t index) { return 1ULL << index; }
+    static uint64_t getPercentileUs(const std::array<uint64_t, kNumBuckets>& buckets,
+                                    uint64_t count, uint32_t percentile);
+    static const char* getStageName(Stage stage);
+
+    std::array<StageHistogram, static_cast<size_t>(Stage::MAX)> mStages;
+};
+
+#endif // _PRESENT_LATENCY_HISTOGRAM_H_
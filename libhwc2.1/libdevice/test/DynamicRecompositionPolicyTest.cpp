@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "DynamicRecompositionPolicy.h"
+
+namespace {
+
+/*
+ * Four full screen layers merged into one target at 60Hz,
+ * the saving ratio is 0.75 - updateRate / 3:
+ * client composition is entered below 1.35 updates per second and left above 1.95.
+ */
+DynamicRecompositionPolicy::Input makeInput(nsecs_t timestamp, float updateRate,
+                                            nsecs_t lastUpdateNs = 0) {
+    DynamicRecompositionPolicy::Input input;
+    input.timestamp = timestamp;
+    input.refreshRate = 60;
+    input.incomingPixels = 4000000;
+    input.mergedPixels = 1000000;
+    input.updateRate = updateRate;
+    input.lastUpdateNs = lastUpdateNs;
+    return input;
+}
+
+TEST(DynamicRecompositionPolicyTest, EnterThreshold) {
+    DynamicRecompositionPolicy policy;
+    EXPECT_FALSE(policy.evaluate(makeInput(s2ns(1), 1.4f), false));
+    EXPECT_TRUE(policy.evaluate(makeInput(s2ns(1), 1.3f), false));
+}
+
+TEST(DynamicRecompositionPolicyTest, ExitThresholdWithHysteresis) {
+    DynamicRecompositionPolicy policy;
+    ASSERT_TRUE(policy.evaluate(makeInput(s2ns(1), 0), false));
+
+    // Between the exit and the enter thresholds the current mode is kept
+    EXPECT_TRUE(policy.evaluate(makeInput(s2ns(2), 1.6f), true));
+    EXPECT_TRUE(policy.evaluate(makeInput(s2ns(2), 1.9f), true));
+    EXPECT_FALSE(policy.evaluate(makeInput(s2ns(2), 2.0f), true));
+
+    EXPECT_FALSE(policy.evaluate(makeInput(s2ns(3), 1.6f), false));
+}
+
+TEST(DynamicRecompositionPolicyTest, DeviceDwellBeforeReentering) {
+    DynamicRecompositionPolicy policy;
+    ASSERT_TRUE(policy.evaluate(makeInput(s2ns(1), 0), false));
+    ASSERT_FALSE(policy.evaluate(makeInput(s2ns(2), 3.0f), true));
+
+    EXPECT_FALSE(policy.evaluate(makeInput(s2ns(2) + ms2ns(499), 0), false));
+    EXPECT_TRUE(policy.evaluate(makeInput(s2ns(2) + ms2ns(500), 0), false));
+}
+
+TEST(DynamicRecompositionPolicyTest, FirstUpdateLeavesClientComposition) {
+    DynamicRecompositionPolicy policy;
+    ASSERT_TRUE(policy.evaluate(makeInput(s2ns(1), 0, ms2ns(200)), false));
+
+    // Updates before the switch are already merged in the client target
+    EXPECT_TRUE(policy.evaluate(makeInput(s2ns(2), 0, s2ns(1)), true));
+    // Even an otherwise idle stack goes back to device composition on the next update
+    EXPECT_FALSE(policy.evaluate(makeInput(s2ns(3), 0, s2ns(2)), true));
+}
+
+TEST(DynamicRecompositionPolicyTest, DumpLogsEveryEvaluation) {
+    DynamicRecompositionPolicy policy;
+    policy.evaluate(makeInput(s2ns(1), 1.4f, 111), false);
+    policy.evaluate(makeInput(s2ns(2), 0, 222), false);
+    policy.evaluate(makeInput(s2ns(3), 0, 333), true);
+
+    android::String8 result;
+    policy.dump(result);
+    const std::string dump(result.c_str());
+    EXPECT_NE(dump.find("3 evaluations, 1 switches"), std::string::npos) << dump;
+    // The evaluations that kept the mode are logged too, each with its inputs and state
+    EXPECT_NE(dump.find("1000000000 60.00 4000000 1000000 1.400 111 DEVICE 0 0.283 DEVICE"),
+              std::string::npos)
+            << dump;
+    EXPECT_NE(dump.find("2000000000 60.00 4000000 1000000 0.000 222 DEVICE 0 0.750 CLIENT"),
+              std::string::npos)
+            << dump;
+    EXPECT_NE(dump.find("3000000000 60.00 4000000 1000000 0.000 333 CLIENT 2000000000 0.750 "
+                        "CLIENT"),
+              std::string::npos)
+            << dump;
+}
+
+} // namespace
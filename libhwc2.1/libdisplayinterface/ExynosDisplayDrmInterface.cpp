@@ -2255,7 +2255,12 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
         mExynosDisplay->applyExpectedPresentTime();
     }
 
-    if ((ret = drmReq.commit(flags, true)) < 0) {
+    nsecs_t commitStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    ret = drmReq.commit(flags, true);
+    mExynosDisplay->mPresentLatencyHistogram.record(PresentLatencyHistogram::Stage::ATOMIC_COMMIT,
+                                                    systemTime(SYSTEM_TIME_MONOTONIC) -
+                                                            commitStartTime);
+    if (ret < 0) {
         HWC_LOGE(mExynosDisplay, "%s:: Failed to commit pset ret=%d in deliverWinConfigData()\n",
                 __func__, ret);
         return ret;
@@ -83,6 +83,8 @@ int ExynosExternalDisplay::openExternalDisplay()
     mPlugState = true;
 
     if (mLayers.size() != 0) {
+        for (size_t i = 0; i < mLayers.size(); i++)
+            mLayerSlots.erase(mLayers[i]->mSlotHandle);
         mLayers.clear();
     }
 
@@ -119,6 +121,7 @@ void ExynosExternalDisplay::closeExternalDisplay()
         layer->mAcquireFence = fence_close(layer->mAcquireFence, this, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_LAYER);
         layer->mReleaseFence = -1;
         layer->mLayerBuffer = NULL;
+        layer->invalidateContentHash();
     }
 
     mClientCompositionInfo.initializeInfosComplete(this);
@@ -365,7 +368,7 @@ int32_t ExynosExternalDisplay::presentDisplay(
             ((mRenderingState == RENDERING_STATE_PRESENTED) ||
              (mRenderingState == RENDERING_STATE_NONE))) {
 
-            if (mDevice->canSkipValidate() == false) {
+            if (mDevice->canSkipValidate(this) == false) {
                 mRenderingState = RENDERING_STATE_NONE;
                 return HWC2_ERROR_NOT_VALIDATED;
             } else {
@@ -613,4 +613,15 @@ int32_t ExynosHWCService::setDisplayTemperature(uint32_t displayId, int32_t temp
     return NO_ERROR;
 }
 
+int32_t ExynosHWCService::resetPresentLatencyHistogram(uint32_t displayId) {
+    ALOGD("ExynosHWCService::%s() displayID(%u)", __func__, displayId);
+
+    auto display = mHWCCtx->device->getDisplay(displayId);
+
+    if (display == nullptr) return -EINVAL;
+
+    display->mPresentLatencyHistogram.reset();
+    return NO_ERROR;
+}
+
 } //namespace android
@@ -83,6 +83,7 @@ enum {
     SET_PRESENT_TIMEOUT_CONTROLLER = 1017,
     SET_FIXED_TE2_RATE = 1018,
     SET_DISPLAY_TEMPERATURE = 1019,
+    RESET_PRESENT_LATENCY_HISTOGRAM = 1020,
 };
 
 class BpExynosHWCService : public BpInterface<IExynosHWCService> {
@@ -594,6 +595,15 @@ public:
         if (result) ALOGE("SET_DISPLAY_TEMPERATURE transact error(%d)", result);
         return result;
     }
+
+    virtual int32_t resetPresentLatencyHistogram(uint32_t displayId) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IExynosHWCService::getInterfaceDescriptor());
+        data.writeUint32(displayId);
+        int result = remote()->transact(RESET_PRESENT_LATENCY_HISTOGRAM, data, &reply);
+        if (result) ALOGE("RESET_PRESENT_LATENCY_HISTOGRAM transact error(%d)", result);
+        return result;
+    }
 };
 
 IMPLEMENT_META_INTERFACE(ExynosHWCService, "android.hal.ExynosHWCService");
@@ -942,6 +952,12 @@ status_t BnExynosHWCService::onTransact(
             return setDisplayTemperature(displayId, temperature);
         } break;
 
+        case RESET_PRESENT_LATENCY_HISTOGRAM: {
+            CHECK_INTERFACE(IExynosHWCService, data, reply);
+            uint32_t displayId = data.readUint32();
+            return resetPresentLatencyHistogram(displayId);
+        } break;
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -25,6 +25,7 @@
 #include <utils/CallStack.h>
 #include <utils/Errors.h>
 
+#include <cmath>
 #include <iomanip>
 
 #include "ExynosHWC.h"
@@ -680,6 +681,51 @@ void adjustRect(hwc_rect_t &rect, int32_t width, int32_t height)
         rect.bottom = height;
 }
 
+hwc_rect_t mapSourceRectToDisplay(const hwc_rect_t &rect, const hwc_frect_t &sourceCrop,
+                                  const hwc_rect_t &displayFrame, uint32_t transform)
+{
+    const float cropWidth = sourceCrop.right - sourceCrop.left;
+    const float cropHeight = sourceCrop.bottom - sourceCrop.top;
+    if ((cropWidth <= 0) || (cropHeight <= 0))
+        return displayFrame;
+
+    /* Normalized position in the source crop */
+    float l = (rect.left - sourceCrop.left) / cropWidth;
+    float t = (rect.top - sourceCrop.top) / cropHeight;
+    float r = (rect.right - sourceCrop.left) / cropWidth;
+    float b = (rect.bottom - sourceCrop.top) / cropHeight;
+
+    /* Flips are applied before the rotation */
+    if (transform & HAL_TRANSFORM_FLIP_H) {
+        std::swap(l, r);
+        l = 1.0f - l;
+        r = 1.0f - r;
+    }
+    if (transform & HAL_TRANSFORM_FLIP_V) {
+        std::swap(t, b);
+        t = 1.0f - t;
+        b = 1.0f - b;
+    }
+    if (transform & HAL_TRANSFORM_ROT_90) {
+        /* Clockwise, (x, y) -> (1 - y, x) */
+        float rotatedLeft = 1.0f - b;
+        float rotatedRight = 1.0f - t;
+        t = l;
+        b = r;
+        l = rotatedLeft;
+        r = rotatedRight;
+    }
+
+    const float frameWidth = WIDTH(displayFrame);
+    const float frameHeight = HEIGHT(displayFrame);
+    hwc_rect_t mapped;
+    mapped.left = displayFrame.left + (int)floorf(l * frameWidth);
+    mapped.top = displayFrame.top + (int)floorf(t * frameHeight);
+    mapped.right = displayFrame.left + (int)ceilf(r * frameWidth);
+    mapped.bottom = displayFrame.top + (int)ceilf(b * frameHeight);
+    return intersect(mapped, displayFrame);
+}
+
 uint32_t getBufferNumOfFormat(int format, uint32_t compressType) {
     auto exynosFormat = halFormatToExynosFormat(format, compressType);
     return (exynosFormat != nullptr) ? exynosFormat->bufferNum : 0;
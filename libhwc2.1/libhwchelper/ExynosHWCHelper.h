@@ -484,6 +484,9 @@ void printExynosLayer(const ExynosLayer *layer);
 String8 getFormatStr(int format, uint32_t compressType);
 String8 getMPPStr(int typeId);
 void adjustRect(hwc_rect_t &rect, int32_t width, int32_t height);
+/* Maps a rect in the buffer of a layer to the display, rounding outward */
+hwc_rect_t mapSourceRectToDisplay(const hwc_rect_t &rect, const hwc_frect_t &sourceCrop,
+                                  const hwc_rect_t &displayFrame, uint32_t transform);
 uint32_t getBufferNumOfFormat(int format, uint32_t compressType);
 uint32_t getPlaneNumOfFormat(int format, uint32_t compressType);
 uint32_t getBytePerPixelOfPrimaryPlane(int format);
@@ -506,6 +509,16 @@ inline hwc_rect expand(const hwc_rect &r1, const hwc_rect &r2)
     return i;
 }
 
+inline hwc_rect intersect(const hwc_rect &r1, const hwc_rect &r2)
+{
+    hwc_rect i;
+    i.top = max(r1.top, r2.top);
+    i.bottom = min(r1.bottom, r2.bottom);
+    i.left = max(r1.left, r2.left);
+    i.right = min(r1.right, r2.right);
+    return i;
+}
+
 template <typename T>
 inline T pixel_align_down(const T x, const uint32_t a) {
     static_assert(std::numeric_limits<T>::is_integer,
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CompositionPassPolicy.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+float CompositionPassPolicy::getG2DCost(const Input& input) {
+    // G2D reads the client layers, every extra pass reads and writes the target once more
+    const uint32_t extraPasses = (input.passNum > 1) ? (input.passNum - 1) : 0;
+    return input.clientPixels + 2.0f * extraPasses * input.targetPixels;
+}
+
+float CompositionPassPolicy::getGpuCost(const Input& input) {
+    // GPU reads the client layers and writes its target, the DPU reads the target again
+    return kGpuWakeupCost + kGpuCostWeight * (input.clientPixels + input.targetPixels) +
+            input.targetPixels;
+}
+
+bool CompositionPassPolicy::evaluate(const Input& input) {
+    const bool useG2D = !input.gpuRequired && (input.passNum > 0) &&
+            (input.requiredCapacity <= input.capacity) &&
+            (getG2DCost(input) < getGpuCost(input));
+
+    mDecisionLog.record({input, useG2D});
+    return useG2D;
+}
+
+uint32_t CompositionPassPolicy::getPassNum(uint32_t srcNum, uint32_t maxSrcNum,
+                                           uint32_t maxPasses) {
+    if (srcNum <= maxSrcNum) return 1;
+    if (maxSrcNum <= 1) return 0;
+
+    const uint32_t passNum = 1 + (srcNum - 2) / (maxSrcNum - 1);
+    return (passNum <= maxPasses) ? passNum : 0;
+}
+
+uint32_t CompositionPassPolicy::getPassOfSource(size_t srcIndex, size_t srcNum, uint32_t passNum,
+                                                uint32_t maxSrcNum) {
+    if ((passNum <= 1) || (maxSrcNum <= 1)) return 0;
+
+    const size_t pass = (srcNum - 1 - srcIndex) / (maxSrcNum - 1);
+    return static_cast<uint32_t>(std::min<size_t>(pass, passNum - 1));
+}
+
+void CompositionPassPolicy::dump(android::String8& result) const {
+    result.appendFormat("G2D composition pass decisions (%zu)\n", mDecisionLog.getCount());
+    result.appendFormat("\tclientLayers clientPixels targetPixels passes capacity gpuRequired "
+                        "g2dCost gpuCost composition\n");
+    mDecisionLog.forEach([&result](const Decision& decision) {
+        const Input& input = decision.input;
+        result.appendFormat("\t%u %" PRIu64 " %" PRIu64 " %u %.2f/%.2f %d %.0f %.0f %s\n",
+                            input.clientLayerNum, input.clientPixels, input.targetPixels,
+                            input.passNum, input.requiredCapacity, input.capacity,
+                            input.gpuRequired, getG2DCost(input), getGpuCost(input),
+                            decision.useG2D ? "G2D" : "CLIENT");
+    });
+}
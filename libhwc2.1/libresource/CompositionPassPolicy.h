@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _COMPOSITION_PASS_POLICY_H_
+#define _COMPOSITION_PASS_POLICY_H_
+
+#include <utils/String8.h>
+
+#include "DecisionLog.h"
+
+/*
+ * Decides whether layers that overflow a single G2D task are composed by chaining
+ * more G2D passes through an intermediate buffer instead of client composition.
+ * Extra passes cost G2D time to read and write the whole intermediate buffer, client
+ * composition costs a GPU wakeup, the GPU rendering and a client target fetched by the DPU.
+ * The policy is a pure function of its input so that the decision log can be replayed
+ * offline to tune the constants.
+ */
+class CompositionPassPolicy {
+public:
+    struct Input {
+        /* Layers that client composition would take */
+        uint32_t clientLayerNum = 0;
+        /* Pixels read from those layers */
+        uint64_t clientPixels = 0;
+        /* Pixels of the composition target */
+        uint64_t targetPixels = 0;
+        /* G2D passes needed to take the client layers too, 0 if they don't fit */
+        uint32_t passNum = 0;
+        /* G2D time in ms with the client layers and the extra passes */
+        float requiredCapacity = 0;
+        float capacity = 0;
+        /* Client composition is needed anyway, for layers that G2D can't take */
+        bool gpuRequired = false;
+    };
+
+    /* Returns true if the client layers should be composed by extra G2D passes */
+    bool evaluate(const Input& input);
+    void dump(android::String8& result) const;
+
+    /*
+     * Passes needed to compose srcNum sources with up to maxSrcNum sources per pass,
+     * 0 if more than maxPasses are needed. The lowest pass composes up to maxSrcNum
+     * sources, every pass above it composes maxSrcNum - 1 sources over the output of
+     * the pass below.
+     */
+    static uint32_t getPassNum(uint32_t srcNum, uint32_t maxSrcNum, uint32_t maxPasses);
+    /*
+     * Pass of the source at srcIndex, sources are sorted from the bottom and passes
+     * are counted from the final one
+     */
+    static uint32_t getPassOfSource(size_t srcIndex, size_t srcNum, uint32_t passNum,
+                                    uint32_t maxSrcNum);
+
+private:
+    /*
+     * Costs are in G2D pixel accesses. Waking up the GPU and rendering on it costs
+     * much more than a G2D access, so extra passes win whenever the G2D has time for them.
+     */
+    static constexpr float kGpuWakeupCost = 2e6f;
+    static constexpr float kGpuCostWeight = 4.0f;
+    static constexpr size_t kDecisionLogSize = 16;
+
+    struct Decision {
+        Input input;
+        bool useG2D;
+    };
+
+    static float getG2DCost(const Input& input);
+    static float getGpuCost(const Input& input);
+
+    DecisionLog<Decision, kDecisionLogSize> mDecisionLog;
+};
+
+#endif // _COMPOSITION_PASS_POLICY_H_
@@ -23,9 +23,12 @@
 #include <sys/mman.h>
 #include <cutils/properties.h>
 #include "ExynosMPP.h"
+#include "CompositionPassPolicy.h"
 #include "ExynosResourceRestriction.h"
 #include <hardware/hwcomposer_defs.h>
 #include <math.h>
+#include <algorithm>
+#include <memory>
 #include "VendorGraphicBuffer.h"
 #include "ExynosHWCDebug.h"
 #include "ExynosDisplay.h"
@@ -49,6 +52,35 @@ int ExynosMPP::mainDisplayWidth = 0;
 int ExynosMPP::mainDisplayHeight = 0;
 extern struct exynos_hwc_control exynosHWCControl;
 
+/* Partial composition area is aligned to the AFBC block size */
+constexpr uint32_t kPartialCompositionAlign = 16;
+/* Larger damage is composed fully, copying the clean area forward costs more than it saves */
+constexpr uint64_t kPartialCompositionMaxAreaPercent = 50;
+/* Bands around the partial composition area */
+constexpr size_t kMaxCopyForwardRects = 4;
+
+static size_t getCopyForwardRects(const hwc_rect_t &area, int32_t width, int32_t height,
+                                  hwc_rect_t rects[kMaxCopyForwardRects])
+{
+    const hwc_rect_t candidates[kMaxCopyForwardRects] = {
+        {0, 0, width, area.top},
+        {0, area.bottom, width, height},
+        {0, area.top, area.left, area.bottom},
+        {area.right, area.top, width, area.bottom},
+    };
+    size_t num = 0;
+    for (const auto &rect : candidates) {
+        if ((WIDTH(rect) > 0) && (HEIGHT(rect) > 0))
+            rects[num++] = rect;
+    }
+    return num;
+}
+
+static hwc_rect_t getImageRect(const exynos_image &img)
+{
+    return {(int)img.x, (int)img.y, (int)(img.x + img.w), (int)(img.y + img.h)};
+}
+
 std::unordered_map<tdm_attr_t, TDMInfo_t> HWAttrs = {
     {TDM_ATTR_SRAM_AMOUNT, {String8("SRAM"),  LS_DPUF}},
     {TDM_ATTR_AFBC,        {String8("AFBC"),  LS_DPUF}},
@@ -160,16 +192,19 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
     mAllocOutBufFlag(true),
     mFreeOutBufFlag(true),
     mHWBusyFlag(false),
+    mPartialCompositionEnabled(false),
+    mLastComposedDstBuf(-1),
+    mLastComposedDstFence(-1),
     mCurrentDstBuf(0),
     mPrivDstBuf(-1),
     mNeedCompressedTarget(false),
-    mDstAllocatedSize(DST_SIZE_UNKNOWN),
     mUseM2MSrcFence(false),
     mAttr(0),
     mAssignOrder(0),
     mAXIPortId(0),
     mHWBlockId(0),
-    mNeedSolidColorLayer(false)
+    mNeedSolidColorLayer(false),
+    mMaxCompositionPasses(1)
 {
     if (mPhysicalType < MPP_DPP_NUM) {
         mClockKhz = VPP_CLOCK;
@@ -232,6 +267,24 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
     if (mMaxSrcLayerNum > 1) {
         mNeedSolidColorLayer = true;
         mAcrylicHandle->setDefaultColor(0, 0, 0, 0);
+        mPartialCompositionEnabled = (mPhysicalType == MPP_G2D) &&
+                property_get_bool("vendor.display.g2d.partial_composition.enabled", true);
+    }
+
+    if ((mPhysicalType == MPP_G2D) && (mLogicalType == MPP_LOGICAL_G2D_RGB)) {
+        int32_t passes = property_get_int32("vendor.display.g2d.composition_passes",
+                                            MAX_G2D_COMPOSITION_PASSES);
+        mMaxCompositionPasses = std::clamp(passes, 1, MAX_G2D_COMPOSITION_PASSES);
+        for (uint32_t i = 1; i < mMaxCompositionPasses; i++) {
+            Acrylic *handle = AcrylicFactory::createAcrylic("default_compositor");
+            if (handle == NULL) {
+                MPP_LOGE("Fail to allocate acrylic handle for pass %d", i);
+                mMaxCompositionPasses = i;
+                break;
+            }
+            handle->setDefaultColor(0, 0, 0, 0);
+            mLowerPassHandles.emplace_back(handle);
+        }
     }
 
     mAssignedSources.clear();
@@ -258,6 +311,11 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
         mDstImgs[i].acrylicAcquireFenceFd = -1;
         mDstImgs[i].acrylicReleaseFenceFd = -1;
     }
+    for (auto &img : mIntermediateImgs) {
+        memset(&img, 0, sizeof(img));
+        img.acrylicAcquireFenceFd = -1;
+        img.acrylicReleaseFenceFd = -1;
+    }
 
     for (uint32_t i = 0; i < DISPLAY_MODE_NUM; i++)
     {
@@ -269,6 +327,8 @@ ExynosMPP::~ExynosMPP()
 {
     mResourceManageThread->mRunning = false;
     mResourceManageThread->requestExitAndWait();
+    /* The assigned display may already be destroyed, skip fence tracking */
+    mLastComposedDstFence = hwcFdClose(mLastComposedDstFence);
 }
 
 
@@ -845,7 +905,6 @@ bool ExynosMPP::ResourceManageThread::threadLoop()
 
 void ExynosMPP::ResourceManageThread::freeBuffers()
 {
-    VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
     android::List<exynos_mpp_img_info >::iterator it;
     android::List<exynos_mpp_img_info >::iterator end;
     it = mFreedBuffers.begin();
@@ -870,7 +929,8 @@ void ExynosMPP::ResourceManageThread::freeBuffers()
                 fence_close(freeBuffer.acrylicReleaseFenceFd, mExynosMPP->mAssignedDisplay,
                         FENCE_TYPE_SRC_RELEASE, FENCE_IP_ALL);
         }
-        gAllocator.free(freeBuffer.bufferHandle);
+        mExynosMPP->mResourceManager->mDstBufPool.release(freeBuffer.bufferHandle,
+                                                          freeBuffer.reusable);
         it = mFreedBuffers.erase(it);
     }
 }
@@ -926,7 +986,6 @@ void ExynosMPP::ResourceManageThread::addStateFence(int fence)
  */
 int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t usage, uint32_t index) {
     ATRACE_CALL();
-    uint32_t dstStride = 0;
 
     MPP_LOGD(eDebugMPP|eDebugBuf, "index: %d++++++++", index);
 
@@ -949,12 +1008,8 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
 
     status_t error = NO_ERROR;
 
-    {
-        ATRACE_CALL();
-
-        VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
-        error = gAllocator.allocate(w, h, format, 1, allocUsage, &dstBuffer, &dstStride, "HWC");
-    }
+    error = mResourceManager->mDstBufPool.acquire(w, h, getOutBufAlign(), format, allocUsage,
+                                                  &dstBuffer);
 
     if ((error != NO_ERROR) || (dstBuffer == NULL)) {
         MPP_LOGE("failed to allocate destination buffer(%dx%d): %d", w, h, error);
@@ -962,6 +1017,8 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
     }
 
     memset(&mDstImgs[index], 0, sizeof(mDstImgs[index]));
+    if (mLastComposedDstBuf == (int32_t)index)
+        invalidateLastComposedDst();
 
     mDstImgs[index].acrylicAcquireFenceFd = -1;
     mDstImgs[index].acrylicReleaseFenceFd = -1;
@@ -972,6 +1029,14 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
     MPP_LOGD(eDebugMPP|eDebugBuf, "free outbuf[%d] %p", index, freeDstBuf.bufferHandle);
 
     if (freeDstBuf.bufferHandle != NULL) {
+        /*
+         * Replaced buffer can serve other MPPs or a later mode change,
+         * unless the pool is shrinking to a smaller size class.
+         */
+        VendorGraphicBufferMeta freeMeta(freeDstBuf.bufferHandle);
+        VendorGraphicBufferMeta dstMeta(dstBuffer);
+        freeDstBuf.reusable = ((freeMeta.width <= dstMeta.width) &&
+                               (freeMeta.height <= dstMeta.height));
         freeOutBuf(freeDstBuf);
     } else {
         if (mAssignedDisplay != NULL) {
@@ -1131,12 +1196,32 @@ bool ExynosMPP::canUsePrevFrame()
     if (mAllocOutBufFlag == false)
         return false;
 
+    if (isSrcGeometryUnchanged() == false)
+        return false;
+
+    for (uint32_t i = 0; i < mPrevFrameInfo.srcNum; i++) {
+        if (mPrevFrameInfo.srcInfo[i].bufferHandle != mAssignedSources[i]->mSrcImg.bufferHandle)
+            return false;
+    }
+
+   int32_t prevDstIndex  = (mCurrentDstBuf + NUM_MPP_DST_BUFS(mLogicalType) - 1)% NUM_MPP_DST_BUFS(mLogicalType);
+   if (mDstImgs[prevDstIndex].bufferHandle == NULL)
+       return false;
+
+    return true;
+}
+
+/*
+ * Returns true if the sources are composed with the same attributes
+ * as the previous frame, only the buffer contents can be changed.
+ */
+bool ExynosMPP::isSrcGeometryUnchanged()
+{
     if (mPrevFrameInfo.srcNum != mAssignedSources.size())
         return false;
 
     for (uint32_t i = 0; i < mPrevFrameInfo.srcNum; i++) {
-        if ((mPrevFrameInfo.srcInfo[i].bufferHandle != mAssignedSources[i]->mSrcImg.bufferHandle) ||
-            (mPrevFrameInfo.srcInfo[i].x != mAssignedSources[i]->mSrcImg.x) ||
+        if ((mPrevFrameInfo.srcInfo[i].x != mAssignedSources[i]->mSrcImg.x) ||
             (mPrevFrameInfo.srcInfo[i].y != mAssignedSources[i]->mSrcImg.y) ||
             (mPrevFrameInfo.srcInfo[i].w != mAssignedSources[i]->mSrcImg.w) ||
             (mPrevFrameInfo.srcInfo[i].h != mAssignedSources[i]->mSrcImg.h) ||
@@ -1156,13 +1241,346 @@ bool ExynosMPP::canUsePrevFrame()
             return false;
     }
 
-   int32_t prevDstIndex  = (mCurrentDstBuf + NUM_MPP_DST_BUFS(mLogicalType) - 1)% NUM_MPP_DST_BUFS(mLogicalType);
-   if (mDstImgs[prevDstIndex].bufferHandle == NULL)
-       return false;
+    return true;
+}
+
+/*
+ * Checks whether only the damaged area of the destination can be composed.
+ * The rest of the destination is copied forward from the previous destination
+ * buffer, so the sources should be placed same as the previous frame and
+ * the previous destination buffer should hold a complete frame.
+ */
+bool ExynosMPP::getPartialCompositionArea(hwc_rect_t &area)
+{
+    /* Multi-pass composition always composes the entire destination */
+    if (!mPartialCompositionEnabled || !mSrcDamage.has_value() || !mAllocOutBufFlag ||
+        mUseM2MSrcFence || (mAssignedDisplay == NULL) ||
+        (mAssignedSources.size() > mMaxSrcLayerNum))
+        return false;
+
+    int32_t prevDstIndex = (mCurrentDstBuf + NUM_MPP_DST_BUFS(mLogicalType) - 1) %
+            NUM_MPP_DST_BUFS(mLogicalType);
+    if ((prevDstIndex == mCurrentDstBuf) || (prevDstIndex != mLastComposedDstBuf) ||
+        (mPrevAssignedDisplayType != (int32_t)mAssignedDisplay->mType) ||
+        (isSrcGeometryUnchanged() == false))
+        return false;
+
+    const exynos_mpp_img_info &prevDst = mDstImgs[prevDstIndex];
+    const exynos_mpp_img_info &curDst = mDstImgs[mCurrentDstBuf];
+    if ((prevDst.bufferHandle == NULL) || (curDst.bufferHandle == NULL) ||
+        (prevDst.format != curDst.format) || !isFormatRgb(curDst.format) ||
+        (getCompressionType(prevDst.bufferHandle) != getCompressionType(curDst.bufferHandle)))
+        return false;
+
+    VendorGraphicBufferMeta prevMeta(prevDst.bufferHandle);
+    VendorGraphicBufferMeta curMeta(curDst.bufferHandle);
+    if ((prevMeta.stride != curMeta.stride) || (prevMeta.vstride != curMeta.vstride))
+        return false;
+
+    const int32_t width = mAssignedDisplay->mXres;
+    const int32_t height = mAssignedDisplay->mYres;
+    area = mSrcDamage.value();
+    area.left = pixel_align_down(max(area.left, 0), kPartialCompositionAlign);
+    area.top = pixel_align_down(max(area.top, 0), kPartialCompositionAlign);
+    area.right = min(pixel_align(area.right, kPartialCompositionAlign), width);
+    area.bottom = min(pixel_align(area.bottom, kPartialCompositionAlign), height);
+    if ((WIDTH(area) <= 0) || (HEIGHT(area) <= 0))
+        return false;
+    if ((uint64_t)WIDTH(area) * HEIGHT(area) * 100 >
+        (uint64_t)width * height * kPartialCompositionMaxAreaPercent)
+        return false;
 
+    hwc_rect_t copyRects[kMaxCopyForwardRects];
+    size_t layerNum = getCopyForwardRects(area, width, height, copyRects);
+    for (size_t i = 0; i < mAssignedSources.size(); i++) {
+        hwc_rect_t overlap = intersect(getImageRect(mAssignedSources[i]->mMidImg), area);
+        if ((WIDTH(overlap) > 0) && (HEIGHT(overlap) > 0))
+            layerNum++;
+    }
+    if (layerNum > mMaxSrcLayerNum)
+        return false;
+
+    MPP_LOGD(eDebugMPP, "partial composition [%d, %d, %d, %d], layers(%zu)",
+            area.left, area.top, area.right, area.bottom, layerNum);
     return true;
 }
 
+/*
+ * Configures a layer that copies the rect of the previous destination buffer
+ * over everything composed below it.
+ */
+int32_t ExynosMPP::setupCopyForwardLayer(AcrylicLayer *layer, const exynos_mpp_img_info &prevDst,
+                                         hwc_rect_t &rect, int zOrder)
+{
+    VendorGraphicBufferMeta gmeta(prevDst.bufferHandle);
+    int bufFds[MAX_HW2D_PLANES];
+    size_t bufLength[MAX_HW2D_PLANES];
+    uint32_t attribute = 0;
+    CompressionInfo compressionInfo = getCompressionInfo(prevDst.bufferHandle);
+    uint32_t bufferNum = getBufferNumOfFormat(prevDst.format, compressionInfo.type);
+    if (bufferNum == 0) {
+        MPP_LOGE("%s:: Fail to get bufferNum, format(0x%8x)", __func__, prevDst.format);
+        return -EINVAL;
+    }
+
+    bufFds[0] = gmeta.fd;
+    bufFds[1] = gmeta.fd1;
+    bufFds[2] = gmeta.fd2;
+    if (getBufLength(prevDst.bufferHandle, MAX_HW2D_PLANES, bufLength, prevDst.format,
+                gmeta.stride, gmeta.vstride) != NO_ERROR) {
+        MPP_LOGE("%s:: invalid bufferLength(%zu, %zu, %zu), format(0x%8x)", __func__,
+                bufLength[0], bufLength[1], bufLength[2], prevDst.format);
+        return -EINVAL;
+    }
+
+    if (prevDst.bufferType == MPP_BUFFER_SECURE_DRM)
+        attribute |= AcrylicCanvas::ATTR_PROTECTED;
+    if (compressionInfo.type == COMP_TYPE_AFBC) {
+        if (isAFBC32x8(compressionInfo))
+            attribute |= AcrylicCanvas::ATTR_COMPRESSED_WIDEBLK;
+        else
+            attribute |= AcrylicCanvas::ATTR_COMPRESSED;
+    }
+
+    /*
+     * The previous task can still be writing the previous destination since
+     * the tasks are submitted asynchronously, so wait for its completion.
+     */
+    int acquireFence = hwc_dup(mLastComposedDstFence, mAssignedDisplay,
+                               FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D);
+    if (acquireFence >= 0) {
+        setFenceName(acquireFence, FENCE_G2D_SRC_LAYER);
+        setFenceInfo(acquireFence, mAssignedDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D,
+                     HwcFenceDirection::TO);
+    }
+
+    layer->setImageDimension(gmeta.stride, gmeta.vstride);
+    layer->setImageType(prevDst.format, prevDst.dataspace);
+    layer->setImageBuffer(bufFds, bufLength, bufferNum, acquireFence, attribute);
+    layer->setLayerHDR(false);
+    layer->setCompositMode(HWC2_BLEND_MODE_NONE, 255, zOrder);
+    layer->setCompositArea(rect, rect, 0, AcrylicLayer::ATTR_NORESAMPLING);
+
+    MPP_LOGD(eDebugMPP, "copy forward [%d, %d, %d, %d] from %p",
+            rect.left, rect.top, rect.right, rect.bottom, prevDst.bufferHandle);
+
+    return NO_ERROR;
+}
+
+Acrylic *ExynosMPP::getCompositionPassHandle(uint32_t pass)
+{
+    if (pass == 0)
+        return mAcrylicHandle;
+    return (pass <= mLowerPassHandles.size()) ? mLowerPassHandles[pass - 1].get() : NULL;
+}
+
+uint32_t ExynosMPP::getCompositionPassOfSource(size_t srcIndex, size_t srcNum,
+                                               uint32_t passNum) const
+{
+    return CompositionPassPolicy::getPassOfSource(srcIndex, srcNum, passNum, mMaxSrcLayerNum);
+}
+
+/*
+ * Configures the lowest layer of a pass that takes the entire output of the pass below.
+ */
+int32_t ExynosMPP::setupIntermediateLayer(uint32_t pass, const exynos_mpp_img_info &intermediate,
+                                          int acquireFence)
+{
+    Acrylic *handle = getCompositionPassHandle(pass);
+    if (handle == NULL) {
+        MPP_LOGE("%s:: no compositor for pass %d", __func__, pass);
+        fence_close(acquireFence, mAssignedDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D);
+        return -EINVAL;
+    }
+
+    std::unique_ptr<AcrylicLayer> &layer = mIntermediateLayers[pass];
+    if (layer == nullptr) {
+        layer.reset(handle->createLayer());
+        if (layer == nullptr) {
+            MPP_LOGE("%s:: Fail to create intermediate layer", __func__);
+            fence_close(acquireFence, mAssignedDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D);
+            return -EINVAL;
+        }
+    }
+
+    VendorGraphicBufferMeta gmeta(intermediate.bufferHandle);
+    int bufFds[MAX_HW2D_PLANES];
+    size_t bufLength[MAX_HW2D_PLANES];
+    uint32_t bufferNum = getBufferNumOfFormat(intermediate.format, COMP_TYPE_NONE);
+    bufFds[0] = gmeta.fd;
+    bufFds[1] = gmeta.fd1;
+    bufFds[2] = gmeta.fd2;
+    if ((bufferNum == 0) ||
+        (getBufLength(intermediate.bufferHandle, MAX_HW2D_PLANES, bufLength, intermediate.format,
+                      gmeta.stride, gmeta.vstride) != NO_ERROR)) {
+        MPP_LOGE("%s:: invalid intermediate buffer, format(0x%8x)", __func__,
+                 intermediate.format);
+        fence_close(acquireFence, mAssignedDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D);
+        return -EINVAL;
+    }
+
+    uint32_t attribute = 0;
+    if (intermediate.bufferType == MPP_BUFFER_SECURE_DRM)
+        attribute |= AcrylicCanvas::ATTR_PROTECTED;
+
+    hwc_rect_t rect = {0, 0, (int)mAssignedDisplay->mXres, (int)mAssignedDisplay->mYres};
+    layer->setImageDimension(gmeta.stride, gmeta.vstride);
+    layer->setImageType(intermediate.format, intermediate.dataspace);
+    layer->setImageBuffer(bufFds, bufLength, bufferNum, acquireFence, attribute);
+    layer->setLayerHDR(false);
+    /* Source z-orders are not negative, so it stays below all sources of the pass */
+    layer->setCompositMode(HWC2_BLEND_MODE_NONE, 255, -1);
+    layer->setCompositArea(rect, rect, 0, AcrylicLayer::ATTR_NORESAMPLING);
+
+    MPP_LOGD(eDebugMPP|eDebugFence, "pass %d reads intermediate %p, acquireFence: %d", pass,
+             intermediate.bufferHandle, acquireFence);
+
+    return NO_ERROR;
+}
+
+/*
+ * Intermediate buffers are never compressed so that the passes above read them
+ * with any source restriction.
+ */
+int32_t ExynosMPP::allocIntermediateBuf(uint32_t index, const exynos_mpp_img_info &dstImg)
+{
+    exynos_mpp_img_info &img = mIntermediateImgs[index];
+    VendorGraphicBufferMeta dstMeta(dstImg.bufferHandle);
+    if ((img.bufferHandle != NULL) && (img.format == dstImg.format)) {
+        VendorGraphicBufferMeta meta(img.bufferHandle);
+        if ((meta.stride >= dstMeta.stride) && (meta.vstride >= dstMeta.vstride) &&
+            (img.bufferType == dstImg.bufferType))
+            return NO_ERROR;
+    }
+
+    uint64_t allocUsage = getBufferUsage(VendorGraphicBufferMeta::get_usage(dstImg.bufferHandle)) |
+            VendorGraphicBufferUsage::NO_AFBC;
+    buffer_handle_t buffer = NULL;
+    if ((mResourceManager->mDstBufPool.acquire(dstMeta.stride, dstMeta.vstride,
+                                               getOutBufAlign(), dstImg.format, allocUsage,
+                                               &buffer) != NO_ERROR) ||
+        (buffer == NULL)) {
+        MPP_LOGE("%s:: failed to allocate intermediate buffer(%dx%d)", __func__,
+                 dstMeta.stride, dstMeta.vstride);
+        return -EINVAL;
+    }
+
+    if (img.bufferHandle != NULL) {
+        img.reusable = true;
+        freeOutBuf(img);
+    }
+
+    memset(&img, 0, sizeof(img));
+    img.acrylicAcquireFenceFd = -1;
+    img.acrylicReleaseFenceFd = -1;
+    img.bufferHandle = buffer;
+    img.bufferType = dstImg.bufferType;
+    img.format = dstImg.format;
+    img.dataspace = dstImg.dataspace;
+    img.assignedDisplay = mAssignedDisplay;
+
+    MPP_LOGD(eDebugMPP|eDebugBuf, "intermediate buffer[%d] %p (%dx%d)", index, buffer,
+             dstMeta.stride, dstMeta.vstride);
+    return NO_ERROR;
+}
+
+/*
+ * Executes the passes below the final pass from the lowest one. Each pass waits for
+ * the output of the pass below through the acquire fence of its intermediate layer.
+ * outFence is the release fence of pass 1 that the intermediate layer of pass 0 waits for.
+ */
+int32_t ExynosMPP::executeLowerPasses(uint32_t passNum, int &outFence)
+{
+    ATRACE_CALL();
+    const exynos_mpp_img_info &dstImg = mDstImgs[mCurrentDstBuf];
+    int prevFence = -1;
+    int32_t ret = NO_ERROR;
+
+    for (uint32_t pass = passNum - 1; pass > 0; pass--) {
+        Acrylic *handle = getCompositionPassHandle(pass);
+        exynos_mpp_img_info &out = mIntermediateImgs[pass % 2];
+
+        if ((ret = allocIntermediateBuf(pass % 2, dstImg)) != NO_ERROR)
+            break;
+        out.dataspace = dstImg.dataspace;
+
+        if (pass < passNum - 1) {
+            ret = setupIntermediateLayer(pass, mIntermediateImgs[(pass + 1) % 2], prevFence);
+            prevFence = -1;
+            if (ret != NO_ERROR)
+                break;
+        }
+
+        VendorGraphicBufferMeta gmeta(out.bufferHandle);
+        int bufFds[MAX_HW2D_PLANES];
+        size_t bufLength[MAX_HW2D_PLANES];
+        uint32_t bufferNum = getBufferNumOfFormat(out.format, COMP_TYPE_NONE);
+        bufFds[0] = gmeta.fd;
+        bufFds[1] = gmeta.fd1;
+        bufFds[2] = gmeta.fd2;
+        if ((bufferNum == 0) ||
+            (getBufLength(out.bufferHandle, MAX_HW2D_PLANES, bufLength, out.format,
+                          gmeta.stride, gmeta.vstride) != NO_ERROR)) {
+            MPP_LOGE("%s:: invalid intermediate buffer, format(0x%8x)", __func__, out.format);
+            ret = -EINVAL;
+            break;
+        }
+
+        uint32_t attribute = 0;
+        if (out.bufferType == MPP_BUFFER_SECURE_DRM)
+            attribute |= AcrylicCanvas::ATTR_PROTECTED;
+
+        /* The buffer is written again once the final pass of the previous frame read it */
+        handle->setCanvasDimension(pixel_align(mAssignedDisplay->mXres,
+                                               getDstStrideAlignment(out.format)),
+                                   pixel_align(mAssignedDisplay->mYres, G2D_JUSTIFIED_DST_ALIGN));
+        handle->setCanvasImageType(out.format, out.dataspace);
+        handle->setCanvasBuffer(bufFds, bufLength, bufferNum, out.acrylicReleaseFenceFd,
+                                attribute);
+        out.acrylicReleaseFenceFd = -1;
+        if (mAssignedDisplay->mType != HWC_DISPLAY_VIRTUAL) {
+            dstMetaInfo_t metaInfo = getDstMetaInfo(out.dataspace);
+            handle->setTargetDisplayLuminance(metaInfo.minLuminance, metaInfo.maxLuminance);
+        }
+
+        MPP_LOGD(eDebugMPP|eDebugFence, "execute pass %d: %d layers to %p", pass,
+                 handle->layerCount(), out.bufferHandle);
+        if (handle->execute(&prevFence, 1) == false) {
+            MPP_LOGE("%s:: fail to execute pass %d", __func__, pass);
+            prevFence = -1;
+            ret = -EPERM;
+            break;
+        }
+        setFenceInfo(prevFence, mAssignedDisplay, FENCE_TYPE_DST_ACQUIRE, FENCE_IP_G2D,
+                     HwcFenceDirection::FROM);
+    }
+
+    if (ret != NO_ERROR) {
+        prevFence = fence_close(prevFence, mAssignedDisplay, FENCE_TYPE_DST_ACQUIRE,
+                                FENCE_IP_G2D);
+        return ret;
+    }
+
+    outFence = prevFence;
+    return NO_ERROR;
+}
+
+void ExynosMPP::freeCompositionPassResources()
+{
+    for (auto &layer : mIntermediateLayers)
+        layer.reset();
+
+    for (auto &img : mIntermediateImgs) {
+        if (img.bufferHandle == NULL)
+            continue;
+        img.reusable = true;
+        freeOutBuf(img);
+        memset(&img, 0, sizeof(img));
+        img.acrylicAcquireFenceFd = -1;
+        img.acrylicReleaseFenceFd = -1;
+    }
+}
+
 int32_t ExynosMPP::setupLayer(exynos_mpp_img_info *srcImgInfo, struct exynos_image &src, struct exynos_image &dst)
 {
     int ret = NO_ERROR;
@@ -1474,22 +1892,21 @@ int32_t ExynosMPP::doPostProcessingInternal()
         return -EINVAL;
     }
 
-    /* setup source layers */
-    for(size_t i = 0; i < sourceNum; i++) {
-        MPP_LOGD(eDebugMPP|eDebugFence, "Setup [%zu] source: %p", i, mAssignedSources[i]);
-        if ((ret = setupLayer(&mSrcImgs[i], mAssignedSources[i]->mSrcImg, mAssignedSources[i]->mMidImg)) != NO_ERROR) {
-            MPP_LOGE("%s:: fail to setupLayer[%zu], ret %d",
-                    __func__, i, ret);
-            return ret;
-        }
+    const uint32_t passNum = getCompositionPassNum(sourceNum);
+    if (passNum == 0) {
+        MPP_LOGE("%s:: too many sources(%zu) for %d passes", __func__, sourceNum,
+                 mMaxCompositionPasses);
+        return -EINVAL;
     }
-
-    if ((ret = setColorConversionInfo()) != NO_ERROR) {
-            MPP_LOGE("%s:: fail to setColorConversionInfo ret %d",
-                    __func__, ret);
-            return ret;
+    if (passNum == 1) {
+        freeCompositionPassResources();
+    } else {
+        /* Only the passes above the lowest one read an intermediate buffer */
+        for (uint32_t pass = passNum - 1; pass < MAX_G2D_COMPOSITION_PASSES; pass++)
+            mIntermediateLayers[pass].reset();
     }
 
+    /* Removed sources leave room in their passes before the others move there */
     if (mPrevFrameInfo.srcNum > sourceNum) {
         MPP_LOGD(eDebugMPP, "prev sourceNum(%d), current sourceNum(%zu)",
                 mPrevFrameInfo.srcNum, sourceNum);
@@ -1503,11 +1920,108 @@ int32_t ExynosMPP::doPostProcessingInternal()
         }
     }
 
-    if (mAcrylicHandle->layerCount() != mAssignedSources.size()) {
-        MPP_LOGE("Different layer number, acrylic layers(%d), assigned size(%zu)",
-                mAcrylicHandle->layerCount(), mAssignedSources.size());
-        return -EINVAL;
+    /* Sources that moved to another pass keep their layers and compiled settings */
+    for (size_t i = 0; i < sourceNum; i++) {
+        if (mSrcImgs[i].mppLayer == NULL)
+            continue;
+        uint32_t pass = getCompositionPassOfSource(i, sourceNum, passNum);
+        Acrylic *handle = getCompositionPassHandle(pass);
+        if ((handle == NULL) || !handle->adoptLayer(mSrcImgs[i].mppLayer)) {
+            MPP_LOGE("%s:: Fail to move layer[%zu] to pass %d", __func__, i, pass);
+            return -EINVAL;
+        }
     }
+
+    const bool partial = mPartialArea.has_value();
+    hwc_rect_t partialArea = mPartialArea.value_or(hwc_rect_t{0, 0, 0, 0});
+    size_t composedNum = 0;
+    size_t finalPassLayerNum = (passNum > 1) ? 1 : 0;
+    int topZOrder = 0;
+
+    /* setup source layers */
+    for(size_t i = 0; i < sourceNum; i++) {
+        exynos_image &srcImg = mAssignedSources[i]->mSrcImg;
+        exynos_image &midImg = mAssignedSources[i]->mMidImg;
+        hwc_rect_t overlap = intersect(getImageRect(midImg), partialArea);
+        uint32_t pass = getCompositionPassOfSource(i, sourceNum, passNum);
+        Acrylic *handle = getCompositionPassHandle(pass);
+        if (handle == NULL) {
+            MPP_LOGE("%s:: no compositor for pass %d", __func__, pass);
+            return -EINVAL;
+        }
+        if ((mSrcImgs[i].mppLayer == NULL) && (handle != mAcrylicHandle) &&
+            ((mSrcImgs[i].mppLayer = handle->createLayer()) == NULL)) {
+            MPP_LOGE("%s:: Fail to create layer for pass %d", __func__, pass);
+            return -EINVAL;
+        }
+        if (partial && ((WIDTH(overlap) <= 0) || (HEIGHT(overlap) <= 0))) {
+            /* The source is out of the partial area, it is copied forward */
+            MPP_LOGD(eDebugMPP, "Skip [%zu] source out of partial area", i);
+            srcImg.acquireFenceFd = fence_close(srcImg.acquireFenceFd,
+                    mAssignedDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D);
+            /* Keep the layer and its compiled commands for the following frames */
+            if (mSrcImgs[i].mppLayer != NULL)
+                handle->detachLayer(mSrcImgs[i].mppLayer);
+            continue;
+        }
+        if ((mSrcImgs[i].mppLayer != NULL) && !handle->attachLayer(mSrcImgs[i].mppLayer)) {
+            MPP_LOGE("%s:: Fail to attach layer[%zu] for pass %d", __func__, i, pass);
+            return -EINVAL;
+        }
+
+        MPP_LOGD(eDebugMPP|eDebugFence, "Setup [%zu] source: %p", i, mAssignedSources[i]);
+        if ((ret = setupLayer(&mSrcImgs[i], srcImg, midImg)) != NO_ERROR) {
+            MPP_LOGE("%s:: fail to setupLayer[%zu], ret %d",
+                    __func__, i, ret);
+            return ret;
+        }
+
+        /*
+         * Unscaled RGB sources are cropped to the partial area. Others are composed
+         * entirely and the part out of the area is overwritten by copy forward layers.
+         */
+        if (partial && (srcImg.transform == 0) && (srcImg.w == midImg.w) &&
+            (srcImg.h == midImg.h) && isFormatRgb(srcImg.format) &&
+            (srcImg.compressionInfo.type == COMP_TYPE_NONE)) {
+            hwc_rect_t srcRect = {(int)srcImg.x + overlap.left - (int)midImg.x,
+                                  (int)srcImg.y + overlap.top - (int)midImg.y,
+                                  (int)srcImg.x + overlap.right - (int)midImg.x,
+                                  (int)srcImg.y + overlap.bottom - (int)midImg.y};
+            mSrcImgs[i].mppLayer->setCompositArea(srcRect, overlap, 0,
+                                                  AcrylicLayer::ATTR_NORESAMPLING);
+        }
+        composedNum++;
+        if (pass == 0)
+            finalPassLayerNum++;
+        topZOrder = max(topZOrder, (int)srcImg.zOrder);
+    }
+
+    std::unique_ptr<AcrylicLayer> copyForwardLayers[kMaxCopyForwardRects];
+    size_t copyForwardNum = 0;
+    if (partial) {
+        hwc_rect_t copyRects[kMaxCopyForwardRects];
+        int32_t prevDstIndex = (mCurrentDstBuf + NUM_MPP_DST_BUFS(mLogicalType) - 1) %
+                NUM_MPP_DST_BUFS(mLogicalType);
+        copyForwardNum = getCopyForwardRects(partialArea, mAssignedDisplay->mXres,
+                                             mAssignedDisplay->mYres, copyRects);
+        for (size_t i = 0; i < copyForwardNum; i++) {
+            copyForwardLayers[i].reset(mAcrylicHandle->createLayer());
+            if (copyForwardLayers[i] == nullptr) {
+                MPP_LOGE("%s:: Fail to create copy forward layer", __func__);
+                return -EINVAL;
+            }
+            if ((ret = setupCopyForwardLayer(copyForwardLayers[i].get(), mDstImgs[prevDstIndex],
+                                             copyRects[i], topZOrder + 1)) != NO_ERROR)
+                return ret;
+        }
+    }
+
+    if ((ret = setColorConversionInfo()) != NO_ERROR) {
+            MPP_LOGE("%s:: fail to setColorConversionInfo ret %d",
+                    __func__, ret);
+            return ret;
+    }
+
     MPP_LOGD(eDebugFence, "setupDst ++ mDstImgs[%d] acrylicAcquireFenceFd(%d)",
             mCurrentDstBuf, mDstImgs[mCurrentDstBuf].acrylicAcquireFenceFd);
 
@@ -1516,6 +2030,25 @@ int32_t ExynosMPP::doPostProcessingInternal()
     MPP_LOGD(eDebugFence, "setupDst -- mDstImgs[%d] acrylicAcquireFenceFd(%d) closed",
             mCurrentDstBuf, mDstImgs[mCurrentDstBuf].acrylicAcquireFenceFd);
 
+    /* The lower passes are composed in the format and dataspace of the destination */
+    if (passNum > 1) {
+        int intermediateFence = -1;
+        if (((ret = executeLowerPasses(passNum, intermediateFence)) != NO_ERROR) ||
+            ((ret = setupIntermediateLayer(0, mIntermediateImgs[1], intermediateFence)) !=
+             NO_ERROR)) {
+            MPP_LOGE("%s:: fail to compose %d passes, ret %d", __func__, passNum, ret);
+            return ret;
+        }
+    }
+
+    if (mAcrylicHandle->layerCount() != finalPassLayerNum + copyForwardNum) {
+        MPP_LOGE("Different layer number, acrylic layers(%d), assigned size(%zu), "
+                 "composed(%zu), final pass(%zu), copy forward(%zu)",
+                mAcrylicHandle->layerCount(), mAssignedSources.size(), composedNum,
+                finalPassLayerNum, copyForwardNum);
+        return -EINVAL;
+    }
+
 
     int usingFenceCnt = 1;
     bool acrylicReturn = true;
@@ -1627,6 +2160,22 @@ int32_t ExynosMPP::doPostProcessingInternal()
 
             MPP_LOGD(eDebugFence, "mDstImgs[%d] acrylicReleaseFenceFd: %d , releaseFences[%d]",
                     mCurrentDstBuf, mDstImgs[mCurrentDstBuf].acrylicReleaseFenceFd, dstBufIdx);
+
+            /* Intermediate buffers are free to be written once the final pass is done */
+            for (uint32_t pass = 1; pass < min(passNum, 3u); pass++) {
+                exynos_mpp_img_info &img = mIntermediateImgs[pass % 2];
+                img.acrylicReleaseFenceFd = fence_close(img.acrylicReleaseFenceFd,
+                        mAssignedDisplay, FENCE_TYPE_DST_RELEASE, FENCE_IP_G2D);
+                img.acrylicReleaseFenceFd = hwc_dup(mDstImgs[mCurrentDstBuf].acrylicReleaseFenceFd,
+                        mAssignedDisplay, FENCE_TYPE_DST_RELEASE, FENCE_IP_G2D);
+            }
+
+            /* Copy forward layers of the next frame read this destination */
+            mLastComposedDstFence = fence_close(mLastComposedDstFence,
+                    mAssignedDisplay, FENCE_TYPE_DST_RELEASE, FENCE_IP_G2D);
+            if (mPhysicalType == MPP_G2D)
+                mLastComposedDstFence = hwc_dup(mDstImgs[mCurrentDstBuf].acrylicReleaseFenceFd,
+                        mAssignedDisplay, FENCE_TYPE_DST_RELEASE, FENCE_IP_G2D, true);
         }
 
         if (exynosHWCControl.dumpMidBuf) {
@@ -1696,6 +2245,10 @@ int32_t ExynosMPP::doPostProcessing(struct exynos_image& dst) {
 
     int ret = NO_ERROR;
     bool realloc = false;
+    bool srcGeometryUnchanged = false;
+    hwc_rect_t partialArea;
+
+    mDstDamage.reset();
     if (mAssignedSources.size() == 0) {
         MPP_LOGE("Assigned source size(%zu) is not valid",
                 mAssignedSources.size());
@@ -1744,17 +2297,31 @@ int32_t ExynosMPP::doPostProcessing(struct exynos_image& dst) {
                 fence_close(mAssignedSources[i]->mSrcImg.acquireFenceFd,
                         mAssignedDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_G2D);
         }
+        mDstDamage = hwc_rect_t{0, 0, 0, 0};
         goto save_frame_info;
     }
 
+    srcGeometryUnchanged = isSrcGeometryUnchanged();
+    if ((realloc == false) && getPartialCompositionArea(partialArea))
+        mPartialArea = partialArea;
+
     /* G2D or sclaer case */
-    if ((ret = doPostProcessingInternal()) < 0) {
+    ret = doPostProcessingInternal();
+    mPartialArea.reset();
+    if (ret < 0) {
         MPP_LOGE("%s:: fail to post processing, ret %d",
                 __func__, ret);
+        invalidateLastComposedDst();
         goto save_frame_info;
     }
+    mLastComposedDstBuf = mCurrentDstBuf;
+
+    /* Out of the source damage, the destination is same as the previous one */
+    if (srcGeometryUnchanged && mSrcDamage.has_value())
+        mDstDamage = mSrcDamage;
 
 save_frame_info:
+    mSrcDamage.reset();
     /* Save current frame information for next frame*/
     mPrevAssignedDisplayType = mAssignedDisplay->mType;
     mPrevFrameInfo.srcNum = (uint32_t)mAssignedSources.size();
@@ -1973,6 +2540,7 @@ int32_t ExynosMPP::requestHWStateChange(uint32_t state)
                 mSrcImgs[i].mppLayer = NULL;
             }
         }
+        freeCompositionPassResources();
         memset(&mPrevFrameInfo, 0, sizeof(mPrevFrameInfo));
         for (int i = 0; i < NUM_MPP_SRC_BUFS; i++) {
             mPrevFrameInfo.srcInfo[i].acquireFenceFd = -1;
@@ -2168,14 +2736,24 @@ int64_t ExynosMPP::isSupported(ExynosDisplay &display, struct exynos_image &src,
     return NO_ERROR;
 }
 
+void ExynosMPP::invalidateLastComposedDst()
+{
+    mLastComposedDstBuf = -1;
+    mLastComposedDstFence = fence_close(mLastComposedDstFence, mAssignedDisplay,
+            FENCE_TYPE_DST_RELEASE, FENCE_IP_G2D);
+}
+
 int32_t ExynosMPP::resetMPP()
 {
+    /* The fence is tracked against the display that is about to be released */
+    invalidateLastComposedDst();
     mAssignedState = MPP_ASSIGN_STATE_FREE;
     mAssignedDisplay = NULL;
     mAssignedSources.clear();
     resetUsedCapacity();
     mReservedDisplay = -1;
     mHWBusyFlag = false;
+    mCompositionPasses = 1;
 
     return NO_ERROR;
 }
@@ -2284,36 +2862,39 @@ int32_t ExynosMPP::assignMPP(ExynosDisplay *display, ExynosMPPSource* mppSource)
 uint32_t ExynosMPP::getSrcMaxBlendingNum(struct exynos_image __unused &src, struct exynos_image __unused &dst)
 {
     uint32_t maxSrcLayerNum = mMaxSrcLayerNum;
+    /* Every extra pass takes the output of the pass below as one of its sources */
+    if (mCompositionPasses > 1)
+        maxSrcLayerNum += (mCompositionPasses - 1) * (mMaxSrcLayerNum - 1);
     return maxSrcLayerNum;
 }
 
-uint32_t ExynosMPP::getAssignedSourceNum()
+void ExynosMPP::setCompositionPasses(uint32_t passes)
 {
-    return mAssignedSources.size();
+    mCompositionPasses = std::clamp(passes, 1u, mMaxCompositionPasses);
+    MPP_LOGD(eDebugMPP, "composition passes: %d (max %d)", mCompositionPasses,
+             mMaxCompositionPasses);
 }
 
-/* Based on multi-resolution support */
-void ExynosMPP::setDstAllocSize(uint32_t width, uint32_t height)
+uint32_t ExynosMPP::getCompositionPassNum(uint32_t srcNum) const
 {
-    switch(width) {
-    case 720:
-        mDstAllocatedSize = ((height >= 1480) ? DST_SIZE_HD_PLUS : DST_SIZE_HD);
-        break;
-    case 1080:
-        mDstAllocatedSize = ((height >= 2220) ? DST_SIZE_FHD_PLUS : DST_SIZE_FHD);
-        break;
-    case 1440:
-        mDstAllocatedSize = ((height >= 2960) ? DST_SIZE_WQHD_PLUS : DST_SIZE_WQHD);
-        break;
-    default:
-        mDstAllocatedSize = DST_SIZE_UNKNOWN;
-        break;
-    }
+    return CompositionPassPolicy::getPassNum(srcNum, mMaxSrcLayerNum, mMaxCompositionPasses);
 }
 
-dst_alloc_buf_size_t ExynosMPP::getDstAllocSize()
+float ExynosMPP::getExtraPassCapacity(ExynosDisplay *display, uint32_t srcNum) const
 {
-    return mDstAllocatedSize;
+    uint32_t passNum = getCompositionPassNum(srcNum);
+    if ((display == NULL) || (mPhysicalType != MPP_G2D) || (passNum <= 1))
+        return 0;
+
+    /* Each extra pass reads the intermediate buffer and writes the entire destination */
+    float pixels = display->mXres * display->mYres;
+    float cycles = pixels / G2D_BASE_PPC + pixels / G2D_DST_BASE_PPC;
+    return (passNum - 1) * cycles / mClockKhz;
+}
+
+uint32_t ExynosMPP::getAssignedSourceNum()
+{
+    return mAssignedSources.size();
 }
 
 bool ExynosMPP::needPreAllocation()
@@ -2645,7 +3226,8 @@ float ExynosMPP::getRequiredCapacity(ExynosDisplay *display, struct exynos_image
                     srcCycles, baseCycles, PPC, srcResolution, dstResolution, src.transform);
         }
 
-        capacity = baseCycles / mClockKhz;
+        capacity = baseCycles / mClockKhz +
+                getExtraPassCapacity(display, mAssignedSources.size() + 1);
 
         MPP_LOGD(eDebugCapacity, "baseCycles: %f, capacity: %f",
                 baseCycles, capacity);
@@ -2718,7 +3300,9 @@ bool ExynosMPP::addCapacity(ExynosMPPSource* mppSource)
         else
             mRotatedSrcCropBW += srcResolution;
 
-        mUsedCapacity = mUsedBaseCycles / mClockKhz;
+        /* mppSource is added to mAssignedSources after this */
+        mUsedCapacity = mUsedBaseCycles / mClockKhz +
+                getExtraPassCapacity(mAssignedDisplay, mAssignedSources.size() + 1);
 
         MPP_LOGD(eDebugCapacity, "src num: %zu base cycle is added: %f, mUsedBaseCycles: %f, mUsedCapacity(%f), srcResolution: %d, dstResolution: %d, rot: %d, mNoRotatedSrcCropBW(%d), mRotatedSrcCropBW(%d)",
                 mAssignedSources.size(),
@@ -2753,7 +3337,9 @@ bool ExynosMPP::removeCapacity(ExynosMPPSource* mppSource)
         float baseCycles = getRequiredBaseCycles(mppSource->mSrcImg, mppSource->mMidImg);
         mUsedBaseCycles -= baseCycles;
 
-        mUsedCapacity = mUsedBaseCycles / mClockKhz;
+        /* mppSource is removed from mAssignedSources after this */
+        mUsedCapacity = mUsedBaseCycles / mClockKhz +
+                getExtraPassCapacity(mAssignedDisplay, mAssignedSources.size() - 1);
 
         MPP_LOGD(eDebugCapacity, "src num: %zu, base cycle is removed: %f, mUsedBaseCycles: %f, mUsedCapacity(%f), srcResolution: %d, dstResolution: %d, rot: %d, mNoRotatedSrcCropBW(%d), mRotatedSrcCropBW(%d)",
                 mAssignedSources.size(),
@@ -2827,7 +3413,8 @@ int32_t ExynosMPP::updateUsedCapacity()
         }
 
         mUsedBaseCycles = cycles;
-        capacity = cycles / mClockKhz;
+        capacity = cycles / mClockKhz +
+                getExtraPassCapacity(mAssignedDisplay, mAssignedSources.size());
 
         mUsedCapacity = capacity;
 
@@ -2920,6 +3507,9 @@ void ExynosMPP::dump(String8& result)
             mPrevAssignedState, mPrevAssignedDisplayType, mReservedDisplay);
     result.appendFormat("\tassinedSourceNum(%zu), Capacity(%f), CapaUsed(%f), mCurrentDstBuf(%d)\n",
             mAssignedSources.size(), mCapacity, mUsedCapacity, mCurrentDstBuf);
+    if (mMaxCompositionPasses > 1)
+        result.appendFormat("\tCompositionPasses(%d/%d)\n", mCompositionPasses,
+                mMaxCompositionPasses);
 
 }
 
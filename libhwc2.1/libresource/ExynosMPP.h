@@ -31,6 +31,9 @@
 #include <map>
 #include <hardware/exynos/acryl.h>
 #include <map>
+#include <memory>
+#include <optional>
+#include <vector>
 #include "ExynosHWCModule.h"
 #include "ExynosHWCHelper.h"
 #include "ExynosMPPType.h"
@@ -54,7 +57,17 @@ class ExynosResourceManager;
 
 #define G2D_JUSTIFIED_DST_ALIGN     16
 
-#define NUM_MPP_SRC_BUFS G2D_MAX_SRC_NUM
+/*
+ * G2D passes that can be chained through an intermediate buffer to compose
+ * more sources than one G2D task can take
+ */
+#ifndef MAX_G2D_COMPOSITION_PASSES
+#define MAX_G2D_COMPOSITION_PASSES 2
+#endif
+
+/* Every pass above the lowest one takes the output of the pass below as a source */
+#define NUM_MPP_SRC_BUFS \
+    (G2D_MAX_SRC_NUM + (MAX_G2D_COMPOSITION_PASSES - 1) * (G2D_MAX_SRC_NUM - 1))
 
 #ifndef G2D_RESTRICTIVE_SRC_NUM
 #define G2D_RESTRICTIVE_SRC_NUM   5
@@ -212,17 +225,6 @@ enum {
     MPP_SOURCE_MAX
 };
 
-/* Based on multi-resolution feature */
-typedef enum {
-    DST_SIZE_HD = 0,
-    DST_SIZE_HD_PLUS,
-    DST_SIZE_FHD,
-    DST_SIZE_FHD_PLUS,
-    DST_SIZE_WQHD,
-    DST_SIZE_WQHD_PLUS,
-    DST_SIZE_UNKNOWN,
-} dst_alloc_buf_size_t;
-
 #ifndef DEFAULT_MPP_DST_FORMAT
 #define DEFAULT_MPP_DST_FORMAT HAL_PIXEL_FORMAT_RGBA_8888
 #endif
@@ -242,6 +244,8 @@ typedef struct exynos_mpp_img_info {
     int acrylicAcquireFenceFd;
     int acrylicReleaseFenceFd;
     ExynosDisplay *assignedDisplay;
+    /* Return to the dst buffer pool for reuse instead of freeing it */
+    bool reusable;
 } exynos_mpp_img_info_t;
 
 typedef enum {
@@ -550,6 +554,11 @@ public:
     bool mHWBusyFlag;
     /* For reuse previous frame */
     ExynosMPPFrameInfo mPrevFrameInfo;
+    /* For partial composition */
+    bool mPartialCompositionEnabled;
+    int32_t mLastComposedDstBuf;
+    /* Signaled when mLastComposedDstBuf is written, copy forward layers wait for it */
+    int mLastComposedDstFence;
     struct exynos_mpp_img_info mSrcImgs[NUM_MPP_SRC_BUFS];
     struct exynos_mpp_img_info mDstImgs[NUM_MPP_DST_BUFS_DEFAULT];
     int32_t mCurrentDstBuf;
@@ -558,9 +567,6 @@ public:
     struct restriction_size mSrcSizeRestrictions[RESTRICTION_MAX];
     struct restriction_size mDstSizeRestrictions[RESTRICTION_MAX];
 
-    // Force Dst buffer reallocation
-    dst_alloc_buf_size_t mDstAllocatedSize;
-
     /* For libacryl */
     Acrylic *mAcrylicHandle;
 
@@ -574,6 +580,9 @@ public:
 
     bool mNeedSolidColorLayer;
 
+    /* Number of G2D passes this MPP can chain, 1 if it composes in a single task */
+    uint32_t mMaxCompositionPasses;
+
     ExynosMPP(ExynosResourceManager* resourceManager,
             uint32_t physicalType, uint32_t logicalType, const char *name,
             uint32_t physicalIndex, uint32_t logicalIndex, uint32_t preAssignInfo);
@@ -652,9 +661,18 @@ public:
     uint32_t getSrcMaxBlendingNum(struct exynos_image &src, struct exynos_image &dst);
     uint32_t getAssignedSourceNum();
 
+    /*
+     * Passes allowed for the current frame, set by the resource manager when
+     * extra G2D passes are cheaper than client composition
+     */
+    void setCompositionPasses(uint32_t passes);
+    uint32_t getCompositionPasses() const { return mCompositionPasses; }
+    /* Passes needed to compose srcNum sources, 0 if mMaxCompositionPasses is not enough */
+    uint32_t getCompositionPassNum(uint32_t srcNum) const;
+    /* Capacity of the passes that srcNum sources need below the final pass */
+    float getExtraPassCapacity(ExynosDisplay *display, uint32_t srcNum) const;
+
     /* Based on multi-resolution support */
-    void setDstAllocSize(uint32_t width, uint32_t height);
-    dst_alloc_buf_size_t getDstAllocSize();
     virtual bool needPreAllocation();
 
     int32_t resetMPP();
@@ -680,6 +698,22 @@ public:
     uint32_t increaseDstBuffIndex();
     bool canSkipProcessing();
 
+    /*
+     * Damage of the assigned sources in display coordinates.
+     * It should be set before every doPostProcessing() that can use it,
+     * it is consumed by doPostProcessing().
+     */
+    void setSrcDamage(const hwc_rect_t &damage) { mSrcDamage = damage; }
+    /*
+     * Area of the destination that differs from the previous destination
+     * after doPostProcessing(). Returns false if it is unknown.
+     */
+    bool getDstDamage(hwc_rect_t &damage) const {
+        if (!mDstDamage.has_value()) return false;
+        damage = mDstDamage.value();
+        return true;
+    }
+
     virtual bool isSupportedCompression(struct exynos_image &src);
 
     void closeFences();
@@ -712,6 +746,18 @@ protected:
     uint32_t getAlignedDstFullWidth(struct exynos_image& dst);
     bool needDstBufRealloc(struct exynos_image &dst, uint32_t index);
     bool canUsePrevFrame();
+    bool isSrcGeometryUnchanged();
+    bool getPartialCompositionArea(hwc_rect_t &area);
+    void invalidateLastComposedDst();
+    int32_t setupCopyForwardLayer(AcrylicLayer *layer, const exynos_mpp_img_info &prevDst,
+                                  hwc_rect_t &rect, int zOrder);
+    Acrylic *getCompositionPassHandle(uint32_t pass);
+    uint32_t getCompositionPassOfSource(size_t srcIndex, size_t srcNum, uint32_t passNum) const;
+    int32_t setupIntermediateLayer(uint32_t pass, const exynos_mpp_img_info &intermediate,
+                                   int acquireFence);
+    int32_t allocIntermediateBuf(uint32_t index, const exynos_mpp_img_info &dstImg);
+    int32_t executeLowerPasses(uint32_t passNum, int &outFence);
+    void freeCompositionPassResources();
     uint32_t getDstStrideAlignment(int format);
     int32_t setupDst(exynos_mpp_img_info *dstImgInfo);
     virtual int32_t doPostProcessingInternal();
@@ -754,6 +800,24 @@ protected:
 
     uint32_t mClockKhz = 0;
     float mPPC = 0;
+
+    std::optional<hwc_rect_t> mSrcDamage;
+    std::optional<hwc_rect_t> mDstDamage;
+    /* Valid while doPostProcessing() composes only a part of the destination */
+    std::optional<hwc_rect_t> mPartialArea;
+
+    /*
+     * Multi-pass composition. Pass 0 is the final pass on mAcrylicHandle and composes
+     * the top sources, pass i+1 composes the sources below pass i into an intermediate
+     * buffer that pass i reads as its lowest layer.
+     */
+    uint32_t mCompositionPasses = 1;
+    /* Compositors of the passes below the final one */
+    std::vector<std::unique_ptr<Acrylic>> mLowerPassHandles;
+    /* Layer of each pass that reads the output of the pass below */
+    std::unique_ptr<AcrylicLayer> mIntermediateLayers[MAX_G2D_COMPOSITION_PASSES];
+    /* Pass i writes mIntermediateImgs[i % 2] */
+    struct exynos_mpp_img_info mIntermediateImgs[2];
 };
 
 #endif //_EXYNOSMPP_H
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "ExynosMPPDstBufPool.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "ExynosHWCDebug.h"
+#include "VendorGraphicBuffer.h"
+
+using namespace android;
+using namespace vendor::graphics;
+
+namespace {
+
+uint32_t alignUp(uint32_t value, uint32_t align) {
+    return (align > 1) ? ((value + align - 1) / align) * align : value;
+}
+
+} // namespace
+
+ExynosMPPDstBufPool::~ExynosMPPDstBufPool() {
+    /* MPPs are destroyed before the pool, nothing can reference the buffers */
+    for (const auto& entry : mBuffers) {
+        freeBuffer(entry.first);
+    }
+}
+
+void ExynosMPPDstBufPool::setSizeClasses(std::vector<Size> sizes) {
+    std::sort(sizes.begin(), sizes.end(), [](const Size& l, const Size& r) {
+        return static_cast<uint64_t>(l.first) * l.second <
+                static_cast<uint64_t>(r.first) * r.second;
+    });
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+
+    std::vector<buffer_handle_t> staleBuffers;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (sizes == mSizeClasses) return;
+        mSizeClasses = std::move(sizes);
+
+        for (auto it = mBuffers.begin(); it != mBuffers.end();) {
+            if (!it->second.inUse && !fitsSizeClass(it->second)) {
+                staleBuffers.push_back(it->first);
+                it = mBuffers.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    for (auto handle : staleBuffers) freeBuffer(handle);
+}
+
+ExynosMPPDstBufPool::Size ExynosMPPDstBufPool::getAllocSize(uint32_t width, uint32_t height,
+                                                            uint32_t align) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return getAllocSizeLocked(width, height, align);
+}
+
+ExynosMPPDstBufPool::Size ExynosMPPDstBufPool::getAllocSizeLocked(uint32_t width,
+                                                                  uint32_t height,
+                                                                  uint32_t align) const {
+    for (const auto& [classWidth, classHeight] : mSizeClasses) {
+        uint32_t alignedWidth = alignUp(classWidth, align);
+        uint32_t alignedHeight = alignUp(classHeight, align);
+        if ((alignedWidth >= width) && (alignedHeight >= height))
+            return {alignedWidth, alignedHeight};
+    }
+    return {width, height};
+}
+
+size_t ExynosMPPDstBufPool::getFreeBufferCount(uint32_t format, uint64_t usage) const {
+    return std::count_if(mBuffers.begin(), mBuffers.end(), [&](const auto& entry) {
+        const Buffer& buffer = entry.second;
+        return !buffer.inUse && (buffer.format == format) && (buffer.usage == usage);
+    });
+}
+
+bool ExynosMPPDstBufPool::fitsSizeClass(const Buffer& buffer) const {
+    return std::any_of(mSizeClasses.begin(), mSizeClasses.end(), [&](const Size& size) {
+        return (alignUp(size.first, buffer.align) == buffer.width) &&
+                (alignUp(size.second, buffer.align) == buffer.height);
+    });
+}
+
+int32_t ExynosMPPDstBufPool::acquire(uint32_t width, uint32_t height, uint32_t align,
+                                     uint32_t format, uint64_t usage,
+                                     buffer_handle_t* outBuffer) {
+    ATRACE_CALL();
+    Size allocSize;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        /* Reuse the smallest free buffer that can hold the request */
+        auto best = mBuffers.end();
+        for (auto it = mBuffers.begin(); it != mBuffers.end(); it++) {
+            const Buffer& buffer = it->second;
+            if (buffer.inUse || (buffer.format != format) || (buffer.usage != usage) ||
+                (buffer.width < width) || (buffer.height < height))
+                continue;
+            if ((best == mBuffers.end()) ||
+                (static_cast<uint64_t>(buffer.width) * buffer.height <
+                 static_cast<uint64_t>(best->second.width) * best->second.height))
+                best = it;
+        }
+        if (best != mBuffers.end()) {
+            best->second.inUse = true;
+            mReuseCount++;
+            *outBuffer = best->first;
+            HDEBUGLOGD(eDebugBuf, "%s: reuse %p (%ux%u) for %ux%u", __func__, best->first,
+                       best->second.width, best->second.height, width, height);
+            return NO_ERROR;
+        }
+        allocSize = getAllocSizeLocked(width, height, align);
+    }
+
+    buffer_handle_t handle = nullptr;
+    uint32_t stride = 0;
+    VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
+    status_t error = gAllocator.allocate(allocSize.first, allocSize.second, format, 1, usage,
+                                         &handle, &stride, "HWC");
+    if ((error != NO_ERROR) || (handle == nullptr)) {
+        ALOGE("%s: failed to allocate %ux%u: %d", __func__, allocSize.first, allocSize.second,
+              error);
+        return -EINVAL;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBuffers[handle] = {allocSize.first, allocSize.second, std::max(align, 1u), format, usage,
+                        true};
+    mAllocCount++;
+    *outBuffer = handle;
+    HDEBUGLOGD(eDebugBuf, "%s: allocate %p (%ux%u) for %ux%u", __func__, handle,
+               allocSize.first, allocSize.second, width, height);
+    return NO_ERROR;
+}
+
+void ExynosMPPDstBufPool::release(buffer_handle_t handle, bool keep) {
+    if (handle == nullptr) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mBuffers.find(handle);
+        if (it != mBuffers.end()) {
+            Buffer& buffer = it->second;
+            buffer.inUse = false;
+            if (keep && fitsSizeClass(buffer) &&
+                (getFreeBufferCount(buffer.format, buffer.usage) <= kMaxFreeBuffersPerKey))
+                return;
+            mBuffers.erase(it);
+        }
+    }
+
+    freeBuffer(handle);
+}
+
+void ExynosMPPDstBufPool::freeBuffer(buffer_handle_t handle) {
+    VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
+    gAllocator.free(handle);
+}
+
+void ExynosMPPDstBufPool::dump(String8& result) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    result.appendFormat("M2M dst buffer pool: %zu buffers, allocated %" PRIu64
+                        ", reused %" PRIu64 "\n",
+                        mBuffers.size(), mAllocCount, mReuseCount);
+    result.appendFormat("\tsize classes:");
+    for (const auto& [width, height] : mSizeClasses) {
+        result.appendFormat(" %ux%u", width, height);
+    }
+    result.appendFormat("\n");
+    for (const auto& [handle, buffer] : mBuffers) {
+        result.appendFormat("\t%p %ux%u format 0x%x usage 0x%" PRIx64 " %s\n", handle,
+                            buffer.width, buffer.height, buffer.format, buffer.usage,
+                            buffer.inUse ? "in use" : "free");
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EXYNOS_MPP_DST_BUF_POOL_H_
+#define _EXYNOS_MPP_DST_BUF_POOL_H_
+
+#include <cutils/native_handle.h>
+#include <utils/String8.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Device-wide pool of M2M MPP destination buffers.
+ * Buffers are keyed by format and allocation usage (which carries compression and DRM
+ * attributes) and allocated in size classes taken from the display configs, so that a
+ * buffer allocated for one resolution can serve any smaller request of the same key.
+ * MPPs borrow buffers with acquire() and hand them back with release() once their
+ * fences are signaled.
+ */
+class ExynosMPPDstBufPool {
+public:
+    using Size = std::pair<uint32_t, uint32_t>;
+
+    ~ExynosMPPDstBufPool();
+
+    /* Replaces the size classes and frees free buffers that no class needs any more */
+    void setSizeClasses(std::vector<Size> sizes);
+    /* Size allocated for a request, the smallest size class that can hold it */
+    Size getAllocSize(uint32_t width, uint32_t height, uint32_t align) const;
+
+    int32_t acquire(uint32_t width, uint32_t height, uint32_t align, uint32_t format,
+                    uint64_t usage, buffer_handle_t* outBuffer);
+    /* Returns a buffer to the pool, or frees it if it shouldn't be kept */
+    void release(buffer_handle_t buffer, bool keep);
+
+    void dump(android::String8& result) const;
+
+private:
+    struct Buffer {
+        uint32_t width;
+        uint32_t height;
+        uint32_t align;
+        uint32_t format;
+        uint64_t usage;
+        bool inUse;
+    };
+
+    /* Free buffers kept per format and usage */
+    static constexpr size_t kMaxFreeBuffersPerKey = 3;
+
+    Size getAllocSizeLocked(uint32_t width, uint32_t height, uint32_t align) const;
+    size_t getFreeBufferCount(uint32_t format, uint64_t usage) const;
+    bool fitsSizeClass(const Buffer& buffer) const;
+    static void freeBuffer(buffer_handle_t buffer);
+
+    mutable std::mutex mMutex;
+    /* Sorted by area */
+    std::vector<Size> mSizeClasses;
+    std::unordered_map<buffer_handle_t, Buffer> mBuffers;
+    uint64_t mAllocCount = 0;
+    uint64_t mReuseCount = 0;
+};
+
+#endif // _EXYNOS_MPP_DST_BUF_POOL_H_
@@ -23,7 +23,9 @@
 
 #include <cutils/properties.h>
 
+#include <map>
 #include <numeric>
+#include <set>
 #include <unordered_set>
 
 #include "ExynosDeviceInterface.h"
@@ -161,6 +163,7 @@ ExynosResourceManager::ExynosResourceManager(ExynosDevice *device)
     char value[PROPERTY_VALUE_MAX];
     mMinimumSdrDimRatio = property_get("debug.hwc.min_sdr_dimming", value, nullptr) > 0
                           ? std::atof(value) : 0.0f;
+    mParallelPresentEnabled = property_get_bool(kParallelPresentPropName, false);
     updateSupportWCG();
 }
 
@@ -224,28 +227,60 @@ int32_t ExynosResourceManager::doPreProcessing()
     ExynosDisplay *display = mDevice->getDisplay(getDisplayId(HWC_DISPLAY_PRIMARY, 0));
     if (display == NULL)
         return -EINVAL;
+    updateDstBufSizeClasses();
     ret = doAllocDstBufs(display->mXres, display->mYres);
     return ret;
 }
 
+/*
+ * Size classes of the dst buffer pool are the resolutions of all display configs,
+ * so a buffer allocated for one config can be reused after a mode change.
+ * The display configs are not guarded against hotplug and config updates, so this must be
+ * called from validate or initialization, never from DstBufMgrThread.
+ */
+void ExynosResourceManager::updateDstBufSizeClasses()
+{
+    std::vector<ExynosMPPDstBufPool::Size> sizes;
+    for (auto display : mDevice->mDisplays) {
+        if ((display == nullptr) || (display->mType == HWC_DISPLAY_VIRTUAL))
+            continue;
+        for (const auto& [configId, config] : display->mDisplayConfigs) {
+            sizes.emplace_back(config.width, config.height);
+        }
+        if ((display->mXres != 0) && (display->mYres != 0))
+            sizes.emplace_back(display->mXres, display->mYres);
+    }
+    mDstBufPool.setSizeClasses(std::move(sizes));
+}
+
 void ExynosResourceManager::doReallocDstBufs(uint32_t Xres, uint32_t Yres)
 {
     HDEBUGLOGD(eDebugBuf, "M2M dst alloc call ");
+    updateDstBufSizeClasses();
     mDstBufMgrThread->reallocDstBufs(Xres, Yres);
 }
 
 bool ExynosResourceManager::DstBufMgrThread::needDstRealloc(uint32_t Xres, uint32_t Yres, ExynosMPP *m2mMPP)
 {
-    bool ret = false;
-    if (((Xres == 720 && Yres == 1480) && (m2mMPP->getDstAllocSize() != DST_SIZE_HD_PLUS)) ||
-            ((Xres == 720 && Yres == 1280) && (m2mMPP->getDstAllocSize() != DST_SIZE_HD)) ||
-            ((Xres == 1080 && Yres == 2220) && (m2mMPP->getDstAllocSize() != DST_SIZE_FHD_PLUS)) ||
-            ((Xres == 1080 && Yres == 1920) && (m2mMPP->getDstAllocSize() != DST_SIZE_FHD)) ||
-            ((Xres == 1440 && Yres == 2960) && (m2mMPP->getDstAllocSize() != DST_SIZE_WQHD_PLUS)) ||
-            ((Xres == 1440 && Yres == 2560) && (m2mMPP->getDstAllocSize() != DST_SIZE_WQHD))) {
-        ret = true;
+    /*
+     * Realloc if a dst buffer can't hold the new resolution,
+     * or if it is larger than the size class of the new resolution.
+     */
+    uint32_t bufAlign = m2mMPP->getOutBufAlign();
+    auto [allocWidth, allocHeight] = mExynosResourceManager->mDstBufPool.getAllocSize(
+            ALIGN_UP(Xres, bufAlign), ALIGN_UP(Yres, bufAlign), bufAlign);
+    for (uint32_t i = 0; i < NUM_MPP_DST_BUFS(m2mMPP->mLogicalType); i++) {
+        buffer_handle_t handle = m2mMPP->mDstImgs[i].bufferHandle;
+        if (handle == NULL)
+            return true;
+        VendorGraphicBufferMeta gmeta(handle);
+        if ((gmeta.width < (int)ALIGN_UP(Xres, bufAlign)) ||
+            (gmeta.height < (int)ALIGN_UP(Yres, bufAlign)))
+            return true;
+        if ((gmeta.width > (int)allocWidth) || (gmeta.height > (int)allocHeight))
+            return true;
     }
-    return ret;
+    return false;
 }
 
 void ExynosResourceManager::DstBufMgrThread::reallocDstBufs(uint32_t Xres, uint32_t Yres)
@@ -333,34 +368,61 @@ int32_t ExynosResourceManager::doAllocDstBufs(uint32_t Xres, uint32_t Yres)
                 }
                 mM2mMPPs[i]->mPrevAssignedDisplayType = HWC_DISPLAY_PRIMARY;
             }
-            mM2mMPPs[i]->setDstAllocSize(Xres, Yres);
         }
     }
     return ret;
 }
 
-int32_t ExynosResourceManager::checkScenario(ExynosDisplay __unused *display) {
-    uint32_t prevResourceReserved = mResourceReserved;
-    mResourceReserved = 0x0;
+static bool hasCameraPreviewLayer(ExynosDisplay *display) {
+    if (display->mPlugState == false)
+        return false;
+
+    for (uint32_t i = 0; i < display->mLayers.size(); i++) {
+        ExynosLayer *layer = display->mLayers[i];
+        VendorGraphicBufferMeta gmeta(layer->mLayerBuffer);
+        if ((layer->mLayerBuffer != NULL) &&
+            (gmeta.producer_usage & BufferUsage::CAMERA_OUTPUT))
+            return true;
+    }
+    return false;
+}
+
+int32_t ExynosResourceManager::checkScenario(ExynosDisplay *display) {
+    std::lock_guard<std::mutex> lock(mResourceReservedMutex);
     /* Check whether camera preview is running */
-    ExynosDisplay *exynosDisplay = NULL;
-    for (uint32_t i = 0; i < mDevice->mDisplays.size(); i++) {
-        exynosDisplay = mDevice->mDisplays[i];
-        if ((exynosDisplay != NULL) && (exynosDisplay->mPlugState == true)) {
-            for (uint32_t i = 0; i < exynosDisplay->mLayers.size(); i++) {
-                ExynosLayer *layer = exynosDisplay->mLayers[i];
-                VendorGraphicBufferMeta gmeta(layer->mLayerBuffer);
-                if ((layer->mLayerBuffer != NULL) &&
-                    (gmeta.producer_usage & BufferUsage::CAMERA_OUTPUT)) {
-                    mResourceReserved |= (MPP_LOGICAL_G2D_YUV | MPP_LOGICAL_G2D_RGB);
-                    break;
-                }
-            }
+    if (mParallelPresentEnabled) {
+        /*
+         * Only the layers of the validating display are scanned because displays with
+         * partitioned resources validate concurrently, other displays update their own state
+         * when they validate.
+         */
+        if (hasCameraPreviewLayer(display))
+            mCameraPreviewDisplays.insert(display->mDisplayId);
+        else
+            mCameraPreviewDisplays.erase(display->mDisplayId);
+        for (auto exynosDisplay : mDevice->mDisplays) {
+            if ((exynosDisplay != NULL) && (exynosDisplay->mPlugState == false))
+                mCameraPreviewDisplays.erase(exynosDisplay->mDisplayId);
+        }
+    } else {
+        /* Displays validate one by one, a display that stopped validating must not keep G2D */
+        mCameraPreviewDisplays.clear();
+        for (auto exynosDisplay : mDevice->mDisplays) {
+            if ((exynosDisplay != NULL) && hasCameraPreviewLayer(exynosDisplay))
+                mCameraPreviewDisplays.insert(exynosDisplay->mDisplayId);
         }
     }
 
+    uint32_t prevResourceReserved = mResourceReserved;
+    mResourceReserved = mCameraPreviewDisplays.empty()
+            ? 0x0 : (MPP_LOGICAL_G2D_YUV | MPP_LOGICAL_G2D_RGB);
     if (prevResourceReserved != mResourceReserved) {
-        mDevice->setGeometryChanged(GEOMETRY_DEVICE_SCENARIO_CHANGED);
+        /*
+         * Reserved G2D MPPs may be assigned to any display, so partitions are invalidated
+         * and every display reassigns its resources.
+         */
+        display->setGeometryChanged(GEOMETRY_DEVICE_SCENARIO_CHANGED |
+                                    GEOMETRY_DEVICE_RESOURCE_RESERVED_CHANGED);
     }
 
     return NO_ERROR;
@@ -378,9 +440,11 @@ int32_t ExynosResourceManager::assignResource(ExynosDisplay *display)
         return -EINVAL;
 
     HDEBUGLOGD(eDebugResourceManager|eDebugSkipResourceAssign, "mGeometryChanged(0x%" PRIx64 "), display(%d)",
-            mDevice->mGeometryChanged, display->mType);
+            mDevice->mGeometryChanged.load(), display->mType);
 
-    if (mDevice->mGeometryChanged == 0) {
+    /* Partitioned display only reassigns its own MPPs */
+    const bool partitioned = display->isResourcePartitioned();
+    if ((partitioned ? display->mGeometryChanged : mDevice->mGeometryChanged.load()) == 0) {
         return NO_ERROR;
     }
 
@@ -407,7 +471,10 @@ int32_t ExynosResourceManager::assignResource(ExynosDisplay *display)
         calculateHWResourceAmount(display, display->mLayers[i]);
     }
 
-    if (mDevice->isFirstValidate()) {
+    if (partitioned) {
+        resetPartitionResources(display);
+        preAssignWindows(display);
+    } else if (mDevice->isFirstValidate()) {
         HDEBUGLOGD(eDebugResourceManager, "This is first validate");
         if (exynosHWCControl.displayMode < DISPLAY_MODE_NUM)
             mDevice->mDisplayMode = exynosHWCControl.displayMode;
@@ -455,7 +522,16 @@ int32_t ExynosResourceManager::assignResource(ExynosDisplay *display)
         }
     }
 
-    if (mDevice->isLastValidate(display)) {
+    if (partitioned) {
+        updatePartitionResourceState(display);
+        /*
+         * finishAssignResourceWork() never runs while every display is partitioned.
+         * Drop the device-wide bits once no non-partitioned display is pending, but keep
+         * the ones that invalidate partitions until the next PartitionLock sees them.
+         */
+        if (mDevice->isLastValidate(display))
+            mDevice->mGeometryChanged &= kPartitionInvalidatingGeometry;
+    } else if (mDevice->isLastValidate(display)) {
         if ((ret = finishAssignResourceWork()) != NO_ERROR) {
             HWC_LOGE(display, "%s:: finishAssignResourceWork() error (%d)",
                     __func__, ret);
@@ -569,6 +645,12 @@ int32_t ExynosResourceManager::assignResourceInternal(ExynosDisplay *display)
         }
     }
 
+    /* Extra G2D passes are allowed only after the assignment shows that they help */
+    for (auto mpp : mM2mMPPs) {
+        if ((mpp->mAssignedDisplay == display) || (mpp->mAssignedDisplay == NULL))
+            mpp->setCompositionPasses(1);
+    }
+
     do {
         HDEBUGLOGD(eDebugResourceAssigning, "%s:: retry_count(%d)", __func__, retry_count);
         if ((ret = resetAssignedResources(display)) != NO_ERROR)
@@ -638,6 +720,9 @@ int32_t ExynosResourceManager::assignResourceInternal(ExynosDisplay *display)
         if (ret == NO_ERROR) {
             ret = setResourcePriority(display);
         }
+        if (ret == NO_ERROR) {
+            ret = updateCompositionPasses(display);
+        }
         retry_count++;
     } while((ret == EXYNOS_ERROR_CHANGED) && (retry_count < ASSIGN_RESOURCE_TRY_COUNT));
 
@@ -675,15 +760,18 @@ int32_t ExynosResourceManager::updateExynosComposition(ExynosDisplay *display)
             ExynosMPP *m2mMPP = display->mExynosCompositionInfo.mM2mMPP;
             uint32_t lastIndex = display->mExynosCompositionInfo.mLastIndex;
             uint32_t firstIndex = display->mExynosCompositionInfo.mFirstIndex;
-            uint32_t remainNum = m2mMPP->mMaxSrcLayerNum - (lastIndex - firstIndex + 1);
+            exynos_image src_img;
+            exynos_image dst_img;
+            /* It includes the sources of extra G2D passes if they are allowed */
+            uint32_t maxSrcNum = m2mMPP->getSrcMaxBlendingNum(src_img, dst_img);
+            uint32_t composedNum = lastIndex - firstIndex + 1;
+            uint32_t remainNum = (maxSrcNum > composedNum) ? (maxSrcNum - composedNum) : 0;
 
             HDEBUGLOGD(eDebugResourceAssigning,
                        "Update ExynosComposition firstIndex: %d, lastIndex: %d, remainNum: %d++++",
                        firstIndex, lastIndex, remainNum);
 
             ExynosLayer *layer = NULL;
-            exynos_image src_img;
-            exynos_image dst_img;
             if (remainNum > 0) {
                 for (uint32_t i = (lastIndex + 1); i < display->mLayers.size(); i++)
                 {
@@ -844,6 +932,79 @@ int32_t ExynosResourceManager::changeLayerFromClientToDevice(ExynosDisplay* disp
 
     return ret;
 }
+/*
+ * When the G2D of Exynos composition is full and the layers over its limit went to
+ * client composition, lets the G2D chain more passes if that is cheaper than waking up
+ * the GPU. Returns EXYNOS_ERROR_CHANGED if resources should be assigned again.
+ */
+int32_t ExynosResourceManager::updateCompositionPasses(ExynosDisplay *display)
+{
+    ExynosCompositionInfo &exynosInfo = display->mExynosCompositionInfo;
+    ExynosCompositionInfo &clientInfo = display->mClientCompositionInfo;
+    ExynosMPP *m2mMPP = exynosInfo.mM2mMPP;
+
+    if ((exynosInfo.mHasCompositionLayer == false) ||
+        (clientInfo.mHasCompositionLayer == false) || (m2mMPP == NULL) ||
+        (m2mMPP->mMaxCompositionPasses <= 1) || (m2mMPP->getCompositionPasses() > 1) ||
+        (exynosHWCControl.forceGpu == 1) || (display->mDynamicReCompMode == DEVICE_2_CLIENT))
+        return NO_ERROR;
+
+    exynos_image src_img;
+    exynos_image dst_img;
+    uint32_t assignedNum = m2mMPP->getAssignedSourceNum();
+    /* Layers didn't go to the GPU for lack of G2D sources */
+    if (assignedNum < m2mMPP->getSrcMaxBlendingNum(src_img, dst_img))
+        return NO_ERROR;
+
+    CompositionPassPolicy::Input input;
+    float clientCycles = 0;
+    input.gpuRequired = display->mLowFpsLayerInfo.mHasLowFpsLayer;
+    for (int32_t i = clientInfo.mFirstIndex; i <= clientInfo.mLastIndex; i++) {
+        ExynosLayer *layer = display->mLayers[i];
+        if (layer->getValidateCompositionType() != HWC2_COMPOSITION_CLIENT)
+            continue;
+        if ((layer->mCompositionType == HWC2_COMPOSITION_CLIENT) ||
+            ((layer->mSupportedMPPFlag & m2mMPP->mLogicalType) == 0)) {
+            input.gpuRequired = true;
+            break;
+        }
+        layer->setSrcExynosImage(&src_img);
+        layer->setDstExynosImage(&dst_img);
+        uint64_t pixels = max(src_img.w * src_img.h, dst_img.w * dst_img.h);
+        input.clientLayerNum++;
+        input.clientPixels += pixels;
+        clientCycles += pixels / G2D_BASE_PPC;
+    }
+
+    uint32_t srcNum = assignedNum + input.clientLayerNum;
+    input.targetPixels = (uint64_t)display->mXres * display->mYres;
+    input.passNum = m2mMPP->getCompositionPassNum(srcNum);
+    input.requiredCapacity = getResourceUsedCapa(*m2mMPP) +
+            clientCycles / m2mMPP->getMPPClockKhz() +
+            m2mMPP->getExtraPassCapacity(display, srcNum);
+    input.capacity = m2mMPP->mCapacity;
+
+    bool useG2D = display->mCompositionPassPolicy.evaluate(input);
+    HDEBUGLOGD(eDebugResourceAssigning,
+               "%s:: client layers(%d), sources(%d), passes(%d), capacity(%f/%f), "
+               "gpuRequired(%d): %s",
+               __func__, input.clientLayerNum, srcNum, input.passNum, input.requiredCapacity,
+               input.capacity, input.gpuRequired, useG2D ? "G2D" : "CLIENT");
+    if (!useG2D)
+        return NO_ERROR;
+
+    /* Assign all layers again with the larger G2D */
+    m2mMPP->setCompositionPasses(input.passNum);
+    if (clientInfo.mOtfMPP != NULL)
+        clientInfo.mOtfMPP->resetAssignedState();
+    if (exynosInfo.mOtfMPP != NULL)
+        exynosInfo.mOtfMPP->resetAssignedState();
+    m2mMPP->resetAssignedState();
+
+    display->initializeValidateInfos();
+    return EXYNOS_ERROR_CHANGED;
+}
+
 int32_t ExynosResourceManager::updateClientComposition(ExynosDisplay *display)
 {
     int ret = NO_ERROR;
@@ -1923,6 +2084,8 @@ int32_t ExynosResourceManager::resetResources()
     HDEBUGLOGD(eDebugResourceManager, "%s+++++++++", __func__);
 
     for (uint32_t i = 0; i < mOtfMPPs.size(); i++) {
+        if (isPartitionedMPP(mOtfMPPs[i]))
+            continue;
         mOtfMPPs[i]->resetMPP();
         if (hwcCheckDebugMessages(eDebugResourceManager)) {
             String8 dumpMPP;
@@ -1931,6 +2094,8 @@ int32_t ExynosResourceManager::resetResources()
         }
     }
     for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
+        if (isPartitionedMPP(mM2mMPPs[i]))
+            continue;
         mM2mMPPs[i]->resetMPP();
         if (hwcCheckDebugMessages(eDebugResourceManager)) {
             String8 dumpMPP;
@@ -2013,6 +2178,8 @@ int32_t ExynosResourceManager::preAssignResources()
     uint32_t displayMode = mDevice->mDisplayMode;
 
     for (uint32_t i = 0; i < mOtfMPPs.size(); i++) {
+        if (isPartitionedMPP(mOtfMPPs[i]))
+            continue;
         if (mOtfMPPs[i]->mEnable == false) {
             mOtfMPPs[i]->reserveMPP();
             continue;
@@ -2050,6 +2217,8 @@ int32_t ExynosResourceManager::preAssignResources()
         }
     }
     for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
+        if (isPartitionedMPP(mM2mMPPs[i]))
+            continue;
         if (mM2mMPPs[i]->mEnable == false) {
             mM2mMPPs[i]->reserveMPP();
             continue;
@@ -2186,11 +2355,15 @@ ExynosMPP* ExynosResourceManager::getExynosMPP(uint32_t physicalType, uint32_t p
 int32_t ExynosResourceManager::updateResourceState()
 {
     for (uint32_t i = 0; i < mOtfMPPs.size(); i++) {
+        if (isPartitionedMPP(mOtfMPPs[i]))
+            continue;
         if (mOtfMPPs[i]->mAssignedSources.size() == 0)
             mOtfMPPs[i]->requestHWStateChange(MPP_HW_STATE_IDLE);
         mOtfMPPs[i]->mPrevAssignedState = mOtfMPPs[i]->mAssignedState;
     }
     for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
+        if (isPartitionedMPP(mM2mMPPs[i]))
+            continue;
         if (mM2mMPPs[i]->mAssignedSources.size() == 0)
             mM2mMPPs[i]->requestHWStateChange(MPP_HW_STATE_IDLE);
         mM2mMPPs[i]->mPrevAssignedState = mM2mMPPs[i]->mAssignedState;
@@ -2198,6 +2371,20 @@ int32_t ExynosResourceManager::updateResourceState()
     return NO_ERROR;
 }
 
+void ExynosResourceManager::updatePartitionResourceState(ExynosDisplay *display)
+{
+    auto update = [display](ExynosMPP *mpp) {
+        if (mpp->mReservedDisplay != (int32_t)display->mDisplayId)
+            return;
+        if (mpp->mAssignedSources.size() == 0)
+            mpp->requestHWStateChange(MPP_HW_STATE_IDLE);
+        mpp->mPrevAssignedState = mpp->mAssignedState;
+    };
+
+    for (auto mpp : mOtfMPPs) update(mpp);
+    for (auto mpp : mM2mMPPs) update(mpp);
+}
+
 /*
  * This function is called every frame.
  * This base function does nothing.
@@ -2213,9 +2400,18 @@ void ExynosResourceManager::setFrameRateForPerformance(ExynosMPP &mpp,
     frame->setFrameRate(fps);
 }
 
-int32_t ExynosResourceManager::deliverPerformanceInfo()
+int32_t ExynosResourceManager::deliverPerformanceInfo(ExynosDisplay *display)
 {
     int ret = NO_ERROR;
+    /*
+     * A partitioned display owns every instance of the physical types it uses,
+     * so it only has to deliver the request for its own MPPs.
+     */
+    const bool partitioned = (display != nullptr) && display->isResourcePartitioned();
+    auto isOtherPartition = [&](ExynosMPP *mpp) {
+        return partitioned && (mpp->mReservedDisplay != (int32_t)display->mDisplayId);
+    };
+
     for (uint32_t mpp_physical_type = 0; mpp_physical_type < MPP_P_TYPE_MAX; mpp_physical_type++) {
         /* Only G2D gets performance info in current version */
         if (mpp_physical_type != MPP_G2D)
@@ -2228,7 +2424,7 @@ int32_t ExynosResourceManager::deliverPerformanceInfo()
 
         for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
             mpp = mM2mMPPs[i];
-            if (mpp->mPhysicalType != mpp_physical_type)
+            if ((mpp->mPhysicalType != mpp_physical_type) || isOtherPartition(mpp))
                 continue;
             /* Performance setting can be skipped
              * if all of instance's mPrevAssignedState, mAssignedState
@@ -2260,7 +2456,7 @@ int32_t ExynosResourceManager::deliverPerformanceInfo()
 
         for (uint32_t i = 0; i < mM2mMPPs.size(); i++) {
             mpp = mM2mMPPs[i];
-            if ((mpp->mPhysicalType == mpp_physical_type) &&
+            if ((mpp->mPhysicalType == mpp_physical_type) && !isOtherPartition(mpp) &&
                 (mpp->mAssignedDisplay != NULL) &&
                 (mpp->mAssignedSources.size() > 0))
             {
@@ -2423,6 +2619,10 @@ int32_t ExynosResourceManager::prepareResources(const int32_t willOnDispId) {
         (mDevice->mGeometryChanged & GEOMETRY_DEVICE_DISPLAY_REMOVED) || willOnDispId != -1)
         updatePreAssignDisplayList(mainDisp, minorDisp);
 
+    if (mDevice->mGeometryChanged &
+        (GEOMETRY_DEVICE_DISPLAY_ADDED | GEOMETRY_DEVICE_DISPLAY_REMOVED))
+        updateDstBufSizeClasses();
+
     if ((ret = preAssignResources()) != NO_ERROR) {
         HWC_LOGE(NULL,"%s:: preAssignResources() error (%d)",
                 __func__, ret);
@@ -2430,6 +2630,7 @@ int32_t ExynosResourceManager::prepareResources(const int32_t willOnDispId) {
     }
 
     setDisplaysTDMInfo(mainDisp, minorDisp);
+    updateResourcePartitions();
 
     return ret;
 }
@@ -2447,6 +2648,107 @@ int32_t ExynosResourceManager::finishAssignResourceWork()
     return ret;
 }
 
+ExynosResourceManager::PartitionLock::PartitionLock(ExynosResourceManager& resourceManager,
+                                                    ExynosDisplay* display) {
+    const bool invalidated =
+            (resourceManager.mDevice->mGeometryChanged & kPartitionInvalidatingGeometry) != 0;
+
+    if (resourceManager.mParallelPresentEnabled && !invalidated &&
+        display->isResourcePartitioned()) {
+        mShared = std::shared_lock<std::shared_mutex>(resourceManager.mPartitionMutex);
+        /* Partitions can be cleared while waiting for the lock */
+        if (display->isResourcePartitioned()) return;
+        mShared.unlock();
+    }
+
+    mExclusive = std::unique_lock<std::shared_mutex>(resourceManager.mPartitionMutex);
+    if (invalidated) resourceManager.clearResourcePartitions();
+}
+
+bool ExynosResourceManager::isPartitionedMPP(ExynosMPP *mpp) const
+{
+    if (!mParallelPresentEnabled || (mpp->mReservedDisplay < 0))
+        return false;
+
+    for (auto display : mDevice->mDisplays) {
+        if ((display != nullptr) && ((int32_t)display->mDisplayId == mpp->mReservedDisplay))
+            return display->isResourcePartitioned();
+    }
+    return false;
+}
+
+void ExynosResourceManager::clearResourcePartitions()
+{
+    for (auto display : mDevice->mDisplays) {
+        if (display != nullptr)
+            display->mResourcePartitioned = false;
+    }
+}
+
+/*
+ * Displays can be partitioned only if no enabled MPP is shared.
+ * Every OTF MPP should be reserved to a display, and all instances of
+ * a M2M physical type should be reserved to the same display because
+ * performance QoS is requested per physical type.
+ */
+void ExynosResourceManager::updateResourcePartitions()
+{
+    if (!mParallelPresentEnabled) {
+        clearResourcePartitions();
+        return;
+    }
+
+    std::set<int32_t> owners;
+    std::map<uint32_t, int32_t> m2mOwners;
+    bool shared = false;
+
+    for (auto mpp : mOtfMPPs) {
+        if (mpp->mEnable == false)
+            continue;
+        if (mpp->mReservedDisplay < 0) {
+            shared = true;
+            break;
+        }
+        owners.insert(mpp->mReservedDisplay);
+    }
+    for (auto mpp : mM2mMPPs) {
+        if (shared)
+            break;
+        if (mpp->mEnable == false)
+            continue;
+        auto it = m2mOwners.emplace(mpp->mPhysicalType, mpp->mReservedDisplay).first;
+        if ((mpp->mReservedDisplay < 0) || (it->second != mpp->mReservedDisplay))
+            shared = true;
+    }
+
+    for (auto display : mDevice->mDisplays) {
+        if (display == nullptr)
+            continue;
+        bool partitioned = !shared && (display->mType != HWC_DISPLAY_VIRTUAL) &&
+                (owners.count(display->mDisplayId) != 0);
+        /*
+         * Its MPPs were reset or reassigned under the other mode,
+         * so the display must not skip its next validate.
+         */
+        if (display->mResourcePartitioned.exchange(partitioned) != partitioned)
+            display->setGeometryChanged(GEOMETRY_DISPLAY_FORCE_VALIDATE);
+    }
+    HDEBUGLOGD(eDebugResourceManager, "%s:: MPPs are %s", __func__,
+               shared ? "shared" : "partitioned");
+}
+
+void ExynosResourceManager::resetPartitionResources(ExynosDisplay *display)
+{
+    /* Keep the reservation so that other partitions never see these MPPs as free */
+    auto reset = [display](ExynosMPP *mpp) {
+        if (mpp->mReservedDisplay == (int32_t)display->mDisplayId)
+            mpp->resetAssignedState();
+    };
+
+    for (auto mpp : mOtfMPPs) reset(mpp);
+    for (auto mpp : mM2mMPPs) reset(mpp);
+}
+
 int32_t ExynosResourceManager::initResourcesState(ExynosDisplay *display)
 {
     int ret = 0;
@@ -2702,12 +3004,22 @@ float ExynosResourceManager::getM2MCapa(uint32_t physicalType)
 void ExynosResourceManager::dump(String8 &result) const {
     result.appendFormat("Resource Manager:\n");
 
+    result.appendFormat("Parallel present: %s, partitioned displays:",
+                        mParallelPresentEnabled ? "enabled" : "disabled");
+    for (auto display : mDevice->mDisplays) {
+        if ((display != nullptr) && display->isResourcePartitioned())
+            result.appendFormat(" %u", display->mDisplayId);
+    }
+    result.appendFormat("\n");
+
     result.appendFormat("[RGB Restrictions]\n");
     dump(RESTRICTION_RGB, result);
 
     result.appendFormat("[YUV Restrictions]\n");
     dump(RESTRICTION_YUV, result);
 
+    mDstBufPool.dump(result);
+
     result.appendFormat("[MPP Dump]\n");
     for (auto mpp : mOtfMPPs) {
         mpp->dump(result);
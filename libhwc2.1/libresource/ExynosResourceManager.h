@@ -21,10 +21,14 @@
 #ifndef _EXYNOSRESOURCEMANAGER_H
 #define _EXYNOSRESOURCEMANAGER_H
 
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <unordered_map>
 #include "ExynosDevice.h"
 #include "ExynosDisplay.h"
 #include "ExynosHWCHelper.h"
+#include "ExynosMPPDstBufPool.h"
 #include "ExynosMPPModule.h"
 #include "ExynosResourceRestriction.h"
 
@@ -80,6 +84,24 @@ class ExynosMPPVector : public android::SortedVector< ExynosMPP* > {
 };
 
 class ExynosResourceManager {
+    public:
+    /*
+     * Resource partitioning for parallel present.
+     * When every enabled MPP is reserved to a single display, validate and present of a display
+     * only touch the MPPs of its own partition. Such displays hold the partition lock shared and
+     * run concurrently. Device-wide resource work (first/last validate of non-partitioned
+     * displays, partition updates) holds it exclusively.
+     */
+    class PartitionLock {
+        public:
+            PartitionLock(ExynosResourceManager& resourceManager, ExynosDisplay* display);
+            bool isPartitioned() const { return mShared.owns_lock(); }
+
+        private:
+            std::shared_lock<std::shared_mutex> mShared;
+            std::unique_lock<std::shared_mutex> mExclusive;
+    };
+
     private:
     class DstBufMgrThread: public Thread {
         private:
@@ -113,6 +135,9 @@ class ExynosResourceManager {
 
         std::unordered_map<uint32_t /* physical type */, uint64_t /* attribute */> mMPPAttrs;
 
+        /* Destination buffers shared by all M2M MPPs */
+        ExynosMPPDstBufPool mDstBufPool;
+
         ExynosResourceManager(ExynosDevice *device);
         virtual ~ExynosResourceManager();
         void reloadResourceForHWFC();
@@ -152,10 +177,11 @@ class ExynosResourceManager {
         static float getResourceUsedCapa(ExynosMPP &mpp);
         int32_t updateExynosComposition(ExynosDisplay *display);
         int32_t updateClientComposition(ExynosDisplay *display);
+        int32_t updateCompositionPasses(ExynosDisplay *display);
         int32_t getCandidateM2mMPPOutImages(ExynosDisplay *display,
                 ExynosLayer *layer, std::vector<exynos_image> &image_lists);
         int32_t setResourcePriority(ExynosDisplay *display);
-        int32_t deliverPerformanceInfo();
+        int32_t deliverPerformanceInfo(ExynosDisplay *display = nullptr);
         int32_t prepareResources(const int32_t willOnDispId = -1);
         int32_t finishAssignResourceWork();
         int32_t initResourcesState(ExynosDisplay *display);
@@ -182,6 +208,15 @@ class ExynosResourceManager {
         float getAssignedCapacity(uint32_t physicalType);
 
         void dump(String8 &result) const;
+        bool isParallelPresentEnabled() const { return mParallelPresentEnabled; }
+
+        /* Geometry changes that may move MPPs between displays */
+        static constexpr uint64_t kPartitionInvalidatingGeometry = GEOMETRY_DISPLAY_POWER_ON |
+                GEOMETRY_DISPLAY_POWER_OFF | GEOMETRY_DEVICE_DISPLAY_ADDED |
+                GEOMETRY_DEVICE_DISPLAY_REMOVED | GEOMETRY_DEVICE_CONFIG_CHANGED |
+                GEOMETRY_DEVICE_DISP_MODE_CHAGED | GEOMETRY_DEVICE_RESOURCE_RESERVED_CHANGED;
+
+        bool isPartitionedMPP(ExynosMPP *mpp) const;
         void setM2MCapa(uint32_t physicalType, uint32_t capa);
         virtual bool isAssignable(ExynosMPP* candidateMPP, ExynosDisplay* display,
                                   struct exynos_image& src, struct exynos_image& dst,
@@ -195,6 +230,17 @@ class ExynosResourceManager {
 
         sp<DstBufMgrThread> mDstBufMgrThread;
 
+        static constexpr const char *kParallelPresentPropName =
+                "vendor.display.parallel_present.enabled";
+        bool mParallelPresentEnabled = false;
+        std::shared_mutex mPartitionMutex;
+
+        void updateDstBufSizeClasses();
+        void updateResourcePartitions();
+        void clearResourcePartitions();
+        void resetPartitionResources(ExynosDisplay *display);
+        void updatePartitionResourceState(ExynosDisplay *display);
+
     protected:
         virtual void setFrameRateForPerformance(ExynosMPP &mpp, AcrylicPerformanceRequestFrame *frame);
         void getCandidateScalingM2mMPPOutImages(const ExynosDisplay *display,
@@ -209,6 +255,9 @@ class ExynosResourceManager {
         static ExynosMPPVector mOtfMPPs;
         static ExynosMPPVector mM2mMPPs;
         uint32_t mResourceReserved; /* Set MPP logical type for bit operation */
+        /* Displays running camera preview, guards mResourceReserved updates */
+        std::mutex mResourceReservedMutex;
+        std::set<uint32_t> mCameraPreviewDisplays;
         float mMinimumSdrDimRatio;
 
         android::Vector<ExynosDisplay *> mDisplays;
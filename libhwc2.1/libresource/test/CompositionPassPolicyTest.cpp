@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "CompositionPassPolicy.h"
+
+namespace {
+
+constexpr uint32_t kMaxSrcNum = 4;
+constexpr uint32_t kMaxPasses = 3;
+
+TEST(CompositionPassPolicyTest, PassNumFitsSourcesPerPass) {
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(1, kMaxSrcNum, kMaxPasses), 1u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(4, kMaxSrcNum, kMaxPasses), 1u);
+    // The passes above the lowest one take the intermediate buffer as a source
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(5, kMaxSrcNum, kMaxPasses), 2u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(7, kMaxSrcNum, kMaxPasses), 2u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(8, kMaxSrcNum, kMaxPasses), 3u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(10, kMaxSrcNum, kMaxPasses), 3u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(11, kMaxSrcNum, kMaxPasses), 0u);
+}
+
+TEST(CompositionPassPolicyTest, PassNumWithoutRoomForIntermediate) {
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(1, 1, kMaxPasses), 1u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(2, 1, kMaxPasses), 0u);
+    EXPECT_EQ(CompositionPassPolicy::getPassNum(5, kMaxSrcNum, 1), 0u);
+}
+
+TEST(CompositionPassPolicyTest, SourcesFillPassesWithinLimits) {
+    for (uint32_t srcNum = 1; srcNum <= 10; srcNum++) {
+        const uint32_t passNum = CompositionPassPolicy::getPassNum(srcNum, kMaxSrcNum, kMaxPasses);
+        ASSERT_GT(passNum, 0u) << srcNum;
+
+        std::vector<uint32_t> sources(passNum, 0);
+        uint32_t prevPass = passNum - 1;
+        for (size_t i = 0; i < srcNum; i++) {
+            const uint32_t pass =
+                    CompositionPassPolicy::getPassOfSource(i, srcNum, passNum, kMaxSrcNum);
+            ASSERT_LT(pass, passNum);
+            // The bottom sources go to the lowest pass and z-order is kept across passes
+            EXPECT_LE(pass, prevPass) << srcNum << " " << i;
+            prevPass = pass;
+            sources[pass]++;
+        }
+        EXPECT_EQ(CompositionPassPolicy::getPassOfSource(srcNum - 1, srcNum, passNum, kMaxSrcNum),
+                  0u);
+        for (uint32_t pass = 0; pass < passNum; pass++) {
+            const uint32_t intermediate = (pass == passNum - 1) ? 0 : 1;
+            EXPECT_GT(sources[pass], 0u) << srcNum << " " << pass;
+            EXPECT_LE(sources[pass] + intermediate, kMaxSrcNum) << srcNum << " " << pass;
+        }
+    }
+}
+
+TEST(CompositionPassPolicyTest, SinglePassTakesAllSources) {
+    for (size_t i = 0; i < kMaxSrcNum; i++)
+        EXPECT_EQ(CompositionPassPolicy::getPassOfSource(i, kMaxSrcNum, 1, kMaxSrcNum), 0u);
+}
+
+CompositionPassPolicy::Input getFittingInput() {
+    CompositionPassPolicy::Input input;
+    input.clientLayerNum = 1;
+    input.clientPixels = 1080 * 2400;
+    input.targetPixels = 1080 * 2400;
+    input.passNum = 2;
+    input.requiredCapacity = 8;
+    input.capacity = 16;
+    return input;
+}
+
+TEST(CompositionPassPolicyTest, ExtraPassWinsOverWakingUpGpu) {
+    CompositionPassPolicy policy;
+    EXPECT_TRUE(policy.evaluate(getFittingInput()));
+}
+
+TEST(CompositionPassPolicyTest, ClientCompositionWhenG2DCannotTakeLayers) {
+    CompositionPassPolicy policy;
+
+    CompositionPassPolicy::Input input = getFittingInput();
+    input.gpuRequired = true;
+    EXPECT_FALSE(policy.evaluate(input));
+
+    input = getFittingInput();
+    input.passNum = 0;
+    EXPECT_FALSE(policy.evaluate(input));
+
+    input = getFittingInput();
+    input.requiredCapacity = input.capacity + 1;
+    EXPECT_FALSE(policy.evaluate(input));
+}
+
+TEST(CompositionPassPolicyTest, DumpKeepsLatestDecisions) {
+    CompositionPassPolicy policy;
+    CompositionPassPolicy::Input input = getFittingInput();
+    for (uint32_t i = 0; i < 40; i++) {
+        input.clientLayerNum = i;
+        policy.evaluate(input);
+    }
+
+    android::String8 result;
+    policy.dump(result);
+    const std::string dump(result.c_str());
+    EXPECT_NE(dump.find("decisions (40)"), std::string::npos);
+    EXPECT_NE(dump.find("\n\t39 "), std::string::npos);
+    EXPECT_EQ(dump.find("\n\t23 "), std::string::npos);
+}
+
+} // namespace
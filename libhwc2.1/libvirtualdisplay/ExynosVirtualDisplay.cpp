@@ -268,7 +268,7 @@ int32_t ExynosVirtualDisplay::presentDisplay(
             ((mRenderingState == RENDERING_STATE_PRESENTED) ||
              (mRenderingState == RENDERING_STATE_NONE))) {
 
-            if (mDevice->canSkipValidate() == false) {
+            if (mDevice->canSkipValidate(this) == false) {
                 mRenderingState = RENDERING_STATE_NONE;
                 return HWC2_ERROR_NOT_VALIDATED;
             } else {
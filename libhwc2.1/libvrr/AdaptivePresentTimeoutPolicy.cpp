@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AdaptivePresentTimeoutPolicy.h"
+
+#include <algorithm>
+
+namespace android::hardware::graphics::composer {
+
+AdaptivePresentTimeoutPolicy::AdaptivePresentTimeoutPolicy()
+      : AdaptivePresentTimeoutPolicy(AdaptivePresentTimeoutParameters()) {}
+
+AdaptivePresentTimeoutPolicy::AdaptivePresentTimeoutPolicy(
+        const AdaptivePresentTimeoutParameters& params)
+      : mParams(params) {}
+
+void AdaptivePresentTimeoutPolicy::onPresentInterval(int64_t intervalNs, int64_t idleThresholdNs) {
+    if ((intervalNs <= 0) || (intervalNs >= idleThresholdNs)) {
+        return;
+    }
+
+    // Replace the oldest gap, if the window is full, by the new one in the sorted gaps.
+    size_t size = mIntervals.size();
+    auto sortedEnd = mSortedIntervals.begin() + size;
+    if (size == mIntervals.capacity()) {
+        auto evicted = std::lower_bound(mSortedIntervals.begin(), sortedEnd, mIntervals[0]);
+        std::move(evicted + 1, sortedEnd, evicted);
+        mTotalIntervalNs -= mIntervals[0];
+        --sortedEnd;
+    }
+    mIntervals.next() = intervalNs;
+    mTotalIntervalNs += intervalNs;
+    auto inserted = std::upper_bound(mSortedIntervals.begin(), sortedEnd, intervalNs);
+    std::move_backward(inserted, sortedEnd, sortedEnd + 1);
+    *inserted = intervalNs;
+    size = mIntervals.size();
+
+    // The coverage is weighted by time: the rare pauses of bursty content take a large share of
+    // its time, and must be covered even though they are few. Find the shortest gap such that the
+    // gaps up to it hold the covered time, by leaving out the longest gaps first.
+    int64_t uncoveredNs = mTotalIntervalNs * (100 - mParams.mCoveragePercentage);
+    int64_t leftOutNs = 0;
+    size_t index = size - 1;
+    while ((index > 0) && ((leftOutNs + mSortedIntervals[index]) * 100 <= uncoveredNs)) {
+        leftOutNs += mSortedIntervals[index];
+        --index;
+    }
+    mLearnedTimeoutNs = mSortedIntervals[index] * (100 + mParams.mMarginPercentage) / 100;
+}
+
+int64_t AdaptivePresentTimeoutPolicy::getHibernateTimeoutNs(int64_t fixedTimeoutNs) const {
+    if (!hasLearnedCadence()) {
+        return fixedTimeoutNs;
+    }
+    return std::min(fixedTimeoutNs, std::max(mLearnedTimeoutNs, mParams.mMinHibernateTimeoutNs));
+}
+
+void AdaptivePresentTimeoutPolicy::reset() {
+    mIntervals.clear();
+    mTotalIntervalNs = 0;
+    mLearnedTimeoutNs = 0;
+}
+
+bool AdaptivePresentTimeoutPolicy::hasLearnedCadence() const {
+    return mIntervals.size() >= mParams.mMinNumberOfSamples;
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#include "RingBuffer.h"
+
+namespace android::hardware::graphics::composer {
+
+struct AdaptivePresentTimeoutParameters {
+    // The percentage of the time between the recent presents a learned timeout must cover.
+    int mCoveragePercentage = 95;
+    // The margin added on top of the covered gap.
+    int mMarginPercentage = 50;
+    // The number of gaps required before the learned cadence is trusted.
+    size_t mMinNumberOfSamples = 16;
+    int64_t mMinHibernateTimeoutNs = 100000000; // 100 ms
+};
+
+// Learns the cadence of the presented content from its recent inter-frame gaps, and derives the
+// timeout after which the controller hibernates.
+//
+// Sparse content hibernates shortly after the gaps it usually leaves, instead of waiting for the
+// fixed timeout. Since the learned timeout covers the gaps holding most of the recent time, the
+// occasional pause of bursty content does not cause an extra hibernation exit. The vendor frame
+// insertion timeout is a panel requirement and is not adapted.
+class AdaptivePresentTimeoutPolicy {
+public:
+    AdaptivePresentTimeoutPolicy();
+
+    explicit AdaptivePresentTimeoutPolicy(const AdaptivePresentTimeoutParameters& params);
+
+    // Learn the gap between two consecutive presents. Gaps not shorter than |idleThresholdNs| are
+    // idle periods rather than part of the content cadence, and are ignored.
+    void onPresentInterval(int64_t intervalNs, int64_t idleThresholdNs);
+
+    // Return the learned hibernation timeout, which never exceeds |fixedTimeoutNs|.
+    int64_t getHibernateTimeoutNs(int64_t fixedTimeoutNs) const;
+
+    void reset();
+
+private:
+    static constexpr size_t kMaxNumberOfSamples = 64;
+
+    bool hasLearnedCadence() const;
+
+    const AdaptivePresentTimeoutParameters mParams;
+
+    // The learned gaps in present order, and the same gaps kept sorted as they are learned.
+    RingBuffer<int64_t, kMaxNumberOfSamples> mIntervals;
+    std::array<int64_t, kMaxNumberOfSamples> mSortedIntervals;
+    int64_t mTotalIntervalNs = 0;
+    // The covered gap with its margin, updated for every learned gap.
+    int64_t mLearnedTimeoutNs = 0;
+};
+
+} // namespace android::hardware::graphics::composer
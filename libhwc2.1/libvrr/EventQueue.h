@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <queue>
 
 #include "interface/Event.h"
@@ -24,6 +25,13 @@ namespace android::hardware::graphics::composer {
 
 struct EventQueue {
 public:
+    // A priority queue whose heap storage can be scanned in place, without copying the events
+    // and their functors.
+    class PriorityQueue : public std::priority_queue<VrrControllerEvent> {
+    public:
+        const container_type& events() const { return c; }
+    };
+
     EventQueue() = default;
 
     void postEvent(VrrControllerEventType type, TimedEvent& timedEvent) {
@@ -42,10 +50,10 @@ public:
         mPriorityQueue.emplace(event);
     }
 
-    void dropEvent() { mPriorityQueue = std::priority_queue<VrrControllerEvent>(); }
+    void dropEvent() { mPriorityQueue = PriorityQueue(); }
 
     void dropEvent(VrrControllerEventType event_type) {
-        std::priority_queue<VrrControllerEvent> q;
+        PriorityQueue q;
         while (!mPriorityQueue.empty()) {
             const auto& it = mPriorityQueue.top();
             if (it.mEventType != event_type) {
@@ -58,7 +66,7 @@ public:
 
     size_t getNumberOfEvents(VrrControllerEventType eventType) {
         size_t res = 0;
-        std::priority_queue<VrrControllerEvent> q;
+        PriorityQueue q;
         while (!mPriorityQueue.empty()) {
             const auto& it = mPriorityQueue.top();
             if (it.mEventType == eventType) {
@@ -71,7 +79,18 @@ public:
         return res;
     }
 
-    std::priority_queue<VrrControllerEvent> mPriorityQueue;
+    // Return the time of the latest event due by |untilNs|, or -1 if there is none.
+    int64_t getLatestEventTimeNs(int64_t untilNs) const {
+        int64_t res = -1;
+        for (const auto& event : mPriorityQueue.events()) {
+            if (event.mWhenNs <= untilNs) {
+                res = std::max(res, event.mWhenNs);
+            }
+        }
+        return res;
+    }
+
+    PriorityQueue mPriorityQueue;
 };
 
 } // namespace android::hardware::graphics::composer
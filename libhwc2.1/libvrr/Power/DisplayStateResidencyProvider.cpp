@@ -62,41 +62,38 @@ const std::vector<State>& DisplayStateResidencyProvider::getStates() {
 }
 
 uint64_t DisplayStateResidencyProvider::aggregateStatistics() {
-    uint64_t totalTimeNs = 0;
-    std::set<int> firstIteration;
-    auto updatedStatistics = mStatisticsProvider->getUpdatedStatistics();
-    for (auto& statistic : updatedStatistics) {
-        auto it = mPowerStatsProfileToIdMap.find(statistic.first.toPowerStatsProfile());
-        if (it == mPowerStatsProfileToIdMap.end()) {
-            ALOGE("DisplayStateResidencyProvider %s(): unregistered powerstats state [%s]",
-                  __func__, statistic.first.toPowerStatsProfile().toString().c_str());
-            continue;
+    auto updatedStatistics = mStatisticsProvider->takeUpdatedStatistics();
+    for (const auto& statistic : updatedStatistics) {
+        auto [it, inserted] = mResidencySources.try_emplace(statistic.first);
+        auto& source = it->second;
+        if (inserted) {
+            auto idIt = mPowerStatsProfileToIdMap.find(statistic.first.toPowerStatsProfile());
+            if (idIt == mPowerStatsProfileToIdMap.end()) {
+                ALOGE("DisplayStateResidencyProvider %s(): unregistered powerstats state [%s]",
+                      __func__, statistic.first.toPowerStatsProfile().toString().c_str());
+            } else {
+                source.mStateId = idIt->second;
+            }
         }
-        int id = it->second;
         const auto& displayPresentRecord = statistic.second;
-
-        auto& stateResidency = mStateResidency[id];
-        if (firstIteration.count(id) > 0) {
-            stateResidency.totalStateEntryCount += displayPresentRecord.mCount;
+        const auto& lastRecord = source.mLastRecord;
+        if (source.mStateId >= 0) {
+            // Time is truncated to milliseconds per statistic, as the totals were before.
+            auto& stateResidency = mStateResidency[source.mStateId];
+            stateResidency.totalStateEntryCount +=
+                    displayPresentRecord.mCount - lastRecord.mCount;
             stateResidency.lastEntryTimestampMs =
                     std::max<uint64_t>(stateResidency.lastEntryTimestampMs,
                                        displayPresentRecord.mLastTimeStampInBootClockNs /
                                                MilliToNano);
             stateResidency.totalTimeInStateMs +=
-                    displayPresentRecord.mAccumulatedTimeNs / MilliToNano;
-        } else {
-            stateResidency.totalStateEntryCount = displayPresentRecord.mCount;
-            stateResidency.lastEntryTimestampMs =
-                    displayPresentRecord.mLastTimeStampInBootClockNs / MilliToNano;
-            stateResidency.totalTimeInStateMs =
-                    displayPresentRecord.mAccumulatedTimeNs / MilliToNano;
-            firstIteration.insert(id);
+                    displayPresentRecord.mAccumulatedTimeNs / MilliToNano -
+                    lastRecord.mAccumulatedTimeNs / MilliToNano;
+            mTotalTimeNs += displayPresentRecord.mAccumulatedTimeNs - lastRecord.mAccumulatedTimeNs;
         }
-
-        statistic.second.mUpdated = false;
-        totalTimeNs += displayPresentRecord.mAccumulatedTimeNs;
+        source.mLastRecord = displayPresentRecord;
     }
-    return totalTimeNs;
+    return mTotalTimeNs;
 }
 
 void DisplayStateResidencyProvider::generateUniqueStates() {
@@ -68,6 +68,15 @@ private:
     std::vector<State> mStates;
     std::map<PowerStatsProfile, int> mPowerStatsProfileToIdMap;
 
+    // The state id of each statistic seen so far, and the record last aggregated from it, so that
+    // |mStateResidency| is only updated with deltas. |mStateId| is -1 for unregistered states.
+    typedef struct ResidencySource {
+        int mStateId = -1;
+        DisplayRefreshRecord mLastRecord;
+    } ResidencySource;
+    std::map<DisplayRefreshProfile, ResidencySource> mResidencySources;
+    uint64_t mTotalTimeNs = 0;
+
 #ifdef DEBUG_VRR_POWERSTATS
     int64_t mLastGetStateResidencyTimeNs = -1;
     int64_t mLastPowerStatsTotalTimeNs = -1;
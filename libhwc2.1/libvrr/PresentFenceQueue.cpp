@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentFenceQueue.h"
+
+#include <android-base/logging.h>
+#include <errno.h>
+#include <unistd.h>
+
+namespace android::hardware::graphics::composer {
+
+bool PresentFenceQueue::push(int fence) {
+    mFences.push_back(fence);
+    trim();
+    return scheduleHarvest();
+}
+
+std::deque<int> PresentFenceQueue::take() {
+    std::deque<int> fences;
+    fences.swap(mFences);
+    mHarvestPending = false;
+    return fences;
+}
+
+std::vector<int64_t> PresentFenceQueue::harvest(std::deque<int>& fences,
+                                                const SignalTimeGetter& getSignalTime) {
+    std::vector<int64_t> signalTimes;
+    while (!fences.empty()) {
+        int64_t signalTime = getSignalTime(fences.front());
+        if (signalTime == kSignalTimePending) {
+            break;
+        }
+        closeFence(fences.front());
+        fences.pop_front();
+        if (signalTime != kSignalTimeInvalid) {
+            signalTimes.push_back(signalTime);
+        }
+    }
+    return signalTimes;
+}
+
+bool PresentFenceQueue::requeue(std::deque<int>& fences) {
+    if (fences.empty()) {
+        return false;
+    }
+    mFences.insert(mFences.begin(), fences.begin(), fences.end());
+    fences.clear();
+    trim();
+    return scheduleHarvest();
+}
+
+void PresentFenceQueue::clear() {
+    for (auto fence : mFences) {
+        closeFence(fence);
+    }
+    mFences.clear();
+    mHarvestPending = false;
+}
+
+void PresentFenceQueue::trim() {
+    while (mFences.size() > kMaxFences) {
+        closeFence(mFences.front());
+        mFences.pop_front();
+    }
+}
+
+bool PresentFenceQueue::scheduleHarvest() {
+    if (mHarvestPending) {
+        return false;
+    }
+    mHarvestPending = true;
+    return true;
+}
+
+void PresentFenceQueue::closeFence(int fence) {
+    if (close(fence)) {
+        LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
+    }
+}
+
+} // namespace android::hardware::graphics::composer
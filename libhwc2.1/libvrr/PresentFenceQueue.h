@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace android::hardware::graphics::composer {
+
+// Present fences duplicated on the present path, queued in presentation order until the
+// controller's thread harvests their signal time. The queue owns the fences and closes them.
+// The owner serializes the accesses, |harvest| runs without its lock.
+class PresentFenceQueue {
+public:
+    // Pending fences beyond this depth are dropped, oldest first.
+    static constexpr size_t kMaxFences = 4;
+    static constexpr int64_t kSignalTimePending = INT64_MAX;
+    static constexpr int64_t kSignalTimeInvalid = -1;
+
+    using SignalTimeGetter = std::function<int64_t(int fence)>;
+
+    PresentFenceQueue() = default;
+    ~PresentFenceQueue() { clear(); }
+
+    PresentFenceQueue(const PresentFenceQueue&) = delete;
+    PresentFenceQueue& operator=(const PresentFenceQueue&) = delete;
+
+    // Takes the ownership of |fence|. Returns true if a harvest should be scheduled.
+    bool push(int fence);
+
+    // Takes all queued fences for |harvest|.
+    std::deque<int> take();
+
+    // Closes the signaled fences from the front of |fences| and returns their signal times.
+    // Present fences signal in order, so harvesting stops at the first pending fence.
+    static std::vector<int64_t> harvest(std::deque<int>& fences,
+                                        const SignalTimeGetter& getSignalTime);
+
+    // Puts the fences left by |harvest| back in front of the fences queued meanwhile.
+    // Returns true if a harvest should be scheduled.
+    bool requeue(std::deque<int>& fences);
+
+    // Closes all queued fences. Called whenever the scheduled harvest is dropped.
+    void clear();
+
+    size_t size() const { return mFences.size(); }
+    bool isHarvestPending() const { return mHarvestPending; }
+
+private:
+    void trim();
+    bool scheduleHarvest();
+    static void closeFence(int fence);
+
+    std::deque<int> mFences;
+    bool mHarvestPending = false;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RefreshControlCommandQueue.h"
+
+#include <android-base/logging.h>
+
+namespace android::hardware::graphics::composer {
+
+bool RefreshControlCommandQueue::push(uint32_t command) {
+    bool shouldSchedule = !mPendingCommand.has_value();
+    mPendingCommand = command;
+    return shouldSchedule;
+}
+
+bool RefreshControlCommandQueue::write(uint32_t command) {
+    mPendingCommand = std::nullopt;
+    return mWriter(command);
+}
+
+void RefreshControlCommandQueue::flush() {
+    if (!mPendingCommand) {
+        return;
+    }
+    uint32_t command = mPendingCommand.value();
+    mPendingCommand = std::nullopt;
+    uint32_t lastCommand = 0;
+    if (mGetLastWritten(lastCommand) && (lastCommand == command)) {
+        return;
+    }
+    if (!mWriter(command)) {
+        LOG(WARNING) << "VrrController: write file node error, command = " << command;
+    }
+}
+
+bool RefreshControlCommandQueue::getLastCommand(uint32_t& command) const {
+    if (mPendingCommand) {
+        command = mPendingCommand.value();
+        return true;
+    }
+    return mGetLastWritten(command);
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace android::hardware::graphics::composer {
+
+// Refresh control commands queued by the present path until the controller's thread writes them
+// to the panel. Commands queued before a flush are coalesced into the last one. The owner
+// serializes the accesses.
+class RefreshControlCommandQueue {
+public:
+    // Writes |command| to the node, returns false on failure.
+    using Writer = std::function<bool(uint32_t command)>;
+    // Gets the command last written to the node, returns false if there is none.
+    using LastWrittenGetter = std::function<bool(uint32_t& command)>;
+
+    RefreshControlCommandQueue(Writer writer, LastWrittenGetter getLastWritten)
+          : mWriter(std::move(writer)), mGetLastWritten(std::move(getLastWritten)) {}
+
+    RefreshControlCommandQueue(const RefreshControlCommandQueue&) = delete;
+    RefreshControlCommandQueue& operator=(const RefreshControlCommandQueue&) = delete;
+
+    // Queues |command|, replacing any queued one. Returns true if a flush should be scheduled.
+    bool push(uint32_t command);
+
+    // Writes |command| immediately, superseding any queued command.
+    bool write(uint32_t command);
+
+    // Writes the queued command, unless the node already holds it. Called whenever the scheduled
+    // flush runs or is dropped.
+    void flush();
+
+    // Gets the queued command if any, or else the last written one.
+    bool getLastCommand(uint32_t& command) const;
+
+    bool hasPendingCommand() const { return mPendingCommand.has_value(); }
+
+private:
+    Writer mWriter;
+    LastWrittenGetter mGetLastWritten;
+    std::optional<uint32_t> mPendingCommand;
+};
+
+} // namespace android::hardware::graphics::composer
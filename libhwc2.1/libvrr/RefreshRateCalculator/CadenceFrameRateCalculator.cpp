@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "CadenceFrameRateCalculator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace android::hardware::graphics::composer {
+
+CadenceFrameRateCalculator::CadenceFrameRateCalculator(EventQueue* eventQueue)
+      : CadenceFrameRateCalculator(eventQueue, CadenceFrameRateCalculatorParameters()) {}
+
+CadenceFrameRateCalculator::CadenceFrameRateCalculator(
+        EventQueue* eventQueue, const CadenceFrameRateCalculatorParameters& params)
+      : mEventQueue(eventQueue), mParams(params) {
+    mName = "RefreshRateCalculator-Cadence";
+    mTimeoutEvent.mEventType = VrrControllerEventType::kCadenceFrameRateCalculatorUpdate;
+    mTimeoutEvent.mFunctor =
+            std::move(std::bind(&CadenceFrameRateCalculator::updateRefreshRate, this));
+}
+
+int CadenceFrameRateCalculator::getRefreshRate() const {
+    return mLastRefreshRate;
+}
+
+void CadenceFrameRateCalculator::onPresentInternal(int64_t presentTimeNs, int flag) {
+    if (hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze)) {
+        return;
+    }
+    if (mLastPresentTimeNs != kDefaultInvalidPresentTimeNs) {
+        if (presentTimeNs <= mLastPresentTimeNs) {
+            // Disregard incoming frames that are out of sequence.
+            return;
+        }
+        if (isOutdated(presentTimeNs)) {
+            reset();
+        } else {
+            mIntervals.next() = presentTimeNs - mLastPresentTimeNs;
+            int detectedRefreshRate = detectFrameRate();
+            ATRACE_INT((mName + "-Confidence").c_str(), mConfidencePercentage);
+            ATRACE_INT64((mName + "-JitterNs").c_str(), mJitterNs);
+            // Hysteresis: hold the reported frame rate through detections lacking confidence, or
+            // close enough to it, and only switch to a new one after it has been stable.
+            if ((detectedRefreshRate == kDefaultInvalidRefreshRate) ||
+                (mConfidencePercentage < mParams.mMinConfidencePercentage) ||
+                ((mLastRefreshRate != kDefaultInvalidRefreshRate) &&
+                 isWithinHysteresis(detectedRefreshRate, mLastRefreshRate))) {
+                mCandidateRuns = 0;
+            } else {
+                if ((mCandidateRuns > 0) &&
+                    isWithinHysteresis(detectedRefreshRate, mCandidateRefreshRate)) {
+                    ++mCandidateRuns;
+                } else {
+                    mCandidateRuns = 1;
+                }
+                mCandidateRefreshRate = detectedRefreshRate;
+                // A cadence must repeat as many times, so that drops that happen to line up
+                // into a short-lived pattern are not reported.
+                if (mCandidateRuns >= mParams.mMinStableFrames * std::max(1, mCadenceLength)) {
+                    mCandidateRuns = 0;
+                    setNewRefreshRate(detectedRefreshRate);
+                }
+            }
+        }
+    }
+    mLastPresentTimeNs = presentTimeNs;
+
+    mEventQueue->dropEvent(VrrControllerEventType::kCadenceFrameRateCalculatorUpdate);
+    mTimeoutEvent.mWhenNs = presentTimeNs + mParams.mMaxValidTimeNs;
+    mEventQueue->mPriorityQueue.emplace(mTimeoutEvent);
+}
+
+void CadenceFrameRateCalculator::reset() {
+    mLastPresentTimeNs = kDefaultInvalidPresentTimeNs;
+    mIntervals.clear();
+    mCandidateRefreshRate = kDefaultInvalidRefreshRate;
+    mCandidateRuns = 0;
+    mConfidencePercentage = 0;
+    mJitterNs = 0;
+    mCadenceLength = 0;
+    setNewRefreshRate(kDefaultInvalidRefreshRate);
+}
+
+void CadenceFrameRateCalculator::setEnabled(bool isEnabled) {
+    if (!isEnabled) {
+        mEventQueue->dropEvent(VrrControllerEventType::kCadenceFrameRateCalculatorUpdate);
+    } else {
+        mTimeoutEvent.mWhenNs = getSteadyClockTimeNs() + mParams.mMaxValidTimeNs;
+        mEventQueue->mPriorityQueue.emplace(mTimeoutEvent);
+    }
+}
+
+void CadenceFrameRateCalculator::setVrrConfigAttributes(int64_t vsyncPeriodNs,
+                                                        int64_t minFrameIntervalNs) {
+    RefreshRateCalculator::setVrrConfigAttributes(vsyncPeriodNs, minFrameIntervalNs);
+    // The learned cadence is expressed in vsyncs of the previous config.
+    mIntervals.clear();
+    mCandidateRuns = 0;
+}
+
+int CadenceFrameRateCalculator::detectFrameRate() {
+    const size_t size = mIntervals.size();
+    mCadenceLength = 0;
+    if (size < 2) {
+        mConfidencePercentage = 0;
+        mJitterNs = 0;
+        return kDefaultInvalidRefreshRate;
+    }
+    std::array<int64_t, kMaxNumberOfIntervals> intervals;
+    std::array<int, kMaxNumberOfIntervals> vsyncs;
+    for (size_t i = 0; i < size; ++i) {
+        intervals[i] = mIntervals[i];
+        vsyncs[i] = std::max(1, durationToVsync(intervals[i]));
+    }
+
+    // Search the pattern of vsyncs repeating at least twice over the most of the latest intervals,
+    // favoring the shortest one.
+    size_t numberOfIntervals = 0;
+    for (int length = 1; (length <= kMaxCadenceLength) && (2 * length <= size); ++length) {
+        size_t matched = length;
+        while ((matched < size) &&
+               (vsyncs[size - 1 - (matched - length)] == vsyncs[size - 1 - matched])) {
+            ++matched;
+        }
+        // Only whole patterns are accounted.
+        matched = (matched / length) * length;
+        if ((matched >= 2 * length) && (matched > numberOfIntervals)) {
+            mCadenceLength = length;
+            numberOfIntervals = matched;
+        }
+    }
+
+    // The mean estimate, supported by the whole window.
+    int64_t totalNs = 0;
+    for (size_t i = 0; i < size; ++i) {
+        totalNs += intervals[i];
+    }
+    double meanNs = static_cast<double>(totalNs) / size;
+    double squaredDeviationSum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        double deviationNs = intervals[i] - meanNs;
+        squaredDeviationSum += deviationNs * deviationNs;
+    }
+    int frameRate = std::round(std::nano::den / meanNs);
+    mJitterNs = std::sqrt(squaredDeviationSum / size);
+    // Content without a cadence is allowed a smaller share of jitter than a cadence.
+    mConfidencePercentage = (100 - std::min<int64_t>(100, (200 * mJitterNs) / meanNs)) * size /
+            kMaxNumberOfIntervals;
+
+    if (mCadenceLength > 0) {
+        const size_t first = size - numberOfIntervals;
+        int totalVsyncs = 0;
+        squaredDeviationSum = 0;
+        for (size_t i = first; i < size; ++i) {
+            totalVsyncs += vsyncs[i];
+            double deviationNs = intervals[i] - vsyncs[i] * mVsyncIntervalNs;
+            squaredDeviationSum += deviationNs * deviationNs;
+        }
+        int64_t jitterNs = std::sqrt(squaredDeviationSum / numberOfIntervals);
+        // Intervals are quantized to the nearest vsync, so the jitter stays below half a vsync.
+        int confidencePercentage =
+                (100 - std::min<int64_t>(100, (200 * jitterNs) / mVsyncIntervalNs)) *
+                numberOfIntervals / kMaxNumberOfIntervals;
+        // A cadence is exact, so it wins ties.
+        if (confidencePercentage >= mConfidencePercentage) {
+            frameRate = roundDivide(mVsyncRate * static_cast<int64_t>(numberOfIntervals),
+                                    static_cast<int64_t>(totalVsyncs));
+            mJitterNs = jitterNs;
+            mConfidencePercentage = confidencePercentage;
+        } else {
+            mCadenceLength = 0;
+        }
+    }
+    return std::clamp(frameRate, 1, mMaxFrameRate);
+}
+
+bool CadenceFrameRateCalculator::isWithinHysteresis(int refreshRate,
+                                                    int referenceRefreshRate) const {
+    if (mCadenceLength > 0) {
+        return refreshRate == referenceRefreshRate;
+    }
+    return std::abs(refreshRate - referenceRefreshRate) * 100 <=
+            referenceRefreshRate * mParams.mHysteresisPercentage;
+}
+
+bool CadenceFrameRateCalculator::isOutdated(int64_t timeNs) const {
+    return (mLastPresentTimeNs == kDefaultInvalidPresentTimeNs) ||
+            ((timeNs - mLastPresentTimeNs) > mParams.mMaxValidTimeNs);
+}
+
+void CadenceFrameRateCalculator::setNewRefreshRate(int newRefreshRate) {
+    if (newRefreshRate != mLastRefreshRate) {
+        mLastRefreshRate = newRefreshRate;
+        ATRACE_INT(mName.c_str(), newRefreshRate);
+        if (mRefreshRateChangeCallback) {
+            mRefreshRateChangeCallback(newRefreshRate);
+        }
+    }
+}
+
+int CadenceFrameRateCalculator::updateRefreshRate() {
+    if (isOutdated(getSteadyClockTimeNs())) {
+        reset();
+    }
+    return NO_ERROR;
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "RefreshRateCalculator.h"
+
+#include "../EventQueue.h"
+#include "../RingBuffer.h"
+#include "../Utils.h"
+
+namespace android::hardware::graphics::composer {
+
+struct CadenceFrameRateCalculatorParameters {
+    int64_t mMaxValidTimeNs = 1000000000; // 1 second
+    // A newly detected frame rate is only reported once it has been detected with enough
+    // confidence on this many consecutive frames, or repetitions of its cadence pattern.
+    int mMinStableFrames = 3;
+    int mMinConfidencePercentage = 60;
+    // Without a cadence, the reported frame rate is kept as long as the detected one stays within
+    // this percentage of it. A cadence gives the exact frame rate, so any change of it is real.
+    int mHysteresisPercentage = 5;
+};
+
+// Reports the frame rate of the content together with a confidence score and a jitter estimate.
+//
+// Frame intervals are quantized to vsyncs, and the shortest pattern repeating over the recent
+// intervals is searched for. A repeating pattern is a cadence, such as the 3:2 pulldown of 24 fps
+// content on 60 Hz or a constant interval, and its exact frame rate is the number of frames per
+// vsync of the pattern. Its jitter is the deviation of each interval from its vsync-aligned
+// value. The mean frame rate of the intervals is estimated as well, with the deviation of the
+// intervals from their mean as its jitter. The confidence of both falls with the jitter, twice as
+// fast for the mean estimate, and is scaled by the share of the recent intervals supporting it,
+// so that a change of content gains confidence as its new cadence fills the window. The more
+// confident of the two estimates is the detected frame rate.
+class CadenceFrameRateCalculator : public RefreshRateCalculator {
+public:
+    CadenceFrameRateCalculator(EventQueue* eventQueue);
+
+    CadenceFrameRateCalculator(EventQueue* eventQueue,
+                               const CadenceFrameRateCalculatorParameters& params);
+
+    int getRefreshRate() const override;
+
+    int getConfidencePercentage() const override { return mConfidencePercentage; }
+
+    int64_t getJitterNs() const override { return mJitterNs; }
+
+    // The number of frames in the detected cadence pattern, 0 if there is none.
+    int getCadenceLength() const { return mCadenceLength; }
+
+    void onPresentInternal(int64_t presentTimeNs, int flag) override;
+
+    void reset() override;
+
+    void setEnabled(bool isEnabled) final;
+
+    void setVrrConfigAttributes(int64_t vsyncPeriodNs, int64_t minFrameIntervalNs) final;
+
+private:
+    // The longest cadence pattern searched for, e.g. 5 frames for 25 fps content on 60 Hz.
+    static constexpr int kMaxCadenceLength = 5;
+    // Long enough for the longest pattern to repeat once.
+    static constexpr size_t kMaxNumberOfIntervals = 2 * kMaxCadenceLength;
+
+    CadenceFrameRateCalculator(const CadenceFrameRateCalculator&) = delete;
+    CadenceFrameRateCalculator& operator=(const CadenceFrameRateCalculator&) = delete;
+
+    // Detect the frame rate of the recent intervals, along with its confidence and jitter.
+    int detectFrameRate();
+
+    // Whether |refreshRate| is close enough to |referenceRefreshRate| to be held as it, given the
+    // cadence of the last detection.
+    bool isWithinHysteresis(int refreshRate, int referenceRefreshRate) const;
+
+    bool isOutdated(int64_t timeNs) const;
+
+    void setNewRefreshRate(int newRefreshRate);
+
+    int updateRefreshRate();
+
+    EventQueue* mEventQueue;
+    VrrControllerEvent mTimeoutEvent;
+
+    const CadenceFrameRateCalculatorParameters mParams;
+
+    RingBuffer<int64_t, kMaxNumberOfIntervals> mIntervals;
+
+    int64_t mLastPresentTimeNs = kDefaultInvalidPresentTimeNs;
+    int mLastRefreshRate = kDefaultInvalidRefreshRate;
+
+    int mCandidateRefreshRate = kDefaultInvalidRefreshRate;
+    int mCandidateRuns = 0;
+
+    int mConfidencePercentage = 0;
+    int64_t mJitterNs = 0;
+    int mCadenceLength = 0;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -35,12 +35,23 @@ CombinedRefreshRateCalculator::CombinedRefreshRateCalculator(
       : mRefreshRateCalculators(std::move(refreshRateCalculators)),
         mMinValidRefreshRate(minValidRefreshRate),
         mMaxValidRefreshRate(maxValidRefreshRate) {
-    mName = "RefreshRateCalculator-Combined";
-    for (auto& refreshRateCalculator : mRefreshRateCalculators) {
-        refreshRateCalculator->registerRefreshRateChangeCallback(
-                std::bind(&CombinedRefreshRateCalculator::onRefreshRateChanged, this,
-                          std::placeholders::_1));
-    }
+    registerChildren();
+}
+
+CombinedRefreshRateCalculator::CombinedRefreshRateCalculator(EventQueue* eventQueue,
+                                                             const ChildrenBuilder& buildChildren,
+                                                             int minValidRefreshRate,
+                                                             int maxValidRefreshRate)
+      : mEventQueue(eventQueue),
+        mMinValidRefreshRate(minValidRefreshRate),
+        mMaxValidRefreshRate(maxValidRefreshRate) {
+    // The children may post events while they are built, so the queue has to exist by then.
+    mRefreshRateCalculators = buildChildren(&mChildEventQueue);
+    registerChildren();
+    mChildTimeoutEvent.mEventType = VrrControllerEventType::kCombinedRefreshRateCalculatorUpdate;
+    mChildTimeoutEvent.mFunctor =
+            std::move(std::bind(&CombinedRefreshRateCalculator::onChildTimeout, this));
+    scheduleChildTimeout();
 }
 
 int CombinedRefreshRateCalculator::getRefreshRate() const {
@@ -51,20 +62,22 @@ void CombinedRefreshRateCalculator::onPowerStateChange(int from, int to) {
     for (auto& refreshRateCalculator : mRefreshRateCalculators) {
         refreshRateCalculator->onPowerStateChange(from, to);
     }
+    scheduleChildTimeout();
 }
 
 void CombinedRefreshRateCalculator::onPresentInternal(int64_t presentTimeNs, int flag) {
     mHasRefreshRateChage = false;
 
-    mIsOnPresent = true;
+    mIsEvaluating = true;
     for (auto& refreshRateCalculator : mRefreshRateCalculators) {
         refreshRateCalculator->onPresentInternal(presentTimeNs, flag);
     }
-    mIsOnPresent = false;
+    mIsEvaluating = false;
 
     if (mHasRefreshRateChage) {
         updateRefreshRate();
     }
+    scheduleChildTimeout();
 }
 
 void CombinedRefreshRateCalculator::reset() {
@@ -73,12 +86,14 @@ void CombinedRefreshRateCalculator::reset() {
     }
     setNewRefreshRate(kDefaultInvalidRefreshRate);
     mHasRefreshRateChage = false;
+    scheduleChildTimeout();
 }
 
 void CombinedRefreshRateCalculator::setEnabled(bool isEnabled) {
     for (auto& refreshRateCalculator : mRefreshRateCalculators) {
         refreshRateCalculator->setEnabled(isEnabled);
     }
+    scheduleChildTimeout();
 }
 
 void CombinedRefreshRateCalculator::setVrrConfigAttributes(int64_t vsyncPeriodNs,
@@ -88,16 +103,72 @@ void CombinedRefreshRateCalculator::setVrrConfigAttributes(int64_t vsyncPeriodNs
     for (auto& refreshRateCalculator : mRefreshRateCalculators) {
         refreshRateCalculator->setVrrConfigAttributes(vsyncPeriodNs, minFrameIntervalNs);
     }
+    scheduleChildTimeout();
+}
+
+int CombinedRefreshRateCalculator::onChildTimeout() {
+    mChildTimeoutNs = kNoChildTimeout;
+    mHasRefreshRateChage = false;
+
+    // Run every child event that is due, including those they post meanwhile.
+    mIsEvaluating = true;
+    auto nowNs = getSteadyClockTimeNs();
+    auto& queue = mChildEventQueue.mPriorityQueue;
+    while (!queue.empty() && (queue.top().mWhenNs <= nowNs)) {
+        auto event = queue.top();
+        queue.pop();
+        if (event.mFunctor) {
+            event.mFunctor();
+        }
+    }
+    mIsEvaluating = false;
+
+    if (mHasRefreshRateChage) {
+        updateRefreshRate();
+    }
+    scheduleChildTimeout();
+    return NO_ERROR;
 }
 
 void CombinedRefreshRateCalculator::onRefreshRateChanged(int refreshRate) {
-    if (mIsOnPresent) {
+    if (mIsEvaluating) {
         mHasRefreshRateChage = true;
     } else {
         updateRefreshRate();
     }
 }
 
+void CombinedRefreshRateCalculator::registerChildren() {
+    mName = "RefreshRateCalculator-Combined";
+    for (auto& refreshRateCalculator : mRefreshRateCalculators) {
+        refreshRateCalculator->registerRefreshRateChangeCallback(
+                std::bind(&CombinedRefreshRateCalculator::onRefreshRateChanged, this,
+                          std::placeholders::_1));
+    }
+}
+
+void CombinedRefreshRateCalculator::scheduleChildTimeout() {
+    if (!mEventQueue) {
+        return;
+    }
+    auto& queue = mChildEventQueue.mPriorityQueue;
+    int64_t timeoutNs = queue.empty() ? kNoChildTimeout : queue.top().mWhenNs;
+    // A deadline that has already passed is posted again, as the controller may have dropped
+    // the event along with the rest of its queue.
+    if ((timeoutNs == mChildTimeoutNs) &&
+        ((timeoutNs == kNoChildTimeout) || (timeoutNs > getSteadyClockTimeNs()))) {
+        return;
+    }
+    if (mChildTimeoutNs != kNoChildTimeout) {
+        mEventQueue->dropEvent(VrrControllerEventType::kCombinedRefreshRateCalculatorUpdate);
+    }
+    mChildTimeoutNs = timeoutNs;
+    if (mChildTimeoutNs != kNoChildTimeout) {
+        mChildTimeoutEvent.mWhenNs = mChildTimeoutNs;
+        mEventQueue->mPriorityQueue.emplace(mChildTimeoutEvent);
+    }
+}
+
 void CombinedRefreshRateCalculator::setNewRefreshRate(int newRefreshRate) {
     if (newRefreshRate != mLastRefreshRate) {
         mLastRefreshRate = newRefreshRate;
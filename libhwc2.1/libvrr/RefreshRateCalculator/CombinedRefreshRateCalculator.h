@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "../EventQueue.h"
 #include "RefreshRateCalculator.h"
 
@@ -23,6 +25,9 @@ namespace android::hardware::graphics::composer {
 
 class CombinedRefreshRateCalculator : public RefreshRateCalculator {
 public:
+    using ChildrenBuilder =
+            std::function<std::vector<std::shared_ptr<RefreshRateCalculator>>(EventQueue*)>;
+
     CombinedRefreshRateCalculator(
             std::vector<std::shared_ptr<RefreshRateCalculator>> refreshRateCalculators);
 
@@ -30,6 +35,13 @@ public:
             std::vector<std::shared_ptr<RefreshRateCalculator>> refreshRateCalculators,
             int minValidRefreshRate, int maxValidRefreshRate);
 
+    // Fused evaluation: the children are built by |buildChildren| on a private event queue, and
+    // a single event posted to |eventQueue| runs their timers at the earliest of their deadlines.
+    // Each present and each timeout is evaluated in one pass over the children, whose changes are
+    // reported with a single update of the combined refresh rate.
+    CombinedRefreshRateCalculator(EventQueue* eventQueue, const ChildrenBuilder& buildChildren,
+                                  int minValidRefreshRate, int maxValidRefreshRate);
+
     int getRefreshRate() const override;
 
     void onPowerStateChange(int from, int to) final;
@@ -46,8 +58,15 @@ private:
     static constexpr int kDefaultMinValidRefreshRate = 1;
     static constexpr int kDefaultMaxValidRefreshRate = 120;
 
+    int onChildTimeout();
+
     void onRefreshRateChanged(int refreshRate);
 
+    void registerChildren();
+
+    // Moves the event in |mEventQueue| to the earliest deadline of the children.
+    void scheduleChildTimeout();
+
     void setNewRefreshRate(int newRefreshRate);
 
     void updateRefreshRate();
@@ -57,14 +76,20 @@ private:
 
     std::vector<std::shared_ptr<RefreshRateCalculator>> mRefreshRateCalculators;
 
-    VrrControllerEvent mMeasureEvent;
+    // Only set with fused evaluation.
+    EventQueue* mEventQueue = nullptr;
+    EventQueue mChildEventQueue;
+    VrrControllerEvent mChildTimeoutEvent;
+    static constexpr int64_t kNoChildTimeout = -1;
+    int64_t mChildTimeoutNs = kNoChildTimeout;
 
     int mMinValidRefreshRate;
     int mMaxValidRefreshRate;
 
     int mLastRefreshRate = kDefaultInvalidRefreshRate;
 
-    bool mIsOnPresent = false;
+    // Children changes are collected while evaluating them and reported once.
+    bool mIsEvaluating = false;
     int mHasRefreshRateChage = false;
 };
 
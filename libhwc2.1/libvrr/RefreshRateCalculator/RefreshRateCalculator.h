@@ -38,6 +38,7 @@ enum class RefreshRateCalculatorType : int {
     kPeriodical,
     kVideoPlayback,
     kCombined,
+    kCadence,
     kTotal,
 };
 
@@ -59,6 +60,14 @@ public:
 
     virtual int getRefreshRate() const = 0;
 
+    // The confidence, in percentage, of the last detected refresh rate. Calculators that do not
+    // estimate it are always confident.
+    virtual int getConfidencePercentage() const { return 100; }
+
+    // The jitter of the recent frame intervals around the last detected refresh rate, or 0 when
+    // not estimated.
+    virtual int64_t getJitterNs() const { return 0; }
+
     virtual void onPowerStateChange(int __unused from, int __unused to) override {}
 
     void onPresent(int64_t presentTimeNs, int flag) {
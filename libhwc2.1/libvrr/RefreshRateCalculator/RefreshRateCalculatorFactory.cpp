@@ -42,14 +42,22 @@ std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefres
     return std::make_shared<PeriodRefreshRateCalculator>(eventQueue, params);
 }
 
+// Build CadenceFrameRateCalculator.
+std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefreshRateCalculator(
+        EventQueue* eventQueue, const CadenceFrameRateCalculatorParameters& params) {
+    return std::make_shared<CadenceFrameRateCalculator>(eventQueue, params);
+}
+
 // Build CombinedRefreshRateCalculator.
 std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefreshRateCalculator(
         EventQueue* eventQueue, const std::vector<RefreshRateCalculatorType>& types) {
-    std::vector<std::shared_ptr<RefreshRateCalculator>> refreshRateCalculators;
-    for (const auto& type : types) {
-        refreshRateCalculators.emplace_back(BuildRefreshRateCalculator(eventQueue, type));
-    }
-    return std::make_shared<CombinedRefreshRateCalculator>(std::move(refreshRateCalculators));
+    return BuildRefreshRateCalculator(eventQueue, [this, &types](EventQueue* childEventQueue) {
+        std::vector<std::shared_ptr<RefreshRateCalculator>> refreshRateCalculators;
+        for (const auto& type : types) {
+            refreshRateCalculators.emplace_back(BuildRefreshRateCalculator(childEventQueue, type));
+        }
+        return refreshRateCalculators;
+    });
 }
 
 // Build CombinedRefreshRateCalculator.
@@ -61,6 +69,16 @@ std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefres
                                                            maxValidRefreshRate);
 }
 
+// Build CombinedRefreshRateCalculator with fused evaluation of the children built by
+// |buildChildren|.
+std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefreshRateCalculator(
+        EventQueue* eventQueue, const CombinedRefreshRateCalculator::ChildrenBuilder& buildChildren,
+        int minValidRefreshRate, int maxValidRefreshRate) {
+    return std::make_shared<CombinedRefreshRateCalculator>(eventQueue, buildChildren,
+                                                           minValidRefreshRate,
+                                                           maxValidRefreshRate);
+}
+
 // Build various RefreshRateCalculator with default settings.
 std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefreshRateCalculator(
         EventQueue* eventQueue, RefreshRateCalculatorType type) {
@@ -85,6 +103,9 @@ std::shared_ptr<RefreshRateCalculator> RefreshRateCalculatorFactory::BuildRefres
                                                          RefreshRateCalculatorType::kPeriodical};
             return BuildRefreshRateCalculator(eventQueue, types);
         }
+        case RefreshRateCalculatorType::kCadence: {
+            return std::make_shared<CadenceFrameRateCalculator>(eventQueue);
+        }
         default:
             return nullptr;
     };
@@ -18,6 +18,7 @@
 
 #include "../EventQueue.h"
 #include "AODRefreshRateCalculator.h"
+#include "CadenceFrameRateCalculator.h"
 #include "CombinedRefreshRateCalculator.h"
 #include "ExitIdleRefreshRateCalculator.h"
 #include "InstantRefreshRateCalculator.h"
@@ -51,6 +52,10 @@ public:
     std::shared_ptr<RefreshRateCalculator> BuildRefreshRateCalculator(
             EventQueue* eventQueue, const PeriodRefreshRateCalculatorParameters& params);
 
+    // Build CadenceFrameRateCalculator.
+    std::shared_ptr<RefreshRateCalculator> BuildRefreshRateCalculator(
+            EventQueue* eventQueue, const CadenceFrameRateCalculatorParameters& params);
+
     // Build CombinedRefreshRateCalculator.
     std::shared_ptr<RefreshRateCalculator> BuildRefreshRateCalculator(
             EventQueue* eventQueue, const std::vector<RefreshRateCalculatorType>& types);
@@ -60,6 +65,13 @@ public:
             std::vector<std::shared_ptr<RefreshRateCalculator>> refreshRateCalculators,
             int minValidRefreshRate = 1, int maxValidRefreshRate = 120);
 
+    // Build CombinedRefreshRateCalculator with fused evaluation of the children built by
+    // |buildChildren|.
+    std::shared_ptr<RefreshRateCalculator> BuildRefreshRateCalculator(
+            EventQueue* eventQueue,
+            const CombinedRefreshRateCalculator::ChildrenBuilder& buildChildren,
+            int minValidRefreshRate = 1, int maxValidRefreshRate = 120);
+
     // Build various RefreshRateCalculator with default settings.
     std::shared_ptr<RefreshRateCalculator> BuildRefreshRateCalculator(
             EventQueue* eventQueue, RefreshRateCalculatorType type);
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RefreshRateCalculatorReplayer.h"
+
+#include <time.h>
+#include <limits>
+#include <sstream>
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+// The simulated steady clock seen by the calculator during a replay.
+int64_t sReplayClockNs = 0;
+
+int64_t getReplayClockNs() {
+    return sReplayClockNs;
+}
+
+int64_t getThreadCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * std::nano::den + ts.tv_nsec;
+}
+
+} // namespace
+
+std::string ReplayResult::toString() const {
+    std::ostringstream os;
+    os << "Refresh rate timeline:\n";
+    for (const auto& change : mTimeline) {
+        os << "  " << change.mTimeNs << " ns: " << change.mRefreshRate << "\n";
+    }
+    if (!mDetectionLatencyNs.empty()) {
+        os << "Detection latency:\n";
+        for (size_t i = 0; i < mDetectionLatencyNs.size(); ++i) {
+            os << "  change " << i << ": ";
+            if (mDetectionLatencyNs[i] < 0) {
+                os << "missed\n";
+            } else {
+                os << mDetectionLatencyNs[i] << " ns\n";
+            }
+        }
+    }
+    os << "Presents = " << mNumberOfPresents << ", events = " << mNumberOfEvents << "\n";
+    if (mNumberOfPresents > 0) {
+        os << "CPU time per present = " << (mPresentCpuTimeNs / mNumberOfPresents) << " ns\n";
+    }
+    if (mNumberOfEvents > 0) {
+        os << "CPU time per event = " << (mEventCpuTimeNs / mNumberOfEvents) << " ns\n";
+    }
+    return os.str();
+}
+
+ReplayResult RefreshRateCalculatorReplayer::replay(const std::vector<ReplayFrame>& frames,
+                                                   int64_t tailNs) {
+    ReplayResult result;
+    if (frames.empty()) {
+        return result;
+    }
+
+    mEventQueue.dropEvent();
+    // The calculator is built on the simulated clock, since constructors may already read it.
+    sReplayClockNs = frames.front().mPresentTimeNs;
+    setSteadyClockSource(&getReplayClockNs);
+
+    auto calculator = mBuilder(&mEventQueue);
+    if (!calculator) {
+        setSteadyClockSource(nullptr);
+        return result;
+    }
+    calculator->registerRefreshRateChangeCallback([&result](int refreshRate) {
+        result.mTimeline.push_back({sReplayClockNs, refreshRate});
+    });
+    // Calculators start measuring once the display is powered on.
+    calculator->onPowerStateChange(HWC_POWER_MODE_OFF, HWC_POWER_MODE_NORMAL);
+
+    for (const auto& frame : frames) {
+        runEventsUntil(frame.mPresentTimeNs, result);
+        sReplayClockNs = std::max(sReplayClockNs, frame.mPresentTimeNs);
+        auto startNs = getThreadCpuTimeNs();
+        calculator->onPresent(frame.mPresentTimeNs, frame.mFlag);
+        result.mPresentCpuTimeNs += getThreadCpuTimeNs() - startNs;
+        ++result.mNumberOfPresents;
+    }
+    runEventsUntil(frames.back().mPresentTimeNs + tailNs, result);
+
+    // Drop the calculator's pending events before it goes away, their functors refer to it.
+    mEventQueue.dropEvent();
+    calculator.reset();
+    setSteadyClockSource(nullptr);
+
+    // Match each change of the annotated refresh rate with the first report of the new value.
+    int lastExpectedRefreshRate = kDefaultInvalidRefreshRate;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        int expected = frames[i].mExpectedRefreshRate;
+        if (expected == kDefaultInvalidRefreshRate || expected == lastExpectedRefreshRate) {
+            continue;
+        }
+        lastExpectedRefreshRate = expected;
+        int64_t startNs = frames[i].mPresentTimeNs;
+        int64_t endNs = std::numeric_limits<int64_t>::max();
+        for (size_t j = i + 1; j < frames.size(); ++j) {
+            if (frames[j].mExpectedRefreshRate != kDefaultInvalidRefreshRate &&
+                frames[j].mExpectedRefreshRate != expected) {
+                endNs = frames[j].mPresentTimeNs;
+                break;
+            }
+        }
+        int reported = kDefaultInvalidRefreshRate;
+        int64_t latencyNs = -1;
+        for (const auto& change : result.mTimeline) {
+            if (change.mTimeNs >= endNs) {
+                break;
+            }
+            if (change.mTimeNs < startNs) {
+                reported = change.mRefreshRate;
+                continue;
+            }
+            if (reported == expected) {
+                break;
+            }
+            if (change.mRefreshRate == expected) {
+                latencyNs = change.mTimeNs - startNs;
+                break;
+            }
+        }
+        if (reported == expected) {
+            latencyNs = 0;
+        }
+        result.mDetectionLatencyNs.push_back(latencyNs);
+    }
+    return result;
+}
+
+bool RefreshRateCalculatorReplayer::parseTrace(const std::string& content,
+                                               std::vector<ReplayFrame>& frames) {
+    std::istringstream is(content);
+    std::string line;
+    while (std::getline(is, line)) {
+        auto pos = line.find_first_not_of(" \t\r");
+        if (pos == std::string::npos || line[pos] == '#') {
+            continue;
+        }
+        std::istringstream ls(line);
+        ReplayFrame frame;
+        if (!(ls >> frame.mPresentTimeNs)) {
+            return false;
+        }
+        if (ls >> frame.mFlag) {
+            ls >> frame.mExpectedRefreshRate;
+        }
+        if (!frames.empty() && frame.mPresentTimeNs < frames.back().mPresentTimeNs) {
+            return false;
+        }
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+void RefreshRateCalculatorReplayer::runEventsUntil(int64_t timeNs, ReplayResult& result) {
+    while (!mEventQueue.mPriorityQueue.empty()) {
+        auto event = mEventQueue.mPriorityQueue.top();
+        if (event.mWhenNs > timeNs) {
+            break;
+        }
+        mEventQueue.mPriorityQueue.pop();
+        sReplayClockNs = std::max(sReplayClockNs, event.mWhenNs);
+        if (event.mFunctor) {
+            auto startNs = getThreadCpuTimeNs();
+            event.mFunctor();
+            result.mEventCpuTimeNs += getThreadCpuTimeNs() - startNs;
+            ++result.mNumberOfEvents;
+        }
+    }
+    sReplayClockNs = std::max(sReplayClockNs, timeNs);
+}
+
+} // namespace android::hardware::graphics::composer
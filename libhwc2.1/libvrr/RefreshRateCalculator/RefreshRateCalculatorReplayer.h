@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../EventQueue.h"
+#include "RefreshRateCalculator.h"
+
+namespace android::hardware::graphics::composer {
+
+// A recorded presentation. |mExpectedRefreshRate| is the refresh rate the calculator is expected to
+// report for this frame, or kDefaultInvalidRefreshRate when the trace carries no annotation.
+struct ReplayFrame {
+    int64_t mPresentTimeNs;
+    int mFlag = 0;
+    int mExpectedRefreshRate = kDefaultInvalidRefreshRate;
+};
+
+struct ReplayResult {
+    struct RefreshRateChange {
+        int64_t mTimeNs;
+        int mRefreshRate;
+    };
+
+    // Every refresh rate reported through the change callback, in emission order.
+    std::vector<RefreshRateChange> mTimeline;
+    // For each change of the annotated refresh rate, the time it took the calculator to report it,
+    // or -1 if it never did before the next change.
+    std::vector<int64_t> mDetectionLatencyNs;
+
+    size_t mNumberOfPresents = 0;
+    size_t mNumberOfEvents = 0;
+    // Thread CPU time spent inside the calculator for presents and for its timed events.
+    int64_t mPresentCpuTimeNs = 0;
+    int64_t mEventCpuTimeNs = 0;
+
+    std::string toString() const;
+};
+
+// Replays recorded presents through a refresh rate calculator offline. The calculator's timed
+// events are executed from a private EventQueue against a simulated steady clock, so a replay
+// is deterministic and runs as fast as the calculator allows.
+class RefreshRateCalculatorReplayer {
+public:
+    using Builder = std::function<std::shared_ptr<RefreshRateCalculator>(EventQueue*)>;
+
+    explicit RefreshRateCalculatorReplayer(Builder builder) : mBuilder(std::move(builder)) {}
+
+    RefreshRateCalculatorReplayer(const RefreshRateCalculatorReplayer&) = delete;
+    RefreshRateCalculatorReplayer& operator=(const RefreshRateCalculatorReplayer&) = delete;
+
+    // Replay |frames|, ordered by present time, then keep the clock running for |tailNs| so
+    // timeouts after the last present are observed. Each call starts with a fresh calculator.
+    ReplayResult replay(const std::vector<ReplayFrame>& frames, int64_t tailNs = 0);
+
+    // Parse a trace with one "<present time ns> [flag] [expected refresh rate]" frame per line.
+    // Empty lines and lines starting with '#' are ignored.
+    static bool parseTrace(const std::string& content, std::vector<ReplayFrame>& frames);
+
+private:
+    // Execute every event due up to |timeNs|, advancing the simulated clock to each of them.
+    void runEventsUntil(int64_t timeNs, ReplayResult& result);
+
+    Builder mBuilder;
+    EventQueue mEventQueue;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace android::hardware::graphics::composer {
+
+// Hands snapshots of a |T| from one writer to one reader without either side ever waiting for the
+// other. It keeps three fixed slots: the writer fills its back slot and swaps it with the shared
+// middle one on |publish|, and the reader swaps its front slot with the middle one on |acquire|
+// when a newer snapshot is there. Slots are reused, so a |T| that keeps its storage on assignment
+// stops allocating once every slot has been filled.
+//
+// The writer side (|back| and |publish|) and the reader side (|acquire|) must each be serialized
+// by their callers.
+template <typename T>
+class SnapshotBuffer {
+public:
+    SnapshotBuffer() = default;
+
+    explicit SnapshotBuffer(const T& initial) { mSlots.fill(initial); }
+
+    // The slot the writer fills before publishing it. It holds the snapshot published two calls of
+    // |publish| earlier, or an older one if the reader has not caught up.
+    T& back() { return mSlots[mBack]; }
+
+    // Make the back slot the latest snapshot.
+    void publish() {
+        mBack = mMiddle.exchange(mBack | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Return the latest published snapshot. It stays valid and unchanged until the next call.
+    const T& acquire() {
+        if (mMiddle.load(std::memory_order_relaxed) & kFresh) {
+            mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & kIndexMask;
+        }
+        return mSlots[mFront];
+    }
+
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+private:
+    static constexpr uint32_t kFresh = 1 << 2;
+    static constexpr uint32_t kIndexMask = kFresh - 1;
+
+    std::array<T, 3> mSlots;
+    uint32_t mBack = 0;
+    std::atomic<uint32_t> mMiddle = 1;
+    uint32_t mFront = 2;
+};
+
+} // namespace android::hardware::graphics::composer
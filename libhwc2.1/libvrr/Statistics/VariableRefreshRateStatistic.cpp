@@ -26,10 +26,11 @@ VariableRefreshRateStatistic::VariableRefreshRateStatistic(
         mMaxFrameRate(maxFrameRate),
         mMaxTeFrequency(maxTeFrequency),
         mMinFrameIntervalNs(roundDivide(std::nano::den, static_cast<int64_t>(maxFrameRate))),
-        mTeFrequency(maxFrameRate),
-        mTeIntervalNs(roundDivide(std::nano::den, static_cast<int64_t>(mTeFrequency))),
         mUpdatePeriodNs(updatePeriodNs) {
     mStartStatisticTimeNs = getBootClockTimeNs();
+    mState.mTeFrequency = maxFrameRate;
+    mState.mTeIntervalNs = roundDivide(std::nano::den, static_cast<int64_t>(mState.mTeFrequency));
+    publish();
 
     // For debugging purposes, this will only be triggered when DEBUG_VRR_STATISTICS is defined.
 #ifdef DEBUG_VRR_STATISTICS
@@ -44,20 +45,20 @@ VariableRefreshRateStatistic::VariableRefreshRateStatistic(
     mUpdateEvent.mWhenNs = getSteadyClockTimeNs() + mUpdatePeriodNs;
     mEventQueue->mPriorityQueue.emplace(mUpdateEvent);
 #endif
-    mStatistics[mDisplayRefreshProfile] = DisplayRefreshRecord();
+    mStatistics[mState.mDisplayRefreshProfile] = DisplayRefreshRecord();
 }
 
 uint64_t VariableRefreshRateStatistic::getPowerOffDurationNs() const {
-    if (isPowerModeOffNowLocked()) {
-        const auto& item = mStatistics.find(mDisplayRefreshProfile);
-        if (item == mStatistics.end()) {
-            ALOGE("%s We should have inserted power-off item in constructor.", __func__);
-            return 0;
-        }
-        return mPowerOffDurationNs +
-                (getBootClockTimeNs() - item->second.mLastTimeStampInBootClockNs);
+    std::scoped_lock lock(mMutex);
+    return getPowerOffDurationNs(mSnapshots.acquire().mState);
+}
+
+uint64_t VariableRefreshRateStatistic::getPowerOffDurationNs(const RefreshState& state) {
+    if (isPowerModeOff(state.mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode)) {
+        return state.mPowerOffDurationNs +
+                (getBootClockTimeNs() - state.mPowerOffTimeStampInBootClockNs);
     } else {
-        return mPowerOffDurationNs;
+        return state.mPowerOffDurationNs;
     }
 }
 
@@ -66,43 +67,99 @@ uint64_t VariableRefreshRateStatistic::getStartStatisticTimeNs() const {
 }
 
 DisplayRefreshStatistics VariableRefreshRateStatistic::getStatistics() {
-    updateIdleStats();
     std::scoped_lock lock(mMutex);
-    return mStatistics;
+    return collectStatisticsLocked(false);
 }
 
 DisplayRefreshStatistics VariableRefreshRateStatistic::getUpdatedStatistics() {
-    updateIdleStats();
+    // need all mStatistics to be able to do aggregation and bucketing accurately
     std::scoped_lock lock(mMutex);
-    DisplayRefreshStatistics updatedStatistics;
-    for (auto& it : mStatistics) {
-        if (it.second.mUpdated) {
-            if (it.first.mNumVsync < 0) {
-                it.second.mAccumulatedTimeNs = getPowerOffDurationNs();
-            }
+    return collectStatisticsLocked(false);
+}
+
+DisplayRefreshStatistics VariableRefreshRateStatistic::takeUpdatedStatistics() {
+    std::scoped_lock lock(mMutex);
+    return collectStatisticsLocked(true);
+}
+
+void VariableRefreshRateStatistic::addRecord(DisplayRefreshStatistics& statistics,
+                                             const DisplayRefreshProfile& profile, uint64_t count,
+                                             uint64_t durationNs,
+                                             uint64_t lastTimeStampInBootClockNs) {
+    auto& record = statistics[profile];
+    record.mCount += count;
+    record.mAccumulatedTimeNs += durationNs;
+    record.mLastTimeStampInBootClockNs = lastTimeStampInBootClockNs;
+    record.mUpdated = true;
+    record.mDirty = true;
+}
+
+void VariableRefreshRateStatistic::copyStatistics(const DisplayRefreshStatistics& from,
+                                                  DisplayRefreshStatistics& to) {
+    auto it = to.begin();
+    for (const auto& [profile, record] : from) {
+        if ((it == to.end()) || (profile < it->first)) {
+            it = to.emplace_hint(it, profile, record);
+        } else {
+            it->second = record;
         }
-        // need all mStatistics to be able to do aggregation and bucketing accurately
-        updatedStatistics[it.first] = it.second;
-    }
-    if (isPowerModeOffNowLocked()) {
-        mStatistics[mDisplayRefreshProfile].mUpdated = true;
+        ++it;
     }
+}
 
-    return std::move(updatedStatistics);
+DisplayRefreshStatistics VariableRefreshRateStatistic::collectStatisticsLocked(bool updatedOnly) {
+    const auto& snapshot = mSnapshots.acquire();
+    for (const auto& [profile, record] : snapshot.mStatistics) {
+        auto& current = mStatistics[profile];
+        // The power-off record's time is only maintained on read, see below.
+        bool isSameTime = (profile.mNumVsync < 0) ||
+                (current.mAccumulatedTimeNs == record.mAccumulatedTimeNs);
+        if (isSameTime && (current.mCount == record.mCount) &&
+            (current.mLastTimeStampInBootClockNs == record.mLastTimeStampInBootClockNs)) {
+            continue;
+        }
+        current.mCount = record.mCount;
+        current.mAccumulatedTimeNs = record.mAccumulatedTimeNs;
+        current.mLastTimeStampInBootClockNs = record.mLastTimeStampInBootClockNs;
+        current.mUpdated = true;
+        current.mDirty = true;
+    }
+    RefreshState state = snapshot.mState;
+
+    // The idle time up to now is only reported, not folded into |mStatistics|: the writer
+    // accounts it itself on its next update.
+    DisplayRefreshStatistics idleStatistics;
+    accountIdleTime(state, -1, idleStatistics);
+
+    DisplayRefreshStatistics statistics;
+    for (auto& [profile, record] : mStatistics) {
+        // The power-off time keeps growing while powered off, and is only folded into the record
+        // on read, so that record is always reported.
+        if (profile.mNumVsync < 0) {
+            record.mAccumulatedTimeNs = getPowerOffDurationNs(state);
+        } else if (updatedOnly && !record.mDirty && (idleStatistics.count(profile) == 0)) {
+            continue;
+        }
+        if (updatedOnly) {
+            record.mDirty = false;
+        }
+        statistics.emplace(profile, record);
+    }
+    for (const auto& [profile, record] : idleStatistics) {
+        addRecord(statistics, profile, record.mCount, record.mAccumulatedTimeNs,
+                  record.mLastTimeStampInBootClockNs);
+    }
+    return statistics;
 }
 
 std::string VariableRefreshRateStatistic::dumpStatistics(bool getUpdatedOnly,
                                                          RefreshSource refreshSource,
                                                          const std::string& delimiter) {
     std::string res;
-    updateIdleStats();
     std::scoped_lock lock(mMutex);
-    for (auto& it : mStatistics) {
+    for (auto& it : collectStatisticsLocked(false)) {
         if ((!getUpdatedOnly) || (it.second.mUpdated)) {
             if (it.first.mRefreshSource & refreshSource) {
-                if (it.first.mNumVsync < 0) {
-                    it.second.mAccumulatedTimeNs = getPowerOffDurationNs();
-                }
                 res += "[";
                 res += it.first.toString();
                 res += " , ";
@@ -211,39 +268,34 @@ void VariableRefreshRateStatistic::onPowerStateChange(int from, int to) {
     if (from == to) {
         return;
     }
-    if (mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode != from) {
+    auto& profile = mState.mDisplayRefreshProfile;
+    if (profile.mCurrentDisplayConfig.mPowerMode != from) {
         ALOGE("%s Power mode mismatch between storing state(%d) and actual mode(%d)", __func__,
-              mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode, from);
+              profile.mCurrentDisplayConfig.mPowerMode, from);
     }
-    updateIdleStats();
-    std::scoped_lock lock(mMutex);
+    accountIdleTime(mState, -1, mWriterStatistics);
     if (isPowerModeOff(to)) {
         // Currently the for power stats both |HWC_POWER_MODE_OFF| and |HWC_POWER_MODE_DOZE_SUSPEND|
         // are classified as "off" states in power statistics. Consequently,we assign the value of
         // |HWC_POWER_MODE_OFF| to |mPowerMode| when it is |HWC_POWER_MODE_DOZE_SUSPEND|.
-        mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode = HWC_POWER_MODE_OFF;
+        profile.mCurrentDisplayConfig.mPowerMode = HWC_POWER_MODE_OFF;
 
-        auto& record = mStatistics[mDisplayRefreshProfile];
-        ++record.mCount;
-        record.mLastTimeStampInBootClockNs = getBootClockTimeNs();
-        record.mUpdated = true;
+        mState.mPowerOffTimeStampInBootClockNs = getBootClockTimeNs();
+        addRecord(mWriterStatistics, profile, 1, 0, mState.mPowerOffTimeStampInBootClockNs);
 
-        mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
+        mState.mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
     } else {
         if (isPowerModeOff(from)) {
-            mPowerOffDurationNs +=
-                    (getBootClockTimeNs() -
-                     mStatistics[mDisplayRefreshProfile].mLastTimeStampInBootClockNs);
+            mState.mPowerOffDurationNs +=
+                    (getBootClockTimeNs() - mState.mPowerOffTimeStampInBootClockNs);
         }
-        mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode = to;
+        profile.mCurrentDisplayConfig.mPowerMode = to;
         if (to == HWC_POWER_MODE_DOZE) {
-            mDisplayRefreshProfile.mNumVsync = mTeFrequency;
-            auto& record = mStatistics[mDisplayRefreshProfile];
-            ++record.mCount;
-            record.mLastTimeStampInBootClockNs = getBootClockTimeNs();
-            record.mUpdated = true;
+            profile.mNumVsync = mState.mTeFrequency;
+            addRecord(mWriterStatistics, profile, 1, 0, getBootClockTimeNs());
         }
     }
+    publish();
 }
 
 void VariableRefreshRateStatistic::onPresent(int64_t presentTimeNs, int flag) {
@@ -258,158 +310,158 @@ void VariableRefreshRateStatistic::onNonPresentRefresh(int64_t refreshTimeNs,
 void VariableRefreshRateStatistic::onRefreshInternal(int64_t refreshTimeNs, int flag,
                                                      RefreshSource refreshSource) {
     int64_t presentTimeInBootClockNs = steadyClockTimeToBootClockTimeNs(refreshTimeNs);
-    if (mLastRefreshTimeInBootClockNs == kDefaultInvalidPresentTimeNs) {
-        mLastRefreshTimeInBootClockNs = presentTimeInBootClockNs;
+    auto& profile = mState.mDisplayRefreshProfile;
+    if (mState.mLastRefreshTimeInBootClockNs == kDefaultInvalidPresentTimeNs) {
         updateCurrentDisplayStatus();
+        mState.mLastRefreshTimeInBootClockNs = presentTimeInBootClockNs;
+        publish();
         // Ignore first refresh after resume
         return;
     }
-    updateIdleStats(presentTimeInBootClockNs);
+    accountIdleTime(mState, presentTimeInBootClockNs, mWriterStatistics);
     updateCurrentDisplayStatus();
     if (hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze)) {
         // In low power mode, panel boost to 30 Hz while presenting new frame.
-        mDisplayRefreshProfile.mNumVsync = mTeFrequency / kFrameRateWhenPresentAtLpMode;
-        mLastRefreshTimeInBootClockNs =
+        profile.mNumVsync = mState.mTeFrequency / kFrameRateWhenPresentAtLpMode;
+        mState.mLastRefreshTimeInBootClockNs =
                 presentTimeInBootClockNs + (std::nano::den / kFrameRateWhenPresentAtLpMode);
     } else {
-        int numVsync = roundDivide((presentTimeInBootClockNs - mLastRefreshTimeInBootClockNs),
-                                   mTeIntervalNs);
+        int numVsync =
+                roundDivide((presentTimeInBootClockNs - mState.mLastRefreshTimeInBootClockNs),
+                            mState.mTeIntervalNs);
         // TODO(b/353976456): Implement a scheduler to avoid conflicts between present and
         // non-present refresh. Currently, If a conflict occurs, both present and non-present
         // refresh may request to take effect simultaneously, resulting in a zero duration between
         // them. To address this, we avoid including statistics with zero duration. This issue
         // should be resolved once the scheduler is implemented.
-        if (numVsync == 0) return;
-        numVsync = std::max(1, std::min(mTeFrequency, numVsync));
-        mDisplayRefreshProfile.mNumVsync = numVsync;
-        mLastRefreshTimeInBootClockNs = presentTimeInBootClockNs;
-        mDisplayRefreshProfile.mRefreshSource = refreshSource;
-    }
-    {
-        std::scoped_lock lock(mMutex);
-
-        auto& record = mStatistics[mDisplayRefreshProfile];
-        ++record.mCount;
-        record.mAccumulatedTimeNs += (mTeIntervalNs * mDisplayRefreshProfile.mNumVsync);
-        record.mLastTimeStampInBootClockNs = presentTimeInBootClockNs;
-        record.mUpdated = true;
-        if (hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze)) {
-            // After presenting a frame in AOD, we revert back to 1 Hz operation.
-            mDisplayRefreshProfile.mNumVsync = mTeFrequency;
-            auto& record = mStatistics[mDisplayRefreshProfile];
-            ++record.mCount;
-            record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
-            record.mUpdated = true;
+        if (numVsync == 0) {
+            publish();
+            return;
         }
+        numVsync = std::max(1, std::min(mState.mTeFrequency, numVsync));
+        profile.mNumVsync = numVsync;
+        mState.mLastRefreshTimeInBootClockNs = presentTimeInBootClockNs;
+        profile.mRefreshSource = refreshSource;
     }
+    addRecord(mWriterStatistics, profile, 1, mState.mTeIntervalNs * profile.mNumVsync,
+              presentTimeInBootClockNs);
+    if (hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze)) {
+        // After presenting a frame in AOD, we revert back to 1 Hz operation.
+        profile.mNumVsync = mState.mTeFrequency;
+        addRecord(mWriterStatistics, profile, 1, 0, mState.mLastRefreshTimeInBootClockNs);
+    }
+    publish();
 }
 
 void VariableRefreshRateStatistic::setActiveVrrConfiguration(int activeConfigId, int teFrequency) {
-    updateIdleStats();
-    mDisplayRefreshProfile.mCurrentDisplayConfig.mActiveConfigId = activeConfigId;
-    mDisplayRefreshProfile.mWidth = mDisplayContextProvider->getWidth(activeConfigId);
-    mDisplayRefreshProfile.mHeight = mDisplayContextProvider->getHeight(activeConfigId);
-    mDisplayRefreshProfile.mTeFrequency = mDisplayContextProvider->getTeFrequency(activeConfigId);
-    mTeFrequency = teFrequency;
-    if (mTeFrequency % mMaxFrameRate != 0) {
+    accountIdleTime(mState, -1, mWriterStatistics);
+    auto& profile = mState.mDisplayRefreshProfile;
+    profile.mCurrentDisplayConfig.mActiveConfigId = activeConfigId;
+    profile.mWidth = mDisplayContextProvider->getWidth(activeConfigId);
+    profile.mHeight = mDisplayContextProvider->getHeight(activeConfigId);
+    profile.mTeFrequency = mDisplayContextProvider->getTeFrequency(activeConfigId);
+    mState.mTeFrequency = teFrequency;
+    if (mState.mTeFrequency % mMaxFrameRate != 0) {
         ALOGW("%s TE frequency does not align with the maximum frame rate as a multiplier.",
               __func__);
     }
-    mTeIntervalNs = roundDivide(std::nano::den, static_cast<int64_t>(mTeFrequency));
+    mState.mTeIntervalNs = roundDivide(std::nano::den, static_cast<int64_t>(mState.mTeFrequency));
     // TODO(b/333204544): how can we handle the case if mTeFrequency % mMinimumRefreshRate != 0?
-    if ((mMinimumRefreshRate > 0) && (mTeFrequency % mMinimumRefreshRate != 0)) {
+    if ((mState.mMinimumRefreshRate > 0) &&
+        (mState.mTeFrequency % mState.mMinimumRefreshRate != 0)) {
         ALOGW("%s TE frequency does not align with the lowest frame rate as a multiplier.",
               __func__);
     }
+    publish();
 }
 
 void VariableRefreshRateStatistic::setFixedRefreshRate(uint32_t rate) {
-    if (mMinimumRefreshRate != rate) {
-        updateIdleStats();
-        mMinimumRefreshRate = rate;
-        if (mMinimumRefreshRate > 1) {
-            mMaximumFrameIntervalNs =
-                    roundDivide(std::nano::den, static_cast<int64_t>(mMinimumRefreshRate));
+    if (mState.mMinimumRefreshRate != rate) {
+        accountIdleTime(mState, -1, mWriterStatistics);
+        mState.mMinimumRefreshRate = rate;
+        if (mState.mMinimumRefreshRate > 1) {
+            mState.mMaximumFrameIntervalNs =
+                    roundDivide(std::nano::den, static_cast<int64_t>(mState.mMinimumRefreshRate));
             // TODO(b/333204544): how can we handle the case if mTeFrequency % mMinimumRefreshRate
             // != 0?
-            if (mTeFrequency % mMinimumRefreshRate != 0) {
+            if (mState.mTeFrequency % mState.mMinimumRefreshRate != 0) {
                 ALOGW("%s TE frequency does not align with the lowest frame rate as a multiplier.",
                       __func__);
             }
         } else {
-            mMaximumFrameIntervalNs = kMaxRefreshIntervalNs;
+            mState.mMaximumFrameIntervalNs = kMaxRefreshIntervalNs;
         }
+        publish();
     }
 }
 
-bool VariableRefreshRateStatistic::isPowerModeOffNowLocked() const {
-    return isPowerModeOff(mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode);
+void VariableRefreshRateStatistic::publish() {
+    auto& snapshot = mSnapshots.back();
+    copyStatistics(mWriterStatistics, snapshot.mStatistics);
+    snapshot.mState = mState;
+    mSnapshots.publish();
 }
 
 void VariableRefreshRateStatistic::updateCurrentDisplayStatus() {
-    mDisplayRefreshProfile.mCurrentDisplayConfig.mBrightnessMode =
-            mDisplayContextProvider->getBrightnessMode();
-    if (mDisplayRefreshProfile.mCurrentDisplayConfig.mBrightnessMode ==
-        BrightnessMode::kInvalidBrightnessMode) {
-        mDisplayRefreshProfile.mCurrentDisplayConfig.mBrightnessMode =
-                BrightnessMode::kNormalBrightnessMode;
+    auto& displayConfig = mState.mDisplayRefreshProfile.mCurrentDisplayConfig;
+    displayConfig.mBrightnessMode = mDisplayContextProvider->getBrightnessMode();
+    if (displayConfig.mBrightnessMode == BrightnessMode::kInvalidBrightnessMode) {
+        displayConfig.mBrightnessMode = BrightnessMode::kNormalBrightnessMode;
     }
 }
 
 void VariableRefreshRateStatistic::updateIdleStats(int64_t endTimeStampInBootClockNs) {
-    if (mDisplayRefreshProfile.isOff()) return;
-    if (mLastRefreshTimeInBootClockNs == kDefaultInvalidPresentTimeNs) return;
+    accountIdleTime(mState, endTimeStampInBootClockNs, mWriterStatistics);
+    publish();
+}
+
+void VariableRefreshRateStatistic::accountIdleTime(RefreshState& state,
+                                                   int64_t endTimeStampInBootClockNs,
+                                                   DisplayRefreshStatistics& statistics) {
+    auto& profile = state.mDisplayRefreshProfile;
+    if (profile.isOff()) return;
+    if (state.mLastRefreshTimeInBootClockNs == kDefaultInvalidPresentTimeNs) return;
 
     endTimeStampInBootClockNs =
             endTimeStampInBootClockNs < 0 ? getBootClockTimeNs() : endTimeStampInBootClockNs;
-    auto durationFromLastPresentNs = endTimeStampInBootClockNs - mLastRefreshTimeInBootClockNs;
+    auto durationFromLastPresentNs =
+            endTimeStampInBootClockNs - state.mLastRefreshTimeInBootClockNs;
     durationFromLastPresentNs = durationFromLastPresentNs < 0 ? 0 : durationFromLastPresentNs;
-    if (mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode == HWC_POWER_MODE_DOZE) {
-        mDisplayRefreshProfile.mNumVsync = mTeFrequency;
-
-        std::scoped_lock lock(mMutex);
-
-        auto& record = mStatistics[mDisplayRefreshProfile];
-        record.mAccumulatedTimeNs += durationFromLastPresentNs;
-        record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
-        mLastRefreshTimeInBootClockNs = endTimeStampInBootClockNs;
-        record.mUpdated = true;
+    if (profile.mCurrentDisplayConfig.mPowerMode == HWC_POWER_MODE_DOZE) {
+        profile.mNumVsync = state.mTeFrequency;
+        addRecord(statistics, profile, 0, durationFromLastPresentNs,
+                  state.mLastRefreshTimeInBootClockNs);
+        state.mLastRefreshTimeInBootClockNs = endTimeStampInBootClockNs;
     } else {
-        if ((mMinimumRefreshRate > 1) &&
-            (!isPresentRefresh(mDisplayRefreshProfile.mRefreshSource))) {
+        if ((state.mMinimumRefreshRate > 1) && (!isPresentRefresh(profile.mRefreshSource))) {
             ALOGE("%s We should not have non-present refresh when the minimum refresh rate is set, "
                   "as it should use auto mode.",
                   __func__);
             return;
         }
-        mDisplayRefreshProfile.mRefreshSource = RefreshSource::kRefreshSourceIdlePresent;
+        profile.mRefreshSource = RefreshSource::kRefreshSourceIdlePresent;
 
-        int numVsync = roundDivide(durationFromLastPresentNs, mTeIntervalNs);
-        mDisplayRefreshProfile.mNumVsync =
-                (mMinimumRefreshRate > 1 ? (mTeFrequency / mMinimumRefreshRate) : mTeFrequency);
-        if (numVsync <= mDisplayRefreshProfile.mNumVsync) return;
+        int numVsync = roundDivide(durationFromLastPresentNs, state.mTeIntervalNs);
+        profile.mNumVsync = (state.mMinimumRefreshRate > 1
+                                     ? (state.mTeFrequency / state.mMinimumRefreshRate)
+                                     : state.mTeFrequency);
+        if (numVsync <= profile.mNumVsync) return;
 
         // Ensure that the last vsync should not be included now, since it would be processed for
         // next update or |onPresent|
-        auto count = (numVsync - 1) / mDisplayRefreshProfile.mNumVsync;
-        auto alignedDurationNs = mMaximumFrameIntervalNs * count;
-        {
-            std::scoped_lock lock(mMutex);
-
-            auto& record = mStatistics[mDisplayRefreshProfile];
-            record.mCount += count;
-            record.mAccumulatedTimeNs += alignedDurationNs;
-            mLastRefreshTimeInBootClockNs += alignedDurationNs;
-            record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
-            record.mUpdated = true;
-        }
+        auto count = (numVsync - 1) / profile.mNumVsync;
+        auto alignedDurationNs = state.mMaximumFrameIntervalNs * count;
+        state.mLastRefreshTimeInBootClockNs += alignedDurationNs;
+        addRecord(statistics, profile, count, alignedDurationNs,
+                  state.mLastRefreshTimeInBootClockNs);
     }
 }
 
 #ifdef DEBUG_VRR_STATISTICS
 int VariableRefreshRateStatistic::updateStatistic() {
     updateIdleStats();
-    for (const auto& it : mStatistics) {
+    std::scoped_lock lock(mMutex);
+    for (const auto& it : collectStatisticsLocked(false)) {
         const auto& key = it.first;
         const auto& value = it.second;
         ALOGD("%s: power mode = %d, id = %d, birghtness mode = %d, vsync "
@@ -18,6 +18,7 @@
 
 #include <hardware/hwcomposer2.h>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -25,6 +26,7 @@
 #include "../Power/PowerStatsProfile.h"
 #include "../Power/PowerStatsProfileTokenGenerator.h"
 #include "EventQueue.h"
+#include "SnapshotBuffer.h"
 #include "Utils.h"
 #include "display/common/CommonDisplayContextProvider.h"
 #include "display/common/Constants.h"
@@ -166,6 +168,9 @@ typedef struct DisplayRefreshRecord {
     uint64_t mAccumulatedTimeNs = 0;
     uint64_t mLastTimeStampInBootClockNs = 0;
     bool mUpdated = false;
+    // Set on every update, and cleared once the record is returned by
+    // |StatisticsProvider::takeUpdatedStatistics|.
+    bool mDirty = false;
 } DisplayRefreshRecord;
 
 // |DisplayRefreshStatistics| is a map consisting of key-value pairs for statistics.
@@ -181,6 +186,10 @@ public:
     virtual DisplayRefreshStatistics getStatistics() = 0;
 
     virtual DisplayRefreshStatistics getUpdatedStatistics() = 0;
+
+    // Return only the records updated since the previous call, with their running totals, so that
+    // consumers can aggregate them incrementally.
+    virtual DisplayRefreshStatistics takeUpdatedStatistics() = 0;
 };
 
 class VariableRefreshRateStatistic : public PowerModeListener,
@@ -199,6 +208,8 @@ public:
 
     DisplayRefreshStatistics getUpdatedStatistics() override;
 
+    DisplayRefreshStatistics takeUpdatedStatistics() override;
+
     void onPowerStateChange(int from, int to) final;
 
     void onPresent(int64_t presentTimeNs, int flag) override;
@@ -222,12 +233,54 @@ private:
     static constexpr int64_t kMaxRefreshIntervalNs = std::nano::den;
     static constexpr uint32_t kFrameRateWhenPresentAtLpMode = 30;
 
-    bool isPowerModeOffNowLocked() const;
+    // The refresh state maintained by the writer, i.e. the caller of the refresh and power
+    // notifications. The idle time since the last refresh is derived from it.
+    typedef struct RefreshState {
+        DisplayRefreshProfile mDisplayRefreshProfile;
+        int mTeFrequency;
+        int64_t mTeIntervalNs;
+        int64_t mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
+        uint32_t mMinimumRefreshRate = 1;
+        uint64_t mMaximumFrameIntervalNs = kMaxRefreshIntervalNs; // 1 second.
+        uint64_t mPowerOffDurationNs = 0;
+        uint64_t mPowerOffTimeStampInBootClockNs = 0;
+    } RefreshState;
+
+    // What the writer hands over to the readers: its running totals and its refresh state.
+    typedef struct StatisticsSnapshot {
+        DisplayRefreshStatistics mStatistics;
+        RefreshState mState;
+    } StatisticsSnapshot;
+
+    // Add |count| refreshes and |durationNs| to the record of |profile|, and set its last
+    // timestamp.
+    static void addRecord(DisplayRefreshStatistics& statistics,
+                          const DisplayRefreshProfile& profile, uint64_t count,
+                          uint64_t durationNs, uint64_t lastTimeStampInBootClockNs);
+
+    // Account the idle time of |state| up to |endTimeStampInBootClockNs| (now if negative) into
+    // |statistics|, and advance |state| past it.
+    static void accountIdleTime(RefreshState& state, int64_t endTimeStampInBootClockNs,
+                                DisplayRefreshStatistics& statistics);
+
+    // Overwrite |to| with |from|, whose profiles are a superset of those of |to|. The nodes of |to|
+    // are reused, so only profiles new to |to| are allocated.
+    static void copyStatistics(const DisplayRefreshStatistics& from, DisplayRefreshStatistics& to);
+
+    static uint64_t getPowerOffDurationNs(const RefreshState& state);
+
+    // Fold the latest snapshot published by the writer into |mStatistics|, and return the
+    // statistics extended with the idle time up to now. Only the records updated since the
+    // previous call are returned when |updatedOnly| is set.
+    DisplayRefreshStatistics collectStatisticsLocked(bool updatedOnly);
 
     std::string normalizeString(const std::string& input);
 
     void onRefreshInternal(int64_t refreshTimeNs, int flag, RefreshSource refreshSource);
 
+    // Hand the writer's statistics and refresh state over to the readers.
+    void publish();
+
     void updateCurrentDisplayStatus();
 
     void updateIdleStats(int64_t endTimeStampInBootClockNs = -1);
@@ -245,22 +298,21 @@ private:
     const int mMaxTeFrequency;
     const int64_t mMinFrameIntervalNs;
 
-    int mTeFrequency;
-    int64_t mTeIntervalNs;
-
     const int64_t mUpdatePeriodNs;
 
+    // Only accessed by the writer. |mWriterStatistics| holds running totals, so its nodes are only
+    // allocated the first time a profile is seen.
+    RefreshState mState;
+    DisplayRefreshStatistics mWriterStatistics;
+
+    // The writer never waits for the readers: it publishes a copy of its running totals after each
+    // update, and the readers pick up the latest one under |mMutex|.
+    mutable SnapshotBuffer<StatisticsSnapshot> mSnapshots;
+
     int64_t mLastDumpsysTime = 0;
-    int64_t mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
 
     DisplayRefreshStatistics mStatistics;
     DisplayRefreshStatistics mStatisticsSnapshot;
-    DisplayRefreshProfile mDisplayRefreshProfile;
-
-    uint64_t mPowerOffDurationNs = 0;
-
-    uint32_t mMinimumRefreshRate = 1;
-    uint64_t mMaximumFrameIntervalNs = kMaxRefreshIntervalNs; // 1 second.
 
     uint64_t mStartStatisticTimeNs;
 
@@ -17,6 +17,7 @@
 #include "Utils.h"
 
 #include <hardware/hwcomposer2.h>
+#include <atomic>
 #include <chrono>
 #include "android-base/chrono_utils.h"
 
@@ -24,18 +25,34 @@
 
 namespace android::hardware::graphics::composer {
 
+namespace {
+
+std::atomic<int64_t (*)()> gSteadyClockSource = nullptr;
+
+} // namespace
+
 int64_t getSteadyClockTimeMs() {
+    if (auto clock = gSteadyClockSource.load(std::memory_order_relaxed)) {
+        return clock() / (std::nano::den / std::milli::den);
+    }
     return std::chrono::duration_cast<std::chrono::milliseconds>(
                    std::chrono::steady_clock::now().time_since_epoch())
             .count();
 }
 
 int64_t getSteadyClockTimeNs() {
+    if (auto clock = gSteadyClockSource.load(std::memory_order_relaxed)) {
+        return clock();
+    }
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
                    std::chrono::steady_clock::now().time_since_epoch())
             .count();
 }
 
+void setSteadyClockSource(int64_t (*clock)()) {
+    gSteadyClockSource.store(clock, std::memory_order_relaxed);
+}
+
 int64_t getBootClockTimeMs() {
     return std::chrono::duration_cast<std::chrono::milliseconds>(
                    ::android::base::boot_clock::now().time_since_epoch())
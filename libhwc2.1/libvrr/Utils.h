@@ -96,6 +96,10 @@ T freqToDurationNs(T freq) {
 int64_t getSteadyClockTimeMs();
 int64_t getSteadyClockTimeNs();
 
+// Replace the steady clock read by the functions above with |clock|, e.g. to replay recorded
+// traces against a simulated clock. Passing nullptr restores the system steady clock.
+void setSteadyClockSource(int64_t (*clock)());
+
 int64_t getBootClockTimeMs();
 int64_t getBootClockTimeNs();
 
@@ -19,6 +19,7 @@
 #include "VariableRefreshRateController.h"
 
 #include <android-base/logging.h>
+#include <cutils/properties.h>
 #include <processgroup/sched_policy.h>
 #include <sync/sync.h>
 #include <utils/Trace.h>
@@ -27,9 +28,11 @@
 #include "drmmode.h"
 
 #include <chrono>
+#include <cinttypes>
 #include <tuple>
 
 #include "RefreshRateCalculator/RefreshRateCalculatorFactory.h"
+#include "VariableRefreshRateDispatcher.h"
 #include "display/DisplayContextProviderFactory.h"
 #include "interface/Panel_def.h"
 
@@ -93,6 +96,11 @@ auto VariableRefreshRateController::CreateInstance(ExynosDisplay* display,
     }
     auto controller = std::shared_ptr<VariableRefreshRateController>(
             new VariableRefreshRateController(display, panelName));
+    if (property_get_bool(kSharedDispatcherPropName, false)) {
+        controller->mUseSharedDispatcher = true;
+        VariableRefreshRateDispatcher::getInstance().registerClient(controller.get());
+        return controller;
+    }
     std::thread thread = std::thread(&VariableRefreshRateController::threadBody, controller.get());
     std::string threadName = "VrrCtrl_";
     threadName += display->mIndex == 0 ? "Primary" : "Second";
@@ -107,7 +115,17 @@ auto VariableRefreshRateController::CreateInstance(ExynosDisplay* display,
 
 VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* display,
                                                              const std::string& panelName)
-      : mDisplay(display), mPanelName(panelName), mPendingVendorRenderingTimeoutTasks(this) {
+      : mDisplay(display),
+        mPendingRefreshControlCommands(
+                [this](uint32_t command) {
+                    return mFileNode->writeValue(kRefreshControlNodeName, command);
+                },
+                [this](uint32_t& command) {
+                    return mFileNode->getLastWrittenValue(kRefreshControlNodeName, command) ==
+                            NO_ERROR;
+                }),
+        mPanelName(panelName),
+        mPendingVendorRenderingTimeoutTasks(this) {
     mState = VrrControllerState::kDisable;
     std::string displayFileNodePath = mDisplay->getPanelSysfsPath();
     if (displayFileNodePath.empty()) {
@@ -139,29 +157,33 @@ VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* disp
 
     // Flow to build refresh rate calculator.
     RefreshRateCalculatorFactory refreshRateCalculatorFactory;
-    std::vector<std::shared_ptr<RefreshRateCalculator>> Calculators;
-
-    Calculators.emplace_back(std::move(
-            refreshRateCalculatorFactory
-                    .BuildRefreshRateCalculator(&mEventQueue, RefreshRateCalculatorType::kAod)));
-    Calculators.emplace_back(
-            std::move(refreshRateCalculatorFactory
-                              .BuildRefreshRateCalculator(&mEventQueue,
-                                                          RefreshRateCalculatorType::kExitIdle)));
-    // videoFrameRateCalculator will be shared with display context provider.
-    auto videoFrameRateCalculator =
-            refreshRateCalculatorFactory
-                    .BuildRefreshRateCalculator(&mEventQueue,
-                                                RefreshRateCalculatorType::kVideoPlayback);
-    Calculators.emplace_back(videoFrameRateCalculator);
-
-    PeriodRefreshRateCalculatorParameters peridParams;
-    peridParams.mConfidencePercentage = 0;
-    Calculators.emplace_back(std::move(
-            refreshRateCalculatorFactory.BuildRefreshRateCalculator(&mEventQueue, peridParams)));
+    std::shared_ptr<RefreshRateCalculator> videoFrameRateCalculator;
+    auto buildCalculators = [&](EventQueue* eventQueue) {
+        std::vector<std::shared_ptr<RefreshRateCalculator>> Calculators;
+
+        Calculators.emplace_back(std::move(
+                refreshRateCalculatorFactory
+                        .BuildRefreshRateCalculator(eventQueue, RefreshRateCalculatorType::kAod)));
+        Calculators.emplace_back(std::move(
+                refreshRateCalculatorFactory
+                        .BuildRefreshRateCalculator(eventQueue,
+                                                    RefreshRateCalculatorType::kExitIdle)));
+        // videoFrameRateCalculator will be shared with display context provider.
+        videoFrameRateCalculator =
+                refreshRateCalculatorFactory
+                        .BuildRefreshRateCalculator(eventQueue,
+                                                    RefreshRateCalculatorType::kVideoPlayback);
+        Calculators.emplace_back(videoFrameRateCalculator);
+
+        PeriodRefreshRateCalculatorParameters peridParams;
+        peridParams.mConfidencePercentage = 0;
+        Calculators.emplace_back(std::move(
+                refreshRateCalculatorFactory.BuildRefreshRateCalculator(eventQueue, peridParams)));
+        return Calculators;
+    };
 
     mRefreshRateCalculator =
-            refreshRateCalculatorFactory.BuildRefreshRateCalculator(std::move(Calculators));
+            refreshRateCalculatorFactory.BuildRefreshRateCalculator(&mEventQueue, buildCalculators);
     mRefreshRateCalculator->registerRefreshRateChangeCallback(
             std::bind(&VariableRefreshRateController::onRefreshRateChanged, this,
                       std::placeholders::_1));
@@ -172,7 +194,7 @@ VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* disp
         mFrameRateReporter =
                 refreshRateCalculatorFactory
                         .BuildRefreshRateCalculator(&mEventQueue,
-                                                    RefreshRateCalculatorType::kInstant);
+                                                    RefreshRateCalculatorType::kCadence);
         mFrameRateReporter->registerRefreshRateChangeCallback(
                 std::bind(&VariableRefreshRateController::onFrameRateChangedForDBI, this,
                           std::placeholders::_1));
@@ -204,14 +226,6 @@ VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* disp
 
 VariableRefreshRateController::~VariableRefreshRateController() {
     stopThread(true);
-
-    const std::lock_guard<std::mutex> lock(mMutex);
-    if (mLastPresentFence.has_value()) {
-        if (close(mLastPresentFence.value())) {
-            LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
-        }
-        mLastPresentFence = std::nullopt;
-    }
 };
 
 int VariableRefreshRateController::notifyExpectedPresent(int64_t timestamp,
@@ -241,7 +255,7 @@ int VariableRefreshRateController::notifyExpectedPresent(int64_t timestamp,
         }
     }
 
-    mCondition.notify_all();
+    notifyEventLoop();
     return 0;
 }
 
@@ -249,15 +263,10 @@ void VariableRefreshRateController::reset() {
     ATRACE_CALL();
 
     const std::lock_guard<std::mutex> lock(mMutex);
-    mEventQueue.mPriorityQueue = std::priority_queue<VrrControllerEvent>();
+    mEventQueue.mPriorityQueue = EventQueue::PriorityQueue();
     mRecord.clear();
+    mPresentTimeoutPolicy.reset();
     dropEventLocked();
-    if (mLastPresentFence.has_value()) {
-        if (close(mLastPresentFence.value())) {
-            LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
-        }
-        mLastPresentFence = std::nullopt;
-    }
 }
 
 void VariableRefreshRateController::setActiveVrrConfiguration(hwc2_config_t config) {
@@ -286,7 +295,7 @@ void VariableRefreshRateController::setActiveVrrConfiguration(hwc2_config_t conf
                 auto newMaxFrameRate = durationNsToFreq(mVrrConfigs[config].minFrameIntervalNs);
                 setBitField(command, newMaxFrameRate, kPanelRefreshCtrlMinimumRefreshRateOffset,
                             kPanelRefreshCtrlMinimumRefreshRateMask);
-                if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
+                if (!writeRefreshControlCommandLocked(command)) {
                     LOG(WARNING) << "VrrController: write file node error, command = " << command;
                 }
                 onRefreshRateChangedInternal(newMaxFrameRate);
@@ -328,7 +337,7 @@ void VariableRefreshRateController::setActiveVrrConfiguration(hwc2_config_t conf
                                              mVrrConfigs[mVrrActiveConfig].minFrameIntervalNs);
         }
     }
-    mCondition.notify_all();
+    notifyEventLoop();
 }
 
 void VariableRefreshRateController::setEnable(bool isEnabled) {
@@ -343,7 +352,7 @@ void VariableRefreshRateController::setEnable(bool isEnabled) {
             dropEventLocked();
         }
     }
-    mCondition.notify_all();
+    notifyEventLoop();
 }
 
 void VariableRefreshRateController::preSetPowerMode(int32_t powerMode) {
@@ -360,7 +369,7 @@ void VariableRefreshRateController::preSetPowerMode(int32_t powerMode) {
                 uint32_t command = getCurrentRefreshControlStateLocked();
                 setBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
                 mPresentTimeoutController = PresentTimeoutControllerType::kHardware;
-                if (!mFileNode->writeValue(kRefreshControlNodeName, command)) {
+                if (!writeRefreshControlCommandLocked(command)) {
                     LOG(ERROR) << "VrrController: write file node error, command = " << command;
                 }
                 cancelPresentTimeoutHandlingLocked();
@@ -428,7 +437,7 @@ void VariableRefreshRateController::postSetPowerMode(int32_t powerMode) {
         }
         mPowerMode = powerMode;
     }
-    mCondition.notify_all();
+    notifyEventLoop();
 }
 
 void VariableRefreshRateController::setVrrConfigurations(
@@ -451,6 +460,7 @@ void VariableRefreshRateController::setVrrConfigurations(
     const std::lock_guard<std::mutex> lock(mMutex);
     mVrrConfigs = std::move(configs);
     mValidRefreshRates = std::move(validRefreshRates);
+    mVendorRenderingTimeoutSchedules.clear();
 }
 
 int VariableRefreshRateController::getAmbientLightSensorOutput() const {
@@ -499,6 +509,7 @@ void VariableRefreshRateController::setPresentTimeoutParameters(
     } else {
         mVendorPresentTimeoutOverride = std::nullopt;
     }
+    mVendorRenderingTimeoutSchedules.clear();
 }
 
 void VariableRefreshRateController::setPresentTimeoutController(uint32_t controllerType) {
@@ -534,7 +545,7 @@ void VariableRefreshRateController::setPresentTimeoutController(uint32_t control
         } else {
             clearBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
         }
-        if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
+        if (!writeRefreshControlCommandLocked(command)) {
             LOG(ERROR) << "VrrController: write file node error, command = " << command;
         }
     }
@@ -610,11 +621,12 @@ int VariableRefreshRateController::setFixedRefreshRateRange(
                                 kPanelRefreshCtrlMinimumRefreshRateOffset,
                                 kPanelRefreshCtrlMinimumRefreshRateMask);
                     onRefreshRateChangedInternal(mMinimumRefreshRate);
-                    return mFileNode->writeValue(composer::kRefreshControlNodeName, command);
+                    queueRefreshControlCommandLocked(command);
+                    return 1;
                 }
             };
         }
-        if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
+        if (!writeRefreshControlCommandLocked(command)) {
             return -1;
         }
         mPresentTimeoutController = PresentTimeoutControllerType::kHardware;
@@ -630,7 +642,7 @@ int VariableRefreshRateController::setFixedRefreshRateRange(
             setBitField(command, 1, kPanelRefreshCtrlMinimumRefreshRateOffset,
                         kPanelRefreshCtrlMinimumRefreshRateMask);
             // Inform Statistics about the minimum refresh rate change.
-            if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
+            if (!writeRefreshControlCommandLocked(command)) {
                 return -1;
             }
         }
@@ -647,6 +659,14 @@ int VariableRefreshRateController::setFixedRefreshRateRange(
     return 1;
 }
 
+void VariableRefreshRateController::notifyEventLoop() {
+    if (mUseSharedDispatcher) {
+        VariableRefreshRateDispatcher::getInstance().notify();
+    } else {
+        mCondition.notify_all();
+    }
+}
+
 void VariableRefreshRateController::stopThread(bool exit) {
     ATRACE_CALL();
     {
@@ -655,7 +675,11 @@ void VariableRefreshRateController::stopThread(bool exit) {
         mEnabled = false;
         mState = VrrControllerState::kDisable;
     }
-    mCondition.notify_all();
+    if (mUseSharedDispatcher && exit) {
+        VariableRefreshRateDispatcher::getInstance().unregisterClient(this);
+        return;
+    }
+    notifyEventLoop();
 }
 
 void VariableRefreshRateController::onPresent(int fence) {
@@ -692,6 +716,12 @@ void VariableRefreshRateController::onPresent(int fence) {
             mState = VrrControllerState::kRendering;
             dropEventLocked(VrrControllerEventType::kHibernateTimeout);
         }
+        if (mRecord.mPresentHistory.size() > 1) {
+            const auto& history = mRecord.mPresentHistory;
+            mPresentTimeoutPolicy.onPresentInterval(history[history.size() - 1].mTime -
+                                                            history[history.size() - 2].mTime,
+                                                    getSystemPresentTimeoutNsLocked());
+        }
 
         if ((mMaximumRefreshRateTimeoutNs > 0) && (mMinimumRefreshRate > 1)) {
             auto maxFrameRate = durationNsToFreq(mVrrConfigs[mVrrActiveConfig].minFrameIntervalNs);
@@ -711,11 +741,7 @@ void VariableRefreshRateController::onPresent(int fence) {
                     // Configure panel to maintain the minimum refresh rate.
                     setBitField(command, maxFrameRate, kPanelRefreshCtrlMinimumRefreshRateOffset,
                                 kPanelRefreshCtrlMinimumRefreshRateMask);
-                    if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
-                        LOG(WARNING)
-                                << "VrrController: write file node error, command = " << command;
-                        return;
-                    }
+                    queueRefreshControlCommandLocked(command);
                     mMinimumRefreshRatePresentStates = kAtMaximumRefreshRate;
                     onRefreshRateChangedInternal(maxFrameRate);
                     mMinimumRefreshRateTimeoutEvent->mIsRelativeTime = false;
@@ -744,11 +770,8 @@ void VariableRefreshRateController::onPresent(int fence) {
         }
     }
 
-    // Prior to pushing the most recent fence update, verify the release timestamps of all preceding
-    // fences.
-    // TODO(b/309873055): delegate the task of executing updateVsyncHistory to the Vrr controller's
-    // loop thread in order to reduce the workload of calling thread.
-    updateVsyncHistory();
+    // Only queue the fence here, its release timestamp is harvested by the Vrr controller's loop
+    // thread to keep the present path free of fence queries.
     int dupFence = dup(fence);
     if (dupFence < 0) {
         LOG(ERROR) << "VrrController: duplicate fence file failed." << errno;
@@ -756,20 +779,18 @@ void VariableRefreshRateController::onPresent(int fence) {
 
     {
         const std::lock_guard<std::mutex> lock(mMutex);
-        if (mLastPresentFence.has_value()) {
-            LOG(WARNING) << "VrrController: last present fence remains open.";
+        if ((dupFence >= 0) && mPendingPresentFences.push(dupFence)) {
+            // The fence cannot signal before the expected present time, a harvest posted right
+            // away would only find it pending and wake up again to retry.
+            postEvent(VrrControllerEventType::kPresentFenceUpdate,
+                      mRecord.mPendingCurrentPresentTime.value().mTime +
+                              mVrrConfigs[mVrrActiveConfig].vsyncPeriodNs);
         }
-        mLastPresentFence = dupFence;
         // Post next rendering timeout.
-        int64_t timeoutNs;
-        if (mVrrConfigs[mVrrActiveConfig].isFullySupported) {
-            timeoutNs = getSteadyClockTimeNs() +
-                    mVrrConfigs[mVrrActiveConfig].notifyExpectedPresentConfig->TimeoutNs;
-        } else {
-            timeoutNs = kDefaultSystemPresentTimeoutNs;
-        }
         postEvent(VrrControllerEventType::kSystemRenderingTimeout,
-                  getSteadyClockTimeNs() + timeoutNs);
+                  getSteadyClockTimeNs() +
+                          mPresentTimeoutPolicy.getHibernateTimeoutNs(
+                                  getSystemPresentTimeoutNsLocked()));
         if (shouldHandleVendorRenderingTimeout()) {
             // Post next frame insertion event.
             int64_t firstTimeOutNs;
@@ -791,7 +812,7 @@ void VariableRefreshRateController::onPresent(int fence) {
         }
         mRecord.mPendingCurrentPresentTime = std::nullopt;
     }
-    mCondition.notify_all();
+    notifyEventLoop();
 }
 
 void VariableRefreshRateController::setExpectedPresentTime(int64_t timestampNanos,
@@ -821,12 +842,21 @@ void VariableRefreshRateController::cancelPresentTimeoutHandlingLocked() {
 }
 
 void VariableRefreshRateController::dropEventLocked() {
-    mEventQueue.mPriorityQueue = std::priority_queue<VrrControllerEvent>();
+    mEventQueue.mPriorityQueue = EventQueue::PriorityQueue();
+    // Nothing would harvest the queued fences or write the queued command anymore.
+    mPendingPresentFences.clear();
+    mPendingRefreshControlCommands.flush();
 }
 
 void VariableRefreshRateController::dropEventLocked(VrrControllerEventType eventType) {
-    std::priority_queue<VrrControllerEvent> q;
+    EventQueue::PriorityQueue q;
     auto target = static_cast<int>(eventType);
+    if ((static_cast<int>(VrrControllerEventType::kPresentFenceUpdate) & target) == target) {
+        mPendingPresentFences.clear();
+    }
+    if ((static_cast<int>(VrrControllerEventType::kRefreshControlUpdate) & target) == target) {
+        mPendingRefreshControlCommands.flush();
+    }
     while (!mEventQueue.mPriorityQueue.empty()) {
         const auto& it = mEventQueue.mPriorityQueue.top();
         if ((static_cast<int>(it.mEventType) & target) != target) {
@@ -843,7 +873,7 @@ std::string VariableRefreshRateController::dumpEventQueueLocked() {
         return content;
     }
 
-    std::priority_queue<VrrControllerEvent> q;
+    EventQueue::PriorityQueue q;
     while (!mEventQueue.mPriorityQueue.empty()) {
         const auto& it = mEventQueue.mPriorityQueue.top();
         content += "VrrController: event = ";
@@ -857,15 +887,42 @@ std::string VariableRefreshRateController::dumpEventQueueLocked() {
 }
 
 void VariableRefreshRateController::dump(String8& result, const std::vector<std::string>& args) {
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        result.appendFormat("\nFrame rate: %u fps, confidence = %d%%, jitter = %" PRId64 " ns\n",
+                            mFrameRate, mFrameRateConfidencePercentage, mFrameRateJitterNs);
+    }
     result.appendFormat("\nVariableRefreshRateStatistic: \n");
     mVariableRefreshRateStatistic->dump(result, args);
 }
 
 uint32_t VariableRefreshRateController::getCurrentRefreshControlStateLocked() const {
     uint32_t state = 0;
-    return (mFileNode->getLastWrittenValue(kRefreshControlNodeName, state) == NO_ERROR)
-            ? (state & kPanelRefreshCtrlStateBitsMask)
-            : 0;
+    return getLastRefreshControlCommandLocked(state) ? (state & kPanelRefreshCtrlStateBitsMask)
+                                                     : 0;
+}
+
+bool VariableRefreshRateController::getLastRefreshControlCommandLocked(uint32_t& command) const {
+    return mPendingRefreshControlCommands.getLastCommand(command);
+}
+
+void VariableRefreshRateController::queueRefreshControlCommandLocked(uint32_t command) {
+    if (mPendingRefreshControlCommands.push(command)) {
+        postEvent(VrrControllerEventType::kRefreshControlUpdate, getSteadyClockTimeNs());
+    }
+}
+
+bool VariableRefreshRateController::writeRefreshControlCommandLocked(uint32_t command) {
+    bool hasPendingCommand = mPendingRefreshControlCommands.hasPendingCommand();
+    bool isWritten = mPendingRefreshControlCommands.write(command);
+    if (hasPendingCommand) {
+        dropEventLocked(VrrControllerEventType::kRefreshControlUpdate);
+    }
+    return isWritten;
+}
+
+void VariableRefreshRateController::flushRefreshControlCommandLocked() {
+    mPendingRefreshControlCommands.flush();
 }
 
 int64_t VariableRefreshRateController::getLastFenceSignalTimeUnlocked(int fd) {
@@ -909,6 +966,12 @@ int64_t VariableRefreshRateController::getNextEventTimeLocked() const {
     return event.mWhenNs;
 }
 
+int64_t VariableRefreshRateController::getSystemPresentTimeoutNsLocked() {
+    const auto& vrrConfig = mVrrConfigs[mVrrActiveConfig];
+    return vrrConfig.isFullySupported ? vrrConfig.notifyExpectedPresentConfig->TimeoutNs
+                                      : kDefaultSystemPresentTimeoutNs;
+}
+
 std::string VariableRefreshRateController::getStateName(VrrControllerState state) const {
     switch (state) {
         case VrrControllerState::kDisable:
@@ -976,11 +1039,11 @@ void VariableRefreshRateController::handlePresentTimeout() {
         LOG(WARNING) << "VrrController: incorrect type of default present timeout controller.";
     }
     uint32_t command = 0;
-    if (mFileNode->getLastWrittenValue(composer::kRefreshControlNodeName, command) == NO_ERROR) {
+    if (getLastRefreshControlCommandLocked(command)) {
         clearBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
         setBitField(command, 1, kPanelRefreshCtrlFrameInsertionFrameCountOffset,
                     kPanelRefreshCtrlFrameInsertionFrameCountMask);
-        mFileNode->writeValue(composer::kRefreshControlNodeName, command);
+        writeRefreshControlCommandLocked(command);
         if (mPresentTimeoutController != PresentTimeoutControllerType::kSoftware) {
             mPresentTimeoutController = PresentTimeoutControllerType::kSoftware;
         }
@@ -1005,6 +1068,8 @@ void VariableRefreshRateController::onFrameRateChangedForDBI(int refreshRate) {
     auto maxFrameRate = durationNsToFreq(mVrrConfigs[mVrrActiveConfig].minFrameIntervalNs);
     refreshRate = std::max(1, refreshRate);
     mFrameRate = std::min(maxFrameRate, refreshRate);
+    mFrameRateConfidencePercentage = mFrameRateReporter->getConfidencePercentage();
+    mFrameRateJitterNs = mFrameRateReporter->getJitterNs();
     postEvent(VrrControllerEventType::kUpdateDbiFrameRate, getSteadyClockTimeNs());
 }
 
@@ -1085,6 +1150,35 @@ bool VariableRefreshRateController::shouldHandleVendorRenderingTimeout() const {
             (mPowerMode == HWC_POWER_MODE_NORMAL);
 }
 
+std::shared_ptr<const VariableRefreshRateController::VendorRenderingTimeoutSchedule>
+VariableRefreshRateController::getVendorRenderingTimeoutScheduleLocked() {
+    auto& schedule = mVendorRenderingTimeoutSchedules[mVrrActiveConfig];
+    if (schedule) {
+        return schedule;
+    }
+    auto newSchedule = std::make_shared<VendorRenderingTimeoutSchedule>();
+    // Verify whether a present timeout override exists, and if so, execute it first.
+    if (mVendorPresentTimeoutOverride) {
+        const auto& params = mVendorPresentTimeoutOverride.value();
+        int64_t whenFromNowNs = 0;
+        for (int i = 0; i < params.mSchedule.size(); ++i) {
+            uint32_t intervalNs = params.mSchedule[i].second;
+            for (int j = 0; j < params.mSchedule[i].first; ++j) {
+                newSchedule->push_back(whenFromNowNs);
+                whenFromNowNs += intervalNs;
+            }
+        }
+    } else {
+        auto handleEvents = mPresentTimeoutEventHandler->getHandleEvents();
+        newSchedule->reserve(handleEvents.size());
+        for (int i = 0; i < handleEvents.size(); ++i) {
+            newSchedule->push_back(handleEvents[i].mWhenNs);
+        }
+    }
+    schedule = std::move(newSchedule);
+    return schedule;
+}
+
 void VariableRefreshRateController::threadBody() {
     struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO)};
     if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
@@ -1092,8 +1186,6 @@ void VariableRefreshRateController::threadBody() {
         return;
     }
     for (;;) {
-        bool stateChanged = false;
-        uint32_t frameRate = 0;
         {
             std::unique_lock<std::mutex> lock(mMutex);
             if (mThreadExit) break;
@@ -1112,136 +1204,148 @@ void VariableRefreshRateController::threadBody() {
                     continue;
                 }
             }
+        }
+        dispatchEvents(getSteadyClockTimeNs());
+    }
+}
 
-            if (mEventQueue.mPriorityQueue.empty()) {
-                continue;
-            }
+int64_t VariableRefreshRateController::getNextEventTimeNs() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    if (mThreadExit || !mEnabled || mEventQueue.mPriorityQueue.empty()) {
+        return -1;
+    }
+    return getNextEventTimeLocked();
+}
 
-            auto event = mEventQueue.mPriorityQueue.top();
-            if (event.mWhenNs > getSteadyClockTimeNs()) {
-                continue;
-            }
-            mEventQueue.mPriorityQueue.pop();
-            if (static_cast<int>(event.mEventType) &
-                static_cast<int>(VrrControllerEventType::kCallbackEventMask)) {
-                handleCallbackEventLocked(event);
-                continue;
-            }
-            if (event.mEventType == VrrControllerEventType::kUpdateDbiFrameRate) {
-                frameRate = mFrameRate;
+int64_t VariableRefreshRateController::getLatestEventTimeNs(int64_t untilNs) {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    if (mThreadExit || !mEnabled) {
+        return -1;
+    }
+    return mEventQueue.getLatestEventTimeNs(untilNs);
+}
+
+void VariableRefreshRateController::dispatchEvents(int64_t deadlineNs) {
+    while (dispatchNextEvent(deadlineNs)) {
+    }
+}
+
+bool VariableRefreshRateController::dispatchNextEvent(int64_t deadlineNs) {
+    bool stateChanged = false;
+    bool presentFenceUpdate = false;
+    uint32_t frameRate = 0;
+    int frameRateConfidencePercentage = 0;
+    int64_t frameRateJitterNs = 0;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mThreadExit || !mEnabled || mEventQueue.mPriorityQueue.empty()) {
+            return false;
+        }
+
+        auto event = mEventQueue.mPriorityQueue.top();
+        if (event.mWhenNs > deadlineNs) {
+            return false;
+        }
+        mEventQueue.mPriorityQueue.pop();
+        if (static_cast<int>(event.mEventType) &
+            static_cast<int>(VrrControllerEventType::kCallbackEventMask)) {
+            handleCallbackEventLocked(event);
+            return true;
+        }
+        if (event.mEventType == VrrControllerEventType::kUpdateDbiFrameRate) {
+            frameRate = mFrameRate;
+            frameRateConfidencePercentage = mFrameRateConfidencePercentage;
+            frameRateJitterNs = mFrameRateJitterNs;
+        }
+        if (event.mEventType == VrrControllerEventType::kPresentFenceUpdate) {
+            presentFenceUpdate = true;
+        }
+        if (event.mEventType == VrrControllerEventType::kRefreshControlUpdate) {
+            flushRefreshControlCommandLocked();
+        }
+        if (mState == VrrControllerState::kRendering) {
+            if (event.mEventType == VrrControllerEventType::kHibernateTimeout) {
+                LOG(ERROR) << "VrrController: receiving a hibernate timeout event while in the "
+                              "rendering state.";
             }
-            if (mState == VrrControllerState::kRendering) {
-                if (event.mEventType == VrrControllerEventType::kHibernateTimeout) {
-                    LOG(ERROR) << "VrrController: receiving a hibernate timeout event while in the "
-                                  "rendering state.";
+            switch (event.mEventType) {
+                case VrrControllerEventType::kSystemRenderingTimeout: {
+                    handleHibernate();
+                    mState = VrrControllerState::kHibernate;
+                    stateChanged = true;
+                    break;
                 }
-                switch (event.mEventType) {
-                    case VrrControllerEventType::kSystemRenderingTimeout: {
-                        handleHibernate();
-                        mState = VrrControllerState::kHibernate;
-                        stateChanged = true;
-                        break;
-                    }
-                    case VrrControllerEventType::kNotifyExpectedPresentConfig: {
-                        handleCadenceChange();
-                        break;
-                    }
-                    case VrrControllerEventType::kVendorRenderingTimeoutInit: {
-                        if (mPresentTimeoutEventHandler) {
-                            size_t numberOfIntervals = 0;
-                            // Verify whether a present timeout override exists, and if so, execute
-                            // it first.
-                            if (mVendorPresentTimeoutOverride) {
-                                const auto& params = mVendorPresentTimeoutOverride.value();
-                                int64_t whenFromNowNs = 0;
-                                for (int i = 0; i < params.mSchedule.size(); ++i) {
-                                    numberOfIntervals += params.mSchedule[i].first;
-                                }
-                                if (numberOfIntervals > 0) {
-                                    mPendingVendorRenderingTimeoutTasks.reserveSpace(
-                                            numberOfIntervals);
-                                    for (int i = 0; i < params.mSchedule.size(); ++i) {
-                                        uint32_t intervalNs = params.mSchedule[i].second;
-                                        for (int j = 0; j < params.mSchedule[i].first; ++j) {
-                                            mPendingVendorRenderingTimeoutTasks.addTask(
-                                                    whenFromNowNs);
-                                            whenFromNowNs += intervalNs;
-                                        }
-                                    }
-                                }
-                            } else {
-                                auto handleEvents = mPresentTimeoutEventHandler->getHandleEvents();
-                                if (!handleEvents.empty()) {
-                                    numberOfIntervals = handleEvents.size();
-                                    mPendingVendorRenderingTimeoutTasks.reserveSpace(
-                                            numberOfIntervals);
-                                    for (int i = 0; i < handleEvents.size(); ++i) {
-                                        mPendingVendorRenderingTimeoutTasks.addTask(
-                                                handleEvents[i].mWhenNs);
-                                    }
-                                }
-                            }
-                            if (numberOfIntervals > 0) {
-                                // Start from 1 since we will execute the first task immediately
-                                // below.
-                                mPendingVendorRenderingTimeoutTasks.nextTaskIndex = 1;
-                                handlePresentTimeout();
-                            }
-                        }
-                        break;
-                    }
-                    case VrrControllerEventType::kVendorRenderingTimeoutPost: {
-                        handlePresentTimeout();
-                        if (event.mFunctor) {
-                            event.mFunctor();
+                case VrrControllerEventType::kNotifyExpectedPresentConfig: {
+                    handleCadenceChange();
+                    break;
+                }
+                case VrrControllerEventType::kVendorRenderingTimeoutInit: {
+                    if (mPresentTimeoutEventHandler) {
+                        mPendingVendorRenderingTimeoutTasks.setSchedule(
+                                getVendorRenderingTimeoutScheduleLocked());
+                        if (!mPendingVendorRenderingTimeoutTasks.isDone()) {
+                            // Start from 1 since we will execute the first task immediately
+                            // below.
+                            mPendingVendorRenderingTimeoutTasks.nextTaskIndex = 1;
+                            handlePresentTimeout();
                         }
-                        break;
                     }
-                    default: {
-                        break;
+                    break;
+                }
+                case VrrControllerEventType::kVendorRenderingTimeoutPost: {
+                    handlePresentTimeout();
+                    if (event.mFunctor) {
+                        event.mFunctor();
                     }
+                    break;
                 }
-            } else {
-                if (event.mEventType == VrrControllerEventType::kSystemRenderingTimeout) {
-                    LOG(ERROR) << "VrrController: receiving a rendering timeout event while in the "
-                                  "hibernate state.";
+                default: {
+                    break;
                 }
-                if (mState != VrrControllerState::kHibernate) {
-                    LOG(ERROR) << "VrrController: expecting to be in hibernate, but instead in "
-                                  "state = "
-                               << getStateName(mState);
+            }
+        } else {
+            if (event.mEventType == VrrControllerEventType::kSystemRenderingTimeout) {
+                LOG(ERROR) << "VrrController: receiving a rendering timeout event while in the "
+                              "hibernate state.";
+            }
+            if (mState != VrrControllerState::kHibernate) {
+                LOG(ERROR) << "VrrController: expecting to be in hibernate, but instead in "
+                              "state = "
+                           << getStateName(mState);
+            }
+            switch (event.mEventType) {
+                case VrrControllerEventType::kHibernateTimeout: {
+                    handleStayHibernate();
+                    break;
                 }
-                switch (event.mEventType) {
-                    case VrrControllerEventType::kHibernateTimeout: {
-                        handleStayHibernate();
-                        break;
-                    }
-                    case VrrControllerEventType::kNotifyExpectedPresentConfig: {
-                        handleResume();
-                        mState = VrrControllerState::kRendering;
-                        stateChanged = true;
-                        break;
-                    }
-                    default: {
-                        break;
-                    }
+                case VrrControllerEventType::kNotifyExpectedPresentConfig: {
+                    handleResume();
+                    mState = VrrControllerState::kRendering;
+                    stateChanged = true;
+                    break;
+                }
+                default: {
+                    break;
                 }
             }
         }
-        // TODO(b/309873055): implement a handler to serialize all outer function calls to the same
-        // thread owned by the VRR controller.
-        if (stateChanged) {
-            updateVsyncHistory();
-        }
-        // Write pending values without holding mutex shared with HWC main thread.
-        if (frameRate) {
-            if (!mFileNode->writeValue(kFrameRateNodeName, frameRate)) {
-                LOG(ERROR) << "VrrController: write to node = " << kFrameRateNodeName
-                           << " failed, value = " << frameRate;
-            }
-            ATRACE_INT("frameRate", frameRate);
+    }
+    // TODO(b/309873055): implement a handler to serialize all outer function calls to the same
+    // thread owned by the VRR controller.
+    if (stateChanged || presentFenceUpdate) {
+        updateVsyncHistory();
+    }
+    // Write pending values without holding mutex shared with HWC main thread.
+    if (frameRate) {
+        if (!mFileNode->writeValue(kFrameRateNodeName, frameRate)) {
+            LOG(ERROR) << "VrrController: write to node = " << kFrameRateNodeName
+                       << " failed, value = " << frameRate;
         }
+        ATRACE_INT("frameRate", frameRate);
+        ATRACE_INT("frameRateConfidence", frameRateConfidencePercentage);
+        ATRACE_INT64("frameRateJitterNs", frameRateJitterNs);
     }
+    return true;
 }
 
 void VariableRefreshRateController::postEvent(VrrControllerEventType type, int64_t when) {
@@ -1261,32 +1365,34 @@ void VariableRefreshRateController::postEvent(VrrControllerEventType type, Timed
 }
 
 void VariableRefreshRateController::updateVsyncHistory() {
-    int fence = -1;
+    std::deque<int> fences;
 
     {
         const std::lock_guard<std::mutex> lock(mMutex);
-        if (!mLastPresentFence.has_value()) {
+        fences = mPendingPresentFences.take();
+        if (fences.empty()) {
             return;
         }
-        fence = mLastPresentFence.value();
-        mLastPresentFence = std::nullopt;
     }
 
-    // Execute the following logic unlocked to enhance performance.
-    int64_t lastSignalTime = getLastFenceSignalTimeUnlocked(fence);
-    if (close(fence)) {
-        LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
-        return;
-    } else if (lastSignalTime == SIGNAL_TIME_PENDING || lastSignalTime == SIGNAL_TIME_INVALID) {
-        return;
-    }
+    // Query the fences unlocked to keep the present path from waiting on the controller's thread.
+    std::vector<int64_t> signalTimes =
+            PresentFenceQueue::harvest(fences, [this](int fence) {
+                return getLastFenceSignalTimeUnlocked(fence);
+            });
 
     {
-        // Acquire the mutex again to store the vsync record.
+        // Acquire the mutex again to store the vsync records.
         const std::lock_guard<std::mutex> lock(mMutex);
-        mRecord.mVsyncHistory
-                .next() = {.mType = VariableRefreshRateController::VsyncEvent::Type::kReleaseFence,
-                           .mTime = lastSignalTime};
+        for (auto signalTime : signalTimes) {
+            mRecord.mVsyncHistory.next() = {.mType = VsyncEvent::Type::kReleaseFence,
+                                            .mTime = signalTime};
+        }
+        // Fences queued meanwhile were presented later, they are kept behind the pending ones.
+        if (mPendingPresentFences.requeue(fences)) {
+            postEvent(VrrControllerEventType::kPresentFenceUpdate,
+                      getSteadyClockTimeNs() + mVrrConfigs[mVrrActiveConfig].vsyncPeriodNs);
+        }
     }
 }
 
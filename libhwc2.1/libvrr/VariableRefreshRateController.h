@@ -18,6 +18,7 @@
 
 #include <utils/Mutex.h>
 #include <condition_variable>
+#include <deque>
 #include <list>
 #include <map>
 #include <optional>
@@ -26,14 +27,18 @@
 
 #include "../libdevice/ExynosDisplay.h"
 #include "../libdevice/ExynosLayer.h"
+#include "AdaptivePresentTimeoutPolicy.h"
 #include "EventQueue.h"
 #include "ExternalEventHandlerLoader.h"
 #include "FileNode.h"
 #include "Power/DisplayStateResidencyWatcher.h"
+#include "PresentFenceQueue.h"
+#include "RefreshControlCommandQueue.h"
 #include "RefreshRateCalculator/RefreshRateCalculator.h"
 #include "RingBuffer.h"
 #include "Statistics/VariableRefreshRateStatistic.h"
 #include "Utils.h"
+#include "VariableRefreshRateDispatcher.h"
 #include "display/common/DisplayConfigurationOwner.h"
 #include "interface/DisplayContextProvider.h"
 #include "interface/VariableRefreshRateInterface.h"
@@ -43,7 +48,8 @@ namespace android::hardware::graphics::composer {
 class VariableRefreshRateController : public VsyncListener,
                                       public RefreshListener,
                                       public DisplayContextProvider,
-                                      public DisplayConfigurationsOwner {
+                                      public DisplayConfigurationsOwner,
+                                      public VariableRefreshRateDispatcher::Client {
 public:
     ~VariableRefreshRateController();
 
@@ -139,8 +145,8 @@ private:
     static constexpr int kDefaultRingBufferCapacity = 128;
     static constexpr int64_t kDefaultWakeUpTimeInPowerSaving =
             500 * (std::nano::den / std::milli::den); // 500 ms
-    static constexpr int64_t SIGNAL_TIME_PENDING = INT64_MAX;
-    static constexpr int64_t SIGNAL_TIME_INVALID = -1;
+    static constexpr int64_t SIGNAL_TIME_PENDING = PresentFenceQueue::kSignalTimePending;
+    static constexpr int64_t SIGNAL_TIME_INVALID = PresentFenceQueue::kSignalTimeInvalid;
 
     static constexpr int64_t kDefaultSystemPresentTimeoutNs =
             500 * (std::nano::den / std::milli::den); // 500 ms
@@ -150,6 +156,11 @@ private:
 
     static constexpr std::string_view kVendorDisplayPanelLibrary = "libdisplaypanel.so";
 
+    // When set, the controllers of all displays share the realtime thread of
+    // VariableRefreshRateDispatcher instead of running one thread each.
+    static constexpr const char* kSharedDispatcherPropName =
+            "vendor.display.vrr.shared_controller_thread";
+
     static constexpr int64_t kDefaultAheadOfTimeNs = 1000000; // 1 ms;
 
     enum class VrrControllerState {
@@ -158,40 +169,37 @@ private:
         kHibernate,
     };
 
+    // A frame insertion schedule, as the offsets of its tasks from the expected present time.
+    typedef std::vector<int64_t> VendorRenderingTimeoutSchedule;
+
     typedef struct PendingVendorRenderingTimeoutTasks {
         PendingVendorRenderingTimeoutTasks(VariableRefreshRateController* controller)
-              : host(controller), taskExecutionTimeNs(kDefaultMaximumNumberOfTasks, 0) {}
+              : host(controller) {}
 
-        void addTask(int64_t executionIntervalNs) {
-            taskExecutionTimeNs[numberOfTasks++] = baseTimeNs + executionIntervalNs;
+        void setSchedule(std::shared_ptr<const VendorRenderingTimeoutSchedule> newSchedule) {
+            schedule = std::move(newSchedule);
+            numberOfTasks = schedule ? schedule->size() : 0;
+            nextTaskIndex = 0;
         }
 
         void scheduleNextTask() {
             if (!isDone()) {
                 host->postEvent(VrrControllerEventType::kVendorRenderingTimeoutPost,
                                 std::max(getSteadyClockTimeNs(),
-                                         taskExecutionTimeNs[nextTaskIndex++] -
+                                         baseTimeNs + (*schedule)[nextTaskIndex++] -
                                                  kDefaultAheadOfTimeNs));
             }
         }
 
         bool isDone() const { return (numberOfTasks == nextTaskIndex); }
 
-        void reserveSpace(size_t size) {
-            if (size > taskExecutionTimeNs.size()) {
-                taskExecutionTimeNs.resize(size);
-            }
-        }
-
         void reset() { numberOfTasks = nextTaskIndex = 0; }
 
-        static constexpr size_t kDefaultMaximumNumberOfTasks = 10;
-
         VariableRefreshRateController* host;
         int64_t baseTimeNs = 0;
         int numberOfTasks = 0;
         int nextTaskIndex = 0;
-        std::vector<int64_t> taskExecutionTimeNs;
+        std::shared_ptr<const VendorRenderingTimeoutSchedule> schedule;
     } PendingVendorRenderingTimeoutTasks;
 
     typedef struct PresentEvent {
@@ -282,10 +290,24 @@ private:
 
     uint32_t getCurrentRefreshControlStateLocked() const;
 
+    // Refresh control commands are composed from the last command, which is the queued one if any,
+    // or else the last written one.
+    bool getLastRefreshControlCommandLocked(uint32_t& command) const;
+    // Queue |command| to be written by the controller's thread. Commands queued before it is
+    // flushed are coalesced into the last one.
+    void queueRefreshControlCommandLocked(uint32_t command);
+    // Write |command| immediately, superseding any queued command.
+    bool writeRefreshControlCommandLocked(uint32_t command);
+    // Write the queued command, unless the node already holds it.
+    void flushRefreshControlCommandLocked();
+
     int64_t getLastFenceSignalTimeUnlocked(int fd);
 
     int64_t getNextEventTimeLocked() const;
 
+    // The fixed timeout after the last present to hibernate, before any cadence is learned.
+    int64_t getSystemPresentTimeoutNsLocked();
+
     int getPresentFrameFlag() const {
         int flag = 0;
         // Is Yuv.
@@ -337,11 +359,27 @@ private:
 
     bool shouldHandleVendorRenderingTimeout() const;
 
+    // Return the frame insertion schedule of the active config and the present timeout override,
+    // built on first use and cached afterwards.
+    std::shared_ptr<const VendorRenderingTimeoutSchedule> getVendorRenderingTimeoutScheduleLocked();
+
+    void notifyEventLoop();
+
     void stopThread(bool exit);
 
     // The core function of the VRR controller thread.
     void threadBody();
 
+    // Implement interface VariableRefreshRateDispatcher::Client.
+    int64_t getNextEventTimeNs() override;
+    int64_t getLatestEventTimeNs(int64_t untilNs) override;
+    void dispatchEvents(int64_t deadlineNs) override;
+
+    // Handle the first event due by |deadlineNs|, return false if there is none.
+    bool dispatchNextEvent(int64_t deadlineNs);
+
+    // Record the signal time of the queued present fences in order. Only called on the
+    // controller's thread.
     void updateVsyncHistory();
 
     ExynosDisplay* mDisplay;
@@ -356,8 +394,16 @@ private:
     VrrControllerState mState;
     hwc2_config_t mVrrActiveConfig = -1;
     std::unordered_map<hwc2_config_t, VrrConfig_t> mVrrConfigs;
-    std::optional<int> mLastPresentFence;
+    // Present fences are duplicated in |onPresent|, the controller's thread harvests their signal
+    // time. The queue is cleared whenever its kPresentFenceUpdate event is dropped.
+    PresentFenceQueue mPendingPresentFences;
+    // Refresh control commands queued by the present path, written by the controller's thread.
+    // The queue is flushed whenever its kRefreshControlUpdate event runs or is dropped.
+    RefreshControlCommandQueue mPendingRefreshControlCommands;
     uint32_t mFrameRate = 0;
+    // How confident |mFrameRateReporter| was in |mFrameRate|, and the jitter it measured.
+    int mFrameRateConfidencePercentage = 0;
+    int64_t mFrameRateJitterNs = 0;
 
     std::shared_ptr<FileNode> mFileNode;
 
@@ -385,6 +431,9 @@ private:
 
     bool mEnabled = false;
     bool mThreadExit = false;
+    // Whether the events are dispatched by VariableRefreshRateDispatcher rather than by the
+    // controller's own thread. Set at creation only.
+    bool mUseSharedDispatcher = false;
 
     PresentTimeoutControllerType mDefaultPresentTimeoutController =
             PresentTimeoutControllerType::kSoftware;
@@ -405,6 +454,12 @@ private:
     std::vector<std::shared_ptr<RefreshRateChangeListener>> mRefreshRateChangeListeners;
 
     PendingVendorRenderingTimeoutTasks mPendingVendorRenderingTimeoutTasks;
+    // The cached frame insertion schedules of the current present timeout override, per config.
+    std::unordered_map<hwc2_config_t, std::shared_ptr<const VendorRenderingTimeoutSchedule>>
+            mVendorRenderingTimeoutSchedules;
+
+    // Adapts the hibernation and the frame insertion timeouts to the cadence of |mPresentHistory|.
+    AdaptivePresentTimeoutPolicy mPresentTimeoutPolicy;
 
     std::mutex mMutex;
     std::condition_variable mCondition;
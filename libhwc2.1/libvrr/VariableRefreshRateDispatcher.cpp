@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "VariableRefreshRateDispatcher.h"
+
+#include <android-base/logging.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "Utils.h"
+
+namespace android {
+
+ANDROID_SINGLETON_STATIC_INSTANCE(hardware::graphics::composer::VariableRefreshRateDispatcher);
+
+namespace hardware::graphics::composer {
+
+void VariableRefreshRateDispatcher::registerClient(Client* client) {
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        if (std::find(mClients.begin(), mClients.end(), client) != mClients.end()) {
+            return;
+        }
+        mClients.push_back(client);
+        mNotified = true;
+        if (!mThreadStarted) {
+            mThreadStarted = true;
+            std::thread thread = std::thread(&VariableRefreshRateDispatcher::threadBody, this);
+            int error = pthread_setname_np(thread.native_handle(), "VrrCtrl_Shared");
+            if (error != 0) {
+                LOG(WARNING) << "VrrDispatcher: Unable to set thread name, error = "
+                             << strerror(error);
+            }
+            thread.detach();
+        }
+    }
+    mCondition.notify_all();
+}
+
+void VariableRefreshRateDispatcher::unregisterClient(Client* client) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mClients.erase(std::remove(mClients.begin(), mClients.end(), client), mClients.end());
+    // The ongoing pass may still hold |client|.
+    mDispatchDoneCondition.wait(lock, [this]() { return !mDispatching; });
+}
+
+void VariableRefreshRateDispatcher::notify() {
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mNotified = true;
+    }
+    mCondition.notify_all();
+}
+
+int64_t VariableRefreshRateDispatcher::getWakeupTimeNs(
+        const std::vector<Client*>& clients, const std::vector<int64_t>& nextEventTimesNs) {
+    int64_t earliestNs = std::numeric_limits<int64_t>::max();
+    for (auto whenNs : nextEventTimesNs) {
+        if (whenNs >= 0) {
+            earliestNs = std::min(earliestNs, whenNs);
+        }
+    }
+    if (earliestNs == std::numeric_limits<int64_t>::max()) {
+        return earliestNs;
+    }
+    int64_t windowEndNs = earliestNs + kCoalescingWindowNs;
+    int64_t wakeupNs = earliestNs;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if ((nextEventTimesNs[i] >= 0) && (nextEventTimesNs[i] <= windowEndNs)) {
+            wakeupNs = std::max(wakeupNs, clients[i]->getLatestEventTimeNs(windowEndNs));
+        }
+    }
+    return wakeupNs;
+}
+
+void VariableRefreshRateDispatcher::threadBody() {
+    struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO)};
+    // Every client relies on this thread, so it keeps running without the realtime priority.
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+        LOG(ERROR) << "VrrDispatcher: fail to set scheduler to SCHED_FIFO.";
+    }
+    std::vector<Client*> clients;
+    std::vector<int64_t> nextEventTimesNs;
+    for (;;) {
+        {
+            const std::lock_guard<std::mutex> lock(mMutex);
+            mNotified = false;
+            mDispatching = true;
+            clients = mClients;
+        }
+        // Handle the events of every client due now.
+        int64_t deadlineNs = getSteadyClockTimeNs();
+        nextEventTimesNs.clear();
+        for (auto client : clients) {
+            client->dispatchEvents(deadlineNs);
+            nextEventTimesNs.push_back(client->getNextEventTimeNs());
+        }
+        int64_t wakeupNs = getWakeupTimeNs(clients, nextEventTimesNs);
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDispatching = false;
+        mDispatchDoneCondition.notify_all();
+        if (mNotified) {
+            continue;
+        }
+        if (wakeupNs == std::numeric_limits<int64_t>::max()) {
+            mCondition.wait(lock, [this]() { return mNotified; });
+        } else {
+            int64_t delayNs = wakeupNs - getSteadyClockTimeNs();
+            if (delayNs > 0) {
+                mCondition.wait_for(lock, std::chrono::nanoseconds(delayNs),
+                                    [this]() { return mNotified; });
+            }
+        }
+    }
+}
+
+} // namespace hardware::graphics::composer
+} // namespace android
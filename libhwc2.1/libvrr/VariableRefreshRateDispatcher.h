@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Singleton.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android::hardware::graphics::composer {
+
+// A single realtime thread servicing the event queues of several VRR controllers, instead of one
+// thread per display. Each client's events are still handled in order by the client itself; the
+// dispatcher only decides when to run them. Events are never handled before they are due: the
+// wakeup for the earliest event is instead delayed to the latest event of any client due within
+// |kCoalescingWindowNs| of it, so that they are all handled in the same wakeup.
+class VariableRefreshRateDispatcher : public Singleton<VariableRefreshRateDispatcher> {
+public:
+    class Client {
+    public:
+        virtual ~Client() = default;
+
+        // Return the time of the next event to handle, or a negative value if there is none.
+        virtual int64_t getNextEventTimeNs() = 0;
+
+        // Return the time of the latest event due by |untilNs|, or a negative value if there is
+        // none.
+        virtual int64_t getLatestEventTimeNs(int64_t untilNs) = 0;
+
+        // Handle the events due by |deadlineNs| in order.
+        virtual void dispatchEvents(int64_t deadlineNs) = 0;
+    };
+
+    VariableRefreshRateDispatcher() = default;
+    ~VariableRefreshRateDispatcher() = default;
+
+    void registerClient(Client* client);
+
+    // Once it returns, |client| is no longer called.
+    void unregisterClient(Client* client);
+
+    // Wake the dispatcher up to reevaluate the next event time of its clients.
+    void notify();
+
+private:
+    static constexpr int64_t kCoalescingWindowNs = 500000; // 500 us
+
+    // Return the time to wake up at for the events of |clients|, whose next event times are
+    // |nextEventTimesNs|, or INT64_MAX if there is none.
+    static int64_t getWakeupTimeNs(const std::vector<Client*>& clients,
+                                   const std::vector<int64_t>& nextEventTimesNs);
+
+    void threadBody();
+
+    std::vector<Client*> mClients;
+    bool mNotified = false;
+    bool mDispatching = false;
+    bool mThreadStarted = false;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::condition_variable mDispatchDoneCondition;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -40,6 +40,12 @@ enum class VrrControllerEventType {
     kNotifyExpectedPresentConfig = kGeneralEventMask + (1 << 4),
     kTestEvent = kGeneralEventMask + (1 << 5),
     kUpdateDbiFrameRate = kGeneralEventMask + (1 << 6),
+    // kPresentFenceUpdate harvests the signal time of queued present fences on the controller's
+    // thread, away from the present path.
+    kPresentFenceUpdate = kGeneralEventMask + (1 << 7),
+    // kRefreshControlUpdate writes the coalesced refresh control command on the controller's
+    // thread.
+    kRefreshControlUpdate = kGeneralEventMask + (1 << 8),
     kGeneralEventMax = kGeneralEventMask + (1 << 27),
     // General callback events.
     kCallbackEventMask = 0x20000000,
@@ -52,6 +58,7 @@ enum class VrrControllerEventType {
     kExitIdleRefreshRateCalculatorUpdate = kCallbackEventMask + (1 << 5),
     kStaticticUpdate = kCallbackEventMask + (1 << 6),
     kMinLockTimeForPeakRefreshRate = kCallbackEventMask + (1 << 7),
+    kCadenceFrameRateCalculatorUpdate = kCallbackEventMask + (1 << 8),
     kCallbackEventMax = kCallbackEventMask + (1 << 27),
     // Sensors, outer events...
 };
@@ -97,10 +104,16 @@ struct VrrControllerEvent {
                 return "kCombinedRefreshRateCalculatorUpdate";
             case VrrControllerEventType::kAodRefreshRateCalculatorUpdate:
                 return "kAodRefreshRateCalculatorUpdate";
+            case VrrControllerEventType::kCadenceFrameRateCalculatorUpdate:
+                return "kCadenceFrameRateCalculatorUpdate";
             case VrrControllerEventType::kStaticticUpdate:
                 return "kStaticticUpdate";
             case VrrControllerEventType::kMinLockTimeForPeakRefreshRate:
                 return "kMinLockTimeForPeakRefreshRate";
+            case VrrControllerEventType::kPresentFenceUpdate:
+                return "kPresentFenceUpdate";
+            case VrrControllerEventType::kRefreshControlUpdate:
+                return "kRefreshControlUpdate";
             default:
                 return "Unknown";
         }
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "AdaptivePresentTimeoutPolicy.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+constexpr int64_t kIdleThresholdNs = 500 * kMsNs;
+constexpr int64_t kFixedTimeoutNs = kIdleThresholdNs;
+constexpr size_t kWindowSize = 64;
+
+// The learned timeout computed from scratch over the last |kWindowSize| gaps.
+int64_t referenceTimeoutNs(const std::deque<int64_t>& window,
+                           const AdaptivePresentTimeoutParameters& params) {
+    std::vector<int64_t> intervals(window.begin(), window.end());
+    std::sort(intervals.begin(), intervals.end());
+    int64_t totalNs = 0;
+    for (auto intervalNs : intervals) {
+        totalNs += intervalNs;
+    }
+    int64_t coveredNs = 0;
+    size_t index = 0;
+    for (; index < intervals.size() - 1; ++index) {
+        coveredNs += intervals[index];
+        if (coveredNs * 100 >= totalNs * params.mCoveragePercentage) {
+            break;
+        }
+    }
+    int64_t learnedNs = intervals[index] * (100 + params.mMarginPercentage) / 100;
+    return std::min(kFixedTimeoutNs, std::max(learnedNs, params.mMinHibernateTimeoutNs));
+}
+
+TEST(AdaptivePresentTimeoutPolicyTest, KeepsFixedTimeoutUntilCadenceIsLearned) {
+    AdaptivePresentTimeoutParameters params;
+    AdaptivePresentTimeoutPolicy policy(params);
+    for (size_t i = 1; i < params.mMinNumberOfSamples; ++i) {
+        policy.onPresentInterval(200 * kMsNs, kIdleThresholdNs);
+        EXPECT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs), kFixedTimeoutNs);
+    }
+    policy.onPresentInterval(200 * kMsNs, kIdleThresholdNs);
+    EXPECT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs), 300 * kMsNs);
+}
+
+TEST(AdaptivePresentTimeoutPolicyTest, IgnoresIdleGaps) {
+    AdaptivePresentTimeoutParameters params;
+    AdaptivePresentTimeoutPolicy policy(params);
+    for (size_t i = 0; i < params.mMinNumberOfSamples; ++i) {
+        policy.onPresentInterval(200 * kMsNs, kIdleThresholdNs);
+    }
+    policy.onPresentInterval(kIdleThresholdNs, kIdleThresholdNs);
+    policy.onPresentInterval(0, kIdleThresholdNs);
+    EXPECT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs), 300 * kMsNs);
+}
+
+TEST(AdaptivePresentTimeoutPolicyTest, HibernateTimeoutStaysWithinBounds) {
+    AdaptivePresentTimeoutParameters params;
+    AdaptivePresentTimeoutPolicy policy(params);
+    for (size_t i = 0; i < kWindowSize; ++i) {
+        policy.onPresentInterval(8 * kMsNs, kIdleThresholdNs);
+    }
+    EXPECT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs), params.mMinHibernateTimeoutNs);
+    for (size_t i = 0; i < kWindowSize; ++i) {
+        policy.onPresentInterval(450 * kMsNs, kIdleThresholdNs);
+    }
+    EXPECT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs), kFixedTimeoutNs);
+
+    policy.reset();
+    EXPECT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs), kFixedTimeoutNs);
+}
+
+TEST(AdaptivePresentTimeoutPolicyTest, SlidingWindowMatchesSortedReference) {
+    AdaptivePresentTimeoutParameters params;
+    AdaptivePresentTimeoutPolicy policy(params);
+    std::deque<int64_t> window;
+    std::mt19937 generator(46);
+    // Few distinct values, so that ties between the evicted and the learned gaps are common.
+    std::uniform_int_distribution<int> vsyncs(1, 60);
+    std::uniform_int_distribution<int> pause(0, 9);
+
+    for (int i = 0; i < 5000; ++i) {
+        int64_t intervalNs = vsyncs(generator) * 8 * kMsNs / (pause(generator) == 0 ? 1 : 4);
+        policy.onPresentInterval(intervalNs, kIdleThresholdNs);
+        if (intervalNs >= kIdleThresholdNs) {
+            continue;
+        }
+        window.push_back(intervalNs);
+        if (window.size() > kWindowSize) {
+            window.pop_front();
+        }
+        if (window.size() >= params.mMinNumberOfSamples) {
+            ASSERT_EQ(policy.getHibernateTimeoutNs(kFixedTimeoutNs),
+                      referenceTimeoutNs(window, params))
+                    << i;
+        }
+        if (i == 2500) {
+            policy.reset();
+            window.clear();
+        }
+    }
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
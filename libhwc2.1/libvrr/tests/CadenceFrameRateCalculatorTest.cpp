@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "RefreshRateCalculator/CadenceFrameRateCalculator.h"
+#include "RefreshRateCalculator/RefreshRateCalculatorReplayer.h"
+#include "Utils.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+// Replays |frames| with a panel refreshing at |vsyncRate| and allowing up to |maxFrameRate|, and
+// keeps the calculator to inspect its last detection.
+class CadenceReplay {
+public:
+    CadenceReplay(int vsyncRate, int maxFrameRate)
+          : mReplayer([this, vsyncRate, maxFrameRate](
+                              EventQueue* eventQueue) -> std::shared_ptr<RefreshRateCalculator> {
+                mCalculator = std::make_shared<CadenceFrameRateCalculator>(eventQueue);
+                mCalculator->setVrrConfigAttributes(freqToDurationNs(vsyncRate),
+                                                    freqToDurationNs(maxFrameRate));
+                return mCalculator;
+            }) {}
+
+    ReplayResult replay(const std::vector<ReplayFrame>& frames) { return mReplayer.replay(frames); }
+
+    const CadenceFrameRateCalculator& calculator() const { return *mCalculator; }
+
+private:
+    RefreshRateCalculatorReplayer mReplayer;
+    std::shared_ptr<CadenceFrameRateCalculator> mCalculator;
+};
+
+void appendCadence(std::vector<ReplayFrame>& frames, const std::vector<int>& vsyncs,
+                   int64_t vsyncNs, int count) {
+    int64_t timeNs = frames.empty() ? 0 : frames.back().mPresentTimeNs;
+    for (int i = 0; i < count; ++i) {
+        timeNs += vsyncs[i % vsyncs.size()] * vsyncNs;
+        frames.push_back({timeNs, kIsYuv});
+    }
+}
+
+int lastRefreshRate(const ReplayResult& result) {
+    return result.mTimeline.empty() ? kDefaultInvalidRefreshRate
+                                    : result.mTimeline.back().mRefreshRate;
+}
+
+TEST(CadenceFrameRateCalculatorTest, Detects24FpsOn60HzPulldown) {
+    CadenceReplay replay(60, 60);
+    std::vector<ReplayFrame> frames;
+    appendCadence(frames, {3, 2}, freqToDurationNs(60), 48);
+    ReplayResult result = replay.replay(frames);
+
+    ASSERT_EQ(result.mTimeline.size(), 1u) << result.toString();
+    EXPECT_EQ(lastRefreshRate(result), 24);
+    EXPECT_EQ(replay.calculator().getCadenceLength(), 2);
+    EXPECT_EQ(replay.calculator().getConfidencePercentage(), 100);
+    EXPECT_EQ(replay.calculator().getJitterNs(), 0);
+}
+
+TEST(CadenceFrameRateCalculatorTest, Detects25FpsOn50Hz) {
+    CadenceReplay replay(50, 50);
+    std::vector<ReplayFrame> frames;
+    appendCadence(frames, {2}, freqToDurationNs(50), 50);
+    ReplayResult result = replay.replay(frames);
+
+    ASSERT_EQ(result.mTimeline.size(), 1u) << result.toString();
+    EXPECT_EQ(lastRefreshRate(result), 25);
+    EXPECT_EQ(replay.calculator().getConfidencePercentage(), 100);
+}
+
+TEST(CadenceFrameRateCalculatorTest, SwitchesBetween24And25Fps) {
+    CadenceReplay replay(120, 120);
+    const int64_t vsyncNs = freqToDurationNs(120);
+    std::vector<ReplayFrame> frames;
+    appendCadence(frames, {5}, vsyncNs, 48);
+    appendCadence(frames, {5, 5, 5, 5, 4}, vsyncNs, 50);
+    appendCadence(frames, {5}, vsyncNs, 48);
+    ReplayResult result = replay.replay(frames);
+
+    ASSERT_EQ(result.mTimeline.size(), 3u) << result.toString();
+    EXPECT_EQ(result.mTimeline[0].mRefreshRate, 24);
+    EXPECT_EQ(result.mTimeline[1].mRefreshRate, 25);
+    EXPECT_EQ(result.mTimeline[2].mRefreshRate, 24);
+}
+
+TEST(CadenceFrameRateCalculatorTest, SwitchesBetween48And50Fps) {
+    CadenceReplay replay(240, 120);
+    const int64_t vsyncNs = freqToDurationNs(240);
+    std::vector<ReplayFrame> frames;
+    appendCadence(frames, {5}, vsyncNs, 96);
+    appendCadence(frames, {5, 5, 5, 5, 4}, vsyncNs, 100);
+    appendCadence(frames, {5}, vsyncNs, 96);
+    ReplayResult result = replay.replay(frames);
+
+    ASSERT_EQ(result.mTimeline.size(), 3u) << result.toString();
+    EXPECT_EQ(result.mTimeline[0].mRefreshRate, 48);
+    EXPECT_EQ(result.mTimeline[1].mRefreshRate, 50);
+    EXPECT_EQ(result.mTimeline[2].mRefreshRate, 48);
+}
+
+TEST(CadenceFrameRateCalculatorTest, ReportsUncadencedContentWithoutThrashing) {
+    CadenceReplay replay(240, 120);
+    const int64_t vsyncNs = freqToDurationNs(240);
+    // A 30 fps game pacing its frames with up to 4 ms of jitter, so that each frame takes 7, 8 or
+    // 9 vsyncs of the panel with no repeating pattern.
+    std::mt19937 generator(50);
+    std::uniform_int_distribution<int64_t> jitterNs(-4 * kMillisecondToNanoSecond,
+                                                    4 * kMillisecondToNanoSecond);
+    std::vector<ReplayFrame> frames;
+    for (int i = 1; i <= 300; ++i) {
+        int64_t timeNs = i * freqToDurationNs(30) + jitterNs(generator);
+        frames.push_back({(timeNs + vsyncNs / 2) / vsyncNs * vsyncNs, 0});
+    }
+    ReplayResult result = replay.replay(frames);
+
+    ASSERT_FALSE(result.mTimeline.empty()) << result.toString();
+    for (const auto& change : result.mTimeline) {
+        EXPECT_NEAR(change.mRefreshRate, 30, 1) << result.toString();
+    }
+    // The hysteresis holds the reported rate while the estimate wanders around it.
+    EXPECT_LE(result.mTimeline.size(), 2u) << result.toString();
+    EXPECT_GE(replay.calculator().getConfidencePercentage(), 60);
+    EXPECT_EQ(replay.calculator().getCadenceLength(), 0);
+    EXPECT_GT(replay.calculator().getJitterNs(), 0);
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "RefreshRateCalculator/RefreshRateCalculatorFactory.h"
+#include "RefreshRateCalculator/RefreshRateCalculatorReplayer.h"
+#include "Utils.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = kMillisecondToNanoSecond;
+
+// The composition built by VariableRefreshRateController.
+std::vector<std::shared_ptr<RefreshRateCalculator>> buildControllerCalculators(
+        EventQueue* eventQueue) {
+    RefreshRateCalculatorFactory factory;
+    std::vector<std::shared_ptr<RefreshRateCalculator>> calculators;
+    calculators.emplace_back(
+            factory.BuildRefreshRateCalculator(eventQueue, RefreshRateCalculatorType::kAod));
+    calculators.emplace_back(
+            factory.BuildRefreshRateCalculator(eventQueue, RefreshRateCalculatorType::kExitIdle));
+    calculators.emplace_back(
+            factory.BuildRefreshRateCalculator(eventQueue,
+                                               RefreshRateCalculatorType::kVideoPlayback));
+    PeriodRefreshRateCalculatorParameters periodParams;
+    periodParams.mConfidencePercentage = 0;
+    calculators.emplace_back(factory.BuildRefreshRateCalculator(eventQueue, periodParams));
+    return calculators;
+}
+
+std::shared_ptr<RefreshRateCalculator> configure(std::shared_ptr<RefreshRateCalculator> calculator) {
+    calculator->setVrrConfigAttributes(freqToDurationNs(240), freqToDurationNs(120));
+    return calculator;
+}
+
+ReplayResult replay(const std::vector<ReplayFrame>& frames, bool fused) {
+    RefreshRateCalculatorReplayer replayer(
+            [fused](EventQueue* eventQueue) -> std::shared_ptr<RefreshRateCalculator> {
+                if (fused) {
+                    RefreshRateCalculatorFactory factory;
+                    return configure(
+                            factory.BuildRefreshRateCalculator(eventQueue,
+                                                               &buildControllerCalculators));
+                }
+                return configure(std::make_shared<CombinedRefreshRateCalculator>(
+                        buildControllerCalculators(eventQueue), 1, 120));
+            });
+    return replayer.replay(frames, 3000 * kMsNs);
+}
+
+void appendFrames(std::vector<ReplayFrame>& frames, int64_t intervalNs, int64_t durationNs,
+                  int flag = 0) {
+    int64_t startNs = frames.empty() ? 0 : frames.back().mPresentTimeNs;
+    for (int64_t timeNs = intervalNs; timeNs <= durationNs; timeNs += intervalNs) {
+        frames.push_back({startNs + timeNs, flag});
+    }
+}
+
+void appendCadence(std::vector<ReplayFrame>& frames, const std::vector<int>& vsyncs,
+                   int64_t vsyncNs, int count, int flag = 0) {
+    int64_t timeNs = frames.empty() ? 0 : frames.back().mPresentTimeNs;
+    for (int i = 0; i < count; ++i) {
+        timeNs += vsyncs[i % vsyncs.size()] * vsyncNs;
+        frames.push_back({timeNs, flag});
+    }
+}
+
+void expectEquivalent(const std::vector<ReplayFrame>& frames) {
+    ReplayResult unfused = replay(frames, false);
+    ReplayResult fused = replay(frames, true);
+
+    ASSERT_FALSE(unfused.mTimeline.empty());
+    ASSERT_EQ(fused.mTimeline.size(), unfused.mTimeline.size())
+            << "unfused\n" << unfused.toString() << "fused\n" << fused.toString();
+    for (size_t i = 0; i < unfused.mTimeline.size(); ++i) {
+        EXPECT_EQ(fused.mTimeline[i].mTimeNs, unfused.mTimeline[i].mTimeNs) << i;
+        EXPECT_EQ(fused.mTimeline[i].mRefreshRate, unfused.mTimeline[i].mRefreshRate) << i;
+    }
+    // The children's timers share a single event of the controller's queue.
+    EXPECT_LE(fused.mNumberOfEvents, unfused.mNumberOfEvents);
+}
+
+TEST(CombinedRefreshRateCalculatorTest, FusedMatchesUnfusedOnSteadyRates) {
+    std::vector<ReplayFrame> frames;
+    appendFrames(frames, freqToDurationNs(120), 2000 * kMsNs);
+    appendFrames(frames, freqToDurationNs(60), 2000 * kMsNs);
+    appendFrames(frames, freqToDurationNs(30), 2000 * kMsNs);
+    expectEquivalent(frames);
+}
+
+TEST(CombinedRefreshRateCalculatorTest, FusedMatchesUnfusedOnVideoCadence) {
+    std::vector<ReplayFrame> frames;
+    appendFrames(frames, freqToDurationNs(60), 1000 * kMsNs);
+    // 24 fps video on a 120 Hz panel, then 25 fps on a 60 Hz cadence.
+    appendCadence(frames, {5}, freqToDurationNs(120), 96, kIsYuv);
+    appendCadence(frames, {3, 2}, freqToDurationNs(60), 100, kIsYuv);
+    appendFrames(frames, freqToDurationNs(60), 1000 * kMsNs);
+    expectEquivalent(frames);
+}
+
+TEST(CombinedRefreshRateCalculatorTest, FusedMatchesUnfusedAcrossIdleAndDoze) {
+    std::vector<ReplayFrame> frames;
+    appendFrames(frames, freqToDurationNs(120), 500 * kMsNs);
+    // Idle long enough for the exit idle and period timers to fire.
+    frames.push_back({frames.back().mPresentTimeNs + 1500 * kMsNs, 0});
+    appendFrames(frames, freqToDurationNs(60), 500 * kMsNs);
+    appendFrames(frames, freqToDurationNs(30), 1000 * kMsNs, kPresentingWhenDoze);
+    frames.push_back({frames.back().mPresentTimeNs + 2000 * kMsNs, 0});
+    appendFrames(frames, freqToDurationNs(120), 500 * kMsNs);
+    expectEquivalent(frames);
+}
+
+TEST(CombinedRefreshRateCalculatorTest, FusedMatchesUnfusedOnRandomBursts) {
+    std::mt19937 generator(43);
+    std::uniform_int_distribution<int> vsyncs(1, 12);
+    std::uniform_int_distribution<int> burst(1, 40);
+    std::uniform_int_distribution<int> gapMs(50, 1500);
+    std::uniform_int_distribution<int> flag(0, 3);
+
+    std::vector<ReplayFrame> frames;
+    int64_t timeNs = 0;
+    for (int i = 0; i < 60; ++i) {
+        int frameFlag = (flag(generator) == 0) ? kIsYuv : 0;
+        for (int j = burst(generator); j > 0; --j) {
+            timeNs += vsyncs(generator) * freqToDurationNs(240);
+            frames.push_back({timeNs, frameFlag});
+        }
+        timeNs += gapMs(generator) * kMsNs;
+    }
+    expectEquivalent(frames);
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
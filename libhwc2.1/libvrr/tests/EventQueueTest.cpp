@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "EventQueue.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+// Counts how often the functor holding it is copied.
+struct CopyCounter {
+    explicit CopyCounter(int* copies) : mCopies(copies) {}
+    CopyCounter(const CopyCounter& other) : mCopies(other.mCopies) { ++*mCopies; }
+    CopyCounter(CopyCounter&&) = default;
+
+    int* mCopies;
+};
+
+void postTimedEvent(EventQueue& queue, int64_t whenNs, int* copies) {
+    TimedEvent event("test");
+    event.mIsRelativeTime = false;
+    event.mWhenNs = whenNs;
+    event.mFunctor = [counter = CopyCounter(copies)]() { return 0; };
+    queue.postEvent(VrrControllerEventType::kPresentFenceUpdate, event);
+}
+
+} // namespace
+
+TEST(EventQueueTest, LatestEventTimeWithoutDueEvents) {
+    EventQueue queue;
+    EXPECT_EQ(queue.getLatestEventTimeNs(100), -1);
+
+    queue.postEvent(VrrControllerEventType::kPresentFenceUpdate, 200);
+    EXPECT_EQ(queue.getLatestEventTimeNs(100), -1);
+}
+
+TEST(EventQueueTest, LatestEventTimeIsTheLastDueEvent) {
+    EventQueue queue;
+    for (int64_t whenNs : {300, 100, 500, 250, 120}) {
+        queue.postEvent(VrrControllerEventType::kPresentFenceUpdate, whenNs);
+    }
+
+    EXPECT_EQ(queue.getLatestEventTimeNs(100), 100);
+    EXPECT_EQ(queue.getLatestEventTimeNs(299), 250);
+    EXPECT_EQ(queue.getLatestEventTimeNs(1000), 500);
+    // The queue is left untouched.
+    EXPECT_EQ(queue.mPriorityQueue.size(), 5u);
+    EXPECT_EQ(queue.mPriorityQueue.top().mWhenNs, 100);
+}
+
+TEST(EventQueueTest, LatestEventTimeDoesNotCopyEvents) {
+    EventQueue queue;
+    int copies = 0;
+    for (int64_t whenNs : {100, 200, 300}) {
+        postTimedEvent(queue, whenNs, &copies);
+    }
+
+    copies = 0;
+    EXPECT_EQ(queue.getLatestEventTimeNs(250), 200);
+    EXPECT_EQ(copies, 0);
+}
+
+} // namespace android::hardware::graphics::composer
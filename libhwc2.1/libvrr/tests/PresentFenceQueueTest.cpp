@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+
+#include "PresentFenceQueue.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+// The write end of a pipe stands for a fence, the read end sees EOF once the queue closes it.
+class PipeFence {
+public:
+    PipeFence() {
+        int fds[2];
+        EXPECT_EQ(pipe2(fds, O_NONBLOCK), 0);
+        mReadFd = fds[0];
+        mWriteFd = fds[1];
+    }
+    ~PipeFence() { close(mReadFd); }
+
+    int fence() const { return mWriteFd; }
+
+    bool isClosed() const {
+        char c;
+        return read(mReadFd, &c, 1) == 0;
+    }
+
+private:
+    int mReadFd = -1;
+    int mWriteFd = -1;
+};
+
+class PresentFenceQueueTest : public ::testing::Test {
+protected:
+    PipeFence& createFence(int64_t signalTime = PresentFenceQueue::kSignalTimePending) {
+        mFences.emplace_back(std::make_unique<PipeFence>());
+        mSignalTimes[mFences.back()->fence()] = signalTime;
+        return *mFences.back();
+    }
+
+    void signal(const PipeFence& fence, int64_t signalTime) {
+        mSignalTimes[fence.fence()] = signalTime;
+    }
+
+    std::vector<int64_t> harvest(std::deque<int>& fences) {
+        return PresentFenceQueue::harvest(fences, [this](int fence) {
+            return mSignalTimes.at(fence);
+        });
+    }
+
+    std::vector<std::unique_ptr<PipeFence>> mFences;
+    std::map<int, int64_t> mSignalTimes;
+};
+
+TEST_F(PresentFenceQueueTest, SchedulesOneHarvestAtATime) {
+    PresentFenceQueue queue;
+    EXPECT_TRUE(queue.push(createFence().fence()));
+    EXPECT_FALSE(queue.push(createFence().fence()));
+    EXPECT_TRUE(queue.isHarvestPending());
+
+    std::deque<int> fences = queue.take();
+    EXPECT_EQ(fences.size(), 2u);
+    EXPECT_FALSE(queue.isHarvestPending());
+    EXPECT_TRUE(queue.push(createFence().fence()));
+
+    for (auto fence : fences) {
+        close(fence);
+    }
+}
+
+TEST_F(PresentFenceQueueTest, PushClosesOldestBeyondLimit) {
+    PresentFenceQueue queue;
+    for (size_t i = 0; i < PresentFenceQueue::kMaxFences + 2; i++) {
+        queue.push(createFence().fence());
+    }
+
+    EXPECT_EQ(queue.size(), PresentFenceQueue::kMaxFences);
+    EXPECT_TRUE(mFences[0]->isClosed());
+    EXPECT_TRUE(mFences[1]->isClosed());
+    for (size_t i = 2; i < mFences.size(); i++) {
+        EXPECT_FALSE(mFences[i]->isClosed()) << i;
+    }
+}
+
+TEST_F(PresentFenceQueueTest, HarvestStopsAtFirstPendingFence) {
+    PresentFenceQueue queue;
+    PipeFence& first = createFence(100);
+    PipeFence& invalid = createFence(PresentFenceQueue::kSignalTimeInvalid);
+    PipeFence& pending = createFence();
+    PipeFence& last = createFence(300);
+    queue.push(first.fence());
+    queue.push(invalid.fence());
+    queue.push(pending.fence());
+    queue.push(last.fence());
+
+    std::deque<int> fences = queue.take();
+    EXPECT_EQ(harvest(fences), std::vector<int64_t>{100});
+    EXPECT_TRUE(first.isClosed());
+    EXPECT_TRUE(invalid.isClosed());
+    EXPECT_FALSE(pending.isClosed());
+    EXPECT_FALSE(last.isClosed());
+    ASSERT_EQ(fences.size(), 2u);
+
+    // A fence presented meanwhile goes behind the fences left by the harvest
+    PipeFence& later = createFence(400);
+    EXPECT_TRUE(queue.push(later.fence()));
+    EXPECT_FALSE(queue.requeue(fences));
+    EXPECT_TRUE(fences.empty());
+
+    signal(pending, 200);
+    fences = queue.take();
+    EXPECT_EQ(harvest(fences), (std::vector<int64_t>{200, 300, 400}));
+    EXPECT_TRUE(pending.isClosed());
+    EXPECT_TRUE(last.isClosed());
+    EXPECT_TRUE(later.isClosed());
+}
+
+TEST_F(PresentFenceQueueTest, RequeueSchedulesHarvestAndKeepsLimit) {
+    PresentFenceQueue queue;
+    for (size_t i = 0; i < PresentFenceQueue::kMaxFences; i++) {
+        queue.push(createFence().fence());
+    }
+    std::deque<int> fences = queue.take();
+    EXPECT_TRUE(harvest(fences).empty());
+    EXPECT_TRUE(queue.requeue(fences));
+
+    fences = queue.take();
+    EXPECT_TRUE(harvest(fences).empty());
+    PipeFence& later = createFence();
+    EXPECT_TRUE(queue.push(later.fence()));
+    EXPECT_FALSE(queue.requeue(fences));
+
+    // The oldest fence makes room for the one presented meanwhile
+    EXPECT_EQ(queue.size(), PresentFenceQueue::kMaxFences);
+    EXPECT_TRUE(mFences[0]->isClosed());
+    EXPECT_FALSE(mFences[1]->isClosed());
+    EXPECT_FALSE(later.isClosed());
+}
+
+TEST_F(PresentFenceQueueTest, ClearClosesQueuedFences) {
+    PresentFenceQueue queue;
+    PipeFence& first = createFence();
+    PipeFence& second = createFence();
+    queue.push(first.fence());
+    queue.push(second.fence());
+
+    queue.clear();
+    EXPECT_TRUE(first.isClosed());
+    EXPECT_TRUE(second.isClosed());
+    EXPECT_EQ(queue.size(), 0u);
+    // The next present schedules a harvest again
+    EXPECT_FALSE(queue.isHarvestPending());
+    EXPECT_TRUE(queue.push(createFence().fence()));
+}
+
+TEST_F(PresentFenceQueueTest, DestructorClosesQueuedFences) {
+    PipeFence& fence = createFence();
+    {
+        PresentFenceQueue queue;
+        queue.push(fence.fence());
+    }
+    EXPECT_TRUE(fence.isClosed());
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
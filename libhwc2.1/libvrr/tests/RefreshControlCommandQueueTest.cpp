@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <vector>
+
+#include "RefreshControlCommandQueue.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+// Stands for the refresh control file node, and records every write it receives.
+class FakeRefreshControlNode {
+public:
+    RefreshControlCommandQueue::Writer writer() {
+        return [this](uint32_t command) {
+            mWrites.push_back(command);
+            if (mFailWrites) {
+                return false;
+            }
+            mLastWritten = command;
+            return true;
+        };
+    }
+
+    RefreshControlCommandQueue::LastWrittenGetter lastWrittenGetter() {
+        return [this](uint32_t& command) {
+            if (!mLastWritten) {
+                return false;
+            }
+            command = mLastWritten.value();
+            return true;
+        };
+    }
+
+    std::vector<uint32_t> mWrites;
+    std::optional<uint32_t> mLastWritten;
+    bool mFailWrites = false;
+};
+
+class RefreshControlCommandQueueTest : public ::testing::Test {
+protected:
+    FakeRefreshControlNode mNode;
+    RefreshControlCommandQueue mQueue{mNode.writer(), mNode.lastWrittenGetter()};
+};
+
+TEST_F(RefreshControlCommandQueueTest, CoalescesQueuedCommandsIntoLastOne) {
+    EXPECT_TRUE(mQueue.push(1));
+    EXPECT_FALSE(mQueue.push(2));
+    EXPECT_FALSE(mQueue.push(3));
+    EXPECT_TRUE(mNode.mWrites.empty());
+
+    mQueue.flush();
+    EXPECT_EQ(mNode.mWrites, std::vector<uint32_t>{3});
+    EXPECT_FALSE(mQueue.hasPendingCommand());
+
+    // A new flush has to be scheduled for the next command.
+    EXPECT_TRUE(mQueue.push(4));
+}
+
+TEST_F(RefreshControlCommandQueueTest, FlushSkipsCommandNodeAlreadyHolds) {
+    ASSERT_TRUE(mQueue.write(5));
+    mQueue.push(6);
+    mQueue.push(5);
+    mQueue.flush();
+    EXPECT_EQ(mNode.mWrites, std::vector<uint32_t>{5});
+    EXPECT_FALSE(mQueue.hasPendingCommand());
+}
+
+TEST_F(RefreshControlCommandQueueTest, FlushWithoutQueuedCommandDoesNotWrite) {
+    mQueue.flush();
+    mQueue.push(1);
+    mQueue.flush();
+    mQueue.flush();
+    EXPECT_EQ(mNode.mWrites, std::vector<uint32_t>{1});
+}
+
+TEST_F(RefreshControlCommandQueueTest, WriteSupersedesQueuedCommand) {
+    mQueue.push(1);
+    EXPECT_TRUE(mQueue.write(2));
+    EXPECT_FALSE(mQueue.hasPendingCommand());
+
+    // The dropped flush must not land the older command after the newer one.
+    mQueue.flush();
+    EXPECT_EQ(mNode.mWrites, std::vector<uint32_t>{2});
+}
+
+TEST_F(RefreshControlCommandQueueTest, LastCommandPrefersQueuedCommand) {
+    uint32_t command = 0;
+    EXPECT_FALSE(mQueue.getLastCommand(command));
+
+    mQueue.write(1);
+    ASSERT_TRUE(mQueue.getLastCommand(command));
+    EXPECT_EQ(command, 1u);
+
+    mQueue.push(2);
+    ASSERT_TRUE(mQueue.getLastCommand(command));
+    EXPECT_EQ(command, 2u);
+
+    mQueue.flush();
+    ASSERT_TRUE(mQueue.getLastCommand(command));
+    EXPECT_EQ(command, 2u);
+}
+
+TEST_F(RefreshControlCommandQueueTest, FailedFlushDoesNotKeepCommandQueued) {
+    mNode.mFailWrites = true;
+    mQueue.push(1);
+    mQueue.flush();
+    EXPECT_EQ(mNode.mWrites, std::vector<uint32_t>{1});
+    EXPECT_FALSE(mQueue.hasPendingCommand());
+    EXPECT_TRUE(mQueue.push(2));
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SnapshotBuffer.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+// Running totals shaped like the refresh statistics: the counters always add up to |mVersion|.
+struct Totals {
+    std::map<int, uint64_t> mCounters;
+    uint64_t mVersion = 0;
+
+    uint64_t sum() const {
+        uint64_t sum = 0;
+        for (const auto& [key, count] : mCounters) {
+            sum += count;
+        }
+        return sum;
+    }
+};
+
+TEST(SnapshotBufferTest, AcquireReturnsInitialValueBeforePublish) {
+    SnapshotBuffer<int> buffer(7);
+    EXPECT_EQ(buffer.acquire(), 7);
+}
+
+TEST(SnapshotBufferTest, AcquireReturnsLatestPublished) {
+    SnapshotBuffer<int> buffer(0);
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+    EXPECT_EQ(buffer.acquire(), 2);
+    // Nothing newer was published.
+    EXPECT_EQ(buffer.acquire(), 2);
+}
+
+TEST(SnapshotBufferTest, AcquiredSnapshotIsNotOverwrittenByWriter) {
+    SnapshotBuffer<int> buffer(0);
+    buffer.back() = 1;
+    buffer.publish();
+    const int& snapshot = buffer.acquire();
+    for (int i = 2; i < 10; ++i) {
+        buffer.back() = i;
+        buffer.publish();
+        EXPECT_EQ(snapshot, 1);
+    }
+    EXPECT_EQ(buffer.acquire(), 9);
+}
+
+TEST(SnapshotBufferTest, ConcurrentWriterAndReadersSeeConsistentSnapshots) {
+    constexpr uint64_t kNumberOfUpdates = 200000;
+    constexpr int kNumberOfReaders = 3;
+    constexpr int kNumberOfKeys = 32;
+
+    SnapshotBuffer<Totals> buffer;
+    // Readers are serialized among themselves, as VariableRefreshRateStatistic does with its
+    // mutex; the writer never takes it.
+    std::mutex readerMutex;
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> numberOfReads = 0;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kNumberOfReaders; ++i) {
+        readers.emplace_back([&]() {
+            uint64_t lastVersion = 0;
+            while (!done.load()) {
+                std::scoped_lock lock(readerMutex);
+                const auto& snapshot = buffer.acquire();
+                ASSERT_EQ(snapshot.sum(), snapshot.mVersion);
+                ASSERT_GE(snapshot.mVersion, lastVersion);
+                lastVersion = snapshot.mVersion;
+                ++numberOfReads;
+            }
+        });
+    }
+
+    Totals totals;
+    for (uint64_t version = 1; version <= kNumberOfUpdates; ++version) {
+        ++totals.mCounters[static_cast<int>(version * 7919 % kNumberOfKeys)];
+        totals.mVersion = version;
+        buffer.back() = totals;
+        buffer.publish();
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_GT(numberOfReads.load(), 0u);
+    std::scoped_lock lock(readerMutex);
+    EXPECT_EQ(buffer.acquire().mVersion, kNumberOfUpdates);
+    EXPECT_EQ(buffer.acquire().sum(), kNumberOfUpdates);
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "Utils.h"
+#include "VariableRefreshRateDispatcher.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kUsNs = 1000;
+constexpr int64_t kMsNs = 1000 * kUsNs;
+
+// A client with timed events that records when and in which dispatch pass each of them runs.
+class FakeClient : public VariableRefreshRateDispatcher::Client {
+public:
+    struct Run {
+        int64_t mEventTimeNs;
+        int64_t mRunTimeNs;
+        int mPass;
+    };
+
+    // The first registered client counts the passes for all of them.
+    FakeClient(std::atomic<int>& passes, bool countsPasses)
+          : mPasses(passes), mCountsPasses(countsPasses) {}
+
+    void post(int64_t whenNs) {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mPending.insert(whenNs);
+    }
+
+    bool waitForRuns(size_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mCondition.wait_for(lock, std::chrono::seconds(2),
+                                   [&]() { return mRuns.size() >= count; });
+    }
+
+    std::vector<Run> runs() {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mRuns;
+    }
+
+    int64_t getNextEventTimeNs() override {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mPending.empty() ? -1 : *mPending.begin();
+    }
+
+    int64_t getLatestEventTimeNs(int64_t untilNs) override {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mPending.upper_bound(untilNs);
+        return (it == mPending.begin()) ? -1 : *std::prev(it);
+    }
+
+    void dispatchEvents(int64_t deadlineNs) override {
+        int pass = mCountsPasses ? ++mPasses : mPasses.load();
+        int64_t nowNs = getSteadyClockTimeNs();
+        const std::lock_guard<std::mutex> lock(mMutex);
+        while (!mPending.empty() && (*mPending.begin() <= deadlineNs)) {
+            mRuns.push_back({*mPending.begin(), nowNs, pass});
+            mPending.erase(mPending.begin());
+        }
+        mCondition.notify_all();
+    }
+
+private:
+    std::atomic<int>& mPasses;
+    const bool mCountsPasses;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::multiset<int64_t> mPending;
+    std::vector<Run> mRuns;
+};
+
+class VariableRefreshRateDispatcherTest : public ::testing::Test {
+protected:
+    VariableRefreshRateDispatcherTest() : mFirst(mPasses, true), mSecond(mPasses, false) {
+        // The dispatcher thread never exits, so the dispatcher is never destroyed.
+        mDispatcher = new VariableRefreshRateDispatcher();
+        mDispatcher->registerClient(&mFirst);
+        mDispatcher->registerClient(&mSecond);
+    }
+
+    ~VariableRefreshRateDispatcherTest() {
+        mDispatcher->unregisterClient(&mFirst);
+        mDispatcher->unregisterClient(&mSecond);
+    }
+
+    void expectNotEarly(const std::vector<FakeClient::Run>& runs) {
+        for (const auto& run : runs) {
+            EXPECT_GE(run.mRunTimeNs, run.mEventTimeNs);
+        }
+    }
+
+    std::atomic<int> mPasses = 0;
+    FakeClient mFirst;
+    FakeClient mSecond;
+    VariableRefreshRateDispatcher* mDispatcher;
+};
+
+TEST_F(VariableRefreshRateDispatcherTest, NeverDispatchesEventsEarly) {
+    int64_t baseNs = getSteadyClockTimeNs() + 5 * kMsNs;
+    for (int64_t offsetNs : std::vector<int64_t>{0, 100 * kUsNs, 450 * kUsNs, 3 * kMsNs}) {
+        mFirst.post(baseNs + offsetNs);
+        mSecond.post(baseNs + offsetNs + 50 * kUsNs);
+    }
+    mDispatcher->notify();
+    ASSERT_TRUE(mFirst.waitForRuns(4));
+    ASSERT_TRUE(mSecond.waitForRuns(4));
+    expectNotEarly(mFirst.runs());
+    expectNotEarly(mSecond.runs());
+}
+
+TEST_F(VariableRefreshRateDispatcherTest, CoalescesEventsOfClientsWithinWindow) {
+    int64_t baseNs = getSteadyClockTimeNs() + 5 * kMsNs;
+    mFirst.post(baseNs);
+    mSecond.post(baseNs + 300 * kUsNs);
+    mDispatcher->notify();
+    ASSERT_TRUE(mFirst.waitForRuns(1));
+    ASSERT_TRUE(mSecond.waitForRuns(1));
+
+    auto first = mFirst.runs().front();
+    auto second = mSecond.runs().front();
+    EXPECT_EQ(first.mPass, second.mPass);
+    // The earlier event waits for the later one rather than the later one running early.
+    EXPECT_GE(first.mRunTimeNs, second.mEventTimeNs);
+    expectNotEarly({first, second});
+}
+
+TEST_F(VariableRefreshRateDispatcherTest, CoalescesEventsOfOneClientWithinWindow) {
+    int64_t baseNs = getSteadyClockTimeNs() + 5 * kMsNs;
+    mSecond.post(baseNs);
+    mSecond.post(baseNs + 200 * kUsNs);
+    mDispatcher->notify();
+    ASSERT_TRUE(mSecond.waitForRuns(2));
+
+    auto runs = mSecond.runs();
+    EXPECT_EQ(runs[0].mPass, runs[1].mPass);
+    expectNotEarly(runs);
+}
+
+TEST_F(VariableRefreshRateDispatcherTest, DoesNotDelayEventsBeyondWindow) {
+    int64_t baseNs = getSteadyClockTimeNs() + 5 * kMsNs;
+    mFirst.post(baseNs);
+    mSecond.post(baseNs + 20 * kMsNs);
+    mDispatcher->notify();
+    ASSERT_TRUE(mFirst.waitForRuns(1));
+    ASSERT_TRUE(mSecond.waitForRuns(1));
+
+    auto first = mFirst.runs().front();
+    auto second = mSecond.runs().front();
+    EXPECT_LT(first.mPass, second.mPass);
+    EXPECT_LT(first.mRunTimeNs, second.mEventTimeNs);
+    expectNotEarly({first, second});
+}
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
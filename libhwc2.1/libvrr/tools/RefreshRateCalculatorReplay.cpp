@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a recorded present trace through one of the refresh rate calculators and prints the
+// reported refresh rate timeline, detection latency and CPU cost.
+//
+// Usage: vrr_calculator_replay <trace> <instant|exit_idle|period|video|combined|aod|cadence>
+//                              [--tail_ms=N] [--measure_period_ms=N] [--confidence=N]
+//                              [--max_valid_ms=N] [--vsync_rate=N] [--max_frame_rate=N]
+//
+// With the type "cadence", --confidence sets the minimum confidence of a reported frame rate.
+//
+// With the type "hibernation", the trace is instead replayed through the fixed and the adaptive
+// present timeout policies of the VRR controller, and their hibernation behavior is compared.
+// Both insert frames on the vendor timeout, which is reported for reference.
+//
+// Usage: vrr_calculator_replay <trace> hibernation [--tail_ms=N] [--hibernate_timeout_ms=N]
+//                              [--frame_insertion_timeout_ms=N]
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../AdaptivePresentTimeoutPolicy.h"
+#include "../RefreshRateCalculator/RefreshRateCalculatorFactory.h"
+#include "../RefreshRateCalculator/RefreshRateCalculatorReplayer.h"
+
+using namespace android::hardware::graphics::composer;
+
+namespace {
+
+bool parseOption(const std::string& arg, const std::string& name, int64_t& value) {
+    const std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    value = std::stoll(arg.substr(prefix.size()));
+    return true;
+}
+
+struct PresentTimeoutResult {
+    int64_t mNumberOfHibernations = 0;
+    // Hibernations ended by a present rather than by the end of the trace.
+    int64_t mNumberOfExits = 0;
+    int64_t mHibernateTimeNs = 0;
+    int64_t mNumberOfFrameInsertions = 0;
+};
+
+PresentTimeoutResult replayPresentTimeout(const std::vector<ReplayFrame>& frames, int64_t tailNs,
+                                          int64_t hibernateTimeoutNs,
+                                          int64_t frameInsertionTimeoutNs, bool adaptive) {
+    PresentTimeoutResult result;
+    AdaptivePresentTimeoutPolicy policy;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        bool isLast = (i + 1 == frames.size());
+        if (adaptive && (i > 0)) {
+            policy.onPresentInterval(frames[i].mPresentTimeNs - frames[i - 1].mPresentTimeNs,
+                                     hibernateTimeoutNs);
+        }
+        int64_t gapNs =
+                isLast ? tailNs : (frames[i + 1].mPresentTimeNs - frames[i].mPresentTimeNs);
+        int64_t timeoutNs =
+                adaptive ? policy.getHibernateTimeoutNs(hibernateTimeoutNs) : hibernateTimeoutNs;
+        if (gapNs > timeoutNs) {
+            ++result.mNumberOfHibernations;
+            result.mHibernateTimeNs += gapNs - timeoutNs;
+            if (!isLast) {
+                ++result.mNumberOfExits;
+            }
+        }
+        // Frames are inserted every |frameInsertionTimeoutNs| until the next present.
+        if ((frameInsertionTimeoutNs > 0) && (gapNs > 0)) {
+            result.mNumberOfFrameInsertions += (gapNs - 1) / frameInsertionTimeoutNs;
+        }
+    }
+    return result;
+}
+
+void printPresentTimeoutResult(const std::string& name, const PresentTimeoutResult& result) {
+    std::cout << name << ": hibernations = " << result.mNumberOfHibernations
+              << ", exits = " << result.mNumberOfExits
+              << ", hibernate time = " << (result.mHibernateTimeNs / kMillisecondToNanoSecond)
+              << " ms, frame insertions = " << result.mNumberOfFrameInsertions << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <trace> <instant|exit_idle|period|video|combined|aod|cadence> [options]\n";
+        return 1;
+    }
+
+    int64_t tailMs = 1000;
+    int64_t measurePeriodMs = -1;
+    int64_t confidence = -1;
+    int64_t maxValidMs = -1;
+    int64_t vsyncRate = 240;
+    int64_t maxFrameRate = 120;
+    int64_t hibernateTimeoutMs = 500;
+    int64_t frameInsertionTimeoutMs = 33;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (!parseOption(arg, "tail_ms", tailMs) &&
+            !parseOption(arg, "measure_period_ms", measurePeriodMs) &&
+            !parseOption(arg, "confidence", confidence) &&
+            !parseOption(arg, "max_valid_ms", maxValidMs) &&
+            !parseOption(arg, "vsync_rate", vsyncRate) &&
+            !parseOption(arg, "max_frame_rate", maxFrameRate) &&
+            !parseOption(arg, "hibernate_timeout_ms", hibernateTimeoutMs) &&
+            !parseOption(arg, "frame_insertion_timeout_ms", frameInsertionTimeoutMs)) {
+            std::cerr << "Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file) {
+        std::cerr << "Cannot open trace " << argv[1] << "\n";
+        return 1;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::vector<ReplayFrame> frames;
+    if (!RefreshRateCalculatorReplayer::parseTrace(content.str(), frames)) {
+        std::cerr << "Malformed trace " << argv[1] << "\n";
+        return 1;
+    }
+
+    const std::string type = argv[2];
+    if (type == "hibernation") {
+        for (bool adaptive : {false, true}) {
+            printPresentTimeoutResult(adaptive ? "Adaptive" : "Fixed",
+                                      replayPresentTimeout(frames,
+                                                           tailMs * kMillisecondToNanoSecond,
+                                                           hibernateTimeoutMs *
+                                                                   kMillisecondToNanoSecond,
+                                                           frameInsertionTimeoutMs *
+                                                                   kMillisecondToNanoSecond,
+                                                           adaptive));
+        }
+        return 0;
+    }
+
+    RefreshRateCalculatorReplayer replayer([&](EventQueue* eventQueue)
+                                                   -> std::shared_ptr<RefreshRateCalculator> {
+        RefreshRateCalculatorFactory factory;
+        std::shared_ptr<RefreshRateCalculator> calculator;
+        if (type == "instant") {
+            calculator = (maxValidMs > 0)
+                    ? factory.BuildRefreshRateCalculator(eventQueue,
+                                                         maxValidMs * kMillisecondToNanoSecond)
+                    : factory.BuildRefreshRateCalculator(eventQueue,
+                                                         RefreshRateCalculatorType::kInstant);
+        } else if (type == "exit_idle") {
+            ExitIdleRefreshRateCalculatorParameters params;
+            if (maxValidMs > 0) params.mMaxValidTimeNs = maxValidMs * kMillisecondToNanoSecond;
+            calculator = factory.BuildRefreshRateCalculator(eventQueue, params);
+        } else if (type == "period") {
+            PeriodRefreshRateCalculatorParameters params;
+            if (measurePeriodMs > 0) {
+                params.mMeasurePeriodNs = measurePeriodMs * kMillisecondToNanoSecond;
+            }
+            if (confidence >= 0) params.mConfidencePercentage = confidence;
+            calculator = factory.BuildRefreshRateCalculator(eventQueue, params);
+        } else if (type == "video") {
+            VideoFrameRateCalculatorParameters params;
+            if (measurePeriodMs > 0) {
+                params.mPeriodParams.mMeasurePeriodNs = measurePeriodMs * kMillisecondToNanoSecond;
+            }
+            if (confidence >= 0) params.mPeriodParams.mConfidencePercentage = confidence;
+            calculator = factory.BuildRefreshRateCalculator(eventQueue, params);
+        } else if (type == "combined") {
+            calculator =
+                    factory.BuildRefreshRateCalculator(eventQueue,
+                                                       RefreshRateCalculatorType::kCombined);
+        } else if (type == "cadence") {
+            CadenceFrameRateCalculatorParameters params;
+            if (maxValidMs > 0) params.mMaxValidTimeNs = maxValidMs * kMillisecondToNanoSecond;
+            if (confidence >= 0) params.mMinConfidencePercentage = confidence;
+            calculator = factory.BuildRefreshRateCalculator(eventQueue, params);
+        } else if (type == "aod") {
+            calculator = factory.BuildRefreshRateCalculator(eventQueue,
+                                                            RefreshRateCalculatorType::kAod);
+        }
+        if (calculator) {
+            calculator->setVrrConfigAttributes(freqToDurationNs(vsyncRate),
+                                               freqToDurationNs(maxFrameRate));
+        }
+        return calculator;
+    });
+
+    auto result = replayer.replay(frames, tailMs * kMillisecondToNanoSecond);
+    if (result.mNumberOfPresents == 0 && !frames.empty()) {
+        std::cerr << "Unknown calculator type " << type << "\n";
+        return 1;
+    }
+    std::cout << result.toString();
+    return 0;
+}